@@ -0,0 +1,448 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/* NetworkManager -- Network link manager
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2008 - 2015 Red Hat, Inc.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include <gio/gio.h>
+
+#include "nm-dispatcher-scripts.h"
+
+static inline gboolean
+check_permissions (struct stat *s, uid_t owner, const char **out_error_msg)
+{
+	g_return_val_if_fail (s != NULL, FALSE);
+	g_return_val_if_fail (out_error_msg != NULL, FALSE);
+	g_return_val_if_fail (*out_error_msg == NULL, FALSE);
+
+	/* Only accept regular files */
+	if (!S_ISREG (s->st_mode)) {
+		*out_error_msg = "not a regular file.";
+		return FALSE;
+	}
+
+	/* Only accept files owned by root */
+	if (s->st_uid != owner) {
+		*out_error_msg = "not owned by root.";
+		return FALSE;
+	}
+
+	/* Only accept files not writable by group or other, and not SUID */
+	if (s->st_mode & (S_IWGRP | S_IWOTH | S_ISUID)) {
+		*out_error_msg = "writable by group or other, or set-UID.";
+		return FALSE;
+	}
+
+	/* Only accept files executable by the owner */
+	if (!(s->st_mode & S_IXUSR)) {
+		*out_error_msg = "not executable by owner.";
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+check_filename (const char *file_name)
+{
+	char *bad_suffixes[] = { "~", ".rpmsave", ".rpmorig", ".rpmnew", NULL };
+	char *tmp;
+	guint i;
+
+	/* File must not be a backup file, package management file, or start with '.' */
+
+	if (file_name[0] == '.')
+		return FALSE;
+	for (i = 0; bad_suffixes[i]; i++) {
+		if (g_str_has_suffix (file_name, bad_suffixes[i]))
+			return FALSE;
+	}
+	tmp = g_strrstr (file_name, ".dpkg-");
+	if (tmp && (tmp == strrchr (file_name, '.')))
+		return FALSE;
+	return TRUE;
+}
+
+/**
+ * nm_dispatcher_script_check:
+ * @path: the script
+ * @owner: the user the script must belong to
+ * @out_error_msg: (out): on failure, why the script may not be run
+ *
+ * Returns: whether @path may be run as a dispatcher script
+ */
+gboolean
+nm_dispatcher_script_check (const char *path, uid_t owner, const char **out_error_msg)
+{
+	struct stat st;
+
+	*out_error_msg = NULL;
+	if (stat (path, &st) != 0) {
+		*out_error_msg = g_strerror (errno);
+		return FALSE;
+	}
+	return check_permissions (&st, owner, out_error_msg);
+}
+
+/*****************************************************************************/
+
+/* The scripts of one directory, kept until the directory or its
+ * no-wait.d subdirectory changes. */
+struct _NMDispatcherScriptDir {
+	char *dirname;
+	uid_t owner;
+	GFileMonitor *monitor;
+	GFileMonitor *no_wait_monitor;
+	GPtrArray *scripts;  /* sorted list of NMDispatcherScript, NULL if stale */
+};
+
+static void
+script_free (gpointer ptr)
+{
+	NMDispatcherScript *script = ptr;
+
+	g_free (script->path);
+	g_slice_free (NMDispatcherScript, script);
+}
+
+static int
+script_cmp (gconstpointer a, gconstpointer b)
+{
+	const NMDispatcherScript *script_a = *((const NMDispatcherScript **) a);
+	const NMDispatcherScript *script_b = *((const NMDispatcherScript **) b);
+
+	return strcmp (script_a->path, script_b->path);
+}
+
+static void
+script_dir_changed (GFileMonitor *monitor,
+                    GFile *file,
+                    GFile *other_file,
+                    GFileMonitorEvent event_type,
+                    gpointer user_data)
+{
+	NMDispatcherScriptDir *script_dir = user_data;
+
+	if (script_dir->scripts)
+		g_debug ("Dispatcher directory '%s' changed", script_dir->dirname);
+	g_clear_pointer (&script_dir->scripts, g_ptr_array_unref);
+}
+
+static GFileMonitor *
+script_dir_monitor (NMDispatcherScriptDir *script_dir, const char *dirname)
+{
+	GFile *file;
+	GFileMonitor *monitor;
+
+	file = g_file_new_for_path (dirname);
+	monitor = g_file_monitor_directory (file, G_FILE_MONITOR_NONE, NULL, NULL);
+	g_object_unref (file);
+
+	if (monitor)
+		g_signal_connect (monitor, "changed", G_CALLBACK (script_dir_changed), script_dir);
+	return monitor;
+}
+
+static GPtrArray *
+script_dir_read (NMDispatcherScriptDir *script_dir)
+{
+	const char *dirname = script_dir->dirname;
+	GDir *dir;
+	const char *filename;
+	GPtrArray *scripts;
+	GError *error = NULL;
+	char *no_wait_dir;
+
+	if (!(dir = g_dir_open (dirname, 0, &error))) {
+		g_message ("Failed to open dispatcher directory '%s': (%d) %s",
+		           dirname, error->code, error->message);
+		g_error_free (error);
+		return NULL;
+	}
+
+	no_wait_dir = g_build_filename (dirname, NMD_NO_WAIT_SUBDIR, NULL);
+	scripts = g_ptr_array_new_with_free_func (script_free);
+	while ((filename = g_dir_read_name (dir))) {
+		char *path, *no_wait_path;
+		struct stat	st;
+		int err;
+		const char *err_msg = NULL;
+		NMDispatcherScript *script;
+
+		if (!check_filename (filename))
+			continue;
+
+		path = g_build_filename (dirname, filename, NULL);
+
+		err = stat (path, &st);
+		if (err)
+			g_warning ("Failed to stat '%s': %d", path, err);
+		else if (S_ISDIR (st.st_mode))
+			; /* silently skip. */
+		else if (!check_permissions (&st, script_dir->owner, &err_msg))
+			g_warning ("Cannot execute '%s': %s", path, err_msg);
+		else {
+			/* success */
+			script = g_slice_new0 (NMDispatcherScript);
+			script->path = path;
+			script->recheck = lstat (path, &st) != 0 || S_ISLNK (st.st_mode);
+
+			/* Scripts that also have an entry in no-wait.d are not
+			 * waited for before running the next one. */
+			no_wait_path = g_build_filename (no_wait_dir, filename, NULL);
+			script->wait = !g_file_test (no_wait_path, G_FILE_TEST_EXISTS);
+			g_free (no_wait_path);
+
+			g_ptr_array_add (scripts, script);
+			path = NULL;
+		}
+		g_free (path);
+	}
+	g_dir_close (dir);
+	g_free (no_wait_dir);
+
+	g_ptr_array_sort (scripts, script_cmp);
+	return scripts;
+}
+
+NMDispatcherScriptDir *
+nm_dispatcher_script_dir_new (const char *dirname, uid_t owner)
+{
+	NMDispatcherScriptDir *script_dir;
+
+	script_dir = g_slice_new0 (NMDispatcherScriptDir);
+	script_dir->dirname = g_strdup (dirname);
+	script_dir->owner = owner;
+	return script_dir;
+}
+
+void
+nm_dispatcher_script_dir_free (NMDispatcherScriptDir *script_dir)
+{
+	if (script_dir->monitor) {
+		g_signal_handlers_disconnect_by_data (script_dir->monitor, script_dir);
+		g_object_unref (script_dir->monitor);
+	}
+	if (script_dir->no_wait_monitor) {
+		g_signal_handlers_disconnect_by_data (script_dir->no_wait_monitor, script_dir);
+		g_object_unref (script_dir->no_wait_monitor);
+	}
+	if (script_dir->scripts)
+		g_ptr_array_unref (script_dir->scripts);
+	g_free (script_dir->dirname);
+	g_slice_free (NMDispatcherScriptDir, script_dir);
+}
+
+/**
+ * nm_dispatcher_script_dir_get_scripts:
+ * @script_dir: the directory
+ *
+ * Returns: (transfer full): the #NMDispatcherScript entries of the
+ *   directory, sorted by name, or %NULL if it cannot be read.  The
+ *   directory is only read again after it changed.
+ */
+GPtrArray *
+nm_dispatcher_script_dir_get_scripts (NMDispatcherScriptDir *script_dir)
+{
+	GPtrArray *scripts;
+	char *no_wait_dir;
+
+	if (script_dir->scripts)
+		return g_ptr_array_ref (script_dir->scripts);
+
+	/* Start watching before reading, so that no change can be missed */
+	if (!script_dir->monitor)
+		script_dir->monitor = script_dir_monitor (script_dir, script_dir->dirname);
+	if (!script_dir->no_wait_monitor) {
+		no_wait_dir = g_build_filename (script_dir->dirname, NMD_NO_WAIT_SUBDIR, NULL);
+		script_dir->no_wait_monitor = script_dir_monitor (script_dir, no_wait_dir);
+		g_free (no_wait_dir);
+	}
+
+	scripts = script_dir_read (script_dir);
+	if (scripts && script_dir->monitor && script_dir->no_wait_monitor)
+		script_dir->scripts = g_ptr_array_ref (scripts);
+	return scripts;
+}
+
+/*****************************************************************************/
+
+typedef struct {
+	char *lane;
+	gpointer item;
+} PendingItem;
+
+void
+nm_dispatcher_lanes_init (NMDispatcherLanes *lanes, guint max_running)
+{
+	lanes->pending = g_queue_new ();
+	lanes->running = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	lanes->num_running = 0;
+	lanes->max_running = MAX (max_running, 1);
+}
+
+void
+nm_dispatcher_lanes_clear (NMDispatcherLanes *lanes)
+{
+	PendingItem *pending;
+
+	while ((pending = g_queue_pop_head (lanes->pending))) {
+		g_free (pending->lane);
+		g_slice_free (PendingItem, pending);
+	}
+	g_clear_pointer (&lanes->pending, g_queue_free);
+	g_clear_pointer (&lanes->running, g_hash_table_destroy);
+}
+
+void
+nm_dispatcher_lanes_push (NMDispatcherLanes *lanes, const char *lane, gpointer item)
+{
+	PendingItem *pending;
+
+	pending = g_slice_new (PendingItem);
+	pending->lane = g_strdup (lane);
+	pending->item = item;
+	g_queue_push_tail (lanes->pending, pending);
+}
+
+/**
+ * nm_dispatcher_lanes_pop:
+ * @lanes: the lanes
+ *
+ * Returns: the oldest pending item that may start now, or %NULL.  Its lane
+ *   counts as running until nm_dispatcher_lanes_done() is called for it.
+ */
+gpointer
+nm_dispatcher_lanes_pop (NMDispatcherLanes *lanes)
+{
+	GHashTable *blocked;
+	GList *iter;
+	gpointer item = NULL;
+
+	if (lanes->num_running >= lanes->max_running)
+		return NULL;
+
+	/* A pending item also blocks the later items of its lane, so that
+	 * they cannot overtake it. */
+	blocked = g_hash_table_new (g_str_hash, g_str_equal);
+	for (iter = lanes->pending->head; iter; iter = iter->next) {
+		PendingItem *pending = iter->data;
+
+		if (   g_hash_table_contains (lanes->running, pending->lane)
+		    || g_hash_table_contains (blocked, pending->lane)) {
+			g_hash_table_add (blocked, pending->lane);
+			continue;
+		}
+
+		g_queue_delete_link (lanes->pending, iter);
+		g_hash_table_add (lanes->running, pending->lane);
+		lanes->num_running++;
+		item = pending->item;
+		g_slice_free (PendingItem, pending);
+		break;
+	}
+	g_hash_table_destroy (blocked);
+
+	return item;
+}
+
+void
+nm_dispatcher_lanes_done (NMDispatcherLanes *lanes, const char *lane)
+{
+	if (g_hash_table_remove (lanes->running, lane))
+		lanes->num_running--;
+	else
+		g_warn_if_reached ();
+}
+
+/*****************************************************************************/
+
+static int
+sort_asciibetically (gconstpointer a, gconstpointer b)
+{
+	const char *s1 = *(const char **)a;
+	const char *s2 = *(const char **)b;
+
+	return strcmp (s1, s2);
+}
+
+static int
+read_max_requests (const char *path, int max_requests)
+{
+	GKeyFile *kf;
+	GError *error = NULL;
+	int value;
+
+	kf = g_key_file_new ();
+	if (g_key_file_load_from_file (kf, path, G_KEY_FILE_NONE, NULL)) {
+		value = g_key_file_get_integer (kf, "dispatcher", "max-requests", &error);
+		if (!error)
+			max_requests = value;
+		g_clear_error (&error);
+	}
+	g_key_file_free (kf);
+	return max_requests;
+}
+
+/**
+ * nm_dispatcher_read_max_requests:
+ * @config_file: NetworkManager's configuration file
+ * @config_dir: NetworkManager's configuration directory
+ *
+ * Reads the "max-requests" key of the "dispatcher" section from @config_file
+ * and the *.conf files in @config_dir.  As for NetworkManager itself, the
+ * files in @config_dir are read in alphabetical order and override values
+ * from earlier files.
+ *
+ * Returns: the configured number of requests to run concurrently, or 0
+ *   if it is not set.
+ */
+int
+nm_dispatcher_read_max_requests (const char *config_file, const char *config_dir)
+{
+	GPtrArray *confs;
+	GDir *dir;
+	const char *name;
+	int max_requests;
+	guint i;
+
+	max_requests = read_max_requests (config_file, 0);
+
+	dir = g_dir_open (config_dir, 0, NULL);
+	if (!dir)
+		return MAX (max_requests, 0);
+
+	confs = g_ptr_array_new_with_free_func (g_free);
+	while ((name = g_dir_read_name (dir))) {
+		if (g_str_has_suffix (name, ".conf"))
+			g_ptr_array_add (confs, g_build_filename (config_dir, name, NULL));
+	}
+	g_dir_close (dir);
+
+	g_ptr_array_sort (confs, sort_asciibetically);
+	for (i = 0; i < confs->len; i++)
+		max_requests = read_max_requests (confs->pdata[i], max_requests);
+	g_ptr_array_free (confs, TRUE);
+
+	return MAX (max_requests, 0);
+}
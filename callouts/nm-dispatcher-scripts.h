@@ -0,0 +1,66 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/* NetworkManager -- Network link manager
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2015 Red Hat, Inc.
+ */
+
+#ifndef __NETWORKMANAGER_DISPATCHER_SCRIPTS_H__
+#define __NETWORKMANAGER_DISPATCHER_SCRIPTS_H__
+
+#include <sys/types.h>
+#include <glib.h>
+
+#define NMD_NO_WAIT_SUBDIR "no-wait.d"
+
+typedef struct {
+	char *path;
+	gboolean wait;     /* FALSE if listed in no-wait.d */
+	gboolean recheck;  /* a symlink, validate again before running it */
+} NMDispatcherScript;
+
+typedef struct _NMDispatcherScriptDir NMDispatcherScriptDir;
+
+/* @owner is the user scripts must belong to; root, except in tests */
+NMDispatcherScriptDir *nm_dispatcher_script_dir_new (const char *dirname, uid_t owner);
+void nm_dispatcher_script_dir_free (NMDispatcherScriptDir *script_dir);
+
+GPtrArray *nm_dispatcher_script_dir_get_scripts (NMDispatcherScriptDir *script_dir);
+
+gboolean nm_dispatcher_script_check (const char *path, uid_t owner, const char **out_error_msg);
+
+/*****************************************************************************/
+
+/* Runs items in order for each lane, and up to @max_running items of
+ * different lanes at the same time. */
+typedef struct {
+	GQueue *pending;
+	GHashTable *running;
+	guint num_running;
+	guint max_running;
+} NMDispatcherLanes;
+
+void     nm_dispatcher_lanes_init  (NMDispatcherLanes *lanes, guint max_running);
+void     nm_dispatcher_lanes_clear (NMDispatcherLanes *lanes);
+void     nm_dispatcher_lanes_push  (NMDispatcherLanes *lanes, const char *lane, gpointer item);
+gpointer nm_dispatcher_lanes_pop   (NMDispatcherLanes *lanes);
+void     nm_dispatcher_lanes_done  (NMDispatcherLanes *lanes, const char *lane);
+
+/*****************************************************************************/
+
+int nm_dispatcher_read_max_requests (const char *config_file, const char *config_dir);
+
+#endif  /* __NETWORKMANAGER_DISPATCHER_SCRIPTS_H__ */
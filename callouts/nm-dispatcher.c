@@ -34,10 +34,12 @@
 
 #include <glib.h>
 #include <glib-unix.h>
+#include <gio/gio.h>
 
 
 #include "nm-dispatcher-api.h"
 #include "nm-dispatcher-utils.h"
+#include "nm-dispatcher-scripts.h"
 #include "nm-glib-compat.h"
 
 #include "nmdbus-dispatcher.h"
@@ -45,6 +47,7 @@
 static GMainLoop *loop = NULL;
 static gboolean debug = FALSE;
 static gboolean persist = FALSE;
+static int max_requests = 0;
 static guint quit_id;
 
 typedef struct Request Request;
@@ -55,8 +58,7 @@ typedef struct {
 	/* Private data */
 	NMDBusDispatcher *dbus_dispatcher;
 
-	Request *current_request;
-	GQueue *pending_requests;
+	NMDispatcherLanes lanes;  /* requests, by interface name */
 } Handler;
 
 typedef struct {
@@ -91,7 +93,7 @@ handle_action (NMDBusDispatcher *dbus_dispatcher,
 static void
 handler_init (Handler *h)
 {
-	h->pending_requests = g_queue_new ();
+	nm_dispatcher_lanes_init (&h->lanes, max_requests);
 	h->dbus_dispatcher = nmdbus_dispatcher_skeleton_new ();
 	g_signal_connect (h->dbus_dispatcher, "handle-action",
 	                  G_CALLBACK (handle_action), h);
@@ -102,15 +104,20 @@ handler_class_init (HandlerClass *h_class)
 {
 }
 
-static void dispatch_one_script (Request *request);
+static void dispatch_scripts (Request *request);
 
 typedef struct {
 	Request *request;
 
 	char *script;
+	gboolean wait;
+	gboolean recheck;
 	GPid pid;
 	DispatchResult result;
 	char *error;
+
+	guint watch_id;
+	guint timeout_id;
 } ScriptInfo;
 
 struct Request {
@@ -124,9 +131,7 @@ struct Request {
 
 	GPtrArray *scripts;  /* list of ScriptInfo */
 	guint idx;
-
-	guint script_watch_id;
-	guint script_timeout_id;
+	guint num_scripts_running;
 };
 
 static void
@@ -147,6 +152,15 @@ request_free (Request *request)
 	g_strfreev (request->envp);
 	if (request->scripts)
 		g_ptr_array_free (request->scripts, TRUE);
+	g_free (request);
+}
+
+/* Requests for the same interface are run in order; requests for
+ * different interfaces may run concurrently. */
+static const char *
+request_lane (Request *request)
+{
+	return request->iface ? request->iface : "";
 }
 
 static gboolean
@@ -181,26 +195,23 @@ start_request (Request *request)
 	else
 		g_message ("Dispatching action '%s'", request->action);
 
-	request->handler->current_request = request;
-	dispatch_one_script (request);
+	dispatch_scripts (request);
 }
 
 static void
-next_request (Handler *h)
+schedule_requests (Handler *h)
 {
-	Request *request = g_queue_pop_head (h->pending_requests);
+	Request *request;
 
-	if (request) {
+	while ((request = nm_dispatcher_lanes_pop (&h->lanes)))
 		start_request (request);
-		return;
-	}
 
-	h->current_request = NULL;
-	quit_timeout_reschedule ();
+	if (!h->lanes.num_running)
+		quit_timeout_reschedule ();
 }
 
 static gboolean
-next_script (gpointer user_data)
+complete_request (gpointer user_data)
 {
 	Request *request = user_data;
 	Handler *h = request->handler;
@@ -208,13 +219,6 @@ next_script (gpointer user_data)
 	GVariant *ret;
 	guint i;
 
-	request->idx++;
-	if (request->idx < request->scripts->len) {
-		dispatch_one_script (request);
-		return FALSE;
-	}
-
-	/* All done */
 	g_variant_builder_init (&results, G_VARIANT_TYPE ("a(sus)"));
 	for (i = 0; i < request->scripts->len; i++) {
 		ScriptInfo *script = g_ptr_array_index (request->scripts, i);
@@ -234,12 +238,26 @@ next_script (gpointer user_data)
 		else
 			g_message ("Dispatch '%s' complete", request->action);
 	}
+
+	nm_dispatcher_lanes_done (&h->lanes, request_lane (request));
 	request_free (request);
 
-	next_request (h);
+	schedule_requests (h);
 	return FALSE;
 }
 
+static void
+script_finished (ScriptInfo *script)
+{
+	Request *request = script->request;
+
+	request->num_scripts_running--;
+	if (script->wait)
+		dispatch_scripts (request);
+	else if (request->idx == request->scripts->len && !request->num_scripts_running)
+		g_idle_add (complete_request, request);
+}
+
 static void
 script_watch_cb (GPid pid, gint status, gpointer user_data)
 {
@@ -248,9 +266,9 @@ script_watch_cb (GPid pid, gint status, gpointer user_data)
 
 	g_assert (pid == script->pid);
 
-	script->request->script_watch_id = 0;
-	g_source_remove (script->request->script_timeout_id);
-	script->request->script_timeout_id = 0;
+	script->watch_id = 0;
+	g_source_remove (script->timeout_id);
+	script->timeout_id = 0;
 
 	if (WIFEXITED (status)) {
 		err = WEXITSTATUS (status);
@@ -280,7 +298,7 @@ script_watch_cb (GPid pid, gint status, gpointer user_data)
 	}
 
 	g_spawn_close_pid (script->pid);
-	next_script (script->request);
+	script_finished (script);
 }
 
 static gboolean
@@ -288,9 +306,9 @@ script_timeout_cb (gpointer user_data)
 {
 	ScriptInfo *script = user_data;
 
-	g_source_remove (script->request->script_watch_id);
-	script->request->script_watch_id = 0;
-	script->request->script_timeout_id = 0;
+	g_source_remove (script->watch_id);
+	script->watch_id = 0;
+	script->timeout_id = 0;
 
 	g_warning ("Script '%s' took too long; killing it.", script->script);
 
@@ -305,73 +323,31 @@ again:
 	script->result = DISPATCH_RESULT_TIMEOUT;
 
 	g_spawn_close_pid (script->pid);
-	g_idle_add (next_script, script->request);
+	script_finished (script);
 	return FALSE;
 }
 
-static inline gboolean
-check_permissions (struct stat *s, const char **out_error_msg)
-{
-	g_return_val_if_fail (s != NULL, FALSE);
-	g_return_val_if_fail (out_error_msg != NULL, FALSE);
-	g_return_val_if_fail (*out_error_msg == NULL, FALSE);
-
-	/* Only accept regular files */
-	if (!S_ISREG (s->st_mode)) {
-		*out_error_msg = "not a regular file.";
-		return FALSE;
-	}
-
-	/* Only accept files owned by root */
-	if (s->st_uid != 0) {
-		*out_error_msg = "not owned by root.";
-		return FALSE;
-	}
-
-	/* Only accept files not writable by group or other, and not SUID */
-	if (s->st_mode & (S_IWGRP | S_IWOTH | S_ISUID)) {
-		*out_error_msg = "writable by group or other, or set-UID.";
-		return FALSE;
-	}
-
-	/* Only accept files executable by the owner */
-	if (!(s->st_mode & S_IXUSR)) {
-		*out_error_msg = "not executable by owner.";
-		return FALSE;
-	}
-
-	return TRUE;
-}
+#define SCRIPT_TIMEOUT 600  /* 10 minutes */
 
 static gboolean
-check_filename (const char *file_name)
+spawn_script (ScriptInfo *script)
 {
-	char *bad_suffixes[] = { "~", ".rpmsave", ".rpmorig", ".rpmnew", NULL };
-	char *tmp;
-	guint i;
+	Request *request = script->request;
+	GError *error = NULL;
+	gchar *argv[4];
 
-	/* File must not be a backup file, package management file, or start with '.' */
+	/* The cache only notices changes to the script directories, so
+	 * re-validate scripts that are symlinks before running them. */
+	if (script->recheck) {
+		const char *err_msg;
 
-	if (file_name[0] == '.')
-		return FALSE;
-	for (i = 0; bad_suffixes[i]; i++) {
-		if (g_str_has_suffix (file_name, bad_suffixes[i]))
+		if (!nm_dispatcher_script_check (script->script, 0, &err_msg)) {
+			script->error = g_strdup_printf ("Cannot execute '%s': %s", script->script, err_msg);
+			script->result = DISPATCH_RESULT_EXEC_FAILED;
+			g_warning ("%s", script->error);
 			return FALSE;
+		}
 	}
-	tmp = g_strrstr (file_name, ".dpkg-");
-	if (tmp && (tmp == strrchr (file_name, '.')))
-		return FALSE;
-	return TRUE;
-}
-
-#define SCRIPT_TIMEOUT 600  /* 10 minutes */
-
-static void
-dispatch_one_script (Request *request)
-{
-	GError *error = NULL;
-	gchar *argv[4];
-	ScriptInfo *script = g_ptr_array_index (request->scripts, request->idx);
 
 	argv[0] = script->script;
 	argv[1] = request->iface ? request->iface : "none";
@@ -379,76 +355,65 @@ dispatch_one_script (Request *request)
 	argv[3] = NULL;
 
 	if (request->debug)
-		g_message ("Running script '%s'", script->script);
+		g_message ("Running script '%s'%s", script->script, script->wait ? "" : " (no-wait)");
 
-	if (g_spawn_async ("/", argv, request->envp, G_SPAWN_DO_NOT_REAP_CHILD, NULL, request, &script->pid, &error)) {
-		request->script_watch_id = g_child_watch_add (script->pid, (GChildWatchFunc) script_watch_cb, script);
-		request->script_timeout_id = g_timeout_add_seconds (SCRIPT_TIMEOUT, script_timeout_cb, script);
-	} else {
+	if (!g_spawn_async ("/", argv, request->envp, G_SPAWN_DO_NOT_REAP_CHILD, NULL, request, &script->pid, &error)) {
 		g_warning ("Failed to execute script '%s': (%d) %s",
 		           script->script, error->code, error->message);
 		script->result = DISPATCH_RESULT_EXEC_FAILED;
 		script->error = g_strdup (error->message);
 		g_clear_error (&error);
+		return FALSE;
+	}
 
-		/* Try the next script */
-		g_idle_add (next_script, request);
+	script->watch_id = g_child_watch_add (script->pid, (GChildWatchFunc) script_watch_cb, script);
+	script->timeout_id = g_timeout_add_seconds (SCRIPT_TIMEOUT, script_timeout_cb, script);
+	request->num_scripts_running++;
+	return TRUE;
+}
+
+static void
+dispatch_scripts (Request *request)
+{
+	ScriptInfo *script;
+
+	/* Start scripts in order until one has to be waited for; no-wait
+	 * scripts keep running while the following ones are started. */
+	while (request->idx < request->scripts->len) {
+		script = g_ptr_array_index (request->scripts, request->idx++);
+		if (spawn_script (script) && script->wait)
+			return;
 	}
+
+	if (!request->num_scripts_running)
+		g_idle_add (complete_request, request);
 }
 
-static GSList *
+/*****************************************************************************/
+
+static GPtrArray *
 find_scripts (const char *str_action)
 {
-	GDir *dir;
-	const char *filename;
-	GSList *sorted = NULL;
-	GError *error = NULL;
-	const char *dirname;
+	static NMDispatcherScriptDir *script_dirs[3];
+	static const char *dirnames[] = {
+		NMD_SCRIPT_DIR_DEFAULT,
+		NMD_SCRIPT_DIR_PRE_UP,
+		NMD_SCRIPT_DIR_PRE_DOWN,
+	};
+	guint i;
 
 	if (   strcmp (str_action, NMD_ACTION_PRE_UP) == 0
 	    || strcmp (str_action, NMD_ACTION_VPN_PRE_UP) == 0)
-		dirname = NMD_SCRIPT_DIR_PRE_UP;
+		i = 1;
 	else if (   strcmp (str_action, NMD_ACTION_PRE_DOWN) == 0
 	         || strcmp (str_action, NMD_ACTION_VPN_PRE_DOWN) == 0)
-		dirname = NMD_SCRIPT_DIR_PRE_DOWN;
+		i = 2;
 	else
-		dirname = NMD_SCRIPT_DIR_DEFAULT;
-
-	if (!(dir = g_dir_open (dirname, 0, &error))) {
-		g_message ("Failed to open dispatcher directory '%s': (%d) %s",
-		           dirname, error->code, error->message);
-		g_error_free (error);
-		return NULL;
-	}
-
-	while ((filename = g_dir_read_name (dir))) {
-		char *path;
-		struct stat	st;
-		int err;
-		const char *err_msg = NULL;
-
-		if (!check_filename (filename))
-			continue;
-
-		path = g_build_filename (dirname, filename, NULL);
+		i = 0;
 
-		err = stat (path, &st);
-		if (err)
-			g_warning ("Failed to stat '%s': %d", path, err);
-		else if (S_ISDIR (st.st_mode))
-			; /* silently skip. */
-		else if (!check_permissions (&st, &err_msg))
-			g_warning ("Cannot execute '%s': %s", path, err_msg);
-		else {
-			/* success */
-			sorted = g_slist_insert_sorted (sorted, path, (GCompareFunc) g_strcmp0);
-			path = NULL;
-		}
-		g_free (path);
-	}
-	g_dir_close (dir);
-
-	return sorted;
+	if (!script_dirs[i])
+		script_dirs[i] = nm_dispatcher_script_dir_new (dirnames[i], 0);
+	return nm_dispatcher_script_dir_get_scripts (script_dirs[i]);
 }
 
 static gboolean
@@ -469,19 +434,21 @@ handle_action (NMDBusDispatcher *dbus_dispatcher,
                gpointer user_data)
 {
 	Handler *h = user_data;
-	GSList *sorted_scripts = NULL;
-	GSList *iter;
+	GPtrArray *scripts;
 	Request *request;
 	char **p;
 	char *iface = NULL;
+	guint i;
 
-	sorted_scripts = find_scripts (str_action);
+	scripts = find_scripts (str_action);
 
-	if (!sorted_scripts) {
+	if (!scripts || !scripts->len) {
 		GVariant *results;
 
 		results = g_variant_new_array (G_VARIANT_TYPE ("(sus)"), NULL, 0);
 		g_dbus_method_invocation_return_value (context, g_variant_new ("(@a(sus))", results));
+		if (scripts)
+			g_ptr_array_unref (scripts);
 		return TRUE;
 	}
 
@@ -516,19 +483,21 @@ handle_action (NMDBusDispatcher *dbus_dispatcher,
 
 	request->iface = g_strdup (iface);
 
-	request->scripts = g_ptr_array_new_full (5, script_info_free);
-	for (iter = sorted_scripts; iter; iter = g_slist_next (iter)) {
+	request->scripts = g_ptr_array_new_full (scripts->len, script_info_free);
+	for (i = 0; i < scripts->len; i++) {
+		NMDispatcherScript *entry = g_ptr_array_index (scripts, i);
 		ScriptInfo *s = g_malloc0 (sizeof (*s));
+
 		s->request = request;
-		s->script = iter->data;
+		s->script = g_strdup (entry->path);
+		s->wait = entry->wait;
+		s->recheck = entry->recheck;
 		g_ptr_array_add (request->scripts, s);
 	}
-	g_slist_free (sorted_scripts);
+	g_ptr_array_unref (scripts);
 
-	if (h->current_request)
-		g_queue_push_tail (h->pending_requests, request);
-	else
-		start_request (request);
+	nm_dispatcher_lanes_push (&h->lanes, request_lane (request), request);
+	schedule_requests (h);
 
 	return TRUE;
 }
@@ -632,6 +601,7 @@ main (int argc, char **argv)
 	GOptionEntry entries[] = {
 		{ "debug", 0, 0, G_OPTION_ARG_NONE, &debug, "Output to console rather than syslog", NULL },
 		{ "persist", 0, 0, G_OPTION_ARG_NONE, &persist, "Don't quit after a short timeout", NULL },
+		{ "max-requests", 0, 0, G_OPTION_ARG_INT, &max_requests, "Number of requests for different interfaces to run concurrently (default: the 'max-requests' key of the [dispatcher] section of NetworkManager.conf, or 1)", "N" },
 		{ NULL }
 	};
 
@@ -647,6 +617,13 @@ main (int argc, char **argv)
 
 	g_option_context_free (opt_ctx);
 
+	/* The dispatcher is started by D-Bus activation, so the option is
+	 * rarely given; admins set the limit in NetworkManager.conf instead. */
+	if (max_requests < 1)
+		max_requests = nm_dispatcher_read_max_requests (NMCONFDIR "/NetworkManager.conf", NMCONFDIR "/conf.d");
+	if (max_requests < 1)
+		max_requests = 1;
+
 #if !GLIB_CHECK_VERSION (2, 35, 0)
 	g_type_init ();
 #endif
@@ -692,6 +669,7 @@ main (int argc, char **argv)
 	g_main_loop_run (loop);
 
 	g_queue_free (handler->pending_requests);
+	g_hash_table_destroy (handler->running_lanes);
 	g_object_unref (handler);
 
 	if (!debug)
@@ -0,0 +1,362 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2015 Red Hat, Inc.
+ *
+ */
+
+#include "config.h"
+
+#include <unistd.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+
+#include "nm-dispatcher-scripts.h"
+
+#include "nm-test-utils.h"
+
+/* Scripts must be owned by root; in the tests they belong to the user
+ * running them. */
+#define OWNER getuid ()
+
+static char *
+make_tmp_dir (void)
+{
+	char *dir;
+
+	dir = g_build_filename (g_get_tmp_dir (), "test-dispatcher-scripts-XXXXXX", NULL);
+	g_assert (g_mkdtemp (dir));
+	return dir;
+}
+
+static void
+remove_tmp_dir (const char *path)
+{
+	GDir *dir;
+	const char *name;
+	char *child;
+
+	dir = g_dir_open (path, 0, NULL);
+	g_assert (dir);
+	while ((name = g_dir_read_name (dir))) {
+		child = g_build_filename (path, name, NULL);
+		if (g_file_test (child, G_FILE_TEST_IS_DIR) && !g_file_test (child, G_FILE_TEST_IS_SYMLINK))
+			remove_tmp_dir (child);
+		else
+			g_assert_cmpint (g_unlink (child), ==, 0);
+		g_free (child);
+	}
+	g_dir_close (dir);
+	g_assert_cmpint (g_rmdir (path), ==, 0);
+}
+
+static char *
+write_script (const char *dir, const char *name)
+{
+	char *path;
+
+	path = g_build_filename (dir, name, NULL);
+	g_assert (g_file_set_contents (path, "#!/bin/sh\n", -1, NULL));
+	g_assert_cmpint (g_chmod (path, 0755), ==, 0);
+	return path;
+}
+
+static NMDispatcherScript *
+get_script (GPtrArray *scripts, guint idx)
+{
+	g_assert_cmpint (idx, <, scripts->len);
+	return g_ptr_array_index (scripts, idx);
+}
+
+static void
+assert_script (GPtrArray *scripts, guint idx, const char *name, gboolean wait, gboolean recheck)
+{
+	NMDispatcherScript *script = get_script (scripts, idx);
+	char *basename;
+
+	basename = g_path_get_basename (script->path);
+	g_assert_cmpstr (basename, ==, name);
+	g_assert_cmpint (script->wait, ==, wait);
+	g_assert_cmpint (script->recheck, ==, recheck);
+	g_free (basename);
+}
+
+/*******************************************/
+
+typedef struct {
+	NMDispatcherScriptDir *script_dir;
+	GPtrArray *scripts;
+	guint len;
+	guint no_wait_idx;
+} CacheWait;
+
+/* Whether the cache was refreshed, as seen by a new list with @len
+ * entries, or with entry @no_wait_idx not waited for. */
+static gboolean
+cache_refreshed (gpointer user_data)
+{
+	CacheWait *w = user_data;
+	GPtrArray *scripts;
+
+	scripts = nm_dispatcher_script_dir_get_scripts (w->script_dir);
+	g_assert (scripts);
+	if (scripts == w->scripts) {
+		g_ptr_array_unref (scripts);
+		return FALSE;
+	}
+	g_ptr_array_unref (w->scripts);
+	w->scripts = scripts;
+
+	if (w->len)
+		return scripts->len == w->len;
+	return !get_script (scripts, w->no_wait_idx)->wait;
+}
+
+static void
+test_cache_invalidation (void)
+{
+	char *tmp, *dir, *no_wait_dir, *path, *new_path;
+	CacheWait w = { 0 };
+	GPtrArray *scripts;
+
+	tmp = make_tmp_dir ();
+	dir = g_build_filename (tmp, "dispatcher.d", NULL);
+	no_wait_dir = g_build_filename (dir, NMD_NO_WAIT_SUBDIR, NULL);
+	g_assert_cmpint (g_mkdir_with_parents (no_wait_dir, 0755), ==, 0);
+
+	g_free (write_script (dir, "20-b"));
+	g_free (write_script (dir, "10-a"));
+	g_free (write_script (dir, "30-c~"));
+
+	/* Backup files and the no-wait.d directory are skipped */
+	w.script_dir = nm_dispatcher_script_dir_new (dir, OWNER);
+	w.scripts = nm_dispatcher_script_dir_get_scripts (w.script_dir);
+	g_assert (w.scripts);
+	g_assert_cmpint (w.scripts->len, ==, 2);
+	assert_script (w.scripts, 0, "10-a", TRUE, FALSE);
+	assert_script (w.scripts, 1, "20-b", TRUE, FALSE);
+
+	/* Unchanged directories are not read again */
+	scripts = nm_dispatcher_script_dir_get_scripts (w.script_dir);
+	g_assert (scripts == w.scripts);
+	g_ptr_array_unref (scripts);
+
+	/* A new script; it is moved into place so that the directory
+	 * never holds a script that is not executable yet. */
+	path = write_script (tmp, "15-new");
+	new_path = g_build_filename (dir, "15-new", NULL);
+	g_assert_cmpint (g_rename (path, new_path), ==, 0);
+	g_free (path);
+	g_free (new_path);
+
+	w.len = 3;
+	nmtst_main_context_wait_for (cache_refreshed, &w, "the new script");
+	assert_script (w.scripts, 0, "10-a", TRUE, FALSE);
+	assert_script (w.scripts, 1, "15-new", TRUE, FALSE);
+	assert_script (w.scripts, 2, "20-b", TRUE, FALSE);
+
+	/* A script listed in no-wait.d */
+	path = g_build_filename (no_wait_dir, "20-b", NULL);
+	g_assert_cmpint (symlink ("../20-b", path), ==, 0);
+	g_free (path);
+
+	w.len = 0;
+	w.no_wait_idx = 2;
+	nmtst_main_context_wait_for (cache_refreshed, &w, "the no-wait.d entry");
+	g_assert_cmpint (w.scripts->len, ==, 3);
+	assert_script (w.scripts, 0, "10-a", TRUE, FALSE);
+	assert_script (w.scripts, 1, "15-new", TRUE, FALSE);
+	assert_script (w.scripts, 2, "20-b", FALSE, FALSE);
+
+	g_ptr_array_unref (w.scripts);
+	nm_dispatcher_script_dir_free (w.script_dir);
+	remove_tmp_dir (tmp);
+	g_free (no_wait_dir);
+	g_free (dir);
+	g_free (tmp);
+}
+
+static void
+test_symlink_recheck (void)
+{
+	char *tmp, *dir, *target, *link;
+	NMDispatcherScriptDir *script_dir;
+	GPtrArray *scripts;
+	const char *err_msg;
+
+	tmp = make_tmp_dir ();
+	dir = g_build_filename (tmp, "dispatcher.d", NULL);
+	g_assert_cmpint (g_mkdir (dir, 0755), ==, 0);
+
+	g_free (write_script (dir, "10-plain"));
+	target = write_script (tmp, "target");
+	link = g_build_filename (dir, "20-link", NULL);
+	g_assert_cmpint (symlink (target, link), ==, 0);
+
+	/* Only symlinks are checked again before they are run */
+	script_dir = nm_dispatcher_script_dir_new (dir, OWNER);
+	scripts = nm_dispatcher_script_dir_get_scripts (script_dir);
+	g_assert (scripts);
+	g_assert_cmpint (scripts->len, ==, 2);
+	assert_script (scripts, 0, "10-plain", TRUE, FALSE);
+	assert_script (scripts, 1, "20-link", TRUE, TRUE);
+	g_ptr_array_unref (scripts);
+	nm_dispatcher_script_dir_free (script_dir);
+
+	g_assert (nm_dispatcher_script_check (link, OWNER, &err_msg));
+	g_assert (err_msg == NULL);
+
+	/* The target changes without the directory changing */
+	g_assert_cmpint (g_chmod (target, 0777), ==, 0);
+	g_assert (!nm_dispatcher_script_check (link, OWNER, &err_msg));
+	g_assert (err_msg);
+
+	g_assert_cmpint (g_chmod (target, 0755), ==, 0);
+	g_assert (nm_dispatcher_script_check (link, OWNER, &err_msg));
+
+	g_assert_cmpint (g_unlink (target), ==, 0);
+	g_assert (!nm_dispatcher_script_check (link, OWNER, &err_msg));
+	g_assert (err_msg);
+
+	remove_tmp_dir (tmp);
+	g_free (link);
+	g_free (target);
+	g_free (dir);
+	g_free (tmp);
+}
+
+/*******************************************/
+
+static void
+test_lanes_serial (void)
+{
+	NMDispatcherLanes lanes;
+
+	nm_dispatcher_lanes_init (&lanes, 1);
+
+	nm_dispatcher_lanes_push (&lanes, "eth0", "A");
+	nm_dispatcher_lanes_push (&lanes, "eth1", "B");
+	nm_dispatcher_lanes_push (&lanes, "eth0", "C");
+
+	g_assert_cmpstr (nm_dispatcher_lanes_pop (&lanes), ==, "A");
+	g_assert (nm_dispatcher_lanes_pop (&lanes) == NULL);
+	nm_dispatcher_lanes_done (&lanes, "eth0");
+
+	g_assert_cmpstr (nm_dispatcher_lanes_pop (&lanes), ==, "B");
+	g_assert (nm_dispatcher_lanes_pop (&lanes) == NULL);
+	nm_dispatcher_lanes_done (&lanes, "eth1");
+
+	g_assert_cmpstr (nm_dispatcher_lanes_pop (&lanes), ==, "C");
+	nm_dispatcher_lanes_done (&lanes, "eth0");
+
+	g_assert (nm_dispatcher_lanes_pop (&lanes) == NULL);
+	g_assert_cmpint (lanes.num_running, ==, 0);
+
+	nm_dispatcher_lanes_clear (&lanes);
+}
+
+static void
+test_lanes_concurrent (void)
+{
+	NMDispatcherLanes lanes;
+
+	nm_dispatcher_lanes_init (&lanes, 2);
+
+	nm_dispatcher_lanes_push (&lanes, "eth0", "A");
+	g_assert_cmpstr (nm_dispatcher_lanes_pop (&lanes), ==, "A");
+
+	nm_dispatcher_lanes_push (&lanes, "eth0", "B");
+	nm_dispatcher_lanes_push (&lanes, "eth1", "C");
+	nm_dispatcher_lanes_push (&lanes, "eth0", "D");
+
+	/* Another interface may overtake, the same one may not */
+	g_assert_cmpstr (nm_dispatcher_lanes_pop (&lanes), ==, "C");
+	g_assert (nm_dispatcher_lanes_pop (&lanes) == NULL);
+	g_assert_cmpint (lanes.num_running, ==, 2);
+
+	/* D must not overtake B */
+	nm_dispatcher_lanes_done (&lanes, "eth0");
+	g_assert_cmpstr (nm_dispatcher_lanes_pop (&lanes), ==, "B");
+	g_assert (nm_dispatcher_lanes_pop (&lanes) == NULL);
+
+	nm_dispatcher_lanes_done (&lanes, "eth0");
+	g_assert_cmpstr (nm_dispatcher_lanes_pop (&lanes), ==, "D");
+
+	nm_dispatcher_lanes_done (&lanes, "eth0");
+	nm_dispatcher_lanes_done (&lanes, "eth1");
+	g_assert_cmpint (lanes.num_running, ==, 0);
+
+	nm_dispatcher_lanes_clear (&lanes);
+}
+
+/*******************************************/
+
+static void
+test_max_requests (void)
+{
+	char *tmp, *main_file, *conf_dir, *path;
+
+	tmp = make_tmp_dir ();
+	main_file = g_build_filename (tmp, "NetworkManager.conf", NULL);
+	conf_dir = g_build_filename (tmp, "conf.d", NULL);
+
+	g_assert_cmpint (nm_dispatcher_read_max_requests (main_file, conf_dir), ==, 0);
+
+	g_assert (g_file_set_contents (main_file, "[dispatcher]\nmax-requests=2\n", -1, NULL));
+	g_assert_cmpint (nm_dispatcher_read_max_requests (main_file, conf_dir), ==, 2);
+
+	/* Files in conf.d override the main file, later ones earlier ones */
+	g_assert_cmpint (g_mkdir (conf_dir, 0755), ==, 0);
+	path = g_build_filename (conf_dir, "20-late.conf", NULL);
+	g_assert (g_file_set_contents (path, "[dispatcher]\nmax-requests=4\n", -1, NULL));
+	g_free (path);
+	path = g_build_filename (conf_dir, "10-early.conf", NULL);
+	g_assert (g_file_set_contents (path, "[dispatcher]\nmax-requests=3\n", -1, NULL));
+	g_free (path);
+	path = g_build_filename (conf_dir, "30-other.conf", NULL);
+	g_assert (g_file_set_contents (path, "[main]\ndns=none\n", -1, NULL));
+	g_free (path);
+	g_assert_cmpint (nm_dispatcher_read_max_requests (main_file, conf_dir), ==, 4);
+
+	/* Invalid values are ignored */
+	path = g_build_filename (conf_dir, "40-invalid.conf", NULL);
+	g_assert (g_file_set_contents (path, "[dispatcher]\nmax-requests=many\n", -1, NULL));
+	g_free (path);
+	g_assert_cmpint (nm_dispatcher_read_max_requests (main_file, conf_dir), ==, 4);
+
+	remove_tmp_dir (tmp);
+	g_free (conf_dir);
+	g_free (main_file);
+	g_free (tmp);
+}
+
+/*******************************************/
+
+NMTST_DEFINE ();
+
+int
+main (int argc, char **argv)
+{
+	nmtst_init (&argc, &argv, TRUE);
+
+	g_test_add_func ("/dispatcher/scripts/cache-invalidation", test_cache_invalidation);
+	g_test_add_func ("/dispatcher/scripts/symlink-recheck", test_symlink_recheck);
+	g_test_add_func ("/dispatcher/lanes/serial", test_lanes_serial);
+	g_test_add_func ("/dispatcher/lanes/concurrent", test_lanes_concurrent);
+	g_test_add_func ("/dispatcher/max-requests", test_max_requests);
+
+	return g_test_run ();
+}
@@ -751,6 +751,139 @@ _nmtst_assert_resolve_relative_path_equals (const char *f1, const char *f2, cons
 
 /*******************************************************************************/
 
+typedef gboolean (*NMTstConditionFunc) (gpointer user_data);
+
+inline static gboolean
+_nmtst_set_flag_cb (gpointer user_data)
+{
+	*((gboolean *) user_data) = TRUE;
+	return G_SOURCE_REMOVE;
+}
+
+inline static gboolean
+_nmtst_wakeup_cb (gpointer user_data)
+{
+	return G_SOURCE_CONTINUE;
+}
+
+/* Iterates the default main context until @condition returns %TRUE, and
+ * fails the test if that takes longer than 5 seconds.  @condition is also
+ * checked periodically, so it may poll state that no event source reports,
+ * like the contents of a file. */
+inline static void
+nmtst_main_context_wait_for (NMTstConditionFunc condition, gpointer user_data, const char *what)
+{
+	gboolean timed_out = FALSE;
+	guint timeout_id, wakeup_id;
+
+	timeout_id = g_timeout_add_seconds (5, _nmtst_set_flag_cb, &timed_out);
+	wakeup_id = g_timeout_add (10, _nmtst_wakeup_cb, NULL);
+	while (!condition (user_data)) {
+		if (timed_out)
+			g_error ("timed out waiting for %s", what);
+		g_main_context_iteration (NULL, TRUE);
+	}
+	g_source_remove (wakeup_id);
+	g_source_remove (timeout_id);
+}
+
+inline static gboolean
+_nmtst_flag_is_set (gpointer user_data)
+{
+	return *((gboolean *) user_data);
+}
+
+inline static void
+nmtst_main_context_wait_for_flag (gboolean *flag, const char *what)
+{
+	nmtst_main_context_wait_for (_nmtst_flag_is_set, flag, what);
+}
+
+/* Iterates the default main context for @timeout_ms. */
+inline static void
+nmtst_main_context_run (guint timeout_ms)
+{
+	gboolean timed_out = FALSE;
+
+	g_timeout_add (timeout_ms, _nmtst_set_flag_cb, &timed_out);
+	while (!timed_out)
+		g_main_context_iteration (NULL, TRUE);
+}
+
+/*******************************************************************************/
+
+/* A temporary directory for tests against a mock service, which appends a
+ * line for every request it handles to the file named by @env_var. */
+typedef struct {
+	char *dir;
+	char *log;
+} NMTstMockLog;
+
+inline static void
+nmtst_mock_log_init (NMTstMockLog *ml, const char *env_var)
+{
+	ml->dir = g_dir_make_tmp ("nmtst-mock-XXXXXX", NULL);
+	g_assert (ml->dir);
+	ml->log = g_build_filename (ml->dir, "log", NULL);
+	g_setenv (env_var, ml->log, TRUE);
+}
+
+/* Removes the log and the directory, which must otherwise be empty. */
+inline static void
+nmtst_mock_log_clear (NMTstMockLog *ml)
+{
+	unlink (ml->log);
+	rmdir (ml->dir);
+	g_clear_pointer (&ml->log, g_free);
+	g_clear_pointer (&ml->dir, g_free);
+}
+
+/* How often @line was logged by the mock */
+inline static guint
+nmtst_mock_log_count (NMTstMockLog *ml, const char *line)
+{
+	char *contents = NULL;
+	char **lines, **iter;
+	guint n = 0;
+
+	if (!g_file_get_contents (ml->log, &contents, NULL, NULL))
+		return 0;
+
+	lines = g_strsplit (contents, "\n", -1);
+	for (iter = lines; *iter; iter++) {
+		if (!strcmp (*iter, line))
+			n++;
+	}
+	g_strfreev (lines);
+	g_free (contents);
+	return n;
+}
+
+typedef struct {
+	NMTstMockLog *ml;
+	const char *line;
+	guint count;
+} _NMTstMockLogWait;
+
+inline static gboolean
+_nmtst_mock_log_has_lines (gpointer user_data)
+{
+	_NMTstMockLogWait *w = user_data;
+
+	return nmtst_mock_log_count (w->ml, w->line) >= w->count;
+}
+
+/* Waits until @line was logged at least @count times */
+inline static void
+nmtst_mock_log_wait (NMTstMockLog *ml, const char *line, guint count)
+{
+	_NMTstMockLogWait w = { ml, line, count };
+
+	nmtst_main_context_wait_for (_nmtst_mock_log_has_lines, &w, line);
+}
+
+/*******************************************************************************/
+
 #ifdef __NETWORKMANAGER_PLATFORM_H__
 
 inline static NMPlatformIP6Address *
@@ -1627,4 +1627,19 @@ nm_setting_connection_class_init (NMSettingConnectionClass *setting_class)
 		                    NM_METERED_UNKNOWN,
 		                    G_PARAM_READWRITE |
 		                    G_PARAM_STATIC_STRINGS));
+
+	/* Compared on the fields, as these are compared for every connection */
+#define ADD_FIELD(name, field) \
+	_nm_setting_class_add_field (parent_class, name, G_STRUCT_OFFSET (NMSettingConnectionPrivate, field))
+	ADD_FIELD (NM_SETTING_CONNECTION_ID, id);
+	ADD_FIELD (NM_SETTING_CONNECTION_UUID, uuid);
+	ADD_FIELD (NM_SETTING_CONNECTION_TYPE, type);
+	ADD_FIELD (NM_SETTING_CONNECTION_AUTOCONNECT, autoconnect);
+	ADD_FIELD (NM_SETTING_CONNECTION_AUTOCONNECT_PRIORITY, autoconnect_priority);
+	ADD_FIELD (NM_SETTING_CONNECTION_READ_ONLY, read_only);
+	ADD_FIELD (NM_SETTING_CONNECTION_ZONE, zone);
+	ADD_FIELD (NM_SETTING_CONNECTION_MASTER, master);
+	ADD_FIELD (NM_SETTING_CONNECTION_SLAVE_TYPE, slave_type);
+	ADD_FIELD (NM_SETTING_CONNECTION_GATEWAY_PING_TIMEOUT, gateway_ping_timeout);
+#undef ADD_FIELD
 }
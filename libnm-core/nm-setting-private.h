@@ -148,6 +148,10 @@ void _nm_setting_class_transform_property (NMSettingClass *setting_class,
                                            NMSettingPropertyTransformToFunc to_dbus,
                                            NMSettingPropertyTransformFromFunc from_dbus);
 
+void _nm_setting_class_add_field (NMSettingClass *setting_class,
+                                  const char *property_name,
+                                  gsize field_offset);
+
 gboolean _nm_setting_use_legacy_property (NMSetting *setting,
                                           GVariant *connection_dict,
                                           const char *legacy_property,
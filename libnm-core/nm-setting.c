@@ -80,6 +80,12 @@ enum {
 static GHashTable *registered_settings = NULL;
 static GHashTable *registered_settings_by_type = NULL;
 
+/* Setting types register themselves lazily from their get_type() function,
+ * which may happen on any thread (e.g. when settings plugins parse
+ * connections in parallel). */
+G_LOCK_DEFINE_STATIC (registered_settings);
+G_LOCK_DEFINE_STATIC (setting_properties);
+
 static gboolean
 _nm_gtype_equal (gconstpointer v1, gconstpointer v2)
 {
@@ -165,13 +171,19 @@ void
 
 	_ensure_registered ();
 
-	if (G_LIKELY ((info = g_hash_table_lookup (registered_settings, name)))) {
+	G_LOCK (registered_settings);
+	info = g_hash_table_lookup (registered_settings, name);
+	if (G_LIKELY (info)) {
+		G_UNLOCK (registered_settings);
 		g_return_if_fail (info->type == type);
 		g_return_if_fail (info->priority == priority);
 		g_return_if_fail (g_strcmp0 (info->name, name) == 0);
 		return;
 	}
-	g_return_if_fail (g_hash_table_lookup (registered_settings_by_type, &type) == NULL);
+	if (g_hash_table_lookup (registered_settings_by_type, &type)) {
+		G_UNLOCK (registered_settings);
+		g_return_if_reached ();
+	}
 
 	if (priority == 0)
 		g_assert_cmpstr (name, ==, NM_SETTING_CONNECTION_SETTING_NAME);
@@ -182,13 +194,20 @@ void
 	info->name = name;
 	g_hash_table_insert (registered_settings, (void *) info->name, info);
 	g_hash_table_insert (registered_settings_by_type, &info->type, info);
+	G_UNLOCK (registered_settings);
 }
 
 static const SettingInfo *
 _nm_setting_lookup_setting_by_type (GType type)
 {
+	const SettingInfo *info;
+
 	_ensure_registered ();
-	return g_hash_table_lookup (registered_settings_by_type, &type);
+
+	G_LOCK (registered_settings);
+	info = g_hash_table_lookup (registered_settings_by_type, &type);
+	G_UNLOCK (registered_settings);
+	return info;
 }
 
 static guint32
@@ -248,7 +267,9 @@ nm_setting_lookup_type (const char *name)
 
 	_ensure_registered ();
 
+	G_LOCK (registered_settings);
 	info = g_hash_table_lookup (registered_settings, name);
+	G_UNLOCK (registered_settings);
 	return info ? info->type : G_TYPE_INVALID;
 }
 
@@ -305,10 +326,16 @@ typedef struct {
 
 	NMSettingPropertyTransformToFunc to_dbus;
 	NMSettingPropertyTransformFromFunc from_dbus;
+
+	/* Where the value lives in the private struct of the owning class, for
+	 * reading it without a GValue copy; see _nm_setting_class_add_field(). */
+	gboolean has_field;
+	gsize field_offset;
 } NMSettingProperty;
 
 static GQuark setting_property_overrides_quark;
 static GQuark setting_properties_quark;
+static GQuark setting_properties_index_quark;
 
 static NMSettingProperty *
 find_property (GArray *properties, const char *name)
@@ -328,7 +355,7 @@ find_property (GArray *properties, const char *name)
 	return NULL;
 }
 
-static void
+static NMSettingProperty *
 add_property_override (NMSettingClass *setting_class,
                        const char *property_name,
                        GParamSpec *param_spec,
@@ -344,7 +371,7 @@ add_property_override (NMSettingClass *setting_class,
 	GArray *overrides;
 	NMSettingProperty override;
 
-	g_return_if_fail (g_type_get_qdata (setting_type, setting_properties_quark) == NULL);
+	g_return_val_if_fail (g_type_get_qdata (setting_type, setting_properties_quark) == NULL, NULL);
 
 	memset (&override, 0, sizeof (override));
 	override.name = property_name;
@@ -362,9 +389,10 @@ add_property_override (NMSettingClass *setting_class,
 		overrides = g_array_new (FALSE, FALSE, sizeof (NMSettingProperty));
 		g_type_set_qdata (setting_type, setting_property_overrides_quark, overrides);
 	}
-	g_return_if_fail (find_property (overrides, property_name) == NULL);
+	g_return_val_if_fail (find_property (overrides, property_name) == NULL, NULL);
 
 	g_array_append_val (overrides, override);
+	return &g_array_index (overrides, NMSettingProperty, overrides->len - 1);
 }
 
 /**
@@ -488,6 +516,44 @@ _nm_setting_class_transform_property (NMSettingClass *setting_class,
 	                       to_dbus, from_dbus);
 }
 
+/**
+ * _nm_setting_class_add_field:
+ * @setting_class: the setting class
+ * @property_name: the name of the property
+ * @field_offset: the offset of the property's field in the private struct
+ *   of @setting_class
+ *
+ * Indicates that the #GObject property named @property_name on
+ * @setting_class is a plain string, boolean or integer field of its private
+ * struct, which its getter returns unchanged. nm_setting_compare() then reads
+ * the field directly instead of copying it out with g_object_get_property().
+ */
+void
+_nm_setting_class_add_field (NMSettingClass *setting_class,
+                             const char *property_name,
+                             gsize field_offset)
+{
+	GParamSpec *param_spec;
+	NMSettingProperty *property;
+
+	param_spec = g_object_class_find_property (G_OBJECT_CLASS (setting_class), property_name);
+	g_return_if_fail (param_spec != NULL);
+	g_return_if_fail (param_spec->owner_type == G_TYPE_FROM_CLASS (setting_class));
+	g_return_if_fail (   param_spec->value_type == G_TYPE_STRING
+	                  || param_spec->value_type == G_TYPE_BOOLEAN
+	                  || param_spec->value_type == G_TYPE_INT
+	                  || param_spec->value_type == G_TYPE_UINT);
+
+	property = add_property_override (setting_class,
+	                                  property_name, param_spec, NULL,
+	                                  NULL, NULL, NULL, NULL,
+	                                  NULL, NULL);
+	g_return_if_fail (property != NULL);
+
+	property->has_field = TRUE;
+	property->field_offset = field_offset;
+}
+
 gboolean
 _nm_setting_use_legacy_property (NMSetting *setting,
                                  GVariant *connection_dict,
@@ -530,6 +596,7 @@ nm_setting_class_ensure_properties (NMSettingClass *setting_class)
 	GType type = G_TYPE_FROM_CLASS (setting_class), otype;
 	NMSettingProperty property, *override;
 	GArray *overrides, *type_overrides, *properties;
+	GHashTable *index;
 	GParamSpec **property_specs;
 	guint n_property_specs, i;
 
@@ -537,6 +604,16 @@ nm_setting_class_ensure_properties (NMSettingClass *setting_class)
 	if (properties)
 		return properties;
 
+	/* Settings are parsed from worker threads too, so make sure only one
+	 * thread builds the table; the others wait and reuse its result. The
+	 * table is per-type qdata, so a static g_once location can't be used. */
+	G_LOCK (setting_properties);
+	properties = g_type_get_qdata (type, setting_properties_quark);
+	if (properties) {
+		G_UNLOCK (setting_properties);
+		return properties;
+	}
+
 	/* Build overrides array from @setting_class and its superclasses */
 	overrides = g_array_new (FALSE, FALSE, sizeof (NMSettingProperty));
 	for (otype = type; otype != G_TYPE_OBJECT; otype = g_type_parent (otype)) {
@@ -571,7 +648,20 @@ nm_setting_class_ensure_properties (NMSettingClass *setting_class)
 	}
 	g_array_unref (overrides);
 
+	/* Index the properties by name. The values are the positions in
+	 * @properties plus one, so that they are never %NULL. */
+	index = g_hash_table_new (g_str_hash, g_str_equal);
+	for (i = 0; i < properties->len; i++) {
+		g_hash_table_insert (index,
+		                     (gpointer) g_array_index (properties, NMSettingProperty, i).name,
+		                     GUINT_TO_POINTER (i + 1));
+	}
+
+	/* Set the index first: the unlocked fast path above only checks for
+	 * @properties, and callers then look up the index. */
+	g_type_set_qdata (type, setting_properties_index_quark, index);
 	g_type_set_qdata (type, setting_properties_quark, properties);
+	G_UNLOCK (setting_properties);
 	return properties;
 }
 
@@ -586,13 +676,28 @@ nm_setting_class_get_properties (NMSettingClass *setting_class, guint *n_propert
 	return (NMSettingProperty *) properties->data;
 }
 
+/* Returns the position of @property_name in the array returned by
+ * nm_setting_class_get_properties(), or -1 if there is no such property. */
+static int
+nm_setting_class_find_property_index (NMSettingClass *setting_class, const char *property_name)
+{
+	GHashTable *index;
+
+	nm_setting_class_ensure_properties (setting_class);
+
+	index = g_type_get_qdata (G_TYPE_FROM_CLASS (setting_class), setting_properties_index_quark);
+	return ((int) GPOINTER_TO_UINT (g_hash_table_lookup (index, property_name))) - 1;
+}
+
 static const NMSettingProperty *
 nm_setting_class_find_property (NMSettingClass *setting_class, const char *property_name)
 {
 	GArray *properties;
+	int i;
 
 	properties = nm_setting_class_ensure_properties (setting_class);
-	return find_property (properties, property_name);
+	i = nm_setting_class_find_property_index (setting_class, property_name);
+	return i >= 0 ? &g_array_index (properties, NMSettingProperty, i) : NULL;
 }
 
 /*************************************************************/
@@ -798,6 +903,10 @@ _nm_setting_new_from_dbus (GType setting_type,
 	NMSetting *setting;
 	const NMSettingProperty *properties;
 	guint n_properties;
+	GVariant **values;
+	GVariantIter iter;
+	const char *key;
+	GVariant *value;
 	guint i;
 
 	g_return_val_if_fail (G_TYPE_IS_INSTANTIATABLE (setting_type), NULL);
@@ -817,14 +926,31 @@ _nm_setting_new_from_dbus (GType setting_type,
 	setting = (NMSetting *) g_object_new (setting_type, NULL);
 
 	properties = nm_setting_class_get_properties (NM_SETTING_GET_CLASS (setting), &n_properties);
+
+	/* Match the values in @setting_dict to the properties in one pass over
+	 * the dictionary, instead of one dictionary lookup per property. */
+	values = g_new0 (GVariant *, n_properties);
+	g_variant_iter_init (&iter, setting_dict);
+	while (g_variant_iter_next (&iter, "{&sv}", &key, &value)) {
+		int idx = nm_setting_class_find_property_index (NM_SETTING_GET_CLASS (setting), key);
+
+		if (idx >= 0 && !values[idx])
+			values[idx] = value;
+		else
+			g_variant_unref (value);
+	}
+
 	for (i = 0; i < n_properties; i++) {
 		const NMSettingProperty *property = &properties[i];
-		GVariant *value;
 
-		if (property->param_spec && !(property->param_spec->flags & G_PARAM_WRITABLE))
-			continue;
+		value = values[i];
+		values[i] = NULL;
 
-		value = g_variant_lookup_value (setting_dict, property->name, NULL);
+		if (property->param_spec && !(property->param_spec->flags & G_PARAM_WRITABLE)) {
+			if (value)
+				g_variant_unref (value);
+			continue;
+		}
 
 		if (value && property->set_func) {
 			if (!g_variant_type_equal (g_variant_get_type (value), property->dbus_type)) {
@@ -840,6 +966,11 @@ _nm_setting_new_from_dbus (GType setting_type,
 
 				g_variant_unref (value);
 				g_object_unref (setting);
+				for (i++; i < n_properties; i++) {
+					if (values[i])
+						g_variant_unref (values[i]);
+				}
+				g_free (values);
 				return NULL;
 			}
 
@@ -865,6 +996,7 @@ _nm_setting_new_from_dbus (GType setting_type,
 		if (value)
 			g_variant_unref (value);
 	}
+	g_free (values);
 
 	return setting;
 }
@@ -1012,6 +1144,111 @@ _nm_setting_verify (NMSetting *setting, NMConnection *connection, GError **error
 	return NM_SETTING_VERIFY_SUCCESS;
 }
 
+static gboolean
+strv_equal (const char *const *strv1, const char *const *strv2)
+{
+	if (!strv1 || !strv2)
+		return strv1 == strv2;
+
+	for (; *strv1 && *strv2; strv1++, strv2++) {
+		if (strcmp (*strv1, *strv2) != 0)
+			return FALSE;
+	}
+	return !*strv1 && !*strv2;
+}
+
+static gboolean
+compare_property_field (NMSetting *setting,
+                        NMSetting *other,
+                        const NMSettingProperty *property)
+{
+	GType owner_type = property->param_spec->owner_type;
+	gconstpointer field1, field2;
+
+	field1 = G_STRUCT_MEMBER_P (g_type_instance_get_private ((GTypeInstance *) setting, owner_type),
+	                            property->field_offset);
+	field2 = G_STRUCT_MEMBER_P (g_type_instance_get_private ((GTypeInstance *) other, owner_type),
+	                            property->field_offset);
+
+	switch (property->param_spec->value_type) {
+	case G_TYPE_STRING:
+		return g_strcmp0 (*((const char *const *) field1), *((const char *const *) field2)) == 0;
+	case G_TYPE_BOOLEAN:
+		return !*((const gboolean *) field1) == !*((const gboolean *) field2);
+	case G_TYPE_INT:
+		return *((const gint *) field1) == *((const gint *) field2);
+	case G_TYPE_UINT:
+		return *((const guint *) field1) == *((const guint *) field2);
+	default:
+		g_return_val_if_reached (FALSE);
+	}
+}
+
+/* Compares @property of @setting and @other on the GObject values, without
+ * serializing them to #GVariant first. This gives the same result as comparing
+ * the D-Bus representations, but only for properties with a plain D-Bus
+ * representation of one of the common types. Returns %FALSE if @property
+ * must be compared on its D-Bus representation. */
+static gboolean
+compare_property_native (NMSetting *setting,
+                         NMSetting *other,
+                         const NMSettingProperty *property,
+                         gboolean *out_same)
+{
+	GParamSpec *param_spec = property->param_spec;
+	GValue value1 = G_VALUE_INIT;
+	GValue value2 = G_VALUE_INIT;
+	GType type;
+
+	if (!param_spec || property->get_func || property->to_dbus)
+		return FALSE;
+
+	if (property->has_field) {
+		*out_same = compare_property_field (setting, other, property);
+		return TRUE;
+	}
+
+	type = param_spec->value_type;
+	if (   type != G_TYPE_BOOLEAN
+	    && type != G_TYPE_UCHAR
+	    && type != G_TYPE_INT
+	    && type != G_TYPE_UINT
+	    && type != G_TYPE_INT64
+	    && type != G_TYPE_UINT64
+	    && type != G_TYPE_DOUBLE
+	    && type != G_TYPE_STRING
+	    && type != G_TYPE_STRV
+	    && type != G_TYPE_BYTES
+	    && !G_TYPE_IS_ENUM (type)
+	    && !G_TYPE_IS_FLAGS (type))
+		return FALSE;
+
+	g_value_init (&value1, type);
+	g_value_init (&value2, type);
+	g_object_get_property (G_OBJECT (setting), param_spec->name, &value1);
+	g_object_get_property (G_OBJECT (other), param_spec->name, &value2);
+
+	/* Default values are omitted from the D-Bus representation, which is
+	 * the same as comparing them on their value. */
+	if (type == G_TYPE_STRV)
+		*out_same = strv_equal (g_value_get_boxed (&value1), g_value_get_boxed (&value2));
+	else if (type == G_TYPE_BYTES) {
+		GBytes *bytes1 = g_value_get_boxed (&value1);
+		GBytes *bytes2 = g_value_get_boxed (&value2);
+
+		*out_same = (bytes1 && bytes2) ? g_bytes_equal (bytes1, bytes2) : (bytes1 == bytes2);
+	} else if (type == G_TYPE_DOUBLE) {
+		/* g_param_values_cmp() allows for the spec's epsilon; the
+		 * D-Bus representations are compared exactly. */
+		*out_same = (g_value_get_double (&value1) == g_value_get_double (&value2));
+	} else
+		*out_same = (g_param_values_cmp (param_spec, &value1, &value2) == 0);
+
+	g_value_unset (&value1);
+	g_value_unset (&value2);
+	return TRUE;
+}
+
 static gboolean
 compare_property (NMSetting *setting,
                   NMSetting *other,
@@ -1020,6 +1257,7 @@ compare_property (NMSetting *setting,
 {
 	const NMSettingProperty *property;
 	GVariant *value1, *value2;
+	gboolean same;
 	int cmp;
 
 	/* Handle compare flags */
@@ -1053,6 +1291,9 @@ compare_property (NMSetting *setting,
 	property = nm_setting_class_find_property (NM_SETTING_GET_CLASS (setting), prop_spec->name);
 	g_return_val_if_fail (property != NULL, FALSE);
 
+	if (compare_property_native (setting, other, property, &same))
+		return same;
+
 	value1 = get_property_for_dbus (setting, property, TRUE);
 	value2 = get_property_for_dbus (other, property, TRUE);
 
@@ -1083,8 +1324,8 @@ nm_setting_compare (NMSetting *a,
                     NMSetting *b,
                     NMSettingCompareFlags flags)
 {
-	GParamSpec **property_specs;
-	guint n_property_specs;
+	const NMSettingProperty *properties;
+	guint n_properties;
 	gint same = TRUE;
 	guint i;
 
@@ -1096,9 +1337,13 @@ nm_setting_compare (NMSetting *a,
 		return FALSE;
 
 	/* And now all properties */
-	property_specs = g_object_class_list_properties (G_OBJECT_GET_CLASS (a), &n_property_specs);
-	for (i = 0; i < n_property_specs && same; i++) {
-		GParamSpec *prop_spec = property_specs[i];
+	properties = nm_setting_class_get_properties (NM_SETTING_GET_CLASS (a), &n_properties);
+	for (i = 0; i < n_properties && same; i++) {
+		GParamSpec *prop_spec = properties[i].param_spec;
+
+		/* Skip D-Bus only properties */
+		if (!prop_spec)
+			continue;
 
 		/* Fuzzy compare ignores secrets and properties defined with the FUZZY_IGNORE flag */
 		if (   (flags & NM_SETTING_COMPARE_FLAG_FUZZY)
@@ -1114,7 +1359,6 @@ nm_setting_compare (NMSetting *a,
 
 		same = NM_SETTING_GET_CLASS (a)->compare_property (a, b, prop_spec, flags);
 	}
-	g_free (property_specs);
 
 	return same;
 }
@@ -1200,8 +1444,8 @@ nm_setting_diff (NMSetting *a,
                  gboolean invert_results,
                  GHashTable **results)
 {
-	GParamSpec **property_specs;
-	guint n_property_specs;
+	const NMSettingProperty *properties;
+	guint n_properties;
 	guint i;
 	NMSettingDiffResult a_result = NM_SETTING_DIFF_RESULT_IN_A;
 	NMSettingDiffResult b_result = NM_SETTING_DIFF_RESULT_IN_B;
@@ -1244,12 +1488,16 @@ nm_setting_diff (NMSetting *a,
 	}
 
 	/* And now all properties */
-	property_specs = g_object_class_list_properties (G_OBJECT_GET_CLASS (a), &n_property_specs);
+	properties = nm_setting_class_get_properties (NM_SETTING_GET_CLASS (a), &n_properties);
 
-	for (i = 0; i < n_property_specs; i++) {
-		GParamSpec *prop_spec = property_specs[i];
+	for (i = 0; i < n_properties; i++) {
+		GParamSpec *prop_spec = properties[i].param_spec;
 		NMSettingDiffResult r = NM_SETTING_DIFF_RESULT_UNKNOWN;
 
+		/* Skip D-Bus only properties */
+		if (!prop_spec)
+			continue;
+
 		/* Handle compare flags */
 		if (!should_compare_prop (a, prop_spec->name, flags, prop_spec->flags))
 			continue;
@@ -1311,7 +1559,6 @@ nm_setting_diff (NMSetting *a,
 				g_hash_table_insert (*results, g_strdup (prop_spec->name), GUINT_TO_POINTER (r));
 		}
 	}
-	g_free (property_specs);
 
 	/* Don't return an empty hash table */
 	if (results_created && !g_hash_table_size (*results)) {
@@ -1865,6 +2112,8 @@ nm_setting_class_init (NMSettingClass *setting_class)
 		setting_property_overrides_quark = g_quark_from_static_string ("nm-setting-property-overrides");
 	if (!setting_properties_quark)
 		setting_properties_quark = g_quark_from_static_string ("nm-setting-properties");
+	if (!setting_properties_index_quark)
+		setting_properties_index_quark = g_quark_from_static_string ("nm-setting-properties-index");
 
 	g_type_class_add_private (setting_class, sizeof (NMSettingPrivate));
 
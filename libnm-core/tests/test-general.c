@@ -1320,6 +1320,76 @@ test_setting_new_from_dbus_bad (void)
 	g_variant_unref (orig_dict);
 }
 
+static void
+test_setting_find_property (void)
+{
+	NMSetting *s_ip4, *s_bond;
+	NMSettingWirelessSecurity *s_wsec;
+	NMSettingIPConfig *s_ip;
+	GVariantBuilder builder, addr_builder, conn_builder;
+	GVariant *dict, *conn_dict, *secrets;
+	GError *error = NULL;
+
+	/* Plain GObject properties, own and inherited, overridden ones and
+	 * D-Bus-only ones without a GParamSpec are all found by name */
+	s_ip4 = nm_setting_ip4_config_new ();
+	g_assert (g_variant_type_equal (nm_setting_get_dbus_property_type (s_ip4, NM_SETTING_IP_CONFIG_METHOD),
+	                                G_VARIANT_TYPE_STRING));
+	g_assert (g_variant_type_equal (nm_setting_get_dbus_property_type (s_ip4, NM_SETTING_NAME),
+	                                G_VARIANT_TYPE_STRING));
+	g_assert (g_variant_type_equal (nm_setting_get_dbus_property_type (s_ip4, NM_SETTING_IP_CONFIG_ADDRESSES),
+	                                G_VARIANT_TYPE ("aau")));
+	g_assert (g_variant_type_equal (nm_setting_get_dbus_property_type (s_ip4, "address-data"),
+	                                G_VARIANT_TYPE ("aa{sv}")));
+	g_object_unref (s_ip4);
+
+	/* D-Bus-only properties added to a parent class */
+	s_bond = nm_setting_bond_new ();
+	g_assert (g_variant_type_equal (nm_setting_get_dbus_property_type (s_bond, "interface-name"),
+	                                G_VARIANT_TYPE_STRING));
+	g_object_unref (s_bond);
+
+	/* Unknown names are not found */
+	s_wsec = make_test_wsec_setting ("setting-find-property");
+	g_variant_builder_init (&builder, NM_VARIANT_TYPE_SETTING);
+	g_variant_builder_add (&builder, "{sv}", "no-such-property", g_variant_new_string ("foo"));
+	secrets = g_variant_ref_sink (g_variant_builder_end (&builder));
+	g_assert_cmpint (_nm_setting_update_secrets (NM_SETTING (s_wsec), secrets, &error), ==, NM_SETTING_UPDATE_SECRET_ERROR);
+	g_assert_error (error, NM_CONNECTION_ERROR, NM_CONNECTION_ERROR_PROPERTY_NOT_FOUND);
+	g_clear_error (&error);
+	g_variant_unref (secrets);
+	g_object_unref (s_wsec);
+
+	/* Deserializing matches D-Bus-only keys and skips unknown ones */
+	g_variant_builder_init (&addr_builder, G_VARIANT_TYPE ("aa{sv}"));
+	g_variant_builder_open (&addr_builder, NM_VARIANT_TYPE_SETTING);
+	g_variant_builder_add (&addr_builder, "{sv}", "address", g_variant_new_string ("192.168.1.5"));
+	g_variant_builder_add (&addr_builder, "{sv}", "prefix", g_variant_new_uint32 (24));
+	g_variant_builder_close (&addr_builder);
+
+	g_variant_builder_init (&builder, NM_VARIANT_TYPE_SETTING);
+	g_variant_builder_add (&builder, "{sv}", "no-such-property", g_variant_new_string ("foo"));
+	g_variant_builder_add (&builder, "{sv}", NM_SETTING_IP_CONFIG_METHOD,
+	                       g_variant_new_string (NM_SETTING_IP4_CONFIG_METHOD_MANUAL));
+	g_variant_builder_add (&builder, "{sv}", "address-data", g_variant_builder_end (&addr_builder));
+	dict = g_variant_ref_sink (g_variant_builder_end (&builder));
+
+	g_variant_builder_init (&conn_builder, NM_VARIANT_TYPE_CONNECTION);
+	g_variant_builder_add (&conn_builder, "{s@a{sv}}", NM_SETTING_IP4_CONFIG_SETTING_NAME, dict);
+	conn_dict = g_variant_ref_sink (g_variant_builder_end (&conn_builder));
+
+	s_ip = (NMSettingIPConfig *) _nm_setting_new_from_dbus (NM_TYPE_SETTING_IP4_CONFIG, dict, conn_dict, &error);
+	g_assert_no_error (error);
+	g_assert (s_ip);
+	g_assert_cmpstr (nm_setting_ip_config_get_method (s_ip), ==, NM_SETTING_IP4_CONFIG_METHOD_MANUAL);
+	g_assert_cmpint (nm_setting_ip_config_get_num_addresses (s_ip), ==, 1);
+	g_assert_cmpstr (nm_ip_address_get_address (nm_setting_ip_config_get_address (s_ip, 0)), ==, "192.168.1.5");
+
+	g_variant_unref (conn_dict);
+	g_variant_unref (dict);
+	g_object_unref (s_ip);
+}
+
 static NMConnection *
 new_test_connection (void)
 {
@@ -2440,6 +2510,77 @@ test_setting_compare_timestamp (void)
 	g_assert (success);
 }
 
+static void
+test_setting_compare_native (void)
+{
+	gs_unref_object NMSetting *old = NULL, *new = NULL;
+	GBytes *ssid;
+
+	old = nm_setting_wireless_new ();
+	new = nm_setting_duplicate (old);
+	g_assert (nm_setting_compare (old, new, NM_SETTING_COMPARE_FLAG_EXACT));
+
+	/* An empty SSID is not the same as no SSID */
+	ssid = g_bytes_new ("", 0);
+	g_object_set (new, NM_SETTING_WIRELESS_SSID, ssid, NULL);
+	g_bytes_unref (ssid);
+	g_assert (!nm_setting_compare (old, new, NM_SETTING_COMPARE_FLAG_EXACT));
+
+	ssid = g_bytes_new ("ssid", 4);
+	g_object_set (old, NM_SETTING_WIRELESS_SSID, ssid, NULL);
+	g_object_set (new, NM_SETTING_WIRELESS_SSID, ssid, NULL);
+	g_bytes_unref (ssid);
+	g_assert (nm_setting_compare (old, new, NM_SETTING_COMPARE_FLAG_EXACT));
+
+	g_object_set (new, NM_SETTING_WIRELESS_MODE, NM_SETTING_WIRELESS_MODE_ADHOC, NULL);
+	g_assert (!nm_setting_compare (old, new, NM_SETTING_COMPARE_FLAG_EXACT));
+	g_object_set (old, NM_SETTING_WIRELESS_MODE, NM_SETTING_WIRELESS_MODE_ADHOC, NULL);
+	g_assert (nm_setting_compare (old, new, NM_SETTING_COMPARE_FLAG_EXACT));
+
+	g_object_set (new, NM_SETTING_WIRELESS_CHANNEL, 6, NULL);
+	g_assert (!nm_setting_compare (old, new, NM_SETTING_COMPARE_FLAG_EXACT));
+	g_object_set (old, NM_SETTING_WIRELESS_CHANNEL, 6, NULL);
+	g_assert (nm_setting_compare (old, new, NM_SETTING_COMPARE_FLAG_EXACT));
+
+	g_object_set (new, NM_SETTING_WIRELESS_HIDDEN, TRUE, NULL);
+	g_assert (!nm_setting_compare (old, new, NM_SETTING_COMPARE_FLAG_EXACT));
+}
+
+static void
+test_setting_compare_field (void)
+{
+	gs_unref_object NMSetting *old = NULL, *new = NULL;
+
+	/* NMSettingConnection properties are compared on their fields */
+	old = nm_setting_connection_new ();
+	new = nm_setting_duplicate (old);
+	g_assert (nm_setting_compare (old, new, NM_SETTING_COMPARE_FLAG_EXACT));
+
+	/* An empty ID is not the same as no ID */
+	g_object_set (new, NM_SETTING_CONNECTION_ID, "", NULL);
+	g_assert (!nm_setting_compare (old, new, NM_SETTING_COMPARE_FLAG_EXACT));
+	g_object_set (old, NM_SETTING_CONNECTION_ID, "", NULL);
+	g_assert (nm_setting_compare (old, new, NM_SETTING_COMPARE_FLAG_EXACT));
+
+	g_object_set (new, NM_SETTING_CONNECTION_ZONE, "public", NULL);
+	g_assert (!nm_setting_compare (old, new, NM_SETTING_COMPARE_FLAG_EXACT));
+	g_object_set (old, NM_SETTING_CONNECTION_ZONE, "public", NULL);
+	g_assert (nm_setting_compare (old, new, NM_SETTING_COMPARE_FLAG_EXACT));
+
+	g_object_set (new, NM_SETTING_CONNECTION_AUTOCONNECT, FALSE, NULL);
+	g_assert (!nm_setting_compare (old, new, NM_SETTING_COMPARE_FLAG_EXACT));
+	g_object_set (old, NM_SETTING_CONNECTION_AUTOCONNECT, FALSE, NULL);
+	g_assert (nm_setting_compare (old, new, NM_SETTING_COMPARE_FLAG_EXACT));
+
+	g_object_set (new, NM_SETTING_CONNECTION_AUTOCONNECT_PRIORITY, -5, NULL);
+	g_assert (!nm_setting_compare (old, new, NM_SETTING_COMPARE_FLAG_EXACT));
+	g_object_set (old, NM_SETTING_CONNECTION_AUTOCONNECT_PRIORITY, -5, NULL);
+	g_assert (nm_setting_compare (old, new, NM_SETTING_COMPARE_FLAG_EXACT));
+
+	g_object_set (new, NM_SETTING_CONNECTION_GATEWAY_PING_TIMEOUT, 5, NULL);
+	g_assert (!nm_setting_compare (old, new, NM_SETTING_COMPARE_FLAG_EXACT));
+}
+
 typedef struct {
 	NMSettingSecretFlags secret_flags;
 	NMSettingCompareFlags comp_flags;
@@ -4381,6 +4522,8 @@ int main (int argc, char **argv)
 	g_test_add_func ("/core/general/test_setting_to_dbus_enum", test_setting_to_dbus_enum);
 	g_test_add_func ("/core/general/test_setting_compare_id", test_setting_compare_id);
 	g_test_add_func ("/core/general/test_setting_compare_timestamp", test_setting_compare_timestamp);
+	g_test_add_func ("/core/general/test_setting_compare_native", test_setting_compare_native);
+	g_test_add_func ("/core/general/test_setting_compare_field", test_setting_compare_field);
 #define ADD_FUNC(func, secret_flags, comp_flags, remove_secret) \
 	g_test_add_data_func_full ("/core/general/" G_STRINGIFY (func), \
 	                           test_data_compare_secrets_new (secret_flags, comp_flags, remove_secret), \
@@ -4401,6 +4544,7 @@ int main (int argc, char **argv)
 	g_test_add_func ("/core/general/test_setting_new_from_dbus_transform", test_setting_new_from_dbus_transform);
 	g_test_add_func ("/core/general/test_setting_new_from_dbus_enum", test_setting_new_from_dbus_enum);
 	g_test_add_func ("/core/general/test_setting_new_from_dbus_bad", test_setting_new_from_dbus_bad);
+	g_test_add_func ("/core/general/test_setting_find_property", test_setting_find_property);
 	g_test_add_func ("/core/general/test_connection_replace_settings", test_connection_replace_settings);
 	g_test_add_func ("/core/general/test_connection_replace_settings_from_connection", test_connection_replace_settings_from_connection);
 	g_test_add_func ("/core/general/test_connection_replace_settings_bad", test_connection_replace_settings_bad);
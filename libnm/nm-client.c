@@ -35,6 +35,7 @@
 #include "nm-vpn-connection.h"
 #include "nm-remote-connection.h"
 #include "nm-object-cache.h"
+#include "nm-object-private.h"
 #include "nm-glib-compat.h"
 #include "nm-dbus-helpers.h"
 
@@ -53,6 +54,7 @@ G_DEFINE_TYPE_WITH_CODE (NMClient, nm_client, G_TYPE_OBJECT,
 typedef struct {
 	NMManager *manager;
 	NMRemoteSettings *settings;
+	gboolean managed_objects;
 } NMClientPrivate;
 
 enum {
@@ -1728,6 +1730,15 @@ init_sync (GInitable *initable, GCancellable *cancellable, GError **error)
 {
 	NMClient *client = NM_CLIENT (initable);
 	NMClientPrivate *priv = NM_CLIENT_GET_PRIVATE (client);
+	GDBusConnection *connection;
+
+	/* Load the whole object graph in one go; the objects created below
+	 * then don't need to fetch their properties one by one. */
+	connection = _nm_dbus_new_connection (cancellable, NULL);
+	if (connection) {
+		priv->managed_objects = _nm_object_managed_objects_init (connection, cancellable);
+		g_object_unref (connection);
+	}
 
 	if (!g_initable_init (G_INITABLE (priv->manager), cancellable, error))
 		return FALSE;
@@ -1782,12 +1793,53 @@ init_async_inited_settings (GObject *object, GAsyncResult *result, gpointer user
 		init_async_complete (init_data);
 }
 
+static void
+init_async_init_objects (NMClientInitData *init_data)
+{
+	NMClientPrivate *priv = NM_CLIENT_GET_PRIVATE (init_data->client);
+
+	g_async_initable_init_async (G_ASYNC_INITABLE (priv->manager),
+	                             G_PRIORITY_DEFAULT, init_data->cancellable,
+	                             init_async_inited_manager, init_data);
+	g_async_initable_init_async (G_ASYNC_INITABLE (priv->settings),
+	                             G_PRIORITY_DEFAULT, init_data->cancellable,
+	                             init_async_inited_settings, init_data);
+}
+
+static void
+init_async_got_managed_objects (GObject *object, GAsyncResult *result, gpointer user_data)
+{
+	NMClientInitData *init_data = user_data;
+	NMClientPrivate *priv = NM_CLIENT_GET_PRIVATE (init_data->client);
+
+	priv->managed_objects = _nm_object_managed_objects_init_finish (result);
+	init_async_init_objects (init_data);
+}
+
+static void
+init_async_got_bus (GObject *object, GAsyncResult *result, gpointer user_data)
+{
+	NMClientInitData *init_data = user_data;
+	GDBusConnection *connection;
+
+	/* As in init_sync(), load the whole object graph first; if there is no
+	 * bus, the objects report that themselves. */
+	connection = _nm_dbus_new_connection_finish (result, NULL);
+	if (!connection) {
+		init_async_init_objects (init_data);
+		return;
+	}
+
+	_nm_object_managed_objects_init_async (connection, init_data->cancellable,
+	                                       init_async_got_managed_objects, init_data);
+	g_object_unref (connection);
+}
+
 static void
 init_async (GAsyncInitable *initable, int io_priority,
             GCancellable *cancellable, GAsyncReadyCallback callback,
             gpointer user_data)
 {
-	NMClientPrivate *priv = NM_CLIENT_GET_PRIVATE (initable);
 	NMClientInitData *init_data;
 
 	init_data = g_slice_new0 (NMClientInitData);
@@ -1797,12 +1849,7 @@ init_async (GAsyncInitable *initable, int io_priority,
 	                                               user_data, init_async);
 	g_simple_async_result_set_op_res_gboolean (init_data->result, TRUE);
 
-	g_async_initable_init_async (G_ASYNC_INITABLE (priv->manager),
-	                             G_PRIORITY_DEFAULT, init_data->cancellable,
-	                             init_async_inited_manager, init_data);
-	g_async_initable_init_async (G_ASYNC_INITABLE (priv->settings),
-	                             G_PRIORITY_DEFAULT, init_data->cancellable,
-	                             init_async_inited_settings, init_data);
+	_nm_dbus_new_connection_async (init_data->cancellable, init_async_got_bus, init_data);
 }
 
 static gboolean
@@ -1829,6 +1876,10 @@ dispose (GObject *object)
 		g_signal_handlers_disconnect_by_data (priv->settings, object);
 		g_clear_object (&priv->settings);
 	}
+	if (priv->managed_objects) {
+		_nm_object_managed_objects_release ();
+		priv->managed_objects = FALSE;
+	}
 
 	G_OBJECT_CLASS (nm_client_parent_class)->dispose (object);
 }
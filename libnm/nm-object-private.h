@@ -67,6 +67,15 @@ void _nm_object_set_property (NMObject *object,
 /* object demarshalling support */
 typedef GType (*NMObjectDecideTypeFunc) (GVariant *);
 
+gboolean _nm_object_managed_objects_init (GDBusConnection *connection,
+                                          GCancellable *cancellable);
+void _nm_object_managed_objects_init_async (GDBusConnection *connection,
+                                            GCancellable *cancellable,
+                                            GAsyncReadyCallback callback,
+                                            gpointer user_data);
+gboolean _nm_object_managed_objects_init_finish (GAsyncResult *result);
+void _nm_object_managed_objects_release (void);
+
 void _nm_object_register_type_func (GType base_type,
                                     NMObjectDecideTypeFunc type_func,
                                     const char *interface,
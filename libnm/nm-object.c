@@ -346,6 +346,401 @@ _nm_object_queue_notify (NMObject *object, const char *property)
 	_nm_object_queue_notify_full (object, property, NULL, FALSE, NULL);
 }
 
+/**************************************************************/
+
+/* Mirror of the daemon's org.freedesktop.DBus.ObjectManager: the reply of
+ * one GetManagedObjects call, kept up to date by InterfacesAdded,
+ * InterfacesRemoved and PropertiesChanged. Objects created while the
+ * mirror is populated take their type and initial properties from it
+ * instead of doing a Get and one GetAll per interface.
+ *
+ * The mirror is owned by the NMClients using it and is freed, along with
+ * its reference on the connection, when the last of them is disposed.
+ */
+static struct {
+	guint users;
+	GDBusConnection *connection;
+	guint added_id;
+	guint removed_id;
+	guint changed_id;
+	guint owner_id;
+	/* path -> (interface -> a{sv}) */
+	GHashTable *objects;
+} managed_objects;
+
+static void
+managed_objects_set_interfaces (const char *path, GVariant *interfaces)
+{
+	GHashTable *object;
+	GVariantIter iter;
+	const char *interface;
+	GVariant *properties;
+
+	object = g_hash_table_lookup (managed_objects.objects, path);
+	if (!object) {
+		object = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_variant_unref);
+		g_hash_table_insert (managed_objects.objects, g_strdup (path), object);
+	}
+
+	g_variant_iter_init (&iter, interfaces);
+	while (g_variant_iter_next (&iter, "{&s@a{sv}}", &interface, &properties))
+		g_hash_table_insert (object, g_strdup (interface), properties);
+}
+
+static void
+managed_objects_interfaces_added (GDBusConnection *connection,
+                                  const char *sender_name,
+                                  const char *object_path,
+                                  const char *interface_name,
+                                  const char *signal_name,
+                                  GVariant *parameters,
+                                  gpointer user_data)
+{
+	const char *path;
+	GVariant *interfaces;
+
+	if (!g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(oa{sa{sv}})")))
+		return;
+
+	g_variant_get (parameters, "(&o@a{sa{sv}})", &path, &interfaces);
+	managed_objects_set_interfaces (path, interfaces);
+	g_variant_unref (interfaces);
+}
+
+static void
+managed_objects_interfaces_removed (GDBusConnection *connection,
+                                    const char *sender_name,
+                                    const char *object_path,
+                                    const char *interface_name,
+                                    const char *signal_name,
+                                    GVariant *parameters,
+                                    gpointer user_data)
+{
+	const char *path;
+
+	if (!g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(oas)")))
+		return;
+
+	/* An object only ever goes away as a whole */
+	g_variant_get (parameters, "(&o@as)", &path, NULL);
+	g_hash_table_remove (managed_objects.objects, path);
+}
+
+static void
+managed_objects_properties_changed (GDBusConnection *connection,
+                                    const char *sender_name,
+                                    const char *object_path,
+                                    const char *interface_name,
+                                    const char *signal_name,
+                                    GVariant *parameters,
+                                    gpointer user_data)
+{
+	GHashTable *object;
+	GVariant *old, *changed;
+	GVariantBuilder builder;
+	GVariantIter iter;
+	const char *name;
+	GVariant *value;
+
+	if (!g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(a{sv})")))
+		return;
+
+	object = g_hash_table_lookup (managed_objects.objects, object_path);
+	if (!object)
+		return;
+	old = g_hash_table_lookup (object, interface_name);
+	if (!old)
+		return;
+
+	g_variant_get (parameters, "(@a{sv})", &changed);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+	g_variant_iter_init (&iter, old);
+	while (g_variant_iter_next (&iter, "{&sv}", &name, &value)) {
+		GVariant *new_value = g_variant_lookup_value (changed, name, NULL);
+
+		if (new_value)
+			g_variant_unref (new_value);
+		else
+			g_variant_builder_add (&builder, "{sv}", name, value);
+		g_variant_unref (value);
+	}
+	g_variant_iter_init (&iter, changed);
+	while (g_variant_iter_next (&iter, "{&sv}", &name, &value)) {
+		g_variant_builder_add (&builder, "{sv}", name, value);
+		g_variant_unref (value);
+	}
+	g_variant_unref (changed);
+
+	g_hash_table_insert (object, g_strdup (interface_name),
+	                     g_variant_ref_sink (g_variant_builder_end (&builder)));
+}
+
+static void
+managed_objects_clear (void)
+{
+	if (!managed_objects.connection)
+		return;
+
+	g_dbus_connection_signal_unsubscribe (managed_objects.connection, managed_objects.added_id);
+	g_dbus_connection_signal_unsubscribe (managed_objects.connection, managed_objects.removed_id);
+	g_dbus_connection_signal_unsubscribe (managed_objects.connection, managed_objects.changed_id);
+	if (managed_objects.owner_id)
+		g_dbus_connection_signal_unsubscribe (managed_objects.connection, managed_objects.owner_id);
+	g_clear_object (&managed_objects.connection);
+	g_clear_pointer (&managed_objects.objects, g_hash_table_unref);
+	memset (&managed_objects, 0, sizeof (managed_objects));
+}
+
+static void
+managed_objects_owner_changed (GDBusConnection *connection,
+                               const char *sender_name,
+                               const char *object_path,
+                               const char *interface_name,
+                               const char *signal_name,
+                               GVariant *parameters,
+                               gpointer user_data)
+{
+	/* NetworkManager restarted or went away; nothing we know is valid
+	 * anymore. Objects of a new instance are picked up again from its
+	 * InterfacesAdded signals. */
+	g_hash_table_remove_all (managed_objects.objects);
+}
+
+static const char *
+managed_objects_bus_name (GDBusConnection *connection)
+{
+	return _nm_dbus_is_connection_private (connection) ? NULL : NM_DBUS_SERVICE;
+}
+
+/* Takes a use of the mirror of @connection. If nobody mirrors it yet, this
+ * starts following the daemon's objects and sets @is_new; the caller then
+ * has to fill the mirror with managed_objects_take_reply().
+ *
+ * Returns %FALSE if another client already mirrors a different connection.
+ */
+static gboolean
+managed_objects_acquire (GDBusConnection *connection, gboolean *is_new)
+{
+	const char *name;
+
+	*is_new = FALSE;
+	if (managed_objects.connection == connection) {
+		managed_objects.users++;
+		return TRUE;
+	} else if (managed_objects.connection)
+		return FALSE;
+
+	name = managed_objects_bus_name (connection);
+
+	managed_objects.users = 1;
+	managed_objects.connection = g_object_ref (connection);
+	managed_objects.objects = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_hash_table_unref);
+
+	/* Subscribe first so that no change gets lost between the reply and the
+	 * subscription. */
+	managed_objects.added_id =
+		g_dbus_connection_signal_subscribe (connection, name,
+		                                    "org.freedesktop.DBus.ObjectManager", "InterfacesAdded",
+		                                    NM_DBUS_PATH_OBJECT_MANAGER, NULL,
+		                                    G_DBUS_SIGNAL_FLAGS_NONE,
+		                                    managed_objects_interfaces_added, NULL, NULL);
+	managed_objects.removed_id =
+		g_dbus_connection_signal_subscribe (connection, name,
+		                                    "org.freedesktop.DBus.ObjectManager", "InterfacesRemoved",
+		                                    NM_DBUS_PATH_OBJECT_MANAGER, NULL,
+		                                    G_DBUS_SIGNAL_FLAGS_NONE,
+		                                    managed_objects_interfaces_removed, NULL, NULL);
+	managed_objects.changed_id =
+		g_dbus_connection_signal_subscribe (connection, name,
+		                                    NULL, "PropertiesChanged",
+		                                    NULL, NULL,
+		                                    G_DBUS_SIGNAL_FLAGS_NONE,
+		                                    managed_objects_properties_changed, NULL, NULL);
+	if (name) {
+		managed_objects.owner_id =
+			g_dbus_connection_signal_subscribe (connection, DBUS_SERVICE_DBUS,
+			                                    DBUS_INTERFACE_DBUS, "NameOwnerChanged",
+			                                    DBUS_PATH_DBUS, NM_DBUS_SERVICE,
+			                                    G_DBUS_SIGNAL_FLAGS_NONE,
+			                                    managed_objects_owner_changed, NULL, NULL);
+	}
+
+	*is_new = TRUE;
+	return TRUE;
+}
+
+/* Fills the mirror from the reply @ret to GetManagedObjects. If the call
+ * failed (e.g. because the bus policy denies it), the use taken by
+ * managed_objects_acquire() is dropped again and %FALSE is returned.
+ */
+static gboolean
+managed_objects_take_reply (GVariant *ret, GError *error)
+{
+	GVariant *objects, *interfaces;
+	GVariantIter iter;
+	const char *path;
+
+	if (!ret) {
+		dbgmsg ("Could not fetch managed objects: %s", error->message);
+		_nm_object_managed_objects_release ();
+		return FALSE;
+	}
+
+	g_variant_get (ret, "(@a{oa{sa{sv}}})", &objects);
+	g_variant_iter_init (&iter, objects);
+	while (g_variant_iter_next (&iter, "{&o@a{sa{sv}}}", &path, &interfaces)) {
+		managed_objects_set_interfaces (path, interfaces);
+		g_variant_unref (interfaces);
+	}
+	g_variant_unref (objects);
+	g_variant_unref (ret);
+
+	return TRUE;
+}
+
+/**
+ * _nm_object_managed_objects_init:
+ * @connection: the #GDBusConnection to NetworkManager
+ * @cancellable: a #GCancellable
+ *
+ * Fetches all objects exported by NetworkManager with a single
+ * GetManagedObjects call and starts following their changes. Failure is
+ * not fatal: objects then load their properties one by one.
+ *
+ * Returns: %TRUE if the mirror is in use, in which case the caller must
+ *   drop it with _nm_object_managed_objects_release() when done.
+ */
+gboolean
+_nm_object_managed_objects_init (GDBusConnection *connection, GCancellable *cancellable)
+{
+	GVariant *ret;
+	GError *error = NULL;
+	gboolean is_new, success;
+
+	if (!managed_objects_acquire (connection, &is_new))
+		return FALSE;
+	if (!is_new)
+		return TRUE;
+
+	ret = g_dbus_connection_call_sync (connection, managed_objects_bus_name (connection),
+	                                   NM_DBUS_PATH_OBJECT_MANAGER,
+	                                   "org.freedesktop.DBus.ObjectManager",
+	                                   "GetManagedObjects",
+	                                   NULL,
+	                                   G_VARIANT_TYPE ("(a{oa{sa{sv}}})"),
+	                                   G_DBUS_CALL_FLAGS_NO_AUTO_START, -1,
+	                                   cancellable, &error);
+	success = managed_objects_take_reply (ret, error);
+	g_clear_error (&error);
+	return success;
+}
+
+static void
+managed_objects_init_got_reply (GObject *connection, GAsyncResult *result, gpointer user_data)
+{
+	GSimpleAsyncResult *simple = user_data;
+	GVariant *ret;
+	GError *error = NULL;
+
+	ret = g_dbus_connection_call_finish (G_DBUS_CONNECTION (connection), result, &error);
+	g_simple_async_result_set_op_res_gboolean (simple, managed_objects_take_reply (ret, error));
+	g_clear_error (&error);
+
+	g_simple_async_result_complete (simple);
+	g_object_unref (simple);
+}
+
+/**
+ * _nm_object_managed_objects_init_async:
+ * @connection: the #GDBusConnection to NetworkManager
+ * @cancellable: a #GCancellable
+ * @callback: called when the mirror is ready or could not be set up
+ * @user_data: data for @callback
+ *
+ * Asynchronous version of _nm_object_managed_objects_init(); get the
+ * result with _nm_object_managed_objects_init_finish().
+ */
+void
+_nm_object_managed_objects_init_async (GDBusConnection *connection,
+                                       GCancellable *cancellable,
+                                       GAsyncReadyCallback callback,
+                                       gpointer user_data)
+{
+	GSimpleAsyncResult *simple;
+	gboolean is_new;
+
+	simple = g_simple_async_result_new (NULL, callback, user_data,
+	                                    _nm_object_managed_objects_init_async);
+
+	if (!managed_objects_acquire (connection, &is_new) || !is_new) {
+		g_simple_async_result_set_op_res_gboolean (simple, managed_objects.connection == connection);
+		g_simple_async_result_complete_in_idle (simple);
+		g_object_unref (simple);
+		return;
+	}
+
+	g_dbus_connection_call (connection, managed_objects_bus_name (connection),
+	                        NM_DBUS_PATH_OBJECT_MANAGER,
+	                        "org.freedesktop.DBus.ObjectManager",
+	                        "GetManagedObjects",
+	                        NULL,
+	                        G_VARIANT_TYPE ("(a{oa{sa{sv}}})"),
+	                        G_DBUS_CALL_FLAGS_NO_AUTO_START, -1,
+	                        cancellable,
+	                        managed_objects_init_got_reply, simple);
+}
+
+/**
+ * _nm_object_managed_objects_init_finish:
+ * @result: the #GAsyncResult passed to the callback
+ *
+ * Returns: %TRUE if the mirror is in use, in which case the caller must
+ *   drop it with _nm_object_managed_objects_release() when done.
+ */
+gboolean
+_nm_object_managed_objects_init_finish (GAsyncResult *result)
+{
+	g_return_val_if_fail (g_simple_async_result_is_valid (result, NULL, _nm_object_managed_objects_init_async), FALSE);
+
+	return g_simple_async_result_get_op_res_gboolean (G_SIMPLE_ASYNC_RESULT (result));
+}
+
+/**
+ * _nm_object_managed_objects_release:
+ *
+ * Drops a use of the mirror taken by a successful
+ * _nm_object_managed_objects_init(); the last one frees it.
+ */
+void
+_nm_object_managed_objects_release (void)
+{
+	g_return_if_fail (managed_objects.users > 0);
+
+	if (--managed_objects.users == 0)
+		managed_objects_clear ();
+}
+
+/* Returns a new reference to the a{sv} of @interface of @path, if known */
+static GVariant *
+managed_objects_get_properties (GDBusConnection *connection,
+                                const char *path,
+                                const char *interface)
+{
+	GHashTable *object;
+	GVariant *properties;
+
+	if (!managed_objects.objects || managed_objects.connection != connection)
+		return NULL;
+
+	object = g_hash_table_lookup (managed_objects.objects, path);
+	if (!object)
+		return NULL;
+
+	properties = g_hash_table_lookup (object, interface);
+	return properties ? g_variant_ref (properties) : NULL;
+}
+
 void
 _nm_object_register_type_func (GType base_type,
                                NMObjectDecideTypeFunc type_func,
@@ -378,7 +773,18 @@ _nm_object_create (GType type, GDBusConnection *connection, const char *path)
 	type_data = g_hash_table_lookup (type_funcs, GSIZE_TO_POINTER (type));
 	if (type_data) {
 		GDBusProxy *proxy;
-		GVariant *ret, *value;
+		GVariant *ret, *value, *properties;
+
+		properties = managed_objects_get_properties (connection, path, type_data->interface);
+		if (properties) {
+			value = g_variant_lookup_value (properties, type_data->property, NULL);
+			g_variant_unref (properties);
+			if (value) {
+				type = type_data->type_func (value);
+				g_variant_unref (value);
+				goto have_type;
+			}
+		}
 
 		proxy = _nm_dbus_new_proxy_for_connection (connection, path,
 		                                           DBUS_INTERFACE_PROPERTIES,
@@ -410,6 +816,7 @@ _nm_object_create (GType type, GDBusConnection *connection, const char *path)
 		g_variant_unref (ret);
 	}
 
+have_type:
 	if (type == G_TYPE_INVALID) {
 		dbgmsg ("Could not create object for %s: unknown object type", path);
 		return NULL;
@@ -569,6 +976,20 @@ _nm_object_create_async (GType type, GDBusConnection *connection, const char *pa
 
 	async_data->type_data = g_hash_table_lookup (type_funcs, GSIZE_TO_POINTER (type));
 	if (async_data->type_data) {
+		GVariant *properties, *value;
+
+		properties = managed_objects_get_properties (connection, path, async_data->type_data->interface);
+		if (properties) {
+			value = g_variant_lookup_value (properties, async_data->type_data->property, NULL);
+			g_variant_unref (properties);
+			if (value) {
+				type = async_data->type_data->type_func (value);
+				g_variant_unref (value);
+				create_async_got_type (async_data, type);
+				return;
+			}
+		}
+
 		_nm_dbus_new_proxy_for_connection_async (connection, path,
 		                                         DBUS_INTERFACE_PROPERTIES,
 		                                         NULL,
@@ -1149,6 +1570,13 @@ _nm_object_reload_properties (NMObject *object, GError **error)
 
 	g_hash_table_iter_init (&iter, priv->proxies);
 	while (g_hash_table_iter_next (&iter, (gpointer *) &interface, (gpointer *) &proxy)) {
+		props = managed_objects_get_properties (priv->connection, priv->path, interface);
+		if (props) {
+			process_properties_changed (object, props, TRUE);
+			g_variant_unref (props);
+			continue;
+		}
+
 		ret = _nm_dbus_proxy_call_sync (priv->properties_proxy,
 		                                "GetAll",
 		                                g_variant_new ("(s)", interface),
@@ -1320,17 +1748,32 @@ reload_got_properties (GObject *proxy,
 		reload_complete (object, FALSE);
 }
 
-void
-_nm_object_reload_properties_async (NMObject *object,
-                                    GCancellable *cancellable,
-                                    GAsyncReadyCallback callback,
-                                    gpointer user_data)
+static gboolean
+reload_complete_idle (gpointer user_data)
+{
+	NMObject *object = user_data;
+
+	reload_complete (object, FALSE);
+	g_object_unref (object);
+	return G_SOURCE_REMOVE;
+}
+
+/* @from_mirror: take the properties from the ObjectManager mirror where
+ * possible. Only used for the initial load: a reload is requested because
+ * of a change the mirror may not have seen yet. */
+static void
+reload_properties_async (NMObject *object,
+                         gboolean from_mirror,
+                         GCancellable *cancellable,
+                         GAsyncReadyCallback callback,
+                         gpointer user_data)
 {
 	NMObjectPrivate *priv = NM_OBJECT_GET_PRIVATE (object);
 	GSimpleAsyncResult *simple;
 	GHashTableIter iter;
 	const char *interface;
 	GDBusProxy *proxy;
+	GVariant *props;
 
 	simple = g_simple_async_result_new (G_OBJECT (object), callback,
 	                                    user_data, _nm_object_reload_properties_async);
@@ -1350,8 +1793,18 @@ _nm_object_reload_properties_async (NMObject *object,
 	if (priv->reload_results->next)
 		return;
 
+	/* Hold the reload open until all interfaces have been requested */
+	priv->reload_remaining++;
+
 	g_hash_table_iter_init (&iter, priv->proxies);
 	while (g_hash_table_iter_next (&iter, (gpointer *) &interface, (gpointer *) &proxy)) {
+		props = from_mirror ? managed_objects_get_properties (priv->connection, priv->path, interface) : NULL;
+		if (props) {
+			process_properties_changed (object, props, FALSE);
+			g_variant_unref (props);
+			continue;
+		}
+
 		priv->reload_remaining++;
 		g_dbus_proxy_call (priv->properties_proxy,
 		                   "GetAll",
@@ -1360,6 +1813,20 @@ _nm_object_reload_properties_async (NMObject *object,
 		                   cancellable,
 		                   reload_got_properties, object);
 	}
+
+	/* Everything came from the mirror; complete from the main loop as
+	 * the GetAll replies would have. */
+	if (--priv->reload_remaining == 0)
+		g_idle_add (reload_complete_idle, g_object_ref (object));
+}
+
+void
+_nm_object_reload_properties_async (NMObject *object,
+                                    GCancellable *cancellable,
+                                    GAsyncReadyCallback callback,
+                                    gpointer user_data)
+{
+	reload_properties_async (object, FALSE, cancellable, callback, user_data);
 }
 
 gboolean
@@ -1531,7 +1998,7 @@ init_async_got_proxy (GObject *object, GAsyncResult *result, gpointer user_data)
 
 	NM_OBJECT_GET_CLASS (self)->init_dbus (self);
 
-	_nm_object_reload_properties_async (init_data->object, init_data->cancellable, init_async_got_properties, init_data);
+	reload_properties_async (init_data->object, TRUE, init_data->cancellable, init_async_got_properties, init_data);
 }
 
 static void
@@ -1163,6 +1163,103 @@ test_activate_failed (void)
 
 /*******************************************************************/
 
+static guint
+get_call_count (const char *method)
+{
+	GVariant *ret, *counts;
+	guint32 count = 0;
+	GError *error = NULL;
+
+	ret = g_dbus_proxy_call_sync (sinfo->proxy,
+	                              "GetCallCounts",
+	                              NULL,
+	                              G_DBUS_CALL_FLAGS_NO_AUTO_START,
+	                              3000,
+	                              NULL,
+	                              &error);
+	g_assert_no_error (error);
+	g_variant_get (ret, "(@a{su})", &counts);
+	g_assert (g_variant_lookup (counts, method, "u", &count));
+	g_variant_unref (counts);
+	g_variant_unref (ret);
+
+	return count;
+}
+
+enum {
+	OBJECT_MANAGER_ASYNC  = 0x01,
+	OBJECT_MANAGER_DENIED = 0x02,
+};
+
+static void
+test_object_manager (gconstpointer user_data)
+{
+	guint flags = GPOINTER_TO_UINT (user_data);
+	NMClient *client = NULL;
+	const GPtrArray *devices;
+	NMDevice *device;
+	GError *error = NULL;
+	GVariant *ret;
+
+	sinfo = nm_test_service_init ();
+
+	/* Add the device before the client exists, so it is part of the
+	 * initial object graph */
+	ret = g_dbus_proxy_call_sync (sinfo->proxy,
+	                              "AddWiredDevice",
+	                              g_variant_new ("(s)", "eth0"),
+	                              G_DBUS_CALL_FLAGS_NO_AUTO_START,
+	                              3000,
+	                              NULL,
+	                              &error);
+	g_assert_no_error (error);
+	g_variant_unref (ret);
+
+	if (flags & OBJECT_MANAGER_DENIED) {
+		/* Like the bus policy of a daemon that doesn't allow the call */
+		ret = g_dbus_proxy_call_sync (sinfo->proxy,
+		                              "SetObjectManagerDenied",
+		                              g_variant_new ("(b)", TRUE),
+		                              G_DBUS_CALL_FLAGS_NO_AUTO_START,
+		                              3000,
+		                              NULL,
+		                              &error);
+		g_assert_no_error (error);
+		g_variant_unref (ret);
+	}
+
+	if (flags & OBJECT_MANAGER_ASYNC) {
+		nm_client_new_async (NULL, new_client_cb, &client);
+		g_main_loop_run (loop);
+	} else {
+		client = nm_client_new (NULL, &error);
+		g_assert_no_error (error);
+	}
+	g_assert (client != NULL);
+
+	/* The object graph is complete either way */
+	devices = nm_client_get_devices (client);
+	g_assert_cmpint (devices->len, ==, 1);
+	device = g_ptr_array_index (devices, 0);
+	g_assert (NM_IS_DEVICE_ETHERNET (device));
+	g_assert_cmpstr (nm_device_get_iface (device), ==, "eth0");
+	g_assert (nm_device_ethernet_get_hw_address (NM_DEVICE_ETHERNET (device)) != NULL);
+	g_assert_cmpint (nm_client_get_state (client), ==, NM_STATE_DISCONNECTED);
+
+	/* One GetManagedObjects call replaces the per-object GetAll calls;
+	 * if it is denied, libnm falls back to them. */
+	g_assert_cmpint (get_call_count ("GetManagedObjects"), ==, 1);
+	if (flags & OBJECT_MANAGER_DENIED)
+		g_assert_cmpint (get_call_count ("GetAll"), >, 0);
+	else
+		g_assert_cmpint (get_call_count ("GetAll"), ==, 0);
+
+	g_object_unref (client);
+	g_clear_pointer (&sinfo, nm_test_service_cleanup);
+}
+
+/*******************************************************************/
+
 NMTST_DEFINE ();
 
 int
@@ -1187,6 +1284,18 @@ main (int argc, char **argv)
 	g_test_add_func ("/libnm/active-connections", test_active_connections);
 	g_test_add_func ("/libnm/activate-virtual", test_activate_virtual);
 	g_test_add_func ("/libnm/activate-failed", test_activate_failed);
+	g_test_add_data_func ("/libnm/object-manager/sync",
+	                      GUINT_TO_POINTER (0),
+	                      test_object_manager);
+	g_test_add_data_func ("/libnm/object-manager/async",
+	                      GUINT_TO_POINTER (OBJECT_MANAGER_ASYNC),
+	                      test_object_manager);
+	g_test_add_data_func ("/libnm/object-manager/denied",
+	                      GUINT_TO_POINTER (OBJECT_MANAGER_DENIED),
+	                      test_object_manager);
+	g_test_add_data_func ("/libnm/object-manager/denied-async",
+	                      GUINT_TO_POINTER (OBJECT_MANAGER_ASYNC | OBJECT_MANAGER_DENIED),
+	                      test_object_manager);
 
 	return g_test_run ();
 }
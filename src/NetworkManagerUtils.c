@@ -204,6 +204,83 @@ nm_utils_ip6_address_clear_host_address (struct in6_addr *dst, const struct in6_
 	return dst;
 }
 
+typedef struct {
+	GPtrArray *items;
+	GPtrArray *results;
+	NMUtilsParallelMapFunc func;
+	gpointer user_data;
+	volatile gint next;
+} ParallelMapData;
+
+static gpointer
+parallel_map_worker (gpointer user_data)
+{
+	ParallelMapData *data = user_data;
+	guint idx;
+
+	while ((idx = (guint) g_atomic_int_add (&data->next, 1)) < data->items->len)
+		data->results->pdata[idx] = data->func (data->items->pdata[idx], data->user_data);
+	return NULL;
+}
+
+/**
+ * nm_utils_parallel_map:
+ * @items: the input items
+ * @func: function called once for every item
+ * @user_data: data passed to @func
+ *
+ * Calls @func for every element of @items, spreading the calls over one
+ * worker thread per online CPU, and waits until all of them returned.
+ * @func must be thread-safe and must not touch main-loop owned state;
+ * the caller's main loop is blocked meanwhile.
+ *
+ * Returns: (transfer container): the return values of @func, in the
+ *   order of @items.
+ */
+GPtrArray *
+nm_utils_parallel_map (GPtrArray *items,
+                       NMUtilsParallelMapFunc func,
+                       gpointer user_data)
+{
+	ParallelMapData data = { 0 };
+	GThread **threads;
+	long n_cpus;
+	guint n_threads, i;
+
+	g_return_val_if_fail (items, NULL);
+	g_return_val_if_fail (func, NULL);
+
+	data.items = items;
+	data.results = g_ptr_array_sized_new (items->len);
+	g_ptr_array_set_size (data.results, items->len);
+	data.func = func;
+	data.user_data = user_data;
+
+	n_cpus = sysconf (_SC_NPROCESSORS_ONLN);
+	n_threads = MIN (n_cpus > 0 ? (guint) n_cpus : 1, items->len);
+	if (n_threads <= 1) {
+		parallel_map_worker (&data);
+		return data.results;
+	}
+
+	/* The calling thread is one of the workers */
+	n_threads--;
+	threads = g_new0 (GThread *, n_threads);
+	for (i = 0; i < n_threads; i++) {
+		threads[i] = g_thread_try_new ("parallel-map", parallel_map_worker, &data, NULL);
+		if (!threads[i])
+			break;
+	}
+
+	parallel_map_worker (&data);
+
+	for (i = 0; i < n_threads && threads[i]; i++)
+		g_thread_join (threads[i]);
+	g_free (threads);
+
+	return data.results;
+}
+
 void
 nm_utils_array_remove_at_indexes (GArray *array, const guint *indexes_to_delete, gsize len)
 {
@@ -1946,6 +2023,44 @@ nm_utils_match_connection (GSList *connections,
 	return best_match;
 }
 
+/**
+ * nm_utils_connection_get_fingerprint:
+ * @connection: the #NMConnection
+ *
+ * Builds a key out of those inferrable properties that check_possible_match()
+ * never tolerates to differ: the connection type, master and slave type and
+ * the VLAN ID. Two connections with different fingerprints can never be
+ * matched by nm_utils_match_connection(), so the fingerprint can be used to
+ * narrow down the candidates before diffing them.
+ *
+ * Returns: the fingerprint; free with g_free().
+ */
+char *
+nm_utils_connection_get_fingerprint (NMConnection *connection)
+{
+	NMSettingConnection *s_con;
+	NMSettingVlan *s_vlan;
+	GString *str;
+
+	g_return_val_if_fail (NM_IS_CONNECTION (connection), NULL);
+
+	str = g_string_sized_new (64);
+
+	s_con = nm_connection_get_setting_connection (connection);
+	if (s_con) {
+		g_string_append_printf (str, "%s|%s|%s",
+		                        nm_setting_connection_get_connection_type (s_con) ?: "",
+		                        nm_setting_connection_get_master (s_con) ?: "",
+		                        nm_setting_connection_get_slave_type (s_con) ?: "");
+	}
+
+	s_vlan = nm_connection_get_setting_vlan (connection);
+	if (s_vlan)
+		g_string_append_printf (str, "|vlan:%u", nm_setting_vlan_get_id (s_vlan));
+
+	return g_string_free (str, FALSE);
+}
+
 int
 nm_utils_cmp_connection_by_autoconnect_priority (NMConnection **a, NMConnection **b)
 {
@@ -1971,6 +2086,127 @@ nm_utils_cmp_connection_by_autoconnect_priority (NMConnection **a, NMConnection
 	return 0;
 }
 
+/**
+ * nm_utils_connection_set_recheck:
+ * @set: a hash table of #NMConnection objects, owning a reference to each
+ * @connection: the #NMConnection to re-evaluate
+ * @check_func: returns whether @connection belongs into @set
+ * @user_data: data pointer passed to @check_func
+ *
+ * Adds @connection to @set or removes it from @set, depending on
+ * @check_func.
+ *
+ * Returns: %TRUE if the membership of @connection in @set changed.
+ */
+gboolean
+nm_utils_connection_set_recheck (GHashTable *set,
+                                 NMConnection *connection,
+                                 NMUtilsCheckConnectionFunc check_func,
+                                 gpointer user_data)
+{
+	gboolean was_member, member;
+
+	was_member = g_hash_table_contains (set, connection);
+	member = check_func (connection, user_data);
+	if (member == was_member)
+		return FALSE;
+
+	if (member)
+		g_hash_table_add (set, g_object_ref (connection));
+	else
+		g_hash_table_remove (set, connection);
+	return TRUE;
+}
+
+/**
+ * nm_utils_connection_set_update:
+ * @set: a hash table of #NMConnection objects, owning a reference to each
+ * @connections: all connections that may be members of @set
+ * @prune: if %TRUE, members of @set that are not in @connections are removed
+ * @filter_func: (allow-none): if given, only the connections for which it
+ * returns %TRUE are re-evaluated
+ * @check_func: returns whether a connection belongs into @set
+ * @user_data: data pointer passed to @filter_func and @check_func
+ *
+ * Updates @set in place instead of rebuilding it, so that the caller can
+ * tell whether anything changed. Without @filter_func and with @prune, the
+ * result is the same as rebuilding @set from @connections.
+ *
+ * Returns: %TRUE if @set changed.
+ */
+gboolean
+nm_utils_connection_set_update (GHashTable *set,
+                                const GSList *connections,
+                                gboolean prune,
+                                NMUtilsCheckConnectionFunc filter_func,
+                                NMUtilsCheckConnectionFunc check_func,
+                                gpointer user_data)
+{
+	const GSList *iter;
+	gboolean changed = FALSE;
+
+	if (prune && g_hash_table_size (set)) {
+		GHashTable *provided;
+		GHashTableIter hiter;
+		gpointer connection;
+
+		provided = g_hash_table_new (g_direct_hash, g_direct_equal);
+		for (iter = connections; iter; iter = g_slist_next (iter))
+			g_hash_table_add (provided, iter->data);
+
+		g_hash_table_iter_init (&hiter, set);
+		while (g_hash_table_iter_next (&hiter, &connection, NULL)) {
+			if (!g_hash_table_contains (provided, connection)) {
+				g_hash_table_iter_remove (&hiter);
+				changed = TRUE;
+			}
+		}
+		g_hash_table_unref (provided);
+	}
+
+	for (iter = connections; iter; iter = g_slist_next (iter)) {
+		NMConnection *connection = NM_CONNECTION (iter->data);
+
+		if (filter_func && !filter_func (connection, user_data))
+			continue;
+		if (nm_utils_connection_set_recheck (set, connection, check_func, user_data))
+			changed = TRUE;
+	}
+
+	return changed;
+}
+
+/**
+ * nm_utils_connection_set_carrier_changed:
+ * @set: a hash table of #NMConnection objects, owning a reference to each
+ * @connections: all connections that may be members of @set
+ * @all_need_carrier: whether every connection depends on the carrier,
+ * because the device itself is only available with a carrier
+ * @requires_carrier_func: returns whether a connection depends on the carrier
+ * @check_func: returns whether a connection belongs into @set
+ * @user_data: data pointer passed to @requires_carrier_func and @check_func
+ *
+ * Updates @set after the carrier changed. Unless @all_need_carrier is set,
+ * only the connections that require a carrier are re-evaluated.
+ *
+ * Returns: %TRUE if @set changed.
+ */
+gboolean
+nm_utils_connection_set_carrier_changed (GHashTable *set,
+                                         const GSList *connections,
+                                         gboolean all_need_carrier,
+                                         NMUtilsCheckConnectionFunc requires_carrier_func,
+                                         NMUtilsCheckConnectionFunc check_func,
+                                         gpointer user_data)
+{
+	return nm_utils_connection_set_update (set,
+	                                       connections,
+	                                       all_need_carrier,
+	                                       all_need_carrier ? NULL : requires_carrier_func,
+	                                       check_func,
+	                                       user_data);
+}
+
 /**************************************************************************/
 
 static gint64 monotonic_timestamp_offset_sec;
@@ -2530,6 +2766,22 @@ nm_utils_is_specific_hostname (const char *name)
 	return FALSE;
 }
 
+/* Whether the #GPtrArrays of strings @a and @b hold the same strings
+ * in the same order */
+gboolean
+nm_utils_strv_array_equal (const GPtrArray *a, const GPtrArray *b)
+{
+	guint i;
+
+	if (a->len != b->len)
+		return FALSE;
+	for (i = 0; i < a->len; i++) {
+		if (strcmp (a->pdata[i], b->pdata[i]))
+			return FALSE;
+	}
+	return TRUE;
+}
+
 /******************************************************************/
 
 /* Returns the "u" (universal/local) bit value for a Modified EUI-64 */
@@ -125,8 +125,29 @@ NMConnection *nm_utils_match_connection (GSList *connections,
                                          NMUtilsMatchFilterFunc match_filter_func,
                                          gpointer match_filter_data);
 
+char *nm_utils_connection_get_fingerprint (NMConnection *connection);
+
 int nm_utils_cmp_connection_by_autoconnect_priority (NMConnection **a, NMConnection **b);
 
+typedef gboolean (*NMUtilsCheckConnectionFunc) (NMConnection *connection, gpointer user_data);
+
+gboolean nm_utils_connection_set_recheck (GHashTable *set,
+                                          NMConnection *connection,
+                                          NMUtilsCheckConnectionFunc check_func,
+                                          gpointer user_data);
+gboolean nm_utils_connection_set_update (GHashTable *set,
+                                         const GSList *connections,
+                                         gboolean prune,
+                                         NMUtilsCheckConnectionFunc filter_func,
+                                         NMUtilsCheckConnectionFunc check_func,
+                                         gpointer user_data);
+gboolean nm_utils_connection_set_carrier_changed (GHashTable *set,
+                                                  const GSList *connections,
+                                                  gboolean all_need_carrier,
+                                                  NMUtilsCheckConnectionFunc requires_carrier_func,
+                                                  NMUtilsCheckConnectionFunc check_func,
+                                                  gpointer user_data);
+
 void nm_utils_log_connection_diff (NMConnection *connection, NMConnection *diff_base, guint32 level, guint64 domain, const char *name, const char *prefix);
 
 #define NM_UTILS_NS_PER_SECOND  ((gint64) 1000000000)
@@ -142,6 +163,8 @@ const char *nm_utils_ip4_property_path (const char *ifname, const char *property
 
 gboolean nm_utils_is_specific_hostname (const char *name);
 
+gboolean nm_utils_strv_array_equal (const GPtrArray *a, const GPtrArray *b);
+
 /* IPv6 Interface Identifer helpers */
 
 /**
@@ -181,6 +204,12 @@ void nm_utils_array_remove_at_indexes (GArray *array, const guint *indexes_to_de
 
 void nm_utils_setpgid (gpointer unused);
 
+typedef gpointer (*NMUtilsParallelMapFunc) (gpointer item, gpointer user_data);
+
+GPtrArray *nm_utils_parallel_map (GPtrArray *items,
+                                  NMUtilsParallelMapFunc func,
+                                  gpointer user_data);
+
 typedef enum {
 	NM_UTILS_TEST_NONE                              = 0,
 
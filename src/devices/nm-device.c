@@ -357,6 +357,7 @@ static gboolean dhcp6_start_with_link_ready (NMDevice *self, NMConnection *conne
 static NMActStageReturn linklocal6_start (NMDevice *self);
 
 static void _carrier_wait_check_queued_act_request (NMDevice *self);
+static void _recheck_available_connections (NMDevice *self, gboolean carrier_only);
 
 static gboolean nm_device_get_default_unmanaged (NMDevice *self);
 
@@ -1159,7 +1160,7 @@ carrier_changed (NMDevice *self, gboolean carrier)
 	if (!nm_device_get_managed (self))
 		return;
 
-	nm_device_recheck_available_connections (self);
+	_recheck_available_connections (self, TRUE);
 
 	/* ignore-carrier devices ignore all carrier-down events */
 	if (priv->ignore_carrier && !carrier)
@@ -7399,7 +7400,12 @@ _signal_available_connections_changed (NMDevice *self)
 static void
 _clear_available_connections (NMDevice *self, gboolean do_signal)
 {
-	g_hash_table_remove_all (NM_DEVICE_GET_PRIVATE (self)->available_connections);
+	NMDevicePrivate *priv = NM_DEVICE_GET_PRIVATE (self);
+
+	if (g_hash_table_size (priv->available_connections) == 0)
+		return;
+
+	g_hash_table_remove_all (priv->available_connections);
 	if (do_signal == TRUE)
 		_signal_available_connections_changed (self);
 }
@@ -7448,25 +7454,71 @@ check_connection_available (NMDevice *self,
 	return FALSE;
 }
 
-void
-nm_device_recheck_available_connections (NMDevice *self)
+static gboolean
+_check_connection_available_cb (NMConnection *connection, gpointer user_data)
 {
-	NMDevicePrivate *priv;
-	const GSList *connections, *iter;
+	return nm_device_check_connection_available (NM_DEVICE (user_data), connection, NM_DEVICE_CHECK_CON_AVAILABLE_NONE, NULL);
+}
 
-	g_return_if_fail (NM_IS_DEVICE (self));
+static gboolean
+_connection_requires_carrier_cb (NMConnection *connection, gpointer user_data)
+{
+	return connection_requires_carrier (connection);
+}
 
-	priv = NM_DEVICE_GET_PRIVATE(self);
+/* Re-evaluates @connection and updates the available set accordingly.
+ * Returns %TRUE if the membership of @connection changed. */
+static gboolean
+_recheck_available_connection (NMDevice *self, NMConnection *connection)
+{
+	return nm_utils_connection_set_recheck (NM_DEVICE_GET_PRIVATE (self)->available_connections,
+	                                        connection,
+	                                        _check_connection_available_cb,
+	                                        self);
+}
 
-	if (priv->con_provider) {
-		_clear_available_connections (self, FALSE);
+static void
+_recheck_available_connections (NMDevice *self, gboolean carrier_only)
+{
+	NMDevicePrivate *priv = NM_DEVICE_GET_PRIVATE (self);
+	const GSList *connections;
+	gboolean changed;
 
-		connections = nm_connection_provider_get_connections (priv->con_provider);
-		for (iter = connections; iter; iter = g_slist_next (iter))
-			_try_add_available_connection (self, NM_CONNECTION (iter->data));
+	if (!priv->con_provider)
+		return;
 
-		_signal_available_connections_changed (self);
+	connections = nm_connection_provider_get_connections (priv->con_provider);
+	if (carrier_only) {
+		/* Below DISCONNECTED the availability of the device itself depends
+		 * on the carrier, and so does every connection. Otherwise only
+		 * connections that require a carrier are affected, see
+		 * check_connection_available(). */
+		changed = nm_utils_connection_set_carrier_changed (priv->available_connections,
+		                                                   connections,
+		                                                   nm_device_get_state (self) < NM_DEVICE_STATE_DISCONNECTED,
+		                                                   _connection_requires_carrier_cb,
+		                                                   _check_connection_available_cb,
+		                                                   self);
+	} else {
+		/* A full recheck also drops entries the provider does not know anymore */
+		changed = nm_utils_connection_set_update (priv->available_connections,
+		                                          connections,
+		                                          TRUE,
+		                                          NULL,
+		                                          _check_connection_available_cb,
+		                                          self);
 	}
+
+	if (changed)
+		_signal_available_connections_changed (self);
+}
+
+void
+nm_device_recheck_available_connections (NMDevice *self)
+{
+	g_return_if_fail (NM_IS_DEVICE (self));
+
+	_recheck_available_connections (self, FALSE);
 }
 
 /**
@@ -7522,14 +7574,7 @@ cp_connection_removed (NMConnectionProvider *cp, NMConnection *connection, gpoin
 static void
 cp_connection_updated (NMConnectionProvider *cp, NMConnection *connection, gpointer user_data)
 {
-	gboolean added, deleted;
-
-	/* FIXME: don't remove it from the hash if it's just going to get re-added */
-	deleted = _del_available_connection (NM_DEVICE (user_data), connection);
-	added = _try_add_available_connection (NM_DEVICE (user_data), connection);
-
-	/* Only signal if the connection was removed OR added, but not both */
-	if (added != deleted)
+	if (_recheck_available_connection (NM_DEVICE (user_data), connection))
 		_signal_available_connections_changed (NM_DEVICE (user_data));
 }
 
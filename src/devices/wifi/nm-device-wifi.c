@@ -31,6 +31,7 @@
 
 #include "nm-glib-compat.h"
 #include "nm-dbus-manager.h"
+#include "nm-properties-changed-signal.h"
 #include "nm-device.h"
 #include "nm-device-wifi.h"
 #include "nm-device-private.h"
@@ -56,6 +57,7 @@
 #include "nm-dbus-glib-types.h"
 #include "nm-wifi-enum-types.h"
 #include "nm-connection-provider.h"
+#include "nm-wifi-scan-policy.h"
 
 
 static gboolean impl_device_get_access_points (NMDeviceWifi *device,
@@ -80,6 +82,12 @@ _LOG_DECLARE_SELF(NMDeviceWifi);
 #define SCAN_INTERVAL_STEP 20
 #define SCAN_INTERVAL_MAX 120
 
+/* Minimum time between two Bitrate change signals, in milliseconds */
+#define BITRATE_MIN_INTERVAL_MS 5000
+
+/* How long to collect BSSes reported outside of a scan, in milliseconds */
+#define BSS_BATCH_DELAY_MS 250
+
 #define WIRELESS_SECRETS_TRIES "wireless-secrets-tries"
 
 G_DEFINE_TYPE (NMDeviceWifi, nm_device_wifi, NM_TYPE_DEVICE)
@@ -96,6 +104,7 @@ enum {
 	PROP_ACTIVE_ACCESS_POINT,
 	PROP_CAPABILITIES,
 	PROP_SCANNING,
+	PROP_SCAN_POLICY,
 
 	LAST_PROP
 };
@@ -114,6 +123,7 @@ struct _NMDeviceWifiPrivate {
 	gint8             invalid_strength_counter;
 
 	GHashTable *      aps;
+	GHashTable *      aps_by_sup_path; /* supplicant BSS path -> AP in @aps */
 	NMAccessPoint *   current_ap;
 	guint32           rate;
 	gboolean          enabled; /* rfkilled or not */
@@ -124,6 +134,18 @@ struct _NMDeviceWifiPrivate {
 	guint             pending_scan_id;
 	guint             ap_dump_id;
 	gboolean          requested_scan;
+	gboolean          user_requested_scan;
+
+	/* Decides the kind of each scan from what earlier scans found */
+	NMWifiScanPolicy *scan_policy;
+	guint             scan_max_interval; /* seconds, from the last scan plan */
+
+	/* BSSes reported by the supplicant that were not applied yet, see
+	 * bss_batch_flush().  Maps the BSS path to a GPtrArray of property
+	 * sets in the order received, or to NULL if the BSS was removed.
+	 */
+	GHashTable *      pending_bss;
+	guint             pending_bss_id;
 
 	NMSupplicantManager   *sup_mgr;
 	NMSupplicantInterface *sup_iface;
@@ -180,6 +202,10 @@ static void supplicant_iface_notify_current_bss (NMSupplicantInterface *iface,
                                                  GParamSpec *pspec,
                                                  NMDeviceWifi *self);
 
+static void bss_batch_clear (NMDeviceWifi *self);
+
+static void bss_batch_flush (NMDeviceWifi *self);
+
 static gboolean request_wireless_scan (gpointer user_data);
 
 static void emit_ap_added_removed (NMDeviceWifi *self,
@@ -295,6 +321,7 @@ supplicant_interface_release (NMDeviceWifi *self)
 	       priv->scan_interval);
 
 	nm_clear_g_source (&priv->ap_dump_id);
+	bss_batch_clear (self);
 
 	if (priv->sup_iface) {
 		remove_supplicant_interface_error_handler (self);
@@ -321,17 +348,33 @@ get_ap_by_path (NMDeviceWifi *self, const char *path)
 static NMAccessPoint *
 get_ap_by_supplicant_path (NMDeviceWifi *self, const char *path)
 {
-	GHashTableIter iter;
-	NMAccessPoint *ap;
-
 	g_return_val_if_fail (path != NULL, NULL);
+	return g_hash_table_lookup (NM_DEVICE_WIFI_GET_PRIVATE (self)->aps_by_sup_path, path);
+}
 
-	g_hash_table_iter_init (&iter, NM_DEVICE_WIFI_GET_PRIVATE (self)->aps);
-	while (g_hash_table_iter_next (&iter, NULL, (gpointer) &ap)) {
-		if (g_strcmp0 (path, nm_ap_get_supplicant_path (ap)) == 0)
-			return ap;
-	}
-	return NULL;
+/* Takes ownership of @ap */
+static void
+add_ap (NMDeviceWifi *self, NMAccessPoint *ap)
+{
+	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
+	const char *sup_path = nm_ap_get_supplicant_path (ap);
+
+	g_hash_table_insert (priv->aps, (gpointer) nm_ap_get_dbus_path (ap), ap);
+
+	/* The supplicant path of an AP is set once and never changes */
+	if (sup_path)
+		g_hash_table_insert (priv->aps_by_sup_path, (gpointer) sup_path, ap);
+}
+
+static void
+remove_ap (NMDeviceWifi *self, NMAccessPoint *ap)
+{
+	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
+	const char *sup_path = nm_ap_get_supplicant_path (ap);
+
+	if (sup_path && g_hash_table_lookup (priv->aps_by_sup_path, sup_path) == ap)
+		g_hash_table_remove (priv->aps_by_sup_path, sup_path);
+	g_hash_table_remove (priv->aps, nm_ap_get_dbus_path (ap));
 }
 
 static void
@@ -384,7 +427,7 @@ set_current_ap (NMDeviceWifi *self, NMAccessPoint *new_ap, gboolean recheck_avai
 
 		if (force_remove_old_ap || mode == NM_802_11_MODE_ADHOC || mode == NM_802_11_MODE_AP || nm_ap_get_fake (old_ap)) {
 			emit_ap_added_removed (self, ACCESS_POINT_REMOVED, old_ap, FALSE);
-			g_hash_table_remove (priv->aps, nm_ap_get_dbus_path (old_ap));
+			remove_ap (self, old_ap);
 			if (recheck_available_connections)
 				nm_device_recheck_available_connections (NM_DEVICE (self));
 		}
@@ -403,6 +446,8 @@ periodic_update (NMDeviceWifi *self)
 	int percent;
 	NMDeviceState state;
 	guint32 supplicant_state;
+	const char *bssid;
+	gint32 now;
 
 	/* BSSID and signal strength have meaningful values only if the device
 	 * is activated and not scanning.
@@ -432,6 +477,20 @@ periodic_update (NMDeviceWifi *self)
 			nm_ap_set_strength (priv->current_ap, (gint8) percent);
 			priv->invalid_strength_counter = 0;
 		}
+
+		now = nm_utils_get_monotonic_timestamp_s ();
+		bssid = nm_ap_get_address (priv->current_ap);
+		nm_wifi_scan_policy_link_sample (priv->scan_policy, bssid,
+		                                 nm_ap_get_strength (priv->current_ap), now);
+
+		/* Don't wait out a long scan interval while the link is fading */
+		if (   nm_wifi_scan_policy_link_degraded (priv->scan_policy, bssid)
+		    && priv->pending_scan_id
+		    && priv->scheduled_scan_time > now + SCAN_INTERVAL_MIN + SCAN_INTERVAL_STEP) {
+			_LOGD (LOGD_WIFI_SCAN, "link to %s degraded, scanning sooner", str_if_set (bssid, "(none)"));
+			priv->scan_interval = SCAN_INTERVAL_MIN + SCAN_INTERVAL_STEP;
+			schedule_scan (self, FALSE);
+		}
 	}
 
 	new_rate = nm_platform_wifi_get_rate (NM_PLATFORM_GET, ifindex);
@@ -477,9 +536,13 @@ remove_all_aps (NMDeviceWifi *self)
 	GHashTableIter iter;
 	NMAccessPoint *ap;
 
+	bss_batch_clear (self);
+	nm_wifi_scan_policy_reset (priv->scan_policy);
+
 	if (g_hash_table_size (priv->aps)) {
 		set_current_ap (self, NULL, FALSE, FALSE);
 
+		g_hash_table_remove_all (priv->aps_by_sup_path);
 		g_hash_table_iter_init (&iter, priv->aps);
 		while (g_hash_table_iter_next (&iter, NULL, (gpointer) &ap)) {
 			emit_ap_added_removed (self, ACCESS_POINT_REMOVED, ap, FALSE);
@@ -1073,6 +1136,7 @@ request_scan_cb (NMDevice *device,
 	}
 
 	cancel_pending_scan (self);
+	NM_DEVICE_WIFI_GET_PRIVATE (self)->user_requested_scan = TRUE;
 	request_wireless_scan (self);
 	dbus_g_method_return (context);
 }
@@ -1226,30 +1290,68 @@ check_scanning_allowed (NMDeviceWifi *self)
 	return g_value_get_boolean (&retval);
 }
 
+typedef struct {
+	NMDeviceWifi *self;
+	gboolean likely_only;
+	gint32 now;
+	guint skipped;
+} HiddenFilterData;
+
+/* Whether one of the BSSIDs @connection was seen on is still around */
+static gboolean
+hidden_connection_likely (NMDeviceWifi *self, NMConnection *connection, gint32 now)
+{
+	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
+	gs_free char **bssids = NULL;
+	guint i;
+
+	if (!NM_IS_SETTINGS_CONNECTION (connection))
+		return FALSE;
+
+	bssids = nm_settings_connection_get_seen_bssids (NM_SETTINGS_CONNECTION (connection));
+	for (i = 0; bssids && bssids[i]; i++) {
+		if (nm_wifi_scan_policy_bssid_recent (priv->scan_policy, bssids[i], now))
+			return TRUE;
+	}
+	return FALSE;
+}
+
 static gboolean
 hidden_filter_func (NMConnectionProvider *provider,
                     NMConnection *connection,
                     gpointer user_data)
 {
+	HiddenFilterData *data = user_data;
 	NMSettingWireless *s_wifi;
 
 	s_wifi = (NMSettingWireless *) nm_connection_get_setting_wireless (connection);
-	return s_wifi ? nm_setting_wireless_get_hidden (s_wifi) : FALSE;
+	if (!s_wifi || !nm_setting_wireless_get_hidden (s_wifi))
+		return FALSE;
+
+	if (data->likely_only && !hidden_connection_likely (data->self, connection, data->now)) {
+		data->skipped++;
+		return FALSE;
+	}
+	return TRUE;
 }
 
 static GPtrArray *
-build_hidden_probe_list (NMDeviceWifi *self)
+build_hidden_probe_list (NMDeviceWifi *self, NMWifiScanHidden hidden, guint *out_skipped)
 {
 	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
 	guint max_scan_ssids = nm_supplicant_interface_get_max_scan_ssids (priv->sup_iface);
 	GSList *connections, *iter;
 	GPtrArray *ssids = NULL;
 	static GByteArray *nullssid = NULL;
+	HiddenFilterData filter_data = { self, FALSE, 0, 0 };
 
 	/* Need at least two: wildcard SSID and one or more hidden SSIDs */
-	if (max_scan_ssids < 2)
+	if (max_scan_ssids < 2 || hidden == NM_WIFI_SCAN_HIDDEN_NONE)
 		return NULL;
 
+	filter_data.likely_only = (hidden == NM_WIFI_SCAN_HIDDEN_LIKELY);
+	filter_data.now = nm_utils_get_monotonic_timestamp_s ();
+
 	/* Static wildcard SSID used for every scan */
 	if (G_UNLIKELY (nullssid == NULL))
 		nullssid = g_byte_array_new ();
@@ -1259,7 +1361,7 @@ build_hidden_probe_list (NMDeviceWifi *self)
 	                                                           NM_SETTING_WIRELESS_SETTING_NAME,
 	                                                           NULL,
 	                                                           hidden_filter_func,
-	                                                           NULL);
+	                                                           &filter_data);
 	if (connections && connections->data) {
 		ssids = g_ptr_array_new_full (max_scan_ssids - 1, (GDestroyNotify) g_byte_array_unref);
 		g_ptr_array_add (ssids, g_byte_array_ref (nullssid));  /* Add wildcard SSID */
@@ -1283,16 +1385,46 @@ build_hidden_probe_list (NMDeviceWifi *self)
 	}
 	g_slist_free (connections);
 
+	*out_skipped = filter_data.skipped;
 	return ssids;
 }
 
+static void
+plan_scan (NMDeviceWifi *self, gboolean user_requested, NMWifiScanPlan *plan)
+{
+	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
+	gboolean connected;
+
+	connected =    nm_device_get_state (NM_DEVICE (self)) == NM_DEVICE_STATE_ACTIVATED
+	            && priv->current_ap;
+	nm_wifi_scan_policy_plan (priv->scan_policy,
+	                          connected,
+	                          connected ? nm_ap_get_address (priv->current_ap) : NULL,
+	                          user_requested,
+	                          nm_utils_get_monotonic_timestamp_s (),
+	                          plan);
+	priv->scan_max_interval = plan->max_interval;
+
+	_LOGD (LOGD_WIFI_SCAN, "planned %s scan on %u channels (%s), next in at most %u seconds",
+	       nm_wifi_scan_kind_to_string (plan->kind),
+	       plan->freqs ? plan->freqs->len : 0,
+	       plan->reason,
+	       plan->max_interval);
+}
+
 static gboolean
 request_wireless_scan (gpointer user_data)
 {
 	NMDeviceWifi *self = NM_DEVICE_WIFI (user_data);
 	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
 	gboolean backoff = FALSE;
+	gboolean user_requested;
 	GPtrArray *ssids = NULL;
+	guint hidden_skipped = 0;
+	NMWifiScanPlan plan;
+
+	user_requested = priv->user_requested_scan;
+	priv->user_requested_scan = FALSE;
 
 	if (priv->requested_scan) {
 		/* There's already a scan in progress */
@@ -1302,7 +1434,8 @@ request_wireless_scan (gpointer user_data)
 	if (check_scanning_allowed (self)) {
 		_LOGD (LOGD_WIFI_SCAN, "scanning requested");
 
-		ssids = build_hidden_probe_list (self);
+		plan_scan (self, user_requested, &plan);
+		ssids = build_hidden_probe_list (self, plan.hidden, &hidden_skipped);
 
 		if (nm_logging_enabled (LOGL_DEBUG, LOGD_WIFI_SCAN)) {
 			if (ssids) {
@@ -1323,15 +1456,26 @@ request_wireless_scan (gpointer user_data)
 				_LOGD (LOGD_WIFI_SCAN, "no SSIDs to probe scan");
 		}
 
-		if (nm_supplicant_interface_request_scan (priv->sup_iface, ssids)) {
+		if (nm_supplicant_interface_request_scan (priv->sup_iface,
+		                                          ssids,
+		                                          (   plan.kind == NM_WIFI_SCAN_KIND_FULL_PASSIVE
+		                                           || plan.kind == NM_WIFI_SCAN_KIND_TARGETED_PASSIVE),
+		                                          plan.freqs)) {
 			/* success */
 			backoff = TRUE;
 			priv->requested_scan = TRUE;
 			nm_device_add_pending_action (NM_DEVICE (self), "scan", TRUE);
+
+			nm_wifi_scan_policy_scan_requested (priv->scan_policy, &plan);
+			nm_wifi_scan_policy_hidden_probed (priv->scan_policy,
+			                                   ssids ? ssids->len - 1 : 0,
+			                                   hidden_skipped);
 		}
+		g_object_notify (G_OBJECT (self), NM_DEVICE_WIFI_SCAN_POLICY);
 
 		if (ssids)
 			g_ptr_array_unref (ssids);
+		nm_wifi_scan_plan_clear (&plan);
 	} else
 		_LOGD (LOGD_WIFI_SCAN, "scan requested but not allowed at this time");
 
@@ -1352,15 +1496,20 @@ schedule_scan (NMDeviceWifi *self, gboolean backoff)
 {
 	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
 	gint32 now = nm_utils_get_monotonic_timestamp_s ();
+	guint interval = priv->scan_interval;
+
+	/* The scan policy may want the next scan sooner than the backoff would */
+	if (priv->scan_max_interval)
+		interval = MIN (interval, priv->scan_max_interval);
 
-	/* Cancel the pending scan if it would happen later than (now + the scan_interval) */
+	/* Cancel the pending scan if it would happen later than (now + the scan interval) */
 	if (priv->pending_scan_id) {
-		if (now + priv->scan_interval < priv->scheduled_scan_time)
+		if (now + interval < priv->scheduled_scan_time)
 			cancel_pending_scan (self);
 	}
 
 	if (!priv->pending_scan_id) {
-		guint factor = 2, next_scan = priv->scan_interval;
+		guint factor = 2, next_scan = interval;
 
 		if (    nm_device_is_activating (NM_DEVICE (self))
 		    || (nm_device_get_state (NM_DEVICE (self)) == NM_DEVICE_STATE_ACTIVATED))
@@ -1370,7 +1519,7 @@ schedule_scan (NMDeviceWifi *self, gboolean backoff)
 		                                               request_wireless_scan,
 		                                               self);
 
-		priv->scheduled_scan_time = now + priv->scan_interval;
+		priv->scheduled_scan_time = now + next_scan;
 		if (backoff && (priv->scan_interval < (SCAN_INTERVAL_MAX / factor))) {
 				priv->scan_interval += (SCAN_INTERVAL_STEP / factor);
 				/* Ensure the scan interval will never be less than 20s... */
@@ -1413,8 +1562,12 @@ supplicant_iface_scan_done_cb (NMSupplicantInterface *iface,
 	priv->last_scan = nm_utils_get_monotonic_timestamp_s ();
 	schedule_scan (self, success);
 
+	/* Apply everything the scan reported in one go */
+	bss_batch_flush (self);
+
 	if (priv->requested_scan) {
 		priv->requested_scan = FALSE;
+		nm_wifi_scan_policy_scan_done (priv->scan_policy, success, priv->last_scan);
 		nm_device_remove_pending_action (NM_DEVICE (self), "scan", TRUE);
 	}
 }
@@ -1487,34 +1640,44 @@ try_fill_ssid_for_hidden_ap (NMAccessPoint *ap)
 }
 
 static void
-supplicant_iface_new_bss_cb (NMSupplicantInterface *iface,
-                             const char *object_path,
-                             GVariant *properties,
-                             NMDeviceWifi *self)
+scan_policy_ap_seen (NMDeviceWifi *self, NMAccessPoint *ap)
+{
+	nm_wifi_scan_policy_bss_seen (NM_DEVICE_WIFI_GET_PRIVATE (self)->scan_policy,
+	                              nm_ap_get_address (ap),
+	                              nm_ap_get_ssid (ap),
+	                              nm_ap_get_freq (ap),
+	                              nm_ap_get_strength (ap),
+	                              nm_utils_get_monotonic_timestamp_s ());
+}
+
+/* Returns the AP if it was newly added */
+static NMAccessPoint *
+bss_batch_apply_new (NMDeviceWifi *self,
+                     const char *object_path,
+                     GPtrArray *props_list)
 {
-	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
-	NMDeviceState state;
 	NMAccessPoint *ap;
 	NMAccessPoint *found_ap = NULL;
 	const GByteArray *ssid;
 	const char *bssid;
+	guint i;
 
-	g_return_if_fail (self != NULL);
-	g_return_if_fail (properties != NULL);
-	g_return_if_fail (iface != NULL);
-
-	/* Ignore new APs when unavailable, unmanaged, or in AP mode */
-	state = nm_device_get_state (NM_DEVICE (self));
-	if (state <= NM_DEVICE_STATE_UNAVAILABLE)
-		return;
-	if (NM_DEVICE_WIFI_GET_PRIVATE (self)->mode == NM_802_11_MODE_AP)
-		return;
+	found_ap = get_ap_by_supplicant_path (self, object_path);
+	if (found_ap) {
+		for (i = 0; i < props_list->len; i++)
+			nm_ap_update_from_properties (found_ap, object_path, props_list->pdata[i]);
+		nm_ap_dump (found_ap, "updated ", nm_device_get_iface (NM_DEVICE (self)));
+		scan_policy_ap_seen (self, found_ap);
+		return NULL;
+	}
 
-	ap = nm_ap_new_from_properties (object_path, properties);
+	ap = nm_ap_new_from_properties (object_path, props_list->pdata[0]);
 	if (!ap) {
 		_LOGW (LOGD_WIFI_SCAN, "invalid AP properties received");
-		return;
+		return NULL;
 	}
+	for (i = 1; i < props_list->len; i++)
+		nm_ap_update_from_properties (ap, object_path, props_list->pdata[i]);
 
 	/* Let the manager try to fill in the SSID from seen-bssids lists */
 	bssid = nm_ap_get_address (ap);
@@ -1535,38 +1698,192 @@ supplicant_iface_new_bss_cb (NMSupplicantInterface *iface,
 		}
 	}
 
-	found_ap = get_ap_by_supplicant_path (self, object_path);
-	if (found_ap) {
-		nm_ap_dump (ap, "updated ", nm_device_get_iface (NM_DEVICE (self)));
-		nm_ap_update_from_properties (found_ap, object_path, properties);
-	} else {
-		nm_ap_dump (ap, "added   ", nm_device_get_iface (NM_DEVICE (self)));
-		nm_ap_export_to_dbus (ap);
-		g_hash_table_insert (priv->aps,
-		                     (gpointer) nm_ap_get_dbus_path (ap),
-		                     g_object_ref (ap));
-		emit_ap_added_removed (self, ACCESS_POINT_ADDED, ap, TRUE);
+	nm_ap_dump (ap, "added   ", nm_device_get_iface (NM_DEVICE (self)));
+	nm_ap_export_to_dbus (ap);
+	add_ap (self, ap);
+	scan_policy_ap_seen (self, ap);
+	return ap;
+}
+
+/* Returns TRUE if the AP was removed */
+static gboolean
+bss_batch_apply_removed (NMDeviceWifi *self, const char *object_path)
+{
+	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
+	NMAccessPoint *ap;
+
+	ap = get_ap_by_supplicant_path (self, object_path);
+	if (!ap)
+		return FALSE;
+
+	if (ap == priv->current_ap) {
+		/* The current AP cannot be removed (to prevent NM indicating that
+		 * it is connected, but to nothing), but it must be removed later
+		 * when the current AP is changed or cleared.  Set 'fake' to
+		 * indicate that this AP is now unknown to the supplicant.
+		 */
+		nm_ap_set_fake (ap, TRUE);
+		return FALSE;
 	}
 
-	g_object_unref (ap);
+	nm_ap_dump (ap, "removed ", nm_device_get_iface (NM_DEVICE (self)));
+	g_signal_emit (self, signals[ACCESS_POINT_REMOVED], 0, ap);
+	remove_ap (self, ap);
+	return TRUE;
+}
+
+/* Applies all pending BSS changes.  Each added or removed AP still gets its
+ * own AccessPointAdded/AccessPointRemoved signal, but the AccessPoints
+ * property, the available connections and the auto-activation check are
+ * only updated once for the whole batch.
+ */
+static void
+bss_batch_flush (NMDeviceWifi *self)
+{
+	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
+	GHashTableIter iter;
+	const char *path;
+	GPtrArray *props_list;
+	NMAccessPoint *ap;
+	NMDeviceState state;
+	const char *current_bss = NULL;
+	gboolean ignore_new, current_found = FALSE;
+	guint n_added = 0, n_removed = 0;
+
+	nm_clear_g_source (&priv->pending_bss_id);
+	if (!g_hash_table_size (priv->pending_bss))
+		return;
+
+	/* Ignore new APs when unavailable, unmanaged, or in AP mode */
+	state = nm_device_get_state (NM_DEVICE (self));
+	ignore_new = state <= NM_DEVICE_STATE_UNAVAILABLE || priv->mode == NM_802_11_MODE_AP;
+
+	if (priv->sup_iface)
+		current_bss = nm_supplicant_interface_get_current_bss (priv->sup_iface);
+
+	g_object_freeze_notify (G_OBJECT (self));
+
+	g_hash_table_iter_init (&iter, priv->pending_bss);
+	while (g_hash_table_iter_next (&iter, (gpointer) &path, (gpointer) &props_list)) {
+		if (!props_list) {
+			if (bss_batch_apply_removed (self, path))
+				n_removed++;
+			continue;
+		}
+
+		if (ignore_new)
+			continue;
+
+		ap = bss_batch_apply_new (self, path, props_list);
+		if (ap) {
+			g_signal_emit (self, signals[ACCESS_POINT_ADDED], 0, ap);
+			n_added++;
+		}
+		if (g_strcmp0 (current_bss, path) == 0)
+			current_found = TRUE;
+	}
+	g_hash_table_remove_all (priv->pending_bss);
+
+	if (n_added || n_removed) {
+		_LOGD (LOGD_WIFI_SCAN, "scan results: %u APs added, %u removed", n_added, n_removed);
+		g_object_notify (G_OBJECT (self), NM_DEVICE_WIFI_ACCESS_POINTS);
+		nm_device_emit_recheck_auto_activate (NM_DEVICE (self));
+		nm_device_recheck_available_connections (NM_DEVICE (self));
+	}
+
+	g_object_thaw_notify (G_OBJECT (self));
 
 	/* Update the current AP if the supplicant notified a current BSS change
 	 * before it sent the current BSS's scan result.
 	 */
-	if (g_strcmp0 (nm_supplicant_interface_get_current_bss (iface), object_path) == 0)
+	if (current_found)
 		supplicant_iface_notify_current_bss (priv->sup_iface, NULL, self);
 
 	schedule_ap_list_dump (self);
 }
 
+static gboolean
+bss_batch_flush_cb (gpointer user_data)
+{
+	NMDeviceWifi *self = NM_DEVICE_WIFI (user_data);
+
+	NM_DEVICE_WIFI_GET_PRIVATE (self)->pending_bss_id = 0;
+	bss_batch_flush (self);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+bss_batch_schedule (NMDeviceWifi *self)
+{
+	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
+
+	if (priv->pending_bss_id || !g_hash_table_size (priv->pending_bss))
+		return;
+
+	/* While a scan is running the batch is applied on ScanDone */
+	if (priv->sup_iface && nm_supplicant_interface_get_scanning (priv->sup_iface))
+		return;
+
+	priv->pending_bss_id = g_timeout_add (BSS_BATCH_DELAY_MS, bss_batch_flush_cb, self);
+}
+
+static void
+bss_batch_clear (NMDeviceWifi *self)
+{
+	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
+
+	nm_clear_g_source (&priv->pending_bss_id);
+	g_hash_table_remove_all (priv->pending_bss);
+}
+
+static void
+pending_bss_free (gpointer data)
+{
+	if (data)
+		g_ptr_array_unref (data);
+}
+
+static void
+supplicant_iface_new_bss_cb (NMSupplicantInterface *iface,
+                             const char *object_path,
+                             GVariant *properties,
+                             NMDeviceWifi *self)
+{
+	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
+	NMDeviceState state;
+	GPtrArray *props_list = NULL;
+
+	g_return_if_fail (self != NULL);
+	g_return_if_fail (properties != NULL);
+	g_return_if_fail (iface != NULL);
+
+	/* Ignore new APs when unavailable, unmanaged, or in AP mode */
+	state = nm_device_get_state (NM_DEVICE (self));
+	if (state <= NM_DEVICE_STATE_UNAVAILABLE)
+		return;
+	if (priv->mode == NM_802_11_MODE_AP)
+		return;
+
+	g_hash_table_lookup_extended (priv->pending_bss, object_path, NULL, (gpointer) &props_list);
+	if (!props_list) {
+		props_list = g_ptr_array_new_with_free_func ((GDestroyNotify) g_variant_unref);
+		g_hash_table_insert (priv->pending_bss, g_strdup (object_path), props_list);
+	}
+	g_ptr_array_add (props_list, g_variant_ref (properties));
+
+	bss_batch_schedule (self);
+}
+
 static void
 supplicant_iface_bss_updated_cb (NMSupplicantInterface *iface,
                                  const char *object_path,
                                  GVariant *properties,
                                  NMDeviceWifi *self)
 {
+	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
 	NMDeviceState state;
 	NMAccessPoint *ap;
+	GPtrArray *props_list;
 
 	g_return_if_fail (self != NULL);
 	g_return_if_fail (object_path != NULL);
@@ -1577,10 +1894,18 @@ supplicant_iface_bss_updated_cb (NMSupplicantInterface *iface,
 	if (state <= NM_DEVICE_STATE_UNAVAILABLE)
 		return;
 
+	/* A BSS that is still pending gets the update along with the batch */
+	if (g_hash_table_lookup_extended (priv->pending_bss, object_path, NULL, (gpointer) &props_list)) {
+		if (props_list)
+			g_ptr_array_add (props_list, g_variant_ref (properties));
+		return;
+	}
+
 	ap = get_ap_by_supplicant_path (self, object_path);
 	if (ap) {
 		nm_ap_dump (ap, "updated ", nm_device_get_iface (NM_DEVICE (self)));
 		nm_ap_update_from_properties (ap, object_path, properties);
+		scan_policy_ap_seen (self, ap);
 		schedule_ap_list_dump (self);
 	}
 }
@@ -1591,28 +1916,19 @@ supplicant_iface_bss_removed_cb (NMSupplicantInterface *iface,
                                  NMDeviceWifi *self)
 {
 	NMDeviceWifiPrivate *priv;
-	NMAccessPoint *ap;
 
 	g_return_if_fail (self != NULL);
 	g_return_if_fail (object_path != NULL);
 
 	priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
-	ap = get_ap_by_supplicant_path (self, object_path);
-	if (ap) {
-		if (ap == priv->current_ap) {
-			/* The current AP cannot be removed (to prevent NM indicating that
-			 * it is connected, but to nothing), but it must be removed later
-			 * when the current AP is changed or cleared.  Set 'fake' to
-			 * indicate that this AP is now unknown to the supplicant.
-			 */
-			nm_ap_set_fake (ap, TRUE);
-		} else {
-			nm_ap_dump (ap, "removed ", nm_device_get_iface (NM_DEVICE (self)));
-			emit_ap_added_removed (self, ACCESS_POINT_REMOVED, ap, TRUE);
-			g_hash_table_remove (priv->aps, nm_ap_get_dbus_path (ap));
-			schedule_ap_list_dump (self);
-		}
-	}
+
+	/* Nothing to do for a BSS that was never applied */
+	if (   !get_ap_by_supplicant_path (self, object_path)
+	    && !g_hash_table_contains (priv->pending_bss, object_path))
+		return;
+
+	g_hash_table_insert (priv->pending_bss, g_strdup (object_path), NULL);
+	bss_batch_schedule (self);
 }
 
 static void
@@ -1999,6 +2315,10 @@ supplicant_iface_notify_scanning_cb (NMSupplicantInterface *iface,
 
 	g_object_notify (G_OBJECT (self), "scanning");
 
+	/* Pick up results that arrive after ScanDone */
+	if (!scanning)
+		bss_batch_schedule (self);
+
 	/* Run a quick update of current AP when coming out of a scan */
 	state = nm_device_get_state (NM_DEVICE (self));
 	if (!scanning && state == NM_DEVICE_STATE_ACTIVATED)
@@ -2015,8 +2335,12 @@ supplicant_iface_notify_current_bss (NMSupplicantInterface *iface,
 	NMAccessPoint *new_ap = NULL;
 
 	current_bss = nm_supplicant_interface_get_current_bss (iface);
-	if (current_bss)
+	if (current_bss) {
+		/* Don't wait for the scan to finish to learn about the current BSS */
+		if (g_hash_table_lookup (priv->pending_bss, current_bss))
+			bss_batch_flush (self);
 		new_ap = get_ap_by_supplicant_path (self, current_bss);
+	}
 
 	if (new_ap != priv->current_ap) {
 		const char *new_bssid = NULL;
@@ -2047,6 +2371,8 @@ supplicant_iface_notify_current_bss (NMSupplicantInterface *iface,
 		       new_bssid ? new_bssid : "(none)",
 		       new_ssid ? nm_utils_escape_ssid (new_ssid->data, new_ssid->len) : "(none)");
 
+		nm_wifi_scan_policy_roamed (priv->scan_policy, old_bssid, new_bssid,
+		                            nm_utils_get_monotonic_timestamp_s ());
 		set_current_ap (self, new_ap, TRUE, FALSE);
 	}
 }
@@ -2322,7 +2648,7 @@ act_stage1_prepare (NMDevice *device, NMDeviceStateReason *reason)
 		nm_ap_set_address (ap, nm_device_get_hw_address (device));
 
 	nm_ap_export_to_dbus (ap);
-	g_hash_table_insert (priv->aps, (gpointer) nm_ap_get_dbus_path (ap), ap);
+	add_ap (self, ap);
 	g_object_freeze_notify (G_OBJECT (self));
 	set_current_ap (self, ap, FALSE, FALSE);
 	emit_ap_added_removed (self, ACCESS_POINT_ADDED, ap, TRUE);
@@ -2866,6 +3192,9 @@ nm_device_wifi_init (NMDeviceWifi *self)
 
 	priv->mode = NM_802_11_MODE_INFRA;
 	priv->aps = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_object_unref);
+	priv->aps_by_sup_path = g_hash_table_new (g_str_hash, g_str_equal);
+	priv->pending_bss = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, pending_bss_free);
+	priv->scan_policy = nm_wifi_scan_policy_new ();
 }
 
 static void
@@ -2892,11 +3221,68 @@ dispose (GObject *object)
 static void
 finalize (GObject *object)
 {
-	g_clear_pointer (&NM_DEVICE_WIFI_GET_PRIVATE (object)->aps, g_hash_table_unref);
+	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (object);
+
+	g_clear_pointer (&priv->aps, g_hash_table_unref);
+	g_clear_pointer (&priv->aps_by_sup_path, g_hash_table_unref);
+	g_clear_pointer (&priv->pending_bss, g_hash_table_unref);
+	g_clear_pointer (&priv->scan_policy, nm_wifi_scan_policy_free);
 
 	G_OBJECT_CLASS (nm_device_wifi_parent_class)->finalize (object);
 }
 
+static void
+nm_gvalue_destroy (gpointer data)
+{
+	GValue *value = (GValue *) data;
+
+	g_value_unset (value);
+	g_slice_free (GValue, value);
+}
+
+static void
+hash_add_string (GHashTable *hash, const char *key, const char *str)
+{
+	GValue *value = g_slice_new0 (GValue);
+
+	g_value_init (value, G_TYPE_STRING);
+	g_value_set_string (value, str);
+	g_hash_table_insert (hash, g_strdup (key), value);
+}
+
+static void
+hash_add_uint64 (GHashTable *hash, const char *key, guint64 num)
+{
+	GValue *value = g_slice_new0 (GValue);
+
+	g_value_init (value, G_TYPE_UINT64);
+	g_value_set_uint64 (value, num);
+	g_hash_table_insert (hash, g_strdup (key), value);
+}
+
+static GHashTable *
+scan_policy_to_hash (NMDeviceWifiPrivate *priv)
+{
+	const NMWifiScanStats *stats = nm_wifi_scan_policy_get_stats (priv->scan_policy);
+	GHashTable *hash;
+	char *key;
+	guint i;
+
+	hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, nm_gvalue_destroy);
+	hash_add_string (hash, "last-kind", nm_wifi_scan_kind_to_string (stats->last_kind));
+	hash_add_string (hash, "last-reason", stats->last_reason);
+	hash_add_uint64 (hash, "max-interval", priv->scan_max_interval);
+	for (i = 0; i < NM_WIFI_SCAN_KIND_LAST; i++) {
+		key = g_strdup_printf ("%s-scans", nm_wifi_scan_kind_to_string (i));
+		hash_add_uint64 (hash, key, stats->scans[i]);
+		g_free (key);
+	}
+	hash_add_uint64 (hash, "hidden-probed", stats->hidden_probed);
+	hash_add_uint64 (hash, "hidden-skipped", stats->hidden_skipped);
+	hash_add_uint64 (hash, "roams", stats->roams);
+	return hash;
+}
+
 static void
 get_property (GObject *object, guint prop_id,
               GValue *value, GParamSpec *pspec)
@@ -2936,6 +3322,9 @@ get_property (GObject *object, guint prop_id,
 	case PROP_SCANNING:
 		g_value_set_boolean (value, nm_supplicant_interface_get_scanning (priv->sup_iface));
 		break;
+	case PROP_SCAN_POLICY:
+		g_value_take_boxed (value, scan_policy_to_hash (priv));
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -3037,6 +3426,13 @@ nm_device_wifi_class_init (NMDeviceWifiClass *klass)
 		                       G_PARAM_READABLE |
 		                       G_PARAM_STATIC_STRINGS));
 
+	g_object_class_install_property
+		(object_class, PROP_SCAN_POLICY,
+		 g_param_spec_boxed (NM_DEVICE_WIFI_SCAN_POLICY, "", "",
+		                     DBUS_TYPE_G_MAP_OF_VARIANT,
+		                     G_PARAM_READABLE |
+		                     G_PARAM_STATIC_STRINGS));
+
 	/* Signals */
 	signals[ACCESS_POINT_ADDED] =
 		g_signal_new ("access-point-added",
@@ -3067,6 +3463,10 @@ nm_device_wifi_class_init (NMDeviceWifiClass *klass)
 	nm_dbus_manager_register_exported_type (nm_dbus_manager_get (),
 	                                        G_TYPE_FROM_CLASS (klass),
 	                                        &dbus_glib_nm_device_wifi_object_info);
+
+	nm_properties_changed_signal_set_min_interval (G_TYPE_FROM_CLASS (klass),
+	                                               NM_DEVICE_WIFI_BITRATE,
+	                                               BITRATE_MIN_INTERVAL_MS);
 }
 
 
@@ -30,6 +30,7 @@
 #include "nm-utils.h"
 #include "nm-logging.h"
 #include "nm-dbus-manager.h"
+#include "nm-properties-changed-signal.h"
 #include "nm-core-internal.h"
 
 #include "nm-setting-wireless.h"
@@ -38,6 +39,9 @@
 
 #include "nm-access-point-glue.h"
 
+/* Minimum time between two Strength change signals, in milliseconds */
+#define STRENGTH_MIN_INTERVAL_MS 2000
+
 /*
  * Encapsulates Access Point information
  */
@@ -1077,5 +1081,10 @@ nm_ap_class_init (NMAccessPointClass *ap_class)
 	nm_dbus_manager_register_exported_type (nm_dbus_manager_get (),
 	                                        G_TYPE_FROM_CLASS (ap_class),
 	                                        &dbus_glib_nm_access_point_object_info);
+
+	/* Signal strength fluctuates with every scan result */
+	nm_properties_changed_signal_set_min_interval (G_TYPE_FROM_CLASS (ap_class),
+	                                               NM_AP_STRENGTH,
+	                                               STRENGTH_MIN_INTERVAL_MS);
 }
 
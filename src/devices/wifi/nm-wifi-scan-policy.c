@@ -0,0 +1,598 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/* NetworkManager -- Network link manager
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2015 Red Hat, Inc.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "nm-wifi-scan-policy.h"
+
+/* The scan policy decides what kind of scan to run next.  It only looks at
+ * what it was told about the BSSes seen in earlier scans, the signal of the
+ * current link and past roams, so it doesn't need a supplicant or a device
+ * and can be driven directly by tests.
+ */
+
+/* All times are in seconds, all strengths in percent */
+#define BSS_MAX_AGE          600  /* forget BSSes not seen for this long */
+#define BSS_RECENT_AGE       180  /* BSSes seen within this are roam candidates */
+
+#define ROAM_HISTORY         8
+#define ROAM_WINDOW          300
+#define ROAM_FREQUENT        3    /* roams within ROAM_WINDOW */
+
+#define STRENGTH_GOOD        60
+#define STRENGTH_WEAK        40
+#define STRENGTH_ALPHA       0.25
+#define TREND_ALPHA          0.5
+#define TREND_FALLING        -2.0 /* smoothed change per sample */
+
+#define HIDDEN_ALL_EVERY     5    /* disconnected scans between full hidden probes */
+#define TARGETED_MAX_FREQS   8
+
+/* wpa_supplicant drops BSSes not seen for BSSExpireAge (250) seconds, so
+ * all channels must be scanned well within that. */
+#define FULL_SCAN_MAX_AGE    180
+
+#define INTERVAL_WEAK        20
+#define INTERVAL_ROAMING     40
+#define INTERVAL_MODERATE    60
+#define INTERVAL_GOOD        120
+#define INTERVAL_DISCONNECTED 120
+
+typedef struct {
+	GByteArray *ssid;
+	guint32 freq;
+	gint32 last_seen;
+
+	/* Scan results and link samples come at different rates and from
+	 * different sources, so they are smoothed separately.  Only link
+	 * samples are steady enough to tell a trend.
+	 */
+	gboolean have_scan_strength;
+	gdouble scan_strength;
+	gboolean have_link_strength;
+	gdouble link_strength;
+	gdouble link_trend;
+} BssInfo;
+
+struct _NMWifiScanPolicy {
+	GHashTable *bsses;   /* lowercase BSSID -> BssInfo */
+
+	gint32 roam_times[ROAM_HISTORY];
+	guint n_roams;
+
+	guint disconnected_scans;
+
+	gboolean have_full_scan;
+	gint32 last_full_scan;
+	gboolean full_scan_requested;
+
+	NMWifiScanStats stats;
+};
+
+static void
+bss_info_free (gpointer data)
+{
+	BssInfo *info = data;
+
+	if (info->ssid)
+		g_byte_array_unref (info->ssid);
+	g_slice_free (BssInfo, info);
+}
+
+static BssInfo *
+lookup_bss (NMWifiScanPolicy *policy, const char *bssid)
+{
+	char *key;
+	BssInfo *info;
+
+	if (!bssid)
+		return NULL;
+
+	key = g_ascii_strdown (bssid, -1);
+	info = g_hash_table_lookup (policy->bsses, key);
+	g_free (key);
+	return info;
+}
+
+static void
+bss_update_scan_strength (BssInfo *info, gint8 strength)
+{
+	if (strength < 0)
+		return;
+
+	if (!info->have_scan_strength) {
+		info->scan_strength = strength;
+		info->have_scan_strength = TRUE;
+	} else
+		info->scan_strength += (strength - info->scan_strength) * STRENGTH_ALPHA;
+}
+
+static void
+bss_update_link_strength (BssInfo *info, gint8 strength)
+{
+	gdouble prev;
+
+	if (strength < 0)
+		return;
+
+	if (!info->have_link_strength) {
+		info->link_strength = strength;
+		info->link_trend = 0;
+		info->have_link_strength = TRUE;
+		return;
+	}
+
+	prev = info->link_strength;
+	info->link_strength += (strength - prev) * STRENGTH_ALPHA;
+	info->link_trend += ((info->link_strength - prev) - info->link_trend) * TREND_ALPHA;
+}
+
+/* The link samples of the current AP are preferred over scan results */
+static gboolean
+bss_get_strength (const BssInfo *info, gdouble *out_strength, gdouble *out_trend)
+{
+	if (info->have_link_strength) {
+		*out_strength = info->link_strength;
+		*out_trend = info->link_trend;
+	} else if (info->have_scan_strength) {
+		*out_strength = info->scan_strength;
+		*out_trend = 0;
+	} else
+		return FALSE;
+	return TRUE;
+}
+
+static gboolean
+ssid_equal (const GByteArray *a, const GByteArray *b)
+{
+	return    a && b
+	       && a->len && a->len == b->len
+	       && !memcmp (a->data, b->data, a->len);
+}
+
+NMWifiScanPolicy *
+nm_wifi_scan_policy_new (void)
+{
+	NMWifiScanPolicy *policy;
+
+	policy = g_slice_new0 (NMWifiScanPolicy);
+	policy->bsses = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, bss_info_free);
+	policy->stats.last_reason = "none";
+	return policy;
+}
+
+void
+nm_wifi_scan_policy_free (NMWifiScanPolicy *policy)
+{
+	g_return_if_fail (policy != NULL);
+
+	g_hash_table_unref (policy->bsses);
+	g_slice_free (NMWifiScanPolicy, policy);
+}
+
+/* Forgets everything learned about the surroundings, but keeps the
+ * counters.
+ */
+void
+nm_wifi_scan_policy_reset (NMWifiScanPolicy *policy)
+{
+	g_return_if_fail (policy != NULL);
+
+	g_hash_table_remove_all (policy->bsses);
+	policy->n_roams = 0;
+	policy->disconnected_scans = 0;
+	policy->have_full_scan = FALSE;
+	policy->full_scan_requested = FALSE;
+}
+
+void
+nm_wifi_scan_policy_bss_seen (NMWifiScanPolicy *policy,
+                              const char *bssid,
+                              const GByteArray *ssid,
+                              guint32 freq,
+                              gint8 strength,
+                              gint32 now)
+{
+	BssInfo *info;
+
+	g_return_if_fail (policy != NULL);
+
+	if (!bssid)
+		return;
+
+	info = lookup_bss (policy, bssid);
+	if (!info) {
+		info = g_slice_new0 (BssInfo);
+		g_hash_table_insert (policy->bsses, g_ascii_strdown (bssid, -1), info);
+	}
+
+	if (ssid && ssid->len && !ssid_equal (info->ssid, ssid)) {
+		if (info->ssid)
+			g_byte_array_unref (info->ssid);
+		info->ssid = g_byte_array_sized_new (ssid->len);
+		g_byte_array_append (info->ssid, ssid->data, ssid->len);
+	}
+	if (freq)
+		info->freq = freq;
+	bss_update_scan_strength (info, strength);
+	info->last_seen = now;
+}
+
+/* Feeds a signal sample of the link to @bssid, as read by the periodic
+ * update while connected.
+ */
+void
+nm_wifi_scan_policy_link_sample (NMWifiScanPolicy *policy,
+                                 const char *bssid,
+                                 gint8 strength,
+                                 gint32 now)
+{
+	BssInfo *info;
+
+	g_return_if_fail (policy != NULL);
+
+	info = lookup_bss (policy, bssid);
+	if (info) {
+		bss_update_link_strength (info, strength);
+		info->last_seen = now;
+	}
+}
+
+void
+nm_wifi_scan_policy_roamed (NMWifiScanPolicy *policy,
+                            const char *old_bssid,
+                            const char *new_bssid,
+                            gint32 now)
+{
+	g_return_if_fail (policy != NULL);
+
+	if (!old_bssid || !new_bssid || !g_ascii_strcasecmp (old_bssid, new_bssid))
+		return;
+
+	policy->roam_times[policy->n_roams % ROAM_HISTORY] = now;
+	policy->n_roams++;
+	policy->stats.roams++;
+}
+
+gboolean
+nm_wifi_scan_policy_bssid_recent (NMWifiScanPolicy *policy,
+                                  const char *bssid,
+                                  gint32 now)
+{
+	BssInfo *info;
+
+	g_return_val_if_fail (policy != NULL, FALSE);
+
+	info = lookup_bss (policy, bssid);
+	return info && info->last_seen + BSS_RECENT_AGE >= now;
+}
+
+/* Whether the link to @bssid is weak or getting weaker, which makes finding
+ * a roam candidate urgent.
+ */
+gboolean
+nm_wifi_scan_policy_link_degraded (NMWifiScanPolicy *policy,
+                                   const char *bssid)
+{
+	BssInfo *info;
+	gdouble strength, trend;
+
+	g_return_val_if_fail (policy != NULL, FALSE);
+
+	info = lookup_bss (policy, bssid);
+	if (!info || !bss_get_strength (info, &strength, &trend))
+		return FALSE;
+	return strength < STRENGTH_WEAK || trend <= TREND_FALLING;
+}
+
+static gboolean
+roaming_frequently (NMWifiScanPolicy *policy, gint32 now)
+{
+	guint i, n = 0;
+
+	for (i = 0; i < MIN (policy->n_roams, ROAM_HISTORY); i++) {
+		if (policy->roam_times[i] + ROAM_WINDOW >= now)
+			n++;
+	}
+	return n >= ROAM_FREQUENT;
+}
+
+static void
+prune_bsses (NMWifiScanPolicy *policy, gint32 now)
+{
+	GHashTableIter iter;
+	BssInfo *info;
+
+	g_hash_table_iter_init (&iter, policy->bsses);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer) &info)) {
+		if (info->last_seen + BSS_MAX_AGE < now)
+			g_hash_table_iter_remove (&iter);
+	}
+}
+
+static gint
+bss_strength_cmp (gconstpointer a, gconstpointer b)
+{
+	const BssInfo *ia = *(const BssInfo **) a;
+	const BssInfo *ib = *(const BssInfo **) b;
+
+	/* Compare scan results only, as link samples exist for one AP only */
+	if (ia->scan_strength > ib->scan_strength)
+		return -1;
+	if (ia->scan_strength < ib->scan_strength)
+		return 1;
+	return 0;
+}
+
+/* Channels of recently seen BSSes in the same ESS as @current, strongest
+ * first, or NULL if there are none.
+ */
+static GArray *
+candidate_freqs (NMWifiScanPolicy *policy, BssInfo *current, gint32 now)
+{
+	GHashTableIter iter;
+	GPtrArray *candidates;
+	GArray *freqs = NULL;
+	BssInfo *info;
+	guint i, j;
+
+	if (!current->ssid)
+		return NULL;
+
+	candidates = g_ptr_array_new ();
+	g_hash_table_iter_init (&iter, policy->bsses);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer) &info)) {
+		if (   info->freq
+		    && info->last_seen + BSS_RECENT_AGE >= now
+		    && ssid_equal (info->ssid, current->ssid))
+			g_ptr_array_add (candidates, info);
+	}
+	g_ptr_array_sort (candidates, bss_strength_cmp);
+
+	for (i = 0; i < candidates->len; i++) {
+		guint32 freq = ((BssInfo *) candidates->pdata[i])->freq;
+
+		if (!freqs)
+			freqs = g_array_new (FALSE, FALSE, sizeof (guint32));
+		for (j = 0; j < freqs->len; j++) {
+			if (g_array_index (freqs, guint32, j) == freq)
+				break;
+		}
+		if (j < freqs->len)
+			continue;
+		g_array_append_val (freqs, freq);
+		if (freqs->len >= TARGETED_MAX_FREQS)
+			break;
+	}
+	g_ptr_array_free (candidates, TRUE);
+
+	return freqs;
+}
+
+static void
+plan_connected (NMWifiScanPolicy *policy,
+                const char *current_bssid,
+                gint32 now,
+                NMWifiScanPlan *plan)
+{
+	BssInfo *current;
+	gdouble strength, trend;
+	gboolean roaming;
+
+	current = lookup_bss (policy, current_bssid);
+	if (!current || !bss_get_strength (current, &strength, &trend)) {
+		plan->kind = NM_WIFI_SCAN_KIND_FULL_ACTIVE;
+		plan->max_interval = INTERVAL_MODERATE;
+		plan->reason = "no signal history";
+		return;
+	}
+
+	roaming = roaming_frequently (policy, now);
+	plan->freqs = candidate_freqs (policy, current, now);
+
+	if (strength < STRENGTH_WEAK || trend <= TREND_FALLING) {
+		/* Look for somewhere to go, on the known channels first if we
+		 * have just been bouncing between the APs there.
+		 */
+		plan->kind = roaming && plan->freqs
+		             ? NM_WIFI_SCAN_KIND_TARGETED_ACTIVE
+		             : NM_WIFI_SCAN_KIND_FULL_ACTIVE;
+		plan->max_interval = INTERVAL_WEAK;
+		plan->reason = "weak or falling signal";
+	} else if (roaming) {
+		plan->kind = plan->freqs
+		             ? NM_WIFI_SCAN_KIND_TARGETED_ACTIVE
+		             : NM_WIFI_SCAN_KIND_FULL_ACTIVE;
+		plan->max_interval = INTERVAL_ROAMING;
+		plan->reason = "frequent roaming";
+	} else if (strength >= STRENGTH_GOOD) {
+		/* Just keep the candidate list fresh without sending probes */
+		plan->kind = plan->freqs
+		             ? NM_WIFI_SCAN_KIND_TARGETED_PASSIVE
+		             : NM_WIFI_SCAN_KIND_FULL_PASSIVE;
+		plan->max_interval = INTERVAL_GOOD;
+		plan->reason = "good stable signal";
+	} else {
+		plan->kind = NM_WIFI_SCAN_KIND_FULL_PASSIVE;
+		plan->max_interval = INTERVAL_MODERATE;
+		plan->reason = "moderate signal";
+	}
+}
+
+/**
+ * nm_wifi_scan_policy_plan:
+ * @policy: the scan policy
+ * @connected: whether the device is connected
+ * @current_bssid: the BSSID of the current AP, if any
+ * @user_requested: whether the scan was explicitly requested
+ * @now: the current time in seconds
+ * @plan: (out): the scan to run, free with nm_wifi_scan_plan_clear()
+ *
+ * Decides which scan to run next. Nothing is recorded until the scan is
+ * requested, see nm_wifi_scan_policy_scan_requested().
+ */
+void
+nm_wifi_scan_policy_plan (NMWifiScanPolicy *policy,
+                          gboolean connected,
+                          const char *current_bssid,
+                          gboolean user_requested,
+                          gint32 now,
+                          NMWifiScanPlan *plan)
+{
+	g_return_if_fail (policy != NULL);
+	g_return_if_fail (plan != NULL);
+
+	memset (plan, 0, sizeof (*plan));
+
+	prune_bsses (policy, now);
+
+	if (user_requested) {
+		plan->kind = NM_WIFI_SCAN_KIND_FULL_ACTIVE;
+		plan->hidden = NM_WIFI_SCAN_HIDDEN_ALL;
+		plan->max_interval = connected ? INTERVAL_MODERATE : INTERVAL_DISCONNECTED;
+		plan->reason = "requested";
+	} else if (!connected) {
+		plan->kind = NM_WIFI_SCAN_KIND_FULL_ACTIVE;
+		plan->hidden =   (policy->disconnected_scans++ % HIDDEN_ALL_EVERY) == 0
+		               ? NM_WIFI_SCAN_HIDDEN_ALL
+		               : NM_WIFI_SCAN_HIDDEN_LIKELY;
+		plan->max_interval = INTERVAL_DISCONNECTED;
+		plan->reason = "disconnected";
+	} else {
+		policy->disconnected_scans = 0;
+		plan_connected (policy, current_bssid, now, plan);
+		plan->hidden = NM_WIFI_SCAN_HIDDEN_LIKELY;
+	}
+
+	/* Targeted scans need channels, and passive scans can't probe */
+	if (!plan->freqs) {
+		if (plan->kind == NM_WIFI_SCAN_KIND_TARGETED_ACTIVE)
+			plan->kind = NM_WIFI_SCAN_KIND_FULL_ACTIVE;
+		else if (plan->kind == NM_WIFI_SCAN_KIND_TARGETED_PASSIVE)
+			plan->kind = NM_WIFI_SCAN_KIND_FULL_PASSIVE;
+	} else if (   plan->kind == NM_WIFI_SCAN_KIND_FULL_ACTIVE
+	           || plan->kind == NM_WIFI_SCAN_KIND_FULL_PASSIVE) {
+		g_array_unref (plan->freqs);
+		plan->freqs = NULL;
+	}
+
+	/* Targeted scans don't refresh the BSSes on other channels */
+	if (   plan->kind == NM_WIFI_SCAN_KIND_TARGETED_ACTIVE
+	    || plan->kind == NM_WIFI_SCAN_KIND_TARGETED_PASSIVE) {
+		if (   !policy->have_full_scan
+		    || policy->last_full_scan + FULL_SCAN_MAX_AGE <= now) {
+			plan->kind =   plan->kind == NM_WIFI_SCAN_KIND_TARGETED_ACTIVE
+			             ? NM_WIFI_SCAN_KIND_FULL_ACTIVE
+			             : NM_WIFI_SCAN_KIND_FULL_PASSIVE;
+			g_clear_pointer (&plan->freqs, g_array_unref);
+			plan->reason = "refreshing all channels";
+		} else {
+			plan->max_interval = MIN (plan->max_interval,
+			                          MAX (policy->last_full_scan + FULL_SCAN_MAX_AGE - now,
+			                               INTERVAL_WEAK));
+		}
+	}
+
+	if (   plan->kind == NM_WIFI_SCAN_KIND_FULL_PASSIVE
+	    || plan->kind == NM_WIFI_SCAN_KIND_TARGETED_PASSIVE)
+		plan->hidden = NM_WIFI_SCAN_HIDDEN_NONE;
+}
+
+/* Records that the supplicant accepted the scan of @plan */
+void
+nm_wifi_scan_policy_scan_requested (NMWifiScanPolicy *policy,
+                                    const NMWifiScanPlan *plan)
+{
+	g_return_if_fail (policy != NULL);
+	g_return_if_fail (plan != NULL);
+
+	policy->full_scan_requested =    plan->kind == NM_WIFI_SCAN_KIND_FULL_ACTIVE
+	                              || plan->kind == NM_WIFI_SCAN_KIND_FULL_PASSIVE;
+
+	policy->stats.scans[plan->kind]++;
+	policy->stats.last_kind = plan->kind;
+	policy->stats.last_reason = plan->reason;
+}
+
+/* Records the end of the last requested scan. Only a successful full scan
+ * refreshes the BSSes on all channels.
+ */
+void
+nm_wifi_scan_policy_scan_done (NMWifiScanPolicy *policy,
+                               gboolean success,
+                               gint32 now)
+{
+	g_return_if_fail (policy != NULL);
+
+	if (policy->full_scan_requested && success) {
+		policy->have_full_scan = TRUE;
+		policy->last_full_scan = now;
+	}
+	policy->full_scan_requested = FALSE;
+}
+
+/* Records how many hidden SSIDs were probed for and how many were left out
+ * by the last requested scan.
+ */
+void
+nm_wifi_scan_policy_hidden_probed (NMWifiScanPolicy *policy,
+                                   guint probed,
+                                   guint skipped)
+{
+	g_return_if_fail (policy != NULL);
+
+	policy->stats.hidden_probed += probed;
+	policy->stats.hidden_skipped += skipped;
+}
+
+void
+nm_wifi_scan_plan_clear (NMWifiScanPlan *plan)
+{
+	g_return_if_fail (plan != NULL);
+
+	g_clear_pointer (&plan->freqs, g_array_unref);
+}
+
+const NMWifiScanStats *
+nm_wifi_scan_policy_get_stats (NMWifiScanPolicy *policy)
+{
+	g_return_val_if_fail (policy != NULL, NULL);
+
+	return &policy->stats;
+}
+
+const char *
+nm_wifi_scan_kind_to_string (NMWifiScanKind kind)
+{
+	switch (kind) {
+	case NM_WIFI_SCAN_KIND_FULL_ACTIVE:
+		return "full-active";
+	case NM_WIFI_SCAN_KIND_FULL_PASSIVE:
+		return "full-passive";
+	case NM_WIFI_SCAN_KIND_TARGETED_ACTIVE:
+		return "targeted-active";
+	case NM_WIFI_SCAN_KIND_TARGETED_PASSIVE:
+		return "targeted-passive";
+	default:
+		return "unknown";
+	}
+}
@@ -0,0 +1,120 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/* NetworkManager -- Network link manager
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2015 Red Hat, Inc.
+ */
+
+#ifndef __NETWORKMANAGER_WIFI_SCAN_POLICY_H__
+#define __NETWORKMANAGER_WIFI_SCAN_POLICY_H__
+
+#include <glib.h>
+
+/**
+ * NMWifiScanKind:
+ * @NM_WIFI_SCAN_KIND_FULL_ACTIVE: probe all channels
+ * @NM_WIFI_SCAN_KIND_FULL_PASSIVE: listen for beacons on all channels
+ * @NM_WIFI_SCAN_KIND_TARGETED_ACTIVE: probe only the channels in the plan
+ * @NM_WIFI_SCAN_KIND_TARGETED_PASSIVE: listen only on the channels in the plan
+ */
+typedef enum {
+	NM_WIFI_SCAN_KIND_FULL_ACTIVE = 0,
+	NM_WIFI_SCAN_KIND_FULL_PASSIVE,
+	NM_WIFI_SCAN_KIND_TARGETED_ACTIVE,
+	NM_WIFI_SCAN_KIND_TARGETED_PASSIVE,
+
+	NM_WIFI_SCAN_KIND_LAST
+} NMWifiScanKind;
+
+/**
+ * NMWifiScanHidden:
+ * @NM_WIFI_SCAN_HIDDEN_NONE: don't probe for hidden SSIDs
+ * @NM_WIFI_SCAN_HIDDEN_LIKELY: only probe hidden SSIDs of connections whose
+ *   BSSIDs were seen recently
+ * @NM_WIFI_SCAN_HIDDEN_ALL: probe all hidden SSIDs
+ */
+typedef enum {
+	NM_WIFI_SCAN_HIDDEN_NONE = 0,
+	NM_WIFI_SCAN_HIDDEN_LIKELY,
+	NM_WIFI_SCAN_HIDDEN_ALL,
+} NMWifiScanHidden;
+
+typedef struct {
+	NMWifiScanKind kind;
+	GArray *freqs;          /* guint32 MHz, only for targeted scans */
+	NMWifiScanHidden hidden;
+	guint max_interval;     /* seconds until the next scan at most */
+	const char *reason;
+} NMWifiScanPlan;
+
+typedef struct {
+	guint64 scans[NM_WIFI_SCAN_KIND_LAST];
+	guint64 hidden_probed;
+	guint64 hidden_skipped;
+	guint64 roams;
+	NMWifiScanKind last_kind;
+	const char *last_reason;
+} NMWifiScanStats;
+
+typedef struct _NMWifiScanPolicy NMWifiScanPolicy;
+
+NMWifiScanPolicy *nm_wifi_scan_policy_new   (void);
+void              nm_wifi_scan_policy_free  (NMWifiScanPolicy *policy);
+void              nm_wifi_scan_policy_reset (NMWifiScanPolicy *policy);
+
+void nm_wifi_scan_policy_bss_seen    (NMWifiScanPolicy *policy,
+                                      const char *bssid,
+                                      const GByteArray *ssid,
+                                      guint32 freq,
+                                      gint8 strength,
+                                      gint32 now);
+void nm_wifi_scan_policy_link_sample (NMWifiScanPolicy *policy,
+                                      const char *bssid,
+                                      gint8 strength,
+                                      gint32 now);
+void nm_wifi_scan_policy_roamed      (NMWifiScanPolicy *policy,
+                                      const char *old_bssid,
+                                      const char *new_bssid,
+                                      gint32 now);
+
+gboolean nm_wifi_scan_policy_bssid_recent  (NMWifiScanPolicy *policy,
+                                            const char *bssid,
+                                            gint32 now);
+gboolean nm_wifi_scan_policy_link_degraded (NMWifiScanPolicy *policy,
+                                            const char *bssid);
+
+void nm_wifi_scan_policy_plan (NMWifiScanPolicy *policy,
+                               gboolean connected,
+                               const char *current_bssid,
+                               gboolean user_requested,
+                               gint32 now,
+                               NMWifiScanPlan *plan);
+void nm_wifi_scan_policy_scan_requested (NMWifiScanPolicy *policy,
+                                         const NMWifiScanPlan *plan);
+void nm_wifi_scan_policy_scan_done      (NMWifiScanPolicy *policy,
+                                         gboolean success,
+                                         gint32 now);
+void nm_wifi_scan_policy_hidden_probed  (NMWifiScanPolicy *policy,
+                                         guint probed,
+                                         guint skipped);
+
+void nm_wifi_scan_plan_clear (NMWifiScanPlan *plan);
+
+const NMWifiScanStats *nm_wifi_scan_policy_get_stats (NMWifiScanPolicy *policy);
+
+const char *nm_wifi_scan_kind_to_string (NMWifiScanKind kind);
+
+#endif /* __NETWORKMANAGER_WIFI_SCAN_POLICY_H__ */
@@ -0,0 +1,454 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2015 Red Hat, Inc.
+ *
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <string.h>
+
+#include "nm-wifi-scan-policy.h"
+
+/*******************************************/
+
+/* Scan results as the supplicant would report them */
+typedef struct {
+	const char *bssid;
+	const char *ssid;
+	guint32 freq;
+	gint8 strength;
+} FakeBss;
+
+#define BSSID_HOME_1  "00:11:22:33:44:01"
+#define BSSID_HOME_2  "00:11:22:33:44:02"
+#define BSSID_HOME_3  "00:11:22:33:44:03"
+#define BSSID_OTHER   "00:11:22:33:44:AA"
+#define BSSID_HIDDEN  "00:11:22:33:44:20"
+
+static const FakeBss home_scan[] = {
+	{ BSSID_HOME_1, "home",  2412, 75 },
+	{ BSSID_HOME_2, "home",  5180, 82 },
+	{ BSSID_HOME_3, "home",  2412, 30 },
+	{ BSSID_OTHER,  "other", 2437, 90 },
+	{ BSSID_HIDDEN, NULL,    2462, 50 },
+	{ NULL }
+};
+
+static void
+fake_supplicant_scan (NMWifiScanPolicy *policy, const FakeBss *bsses, gint32 now)
+{
+	const FakeBss *bss;
+	GByteArray *ssid;
+
+	for (bss = bsses; bss->bssid; bss++) {
+		ssid = g_byte_array_new ();
+		if (bss->ssid)
+			g_byte_array_append (ssid, (const guint8 *) bss->ssid, strlen (bss->ssid));
+		nm_wifi_scan_policy_bss_seen (policy, bss->bssid, ssid, bss->freq, bss->strength, now);
+		g_byte_array_unref (ssid);
+	}
+}
+
+static void
+fake_supplicant_link (NMWifiScanPolicy *policy,
+                      const char *bssid,
+                      const gint8 *samples,
+                      gint32 now)
+{
+	for (; *samples >= 0; samples++)
+		nm_wifi_scan_policy_link_sample (policy, bssid, *samples, now);
+}
+
+/* The supplicant accepts the scan of @plan and reports its end */
+static void
+fake_supplicant_request (NMWifiScanPolicy *policy,
+                         const NMWifiScanPlan *plan,
+                         gboolean success,
+                         gint32 now)
+{
+	nm_wifi_scan_policy_scan_requested (policy, plan);
+	nm_wifi_scan_policy_scan_done (policy, success, now);
+}
+
+static void
+assert_freqs (const NMWifiScanPlan *plan, const guint32 *expected, guint len)
+{
+	guint i;
+
+	g_assert (plan->freqs != NULL);
+	g_assert_cmpint (plan->freqs->len, ==, len);
+	for (i = 0; i < len; i++)
+		g_assert_cmpint (g_array_index (plan->freqs, guint32, i), ==, expected[i]);
+}
+
+/*******************************************/
+
+static void
+test_disconnected (void)
+{
+	NMWifiScanPolicy *policy = nm_wifi_scan_policy_new ();
+	NMWifiScanPlan plan;
+	guint i;
+
+	fake_supplicant_scan (policy, home_scan, 10);
+
+	/* Hidden SSIDs are all probed for on every few scans only */
+	for (i = 0; i < 6; i++) {
+		nm_wifi_scan_policy_plan (policy, FALSE, NULL, FALSE, 10 + i, &plan);
+		g_assert_cmpint (plan.kind, ==, NM_WIFI_SCAN_KIND_FULL_ACTIVE);
+		g_assert (plan.freqs == NULL);
+		g_assert_cmpint (plan.max_interval, ==, 120);
+		if (i % 5 == 0)
+			g_assert_cmpint (plan.hidden, ==, NM_WIFI_SCAN_HIDDEN_ALL);
+		else
+			g_assert_cmpint (plan.hidden, ==, NM_WIFI_SCAN_HIDDEN_LIKELY);
+		fake_supplicant_request (policy, &plan, TRUE, 10 + i);
+		nm_wifi_scan_plan_clear (&plan);
+	}
+
+	g_assert_cmpint (nm_wifi_scan_policy_get_stats (policy)->scans[NM_WIFI_SCAN_KIND_FULL_ACTIVE], ==, 6);
+
+	nm_wifi_scan_policy_free (policy);
+}
+
+static void
+test_user_requested (void)
+{
+	NMWifiScanPolicy *policy = nm_wifi_scan_policy_new ();
+	static const gint8 good[] = { 80, 80, 80, -1 };
+	NMWifiScanPlan plan;
+
+	fake_supplicant_scan (policy, home_scan, 10);
+	fake_supplicant_link (policy, BSSID_HOME_2, good, 12);
+
+	/* A requested scan finds everything, however good the link is */
+	nm_wifi_scan_policy_plan (policy, TRUE, BSSID_HOME_2, TRUE, 12, &plan);
+	g_assert_cmpint (plan.kind, ==, NM_WIFI_SCAN_KIND_FULL_ACTIVE);
+	g_assert_cmpint (plan.hidden, ==, NM_WIFI_SCAN_HIDDEN_ALL);
+	g_assert (plan.freqs == NULL);
+	nm_wifi_scan_plan_clear (&plan);
+
+	nm_wifi_scan_policy_free (policy);
+}
+
+static void
+test_good_link (void)
+{
+	NMWifiScanPolicy *policy = nm_wifi_scan_policy_new ();
+	static const gint8 good[] = { 82, 84, 83, 85, -1 };
+	static const guint32 expected[] = { 5180, 2412 };
+	NMWifiScanPlan plan;
+
+	fake_supplicant_scan (policy, home_scan, 10);
+	fake_supplicant_link (policy, BSSID_HOME_2, good, 16);
+	g_assert (!nm_wifi_scan_policy_link_degraded (policy, BSSID_HOME_2));
+
+	/* Without an earlier full scan, all channels are scanned first */
+	nm_wifi_scan_policy_plan (policy, TRUE, BSSID_HOME_2, FALSE, 16, &plan);
+	g_assert_cmpint (plan.kind, ==, NM_WIFI_SCAN_KIND_FULL_PASSIVE);
+	g_assert_cmpstr (plan.reason, ==, "refreshing all channels");
+	g_assert (plan.freqs == NULL);
+	fake_supplicant_request (policy, &plan, TRUE, 16);
+	nm_wifi_scan_plan_clear (&plan);
+
+	/* Only listen on the channels of the other "home" APs, strongest first */
+	nm_wifi_scan_policy_plan (policy, TRUE, BSSID_HOME_2, FALSE, 20, &plan);
+	g_assert_cmpint (plan.kind, ==, NM_WIFI_SCAN_KIND_TARGETED_PASSIVE);
+	g_assert_cmpint (plan.hidden, ==, NM_WIFI_SCAN_HIDDEN_NONE);
+	g_assert_cmpint (plan.max_interval, ==, 120);
+	assert_freqs (&plan, expected, G_N_ELEMENTS (expected));
+	nm_wifi_scan_plan_clear (&plan);
+
+	/* BSSIDs are matched regardless of case */
+	g_assert (nm_wifi_scan_policy_bssid_recent (policy, "00:11:22:33:44:aa", 20));
+	g_assert (!nm_wifi_scan_policy_bssid_recent (policy, "00:11:22:33:44:99", 20));
+
+	nm_wifi_scan_policy_free (policy);
+}
+
+static void
+test_degrading_link (void)
+{
+	NMWifiScanPolicy *policy = nm_wifi_scan_policy_new ();
+	static const gint8 falling[] = { 70, 60, 50, -1 };
+	static const gint8 weak[] = { 30, 25, 25, 25, 25, 25, 25, -1 };
+	NMWifiScanPlan plan;
+
+	fake_supplicant_scan (policy, home_scan, 10);
+
+	/* Still a decent signal, but dropping fast */
+	fake_supplicant_link (policy, BSSID_HOME_1, falling, 16);
+	g_assert (nm_wifi_scan_policy_link_degraded (policy, BSSID_HOME_1));
+
+	nm_wifi_scan_policy_plan (policy, TRUE, BSSID_HOME_1, FALSE, 16, &plan);
+	g_assert_cmpint (plan.kind, ==, NM_WIFI_SCAN_KIND_FULL_ACTIVE);
+	g_assert_cmpint (plan.hidden, ==, NM_WIFI_SCAN_HIDDEN_LIKELY);
+	g_assert_cmpint (plan.max_interval, ==, 20);
+	nm_wifi_scan_plan_clear (&plan);
+
+	/* Weak but steady is still degraded */
+	fake_supplicant_link (policy, BSSID_HOME_3, weak, 22);
+	g_assert (nm_wifi_scan_policy_link_degraded (policy, BSSID_HOME_3));
+
+	/* Nothing is known about the link yet */
+	g_assert (!nm_wifi_scan_policy_link_degraded (policy, "00:11:22:33:44:99"));
+
+	nm_wifi_scan_policy_free (policy);
+}
+
+static void
+test_scan_vs_link (void)
+{
+	NMWifiScanPolicy *policy = nm_wifi_scan_policy_new ();
+	static const gint8 steady[] = { 80, 80, 80, -1 };
+	static const FakeBss low_scan[] = {
+		{ BSSID_HOME_2, "home", 5180, 35 },
+		{ NULL }
+	};
+
+	fake_supplicant_scan (policy, home_scan, 10);
+	fake_supplicant_link (policy, BSSID_HOME_2, steady, 16);
+
+	/* A scan result reading lower than the link samples is not a trend */
+	fake_supplicant_scan (policy, low_scan, 20);
+	g_assert (!nm_wifi_scan_policy_link_degraded (policy, BSSID_HOME_2));
+
+	/* Without link samples, scan results decide */
+	g_assert (!nm_wifi_scan_policy_link_degraded (policy, BSSID_HOME_1));
+	g_assert (nm_wifi_scan_policy_link_degraded (policy, BSSID_HOME_3));
+
+	nm_wifi_scan_policy_free (policy);
+}
+
+static void
+test_frequent_roaming (void)
+{
+	NMWifiScanPolicy *policy = nm_wifi_scan_policy_new ();
+	static const guint32 expected[] = { 5180, 2412 };
+	NMWifiScanPlan plan;
+
+	fake_supplicant_scan (policy, home_scan, 10);
+	nm_wifi_scan_policy_plan (policy, FALSE, NULL, FALSE, 10, &plan);
+	fake_supplicant_request (policy, &plan, TRUE, 10);
+	nm_wifi_scan_plan_clear (&plan);
+
+	nm_wifi_scan_policy_roamed (policy, BSSID_HOME_1, BSSID_HOME_2, 20);
+	nm_wifi_scan_policy_roamed (policy, BSSID_HOME_2, BSSID_HOME_1, 40);
+	/* Not a roam */
+	nm_wifi_scan_policy_roamed (policy, BSSID_HOME_1, BSSID_HOME_1, 50);
+	nm_wifi_scan_policy_roamed (policy, BSSID_HOME_1, BSSID_HOME_2, 60);
+	g_assert_cmpint (nm_wifi_scan_policy_get_stats (policy)->roams, ==, 3);
+
+	fake_supplicant_scan (policy, home_scan, 60);
+
+	nm_wifi_scan_policy_plan (policy, TRUE, BSSID_HOME_2, FALSE, 60, &plan);
+	g_assert_cmpint (plan.kind, ==, NM_WIFI_SCAN_KIND_TARGETED_ACTIVE);
+	g_assert_cmpint (plan.hidden, ==, NM_WIFI_SCAN_HIDDEN_LIKELY);
+	g_assert_cmpint (plan.max_interval, ==, 40);
+	assert_freqs (&plan, expected, G_N_ELEMENTS (expected));
+	nm_wifi_scan_plan_clear (&plan);
+
+	/* Once the roams are old, the good link only gets passive scans */
+	fake_supplicant_scan (policy, home_scan, 400);
+	nm_wifi_scan_policy_plan (policy, TRUE, BSSID_HOME_2, FALSE, 400, &plan);
+	g_assert_cmpint (plan.kind, ==, NM_WIFI_SCAN_KIND_FULL_PASSIVE);
+	fake_supplicant_request (policy, &plan, TRUE, 400);
+	nm_wifi_scan_plan_clear (&plan);
+
+	nm_wifi_scan_policy_plan (policy, TRUE, BSSID_HOME_2, FALSE, 401, &plan);
+	g_assert_cmpint (plan.kind, ==, NM_WIFI_SCAN_KIND_TARGETED_PASSIVE);
+	g_assert_cmpint (plan.hidden, ==, NM_WIFI_SCAN_HIDDEN_NONE);
+	g_assert_cmpint (plan.max_interval, ==, 120);
+	nm_wifi_scan_plan_clear (&plan);
+
+	nm_wifi_scan_policy_free (policy);
+}
+
+/* The supplicant only reports the BSSes on the scanned channels */
+static void
+fake_supplicant_run_plan (NMWifiScanPolicy *policy,
+                          const NMWifiScanPlan *plan,
+                          const FakeBss *bsses,
+                          gint32 *last_seen,
+                          gint32 now)
+{
+	FakeBss one[2] = { { NULL }, { NULL } };
+	guint i, j;
+
+	for (i = 0; bsses[i].bssid; i++) {
+		if (plan->freqs) {
+			for (j = 0; j < plan->freqs->len; j++) {
+				if (g_array_index (plan->freqs, guint32, j) == bsses[i].freq)
+					break;
+			}
+			if (j == plan->freqs->len)
+				continue;
+		}
+		one[0] = bsses[i];
+		fake_supplicant_scan (policy, one, now);
+		last_seen[i] = now;
+	}
+}
+
+static void
+test_long_good_link (void)
+{
+	NMWifiScanPolicy *policy = nm_wifi_scan_policy_new ();
+	static const gint8 good[] = { 80, -1 };
+	gint32 last_seen[G_N_ELEMENTS (home_scan)] = { 0 };
+	guint n_targeted = 0;
+	NMWifiScanPlan plan;
+	gint32 now = 10;
+	guint i;
+
+	nm_wifi_scan_policy_plan (policy, FALSE, NULL, FALSE, now, &plan);
+	fake_supplicant_run_plan (policy, &plan, home_scan, last_seen, now);
+	fake_supplicant_request (policy, &plan, TRUE, now);
+	nm_wifi_scan_plan_clear (&plan);
+
+	/* Connected for an hour with a good link, scanning as often as the
+	 * plans ask for */
+	while (now < 3600) {
+		fake_supplicant_link (policy, BSSID_HOME_2, good, now);
+
+		nm_wifi_scan_policy_plan (policy, TRUE, BSSID_HOME_2, FALSE, now, &plan);
+		g_assert (   plan.kind == NM_WIFI_SCAN_KIND_TARGETED_PASSIVE
+		          || plan.kind == NM_WIFI_SCAN_KIND_FULL_PASSIVE);
+		if (plan.kind == NM_WIFI_SCAN_KIND_TARGETED_PASSIVE)
+			n_targeted++;
+		fake_supplicant_run_plan (policy, &plan, home_scan, last_seen, now);
+		fake_supplicant_request (policy, &plan, TRUE, now);
+
+		/* wpa_supplicant must never have expired any BSS (BSSExpireAge is
+		 * 250 seconds), including those off the ESS channels */
+		for (i = 0; home_scan[i].bssid; i++)
+			g_assert_cmpint (now - last_seen[i], <, 250);
+
+		now += plan.max_interval;
+		nm_wifi_scan_plan_clear (&plan);
+	}
+
+	g_assert_cmpint (n_targeted, >, 0);
+	g_assert_cmpint (nm_wifi_scan_policy_get_stats (policy)->scans[NM_WIFI_SCAN_KIND_FULL_PASSIVE], >, 0);
+
+	nm_wifi_scan_policy_free (policy);
+}
+
+static void
+test_expiry (void)
+{
+	NMWifiScanPolicy *policy = nm_wifi_scan_policy_new ();
+	static const gint8 good[] = { 80, 80, -1 };
+	const NMWifiScanStats *stats;
+	NMWifiScanPlan plan;
+
+	fake_supplicant_scan (policy, home_scan, 10);
+	fake_supplicant_link (policy, BSSID_HOME_2, good, 10);
+
+	g_assert (nm_wifi_scan_policy_bssid_recent (policy, BSSID_HIDDEN, 100));
+	g_assert (!nm_wifi_scan_policy_bssid_recent (policy, BSSID_HIDDEN, 300));
+
+	/* Everything is forgotten after a while */
+	nm_wifi_scan_policy_plan (policy, TRUE, BSSID_HOME_2, FALSE, 1000, &plan);
+	g_assert_cmpint (plan.kind, ==, NM_WIFI_SCAN_KIND_FULL_ACTIVE);
+	g_assert_cmpstr (plan.reason, ==, "no signal history");
+	fake_supplicant_request (policy, &plan, TRUE, 1000);
+	nm_wifi_scan_plan_clear (&plan);
+
+	nm_wifi_scan_policy_hidden_probed (policy, 2, 3);
+	stats = nm_wifi_scan_policy_get_stats (policy);
+	g_assert_cmpint (stats->hidden_probed, ==, 2);
+	g_assert_cmpint (stats->hidden_skipped, ==, 3);
+	g_assert_cmpint (stats->last_kind, ==, NM_WIFI_SCAN_KIND_FULL_ACTIVE);
+
+	/* Resetting keeps the counters */
+	fake_supplicant_scan (policy, home_scan, 1000);
+	nm_wifi_scan_policy_reset (policy);
+	g_assert (!nm_wifi_scan_policy_bssid_recent (policy, BSSID_HOME_1, 1000));
+	g_assert_cmpint (stats->scans[NM_WIFI_SCAN_KIND_FULL_ACTIVE], ==, 1);
+
+	nm_wifi_scan_policy_free (policy);
+}
+
+static void
+test_full_scan_done (void)
+{
+	NMWifiScanPolicy *policy = nm_wifi_scan_policy_new ();
+	static const gint8 good[] = { 82, 84, 83, 85, -1 };
+	const NMWifiScanStats *stats = nm_wifi_scan_policy_get_stats (policy);
+	NMWifiScanPlan plan;
+
+	fake_supplicant_scan (policy, home_scan, 10);
+	fake_supplicant_link (policy, BSSID_HOME_2, good, 16);
+
+	/* A plan alone records nothing */
+	nm_wifi_scan_policy_plan (policy, TRUE, BSSID_HOME_2, FALSE, 16, &plan);
+	g_assert_cmpint (plan.kind, ==, NM_WIFI_SCAN_KIND_FULL_PASSIVE);
+	nm_wifi_scan_plan_clear (&plan);
+	g_assert_cmpint (stats->scans[NM_WIFI_SCAN_KIND_FULL_PASSIVE], ==, 0);
+	g_assert_cmpstr (stats->last_reason, ==, "none");
+
+	/* A failed full scan leaves the other channels stale */
+	nm_wifi_scan_policy_plan (policy, TRUE, BSSID_HOME_2, FALSE, 18, &plan);
+	g_assert_cmpint (plan.kind, ==, NM_WIFI_SCAN_KIND_FULL_PASSIVE);
+	fake_supplicant_request (policy, &plan, FALSE, 18);
+	nm_wifi_scan_plan_clear (&plan);
+	g_assert_cmpint (stats->scans[NM_WIFI_SCAN_KIND_FULL_PASSIVE], ==, 1);
+
+	nm_wifi_scan_policy_plan (policy, TRUE, BSSID_HOME_2, FALSE, 20, &plan);
+	g_assert_cmpint (plan.kind, ==, NM_WIFI_SCAN_KIND_FULL_PASSIVE);
+	g_assert_cmpstr (plan.reason, ==, "refreshing all channels");
+	fake_supplicant_request (policy, &plan, TRUE, 20);
+	nm_wifi_scan_plan_clear (&plan);
+
+	/* Only a successful one allows targeted scans */
+	nm_wifi_scan_policy_plan (policy, TRUE, BSSID_HOME_2, FALSE, 22, &plan);
+	g_assert_cmpint (plan.kind, ==, NM_WIFI_SCAN_KIND_TARGETED_PASSIVE);
+	fake_supplicant_request (policy, &plan, TRUE, 22);
+	nm_wifi_scan_plan_clear (&plan);
+
+	g_assert_cmpint (stats->scans[NM_WIFI_SCAN_KIND_FULL_PASSIVE], ==, 2);
+	g_assert_cmpint (stats->scans[NM_WIFI_SCAN_KIND_TARGETED_PASSIVE], ==, 1);
+
+	nm_wifi_scan_policy_free (policy);
+}
+
+/*******************************************/
+
+int
+main (int argc, char **argv)
+{
+#if !GLIB_CHECK_VERSION (2, 35, 0)
+	g_type_init ();
+#endif
+
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/wifi/scan-policy/disconnected", test_disconnected);
+	g_test_add_func ("/wifi/scan-policy/user-requested", test_user_requested);
+	g_test_add_func ("/wifi/scan-policy/good-link", test_good_link);
+	g_test_add_func ("/wifi/scan-policy/degrading-link", test_degrading_link);
+	g_test_add_func ("/wifi/scan-policy/scan-vs-link", test_scan_vs_link);
+	g_test_add_func ("/wifi/scan-policy/frequent-roaming", test_frequent_roaming);
+	g_test_add_func ("/wifi/scan-policy/long-good-link", test_long_good_link);
+	g_test_add_func ("/wifi/scan-policy/expiry", test_expiry);
+	g_test_add_func ("/wifi/scan-policy/full-scan-done", test_full_scan_done);
+
+	return g_test_run ();
+}
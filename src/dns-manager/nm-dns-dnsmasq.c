@@ -26,9 +26,11 @@
 #include <sys/wait.h>
 #include <arpa/inet.h>
 #include <sys/stat.h>
+#include <string.h>
 
 #include <glib.h>
 #include <glib/gi18n.h>
+#include <gio/gio.h>
 
 #include "nm-dns-dnsmasq.h"
 #include "nm-utils.h"
@@ -46,14 +48,45 @@ G_DEFINE_TYPE (NMDnsDnsmasq, nm_dns_dnsmasq, NM_TYPE_DNS_PLUGIN)
 #define CONFFILE NMRUNDIR "/dnsmasq.conf"
 #define CONFDIR NMCONFDIR "/dnsmasq.d"
 
+#define DNSMASQ_DBUS_SERVICE "org.freedesktop.NetworkManager.dnsmasq"
+#define DNSMASQ_DBUS_PATH "/uk/org/thekelleys/dnsmasq"
+
 typedef struct {
-	guint32 foo;
+	char *binary;            /* overridden by tests */
+	char *pidfile;
+	char *conffile;
+
+	GDBusProxy *dnsmasq;
+	GCancellable *cancellable;
+	gboolean running;
+	gboolean dbus_probed;    /* the dnsmasq build was checked for D-Bus support */
+	gboolean no_dbus;        /* dnsmasq can't be configured over D-Bus */
+
+	GVariant *servers;       /* the arguments for SetServersEx */
+	GVariant *servers_sent;  /* what dnsmasq last accepted */
 } NMDnsDnsmasqPrivate;
 
+typedef struct {
+	NMDnsDnsmasq *self;
+	GVariant *servers;
+} SetServersData;
+
+static gboolean start_dnsmasq (NMDnsDnsmasq *self);
+
 /*******************************************/
 
+static void
+add_server (GVariantBuilder *servers, const char *server, const char *domain)
+{
+	g_variant_builder_open (servers, G_VARIANT_TYPE ("as"));
+	g_variant_builder_add (servers, "s", server);
+	if (domain)
+		g_variant_builder_add (servers, "s", domain);
+	g_variant_builder_close (servers);
+}
+
 static gboolean
-add_ip4_config (GString *str, NMIP4Config *ip4, gboolean split)
+add_ip4_config (GVariantBuilder *servers, NMIP4Config *ip4, gboolean split)
 {
 	char buf[INET_ADDRSTRLEN];
 	in_addr_t addr;
@@ -75,9 +108,7 @@ add_ip4_config (GString *str, NMIP4Config *ip4, gboolean split)
 			/* searches are preferred over domains */
 			n = nm_ip4_config_get_num_searches (ip4);
 			for (i = 0; i < n; i++) {
-				g_string_append_printf (str, "server=/%s/%s\n",
-				                        nm_ip4_config_get_search (ip4, i),
-				                        buf);
+				add_server (servers, buf, nm_ip4_config_get_search (ip4, i));
 				added = TRUE;
 			}
 
@@ -85,9 +116,7 @@ add_ip4_config (GString *str, NMIP4Config *ip4, gboolean split)
 				/* If not searches, use any domains */
 				n = nm_ip4_config_get_num_domains (ip4);
 				for (i = 0; i < n; i++) {
-					g_string_append_printf (str, "server=/%s/%s\n",
-					                        nm_ip4_config_get_domain (ip4, i),
-					                        buf);
+					add_server (servers, buf, nm_ip4_config_get_domain (ip4, i));
 					added = TRUE;
 				}
 			}
@@ -98,7 +127,7 @@ add_ip4_config (GString *str, NMIP4Config *ip4, gboolean split)
 			domains = nm_dns_utils_get_ip4_rdns_domains (ip4);
 			if (domains) {
 				for (iter = domains; iter && *iter; iter++)
-					g_string_append_printf (str, "server=/%s/%s\n", *iter, buf);
+					add_server (servers, buf, *iter);
 				g_strfreev (domains);
 				added = TRUE;
 			}
@@ -109,7 +138,7 @@ add_ip4_config (GString *str, NMIP4Config *ip4, gboolean split)
 	if (!added) {
 		for (i = 0; i < nnameservers; i++) {
 			addr = nm_ip4_config_get_nameserver (ip4, i);
-			g_string_append_printf (str, "server=%s\n", nm_utils_inet4_ntop (addr, NULL));
+			add_server (servers, nm_utils_inet4_ntop (addr, NULL), NULL);
 		}
 	}
 
@@ -139,7 +168,7 @@ ip6_addr_to_string (const struct in6_addr *addr, const char *iface)
 }
 
 static gboolean
-add_ip6_config (GString *str, NMIP6Config *ip6, gboolean split)
+add_ip6_config (GVariantBuilder *servers, NMIP6Config *ip6, gboolean split)
 {
 	const struct in6_addr *addr;
 	char *buf = NULL;
@@ -163,9 +192,7 @@ add_ip6_config (GString *str, NMIP6Config *ip6, gboolean split)
 			/* searches are preferred over domains */
 			n = nm_ip6_config_get_num_searches (ip6);
 			for (i = 0; i < n; i++) {
-				g_string_append_printf (str, "server=/%s/%s\n",
-				                        nm_ip6_config_get_search (ip6, i),
-				                        buf);
+				add_server (servers, buf, nm_ip6_config_get_search (ip6, i));
 				added = TRUE;
 			}
 
@@ -173,9 +200,7 @@ add_ip6_config (GString *str, NMIP6Config *ip6, gboolean split)
 				/* If not searches, use any domains */
 				n = nm_ip6_config_get_num_domains (ip6);
 				for (i = 0; i < n; i++) {
-					g_string_append_printf (str, "server=/%s/%s\n",
-					                        nm_ip6_config_get_domain (ip6, i),
-					                        buf);
+					add_server (servers, buf, nm_ip6_config_get_domain (ip6, i));
 					added = TRUE;
 				}
 			}
@@ -190,7 +215,7 @@ add_ip6_config (GString *str, NMIP6Config *ip6, gboolean split)
 			addr = nm_ip6_config_get_nameserver (ip6, i);
 			buf = ip6_addr_to_string (addr, iface);
 			if (buf) {
-				g_string_append_printf (str, "server=%s\n", buf);
+				add_server (servers, buf, NULL);
 				g_free (buf);
 			}
 		}
@@ -199,88 +224,250 @@ add_ip6_config (GString *str, NMIP6Config *ip6, gboolean split)
 	return TRUE;
 }
 
-static gboolean
-update (NMDnsPlugin *plugin,
-        const GSList *vpn_configs,
-        const GSList *dev_configs,
-        const GSList *other_configs,
-        const char *hostname)
+/* Turns the SetServersEx arguments into the equivalent config file */
+static char *
+servers_to_conf (GVariant *servers)
 {
-	NMDnsDnsmasq *self = NM_DNS_DNSMASQ (plugin);
-	const char *dm_binary;
 	GString *conf;
-	GSList *iter;
-	const char *argv[15];
+	GVariantIter *iter;
+	const char **server;
+
+	conf = g_string_sized_new (150);
+	g_variant_get (servers, "(aas)", &iter);
+	while (g_variant_iter_next (iter, "^a&s", &server)) {
+		if (server[0] && server[1])
+			g_string_append_printf (conf, "server=/%s/%s\n", server[1], server[0]);
+		else if (server[0])
+			g_string_append_printf (conf, "server=%s\n", server[0]);
+		g_free (server);
+	}
+	g_variant_iter_free (iter);
+
+	return g_string_free (conf, FALSE);
+}
+
+/* Whether the dnsmasq build has D-Bus support, per its compile time
+ * options.  If that can't be told, starting it with D-Bus will. */
+static gboolean
+dnsmasq_has_dbus (const char *binary)
+{
+	const char *argv[] = { binary, "--version", NULL };
+	char *out = NULL;
+	gboolean has_dbus = TRUE;
+
+	if (g_spawn_sync (NULL, (char **) argv, NULL, G_SPAWN_STDERR_TO_DEV_NULL,
+	                  NULL, NULL, &out, NULL, NULL, NULL)) {
+		has_dbus = !strstr (out, "no-DBus");
+		g_free (out);
+	}
+	return has_dbus;
+}
+
+/* Switches to passing the servers in a config file and restarting
+ * dnsmasq on every change, for dnsmasq builds that can't be configured
+ * over D-Bus.  This lasts until dnsmasq quits on its own; the next one
+ * may be a different build. */
+static void
+disable_dbus (NMDnsDnsmasq *self)
+{
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
+
+	if (priv->no_dbus)
+		return;
+
+	nm_log_info (LOGD_DNS, "dnsmasq: D-Bus interface unavailable; restarting it on every DNS change");
+	priv->no_dbus = TRUE;
+	priv->running = FALSE;
+	g_clear_pointer (&priv->servers_sent, g_variant_unref);
+}
+
+static void
+set_servers_done (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+	SetServersData *data = user_data;
+	NMDnsDnsmasqPrivate *priv;
+	GVariant *response;
 	GError *error = NULL;
-	int ignored;
-	GPid pid = 0;
-	guint idx = 0;
 
-	/* Kill the old dnsmasq; there doesn't appear to be a way to get dnsmasq
-	 * to reread the config file using SIGHUP or similar.  This is a small race
-	 * here when restarting dnsmasq when DNS requests could go to the upstream
-	 * servers instead of to dnsmasq.
-	 */
-	nm_dns_plugin_child_kill (plugin);
+	response = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		goto out;
 
-	dm_binary = nm_utils_find_helper ("dnsmasq", DNSMASQ_PATH, NULL);
-	if (!dm_binary) {
-		nm_log_warn (LOGD_DNS, "Could not find dnsmasq binary");
-		return FALSE;
+	priv = NM_DNS_DNSMASQ_GET_PRIVATE (data->self);
+	if (!response) {
+		nm_log_warn (LOGD_DNS, "dnsmasq: failed to update the DNS servers: %s", error->message);
+
+		/* Only a dnsmasq that is on the bus but lacks the method is known
+		 * not to support it.  Other failures, like dnsmasq having just
+		 * left the bus, are retried with the next update or once it is
+		 * back on the bus. */
+		if (   priv->running
+		    && g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD)) {
+			disable_dbus (data->self);
+			nm_dns_plugin_child_kill (NM_DNS_PLUGIN (data->self));
+			if (!start_dnsmasq (data->self))
+				g_signal_emit_by_name (data->self, NM_DNS_PLUGIN_FAILED);
+		}
+		goto out;
 	}
 
-	/* Build up the new dnsmasq config file */
-	conf = g_string_sized_new (150);
+	/* Only remember servers dnsmasq accepted, so a failed call is
+	 * retried with the next update. */
+	if (priv->servers_sent)
+		g_variant_unref (priv->servers_sent);
+	priv->servers_sent = g_variant_ref (data->servers);
 
-	/* Use split DNS for VPN configs */
-	for (iter = (GSList *) vpn_configs; iter; iter = g_slist_next (iter)) {
-		if (NM_IS_IP4_CONFIG (iter->data))
-			add_ip4_config (conf, NM_IP4_CONFIG (iter->data), TRUE);
-		else if (NM_IS_IP6_CONFIG (iter->data))
-			add_ip6_config (conf, NM_IP6_CONFIG (iter->data), TRUE);
+out:
+	if (response)
+		g_variant_unref (response);
+	g_clear_error (&error);
+	g_variant_unref (data->servers);
+	g_slice_free (SetServersData, data);
+}
+
+static void
+send_servers (NMDnsDnsmasq *self)
+{
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
+	SetServersData *data;
+
+	if (priv->no_dbus || !priv->running || !priv->servers)
+		return;
+	if (priv->servers_sent && g_variant_equal (priv->servers, priv->servers_sent))
+		return;
+
+	if (nm_logging_enabled (LOGL_DEBUG, LOGD_DNS)) {
+		char *str = g_variant_print (priv->servers, FALSE);
+
+		nm_log_dbg (LOGD_DNS, "dnsmasq: setting servers %s", str);
+		g_free (str);
 	}
 
-	/* Now add interface configs without split DNS */
-	for (iter = (GSList *) dev_configs; iter; iter = g_slist_next (iter)) {
-		if (NM_IS_IP4_CONFIG (iter->data))
-			add_ip4_config (conf, NM_IP4_CONFIG (iter->data), FALSE);
-		else if (NM_IS_IP6_CONFIG (iter->data))
-			add_ip6_config (conf, NM_IP6_CONFIG (iter->data), FALSE);
+	data = g_slice_new (SetServersData);
+	data->self = self;
+	data->servers = g_variant_ref (priv->servers);
+
+	g_dbus_proxy_call (priv->dnsmasq,
+	                   "SetServersEx",
+	                   priv->servers,
+	                   G_DBUS_CALL_FLAGS_NONE,
+	                   -1,
+	                   priv->cancellable,
+	                   set_servers_done,
+	                   data);
+}
+
+static void
+name_owner_changed (GObject *object, GParamSpec *pspec, gpointer user_data)
+{
+	NMDnsDnsmasq *self = NM_DNS_DNSMASQ (user_data);
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
+	char *owner;
+
+	if (priv->no_dbus)
+		return;
+
+	owner = g_dbus_proxy_get_name_owner (G_DBUS_PROXY (object));
+	priv->running = !!owner;
+	g_free (owner);
+
+	/* A new dnsmasq instance knows no servers yet */
+	g_clear_pointer (&priv->servers_sent, g_variant_unref);
+
+	if (priv->running) {
+		nm_log_dbg (LOGD_DNS, "dnsmasq appeared on the bus");
+		send_servers (self);
+	} else
+		nm_log_dbg (LOGD_DNS, "dnsmasq disappeared from the bus");
+}
+
+static void
+dnsmasq_proxy_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+	NMDnsDnsmasq *self;
+	NMDnsDnsmasqPrivate *priv;
+	GDBusProxy *proxy;
+	GError *error = NULL;
+
+	proxy = g_dbus_proxy_new_for_bus_finish (res, &error);
+	if (!proxy) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			nm_log_warn (LOGD_DNS, "dnsmasq: failed to connect to the D-Bus: %s", error->message);
+		g_error_free (error);
+		return;
 	}
 
-	/* And any other random configs */
-	for (iter = (GSList *) other_configs; iter; iter = g_slist_next (iter)) {
-		if (NM_IS_IP4_CONFIG (iter->data))
-			add_ip4_config (conf, NM_IP4_CONFIG (iter->data), FALSE);
-		else if (NM_IS_IP6_CONFIG (iter->data))
-			add_ip6_config (conf, NM_IP6_CONFIG (iter->data), FALSE);
+	self = NM_DNS_DNSMASQ (user_data);
+	priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
+	priv->dnsmasq = proxy;
+	g_signal_connect (proxy, "notify::g-name-owner",
+	                  G_CALLBACK (name_owner_changed), self);
+	name_owner_changed (G_OBJECT (proxy), NULL, self);
+}
+
+static gboolean
+start_dnsmasq (NMDnsDnsmasq *self)
+{
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
+	const char *dm_binary;
+	const char *argv[15];
+	guint idx = 0;
+	char *pidfile_arg, *conffile_arg = NULL;
+	GPid pid;
+
+	dm_binary = priv->binary ? priv->binary : nm_utils_find_helper ("dnsmasq", DNSMASQ_PATH, NULL);
+	if (!dm_binary) {
+		nm_log_warn (LOGD_DNS, "Could not find dnsmasq binary");
+		return FALSE;
 	}
 
-	/* Write out the config file */
-	if (!g_file_set_contents (CONFFILE, conf->str, -1, &error)) {
-		nm_log_warn (LOGD_DNS, "Failed to write dnsmasq config file %s: (%d) %s",
-		             CONFFILE,
-		             error ? error->code : -1,
-		             error && error->message ? error->message : "(unknown)");
-		g_clear_error (&error);
-		goto out;
+	if (!priv->no_dbus && !priv->dbus_probed) {
+		priv->dbus_probed = TRUE;
+		if (!dnsmasq_has_dbus (dm_binary))
+			disable_dbus (self);
 	}
-	ignored = chmod (CONFFILE, 0644);
 
-	nm_log_dbg (LOGD_DNS, "dnsmasq local caching DNS configuration:");
-	nm_log_dbg (LOGD_DNS, "%s", conf->str);
+	pidfile_arg = g_strdup_printf ("--pid-file=%s", priv->pidfile);
 
 	argv[idx++] = dm_binary;
 	argv[idx++] = "--no-resolv";  /* Use only commandline */
 	argv[idx++] = "--keep-in-foreground";
 	argv[idx++] = "--no-hosts"; /* don't use /etc/hosts to resolve */
 	argv[idx++] = "--bind-interfaces";
-	argv[idx++] = "--pid-file=" PIDFILE;
+	argv[idx++] = pidfile_arg;
 	argv[idx++] = "--listen-address=127.0.0.1"; /* Should work for both 4 and 6 */
-	argv[idx++] = "--conf-file=" CONFFILE;
 	argv[idx++] = "--cache-size=400";
 	argv[idx++] = "--proxy-dnssec"; /* Allow DNSSEC to pass through */
 
+	if (priv->no_dbus) {
+		GError *error = NULL;
+		char *conf;
+		int ignored;
+
+		conf = servers_to_conf (priv->servers);
+		if (!g_file_set_contents (priv->conffile, conf, -1, &error)) {
+			nm_log_warn (LOGD_DNS, "Failed to write dnsmasq config file %s: (%d) %s",
+			             priv->conffile,
+			             error ? error->code : -1,
+			             error && error->message ? error->message : "(unknown)");
+			g_clear_error (&error);
+			g_free (conf);
+			g_free (pidfile_arg);
+			return FALSE;
+		}
+		ignored = chmod (priv->conffile, 0644);
+
+		nm_log_dbg (LOGD_DNS, "dnsmasq local caching DNS configuration:");
+		nm_log_dbg (LOGD_DNS, "%s", conf);
+		g_free (conf);
+
+		conffile_arg = g_strdup_printf ("--conf-file=%s", priv->conffile);
+		argv[idx++] = conffile_arg;
+	} else {
+		argv[idx++] = "--conf-file=/dev/null"; /* avoid loading /etc/dnsmasq.conf */
+		argv[idx++] = "--enable-dbus=" DNSMASQ_DBUS_SERVICE; /* servers are set over D-Bus */
+	}
+
 	/* dnsmasq exits if the conf dir is not present */
 	if (g_file_test (CONFDIR, G_FILE_TEST_IS_DIR))
 		argv[idx++] = "--conf-dir=" CONFDIR;
@@ -288,12 +475,70 @@ update (NMDnsPlugin *plugin,
 	argv[idx++] = NULL;
 	g_warn_if_fail (idx <= G_N_ELEMENTS (argv));
 
-	/* And finally spawn dnsmasq */
-	pid = nm_dns_plugin_child_spawn (NM_DNS_PLUGIN (self), argv, PIDFILE, "bin/dnsmasq");
+	pid = nm_dns_plugin_child_spawn (NM_DNS_PLUGIN (self), argv, priv->pidfile, "bin/dnsmasq");
+	g_free (pidfile_arg);
+	g_free (conffile_arg);
+	return pid != 0;
+}
 
-out:
-	g_string_free (conf, TRUE);
-	return pid ? TRUE : FALSE;
+static gboolean
+update (NMDnsPlugin *plugin,
+        const GSList *vpn_configs,
+        const GSList *dev_configs,
+        const GSList *other_configs,
+        const char *hostname)
+{
+	NMDnsDnsmasq *self = NM_DNS_DNSMASQ (plugin);
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
+	GVariantBuilder servers;
+	GSList *iter;
+
+	g_variant_builder_init (&servers, G_VARIANT_TYPE ("aas"));
+
+	/* Use split DNS for VPN configs */
+	for (iter = (GSList *) vpn_configs; iter; iter = g_slist_next (iter)) {
+		if (NM_IS_IP4_CONFIG (iter->data))
+			add_ip4_config (&servers, NM_IP4_CONFIG (iter->data), TRUE);
+		else if (NM_IS_IP6_CONFIG (iter->data))
+			add_ip6_config (&servers, NM_IP6_CONFIG (iter->data), TRUE);
+	}
+
+	/* Now add interface configs without split DNS */
+	for (iter = (GSList *) dev_configs; iter; iter = g_slist_next (iter)) {
+		if (NM_IS_IP4_CONFIG (iter->data))
+			add_ip4_config (&servers, NM_IP4_CONFIG (iter->data), FALSE);
+		else if (NM_IS_IP6_CONFIG (iter->data))
+			add_ip6_config (&servers, NM_IP6_CONFIG (iter->data), FALSE);
+	}
+
+	/* And any other random configs */
+	for (iter = (GSList *) other_configs; iter; iter = g_slist_next (iter)) {
+		if (NM_IS_IP4_CONFIG (iter->data))
+			add_ip4_config (&servers, NM_IP4_CONFIG (iter->data), FALSE);
+		else if (NM_IS_IP6_CONFIG (iter->data))
+			add_ip6_config (&servers, NM_IP6_CONFIG (iter->data), FALSE);
+	}
+
+	if (priv->servers)
+		g_variant_unref (priv->servers);
+	priv->servers = g_variant_ref_sink (g_variant_new ("(aas)", &servers));
+
+	if (priv->no_dbus) {
+		/* Without D-Bus there doesn't appear to be a way to get dnsmasq to
+		 * reread the config file, so it is restarted with the new one. */
+		nm_dns_plugin_child_kill (plugin);
+		return start_dnsmasq (self);
+	}
+
+	/* dnsmasq is started once and then told about new servers over
+	 * D-Bus, which keeps its cache.  It is only started again after
+	 * it quit. */
+	if (!nm_dns_plugin_child_pid (plugin) && !start_dnsmasq (self))
+		return FALSE;
+
+	/* Sent right away if dnsmasq is on the bus; otherwise once it shows up */
+	send_servers (self);
+	return TRUE;
 }
 
 /****************************************************************/
@@ -320,7 +565,7 @@ static void
 child_quit (NMDnsPlugin *plugin, gint status)
 {
 	NMDnsDnsmasq *self = NM_DNS_DNSMASQ (plugin);
-	gboolean failed = TRUE;
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
 	int err;
 
 	if (WIFEXITED (status)) {
@@ -330,7 +575,7 @@ child_quit (NMDnsPlugin *plugin, gint status)
 			             dm_exit_code_to_msg (err),
 			             err);
 		} else
-			failed = FALSE;
+			nm_log_warn (LOGD_DNS, "dnsmasq exited unexpectedly");
 	} else if (WIFSTOPPED (status)) {
 		nm_log_warn (LOGD_DNS, "dnsmasq stopped unexpectedly with signal %d", WSTOPSIG (status));
 	} else if (WIFSIGNALED (status)) {
@@ -338,10 +583,16 @@ child_quit (NMDnsPlugin *plugin, gint status)
 	} else {
 		nm_log_warn (LOGD_DNS, "dnsmasq died from an unknown cause");
 	}
-	unlink (CONFFILE);
 
-	if (failed)
-		g_signal_emit_by_name (self, NM_DNS_PLUGIN_FAILED);
+	/* The dnsmasq started next may be another build, e.g. after an
+	 * upgrade, so it gets checked for D-Bus support again. */
+	priv->no_dbus = FALSE;
+	priv->dbus_probed = FALSE;
+	priv->running = FALSE;
+
+	/* dnsmasq is expected to keep running, so even a clean exit leaves
+	 * no local nameserver until the next update starts it again. */
+	g_signal_emit_by_name (self, NM_DNS_PLUGIN_FAILED);
 }
 
 /****************************************************************/
@@ -366,19 +617,74 @@ nm_dns_dnsmasq_new (void)
 	return g_object_new (NM_TYPE_DNS_DNSMASQ, NULL);
 }
 
+NMDnsPlugin *
+_nm_dns_dnsmasq_new_for_test (const char *binary, const char *rundir)
+{
+	NMDnsPlugin *plugin;
+	NMDnsDnsmasqPrivate *priv;
+
+	plugin = nm_dns_dnsmasq_new ();
+	priv = NM_DNS_DNSMASQ_GET_PRIVATE (plugin);
+	priv->binary = g_strdup (binary);
+	g_free (priv->pidfile);
+	priv->pidfile = g_build_filename (rundir, "dnsmasq.pid", NULL);
+	g_free (priv->conffile);
+	priv->conffile = g_build_filename (rundir, "dnsmasq.conf", NULL);
+	return plugin;
+}
+
 static void
 nm_dns_dnsmasq_init (NMDnsDnsmasq *self)
 {
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
+
+	priv->pidfile = g_strdup (PIDFILE);
+	priv->conffile = g_strdup (CONFFILE);
+	priv->cancellable = g_cancellable_new ();
+	g_dbus_proxy_new_for_bus (G_BUS_TYPE_SYSTEM,
+	                          G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
+	                              G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS |
+	                              G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
+	                          NULL,
+	                          DNSMASQ_DBUS_SERVICE,
+	                          DNSMASQ_DBUS_PATH,
+	                          DNSMASQ_DBUS_SERVICE,
+	                          priv->cancellable,
+	                          dnsmasq_proxy_cb,
+	                          self);
 }
 
 static void
 dispose (GObject *object)
 {
-	unlink (CONFFILE);
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (object);
+
+	if (priv->cancellable) {
+		g_cancellable_cancel (priv->cancellable);
+		g_clear_object (&priv->cancellable);
+	}
+	if (priv->dnsmasq) {
+		g_signal_handlers_disconnect_by_func (priv->dnsmasq, name_owner_changed, object);
+		g_clear_object (&priv->dnsmasq);
+	}
+	g_clear_pointer (&priv->servers, g_variant_unref);
+	g_clear_pointer (&priv->servers_sent, g_variant_unref);
 
 	G_OBJECT_CLASS (nm_dns_dnsmasq_parent_class)->dispose (object);
 }
 
+static void
+finalize (GObject *object)
+{
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (object);
+
+	g_free (priv->binary);
+	g_free (priv->pidfile);
+	g_free (priv->conffile);
+
+	G_OBJECT_CLASS (nm_dns_dnsmasq_parent_class)->finalize (object);
+}
+
 static void
 nm_dns_dnsmasq_class_init (NMDnsDnsmasqClass *dns_class)
 {
@@ -388,6 +694,7 @@ nm_dns_dnsmasq_class_init (NMDnsDnsmasqClass *dns_class)
 	g_type_class_add_private (dns_class, sizeof (NMDnsDnsmasqPrivate));
 
 	object_class->dispose = dispose;
+	object_class->finalize = finalize;
 
 	plugin_class->child_quit = child_quit;
 	plugin_class->is_caching = is_caching;
@@ -43,5 +43,8 @@ GType nm_dns_dnsmasq_get_type (void);
 
 NMDnsPlugin *nm_dns_dnsmasq_new (void);
 
+/* For tests: runs @binary instead of dnsmasq, with its files in @rundir */
+NMDnsPlugin *_nm_dns_dnsmasq_new_for_test (const char *binary, const char *rundir);
+
 #endif /* __NETWORKMANAGER_DNS_DNSMASQ_H__ */
 
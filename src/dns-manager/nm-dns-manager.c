@@ -104,7 +104,19 @@ typedef struct {
 
 	NMConfig *config;
 
+	char *my_resolv_conf;  /* overridden by tests */
+
 	gboolean dns_touched;
+
+	/* Coalescing of updates; see schedule_update_dns() */
+	guint update_delay;
+	guint update_id;
+
+	/* What was last handed to resolvconf or netconfig */
+	char *last_dispatch;
+
+	guint64 updates_coalesced;
+	guint64 updates_suppressed;
 } NMDnsManagerPrivate;
 
 enum {
@@ -298,60 +310,79 @@ run_netconfig (GError **error, gint *stdin_fd)
 }
 
 static void
-write_to_netconfig (gint fd, const char *key, const char *value)
+write_to_netconfig (GString *input, const char *key, const char *value)
 {
-	char *str;
-	int x;
-
-	str = g_strdup_printf ("%s='%s'\n", key, value);
-	nm_log_dbg (LOGD_DNS, "writing to netconfig: %s", str);
-	x = write (fd, str, strlen (str));
-	g_free (str);
+	nm_log_dbg (LOGD_DNS, "writing to netconfig: %s='%s'", key, value);
+	g_string_append_printf (input, "%s='%s'\n", key, value);
 }
 
-static SpawnResult
-dispatch_netconfig (char **searches,
-                    char **nameservers,
-                    const char *nis_domain,
-                    char **nis_servers,
-                    GError **error)
+static char *
+create_netconfig_input (char **searches,
+                        char **nameservers,
+                        const char *nis_domain,
+                        char **nis_servers)
 {
+	GString *input;
 	char *str;
-	GPid pid;
-	gint fd;
-	int status;
 
-	pid = run_netconfig (error, &fd);
-	if (pid <= 0)
-		return SR_NOTFOUND;
+	input = g_string_new (NULL);
 
 	/* NM is writing already-merged DNS information to netconfig, so it
 	 * does not apply to a specific network interface.
 	 */
-	write_to_netconfig (fd, "INTERFACE", "NetworkManager");
+	write_to_netconfig (input, "INTERFACE", "NetworkManager");
 
 	if (searches) {
 		str = g_strjoinv (" ", searches);
 
-		write_to_netconfig (fd, "DNSSEARCH", str);
+		write_to_netconfig (input, "DNSSEARCH", str);
 		g_free (str);
 	}
 
 	if (nameservers) {
 		str = g_strjoinv (" ", nameservers);
-		write_to_netconfig (fd, "DNSSERVERS", str);
+		write_to_netconfig (input, "DNSSERVERS", str);
 		g_free (str);
 	}
 
 	if (nis_domain)
-		write_to_netconfig (fd, "NISDOMAIN", nis_domain);
+		write_to_netconfig (input, "NISDOMAIN", nis_domain);
 
 	if (nis_servers) {
 		str = g_strjoinv (" ", nis_servers);
-		write_to_netconfig (fd, "NISSERVERS", str);
+		write_to_netconfig (input, "NISSERVERS", str);
 		g_free (str);
 	}
 
+	return g_string_free (input, FALSE);
+}
+
+static SpawnResult
+dispatch_netconfig (const char *input,
+                    GError **error)
+{
+	GPid pid;
+	gint fd;
+	int status;
+	gssize len, x;
+
+	pid = run_netconfig (error, &fd);
+	if (pid <= 0)
+		return SR_NOTFOUND;
+
+	len = strlen (input);
+	while (len > 0) {
+		x = write (fd, input, len);
+		if (x < 0) {
+			if (errno == EINTR)
+				continue;
+			nm_log_warn (LOGD_DNS, "could not write to netconfig: %s", g_strerror (errno));
+			break;
+		}
+		input += x;
+		len -= x;
+	}
+
 	close (fd);
 
 	/* Wait until the process exits */
@@ -373,35 +404,23 @@ dispatch_netconfig (char **searches,
 	return SR_SUCCESS;
 }
 
-static gboolean
-write_resolv_conf (FILE *f,
-                   char **searches,
-                   char **nameservers,
-                   char **options,
-                   GError **error)
+static char *
+create_resolv_conf (char **searches,
+                    char **nameservers,
+                    char **options)
 {
-	char *searches_str = NULL;
-	char *nameservers_str = NULL;
-	char *options_str = NULL;
-	gboolean retval = FALSE;
-	char *tmp_str;
 	GString *str;
+	char *tmp_str;
 	int i;
 
+	str = g_string_new ("# Generated by NetworkManager\n");
+
 	if (searches) {
 		tmp_str = g_strjoinv (" ", searches);
-		searches_str = g_strconcat ("search ", tmp_str, "\n", NULL);
-		g_free (tmp_str);
-	}
-
-	if (options) {
-		tmp_str = g_strjoinv (" ", options);
-		options_str = g_strconcat ("option ", tmp_str, "\n", NULL);
+		g_string_append_printf (str, "search %s\n", tmp_str);
 		g_free (tmp_str);
 	}
 
-	str = g_string_new ("");
-
 	if (nameservers) {
 		int num = g_strv_length (nameservers);
 
@@ -420,32 +439,17 @@ write_resolv_conf (FILE *f,
 		}
 	}
 
-	nameservers_str = g_string_free (str, FALSE);
-
-	if (fprintf (f, "# Generated by NetworkManager\n%s%s%s",
-	             searches_str ? searches_str : "",
-	             nameservers_str,
-	             options_str ? options_str : "") > 0)
-		retval = TRUE;
-	else {
-		g_set_error (error,
-		             NM_MANAGER_ERROR,
-		             NM_MANAGER_ERROR_FAILED,
-		             "Could not write " _PATH_RESCONF ": %s\n",
-		             g_strerror (errno));
+	if (options) {
+		tmp_str = g_strjoinv (" ", options);
+		g_string_append_printf (str, "option %s\n", tmp_str);
+		g_free (tmp_str);
 	}
 
-	g_free (searches_str);
-	g_free (nameservers_str);
-	g_free (options_str);
-
-	return retval;
+	return g_string_free (str, FALSE);
 }
 
 static SpawnResult
-dispatch_resolvconf (char **searches,
-                     char **nameservers,
-                     char **options,
+dispatch_resolvconf (const char *content,
                      GError **error)
 {
 	char *cmd;
@@ -461,7 +465,7 @@ dispatch_resolvconf (char **searches,
 		return SR_NOTFOUND;
 	}
 
-	if (searches || nameservers) {
+	if (content) {
 		cmd = g_strconcat (RESOLVCONF_PATH, " -a ", "NetworkManager", NULL);
 		nm_log_info (LOGD_DNS, "Writing DNS information to %s", RESOLVCONF_PATH);
 		if ((f = popen (cmd, "w")) == NULL)
@@ -472,7 +476,16 @@ dispatch_resolvconf (char **searches,
 			             RESOLVCONF_PATH,
 			             g_strerror (errno));
 		else {
-			retval = write_resolv_conf (f, searches, nameservers, options, error);
+			if (fputs (content, f) >= 0)
+				retval = TRUE;
+			else {
+				g_set_error (error,
+				             NM_MANAGER_ERROR,
+				             NM_MANAGER_ERROR_FAILED,
+				             "Could not write to %s: %s\n",
+				             RESOLVCONF_PATH,
+				             g_strerror (errno));
+			}
 			err = pclose (f);
 			if (err < 0) {
 				errnosv = errno;
@@ -497,77 +510,110 @@ dispatch_resolvconf (char **searches,
 }
 
 #define MY_RESOLV_CONF NMRUNDIR "/resolv.conf"
-#define MY_RESOLV_CONF_TMP MY_RESOLV_CONF ".tmp"
 #define RESOLV_CONF_TMP "/etc/.resolv.conf.NetworkManager"
 
-static SpawnResult
-update_resolv_conf (char **searches,
-                    char **nameservers,
-					char **options,
-                    GError **error,
-                    gboolean install_etc)
+static gboolean
+write_resolv_conf (const char *path, const char *content, GError **error)
 {
 	FILE *f;
-	struct stat st;
-	gboolean ret;
-
-	/* If we are not managing /etc/resolv.conf and it points to
-	 * MY_RESOLV_CONF, don't write the private DNS configuration to
-	 * MY_RESOLV_CONF otherwise we would overwrite the changes done by
-	 * some external application.
-	 */
-	if (!install_etc) {
-		char *path = g_file_read_link (_PATH_RESCONF, NULL);
-		gboolean ours = !g_strcmp0 (path, MY_RESOLV_CONF);
-
-		g_free (path);
+	char *tmp;
+	gboolean ret = TRUE;
 
-		if (ours) {
-			nm_log_dbg (LOGD_DNS, "not updating " MY_RESOLV_CONF
-			            " since it points to " _PATH_RESCONF);
-			return SR_ERROR;
-		}
-	}
+	tmp = g_strconcat (path, ".tmp", NULL);
 
-	if ((f = fopen (MY_RESOLV_CONF_TMP, "w")) == NULL) {
+	if ((f = fopen (tmp, "w")) == NULL) {
 		g_set_error (error,
 		             NM_MANAGER_ERROR,
 		             NM_MANAGER_ERROR_FAILED,
 		             "Could not open %s: %s\n",
-		             MY_RESOLV_CONF_TMP,
+		             tmp,
 		             g_strerror (errno));
-		return SR_ERROR;
+		g_free (tmp);
+		return FALSE;
 	}
 
-	ret = write_resolv_conf (f, searches, nameservers, options, error);
+	if (fputs (content, f) < 0) {
+		g_set_error (error,
+		             NM_MANAGER_ERROR,
+		             NM_MANAGER_ERROR_FAILED,
+		             "Could not write %s: %s\n",
+		             tmp,
+		             g_strerror (errno));
+		ret = FALSE;
+	}
 
 	if (fclose (f) < 0) {
 		if (ret) {
-			/* only set an error here if write_resolv_conf() was successful,
+			/* only set an error here if the write was successful,
 			 * since its error is more important.
 			 */
 			g_set_error (error,
 			             NM_MANAGER_ERROR,
 			             NM_MANAGER_ERROR_FAILED,
 			             "Could not close %s: %s\n",
-			             MY_RESOLV_CONF_TMP,
+			             tmp,
 			             g_strerror (errno));
+			ret = FALSE;
 		}
 	}
 
 	if (!ret)
-		return SR_ERROR;
-
-	if (rename (MY_RESOLV_CONF_TMP, MY_RESOLV_CONF) < 0) {
+		unlink (tmp);
+	else if (rename (tmp, path) < 0) {
+		/* Replace the file atomically so readers never see a partial one */
 		g_set_error (error,
 		             NM_MANAGER_ERROR,
 		             NM_MANAGER_ERROR_FAILED,
 		             "Could not replace %s: %s\n",
-		             MY_RESOLV_CONF,
+		             path,
 		             g_strerror (errno));
-		return SR_ERROR;
+		ret = FALSE;
+	}
+
+	g_free (tmp);
+	return ret;
+}
+
+static SpawnResult
+update_resolv_conf (NMDnsManager *self,
+                    const char *content,
+                    GError **error,
+                    gboolean install_etc)
+{
+	NMDnsManagerPrivate *priv = NM_DNS_MANAGER_GET_PRIVATE (self);
+	struct stat st;
+	char *old_content = NULL;
+	gboolean unchanged;
+
+	/* If we are not managing /etc/resolv.conf and it points to
+	 * MY_RESOLV_CONF, don't write the private DNS configuration to
+	 * MY_RESOLV_CONF otherwise we would overwrite the changes done by
+	 * some external application.
+	 */
+	if (!install_etc) {
+		char *path = g_file_read_link (_PATH_RESCONF, NULL);
+		gboolean ours = !g_strcmp0 (path, priv->my_resolv_conf);
+
+		g_free (path);
+
+		if (ours) {
+			nm_log_dbg (LOGD_DNS, "not updating %s since it points to " _PATH_RESCONF,
+			            priv->my_resolv_conf);
+			return SR_ERROR;
+		}
 	}
 
+	/* Only touch the disk if the contents actually change */
+	unchanged =    g_file_get_contents (priv->my_resolv_conf, &old_content, NULL, NULL)
+	            && !strcmp (old_content, content);
+	g_free (old_content);
+
+	if (unchanged) {
+		priv->updates_suppressed++;
+		nm_log_dbg (LOGD_DNS, "not rewriting %s since it did not change", priv->my_resolv_conf);
+	} else if (!write_resolv_conf (priv->my_resolv_conf, content, error))
+		return SR_ERROR;
+
 	if (!install_etc)
 		return SR_SUCCESS;
 
@@ -576,12 +622,10 @@ update_resolv_conf (char **searches,
 		/* Don't overwrite a symbolic link. */
 		if (S_ISLNK (st.st_mode)) {
 			if (stat (_PATH_RESCONF, &st) != -1) {
-				char *path = g_file_read_link (_PATH_RESCONF, NULL);
-				gboolean not_ours = g_strcmp0 (path, MY_RESOLV_CONF) != 0;
-
-				g_free (path);
-				if (not_ours)
-					return SR_SUCCESS;
+				/* Either it is not ours, or it already points to
+				 * MY_RESOLV_CONF and there is nothing to replace.
+				 */
+				return SR_SUCCESS;
 			} else {
 				if (errno != ENOENT)
 					return SR_SUCCESS;
@@ -614,13 +658,13 @@ update_resolv_conf (char **searches,
 		return SR_ERROR;
 	}
 
-	if (symlink (MY_RESOLV_CONF, RESOLV_CONF_TMP) == -1) {
+	if (symlink (priv->my_resolv_conf, RESOLV_CONF_TMP) == -1) {
 		g_set_error (error,
 		             NM_MANAGER_ERROR,
 		             NM_MANAGER_ERROR_FAILED,
 		             "Could not create symlink %s pointing to %s: %s\n",
 		             RESOLV_CONF_TMP,
-		             MY_RESOLV_CONF,
+		             priv->my_resolv_conf,
 		             g_strerror (errno));
 		return SR_ERROR;
 	}
@@ -727,6 +771,7 @@ update_dns (NMDnsManager *self,
 	char **options = NULL;
 	char **nameservers = NULL;
 	char **nis_servers = NULL;
+	char *content, *input;
 	int num, i, len;
 	gboolean caching = FALSE, update = TRUE;
 	gboolean resolv_conf_updated = FALSE;
@@ -736,6 +781,9 @@ update_dns (NMDnsManager *self,
 
 	priv = NM_DNS_MANAGER_GET_PRIVATE (self);
 
+	/* Anything still waiting to be coalesced is covered by this update */
+	nm_clear_g_source (&priv->update_id);
+
 	if (priv->resolv_conf_mode == NM_DNS_MANAGER_RESOLV_CONF_UNMANAGED) {
 		update = FALSE;
 		nm_log_dbg (LOGD_DNS, "not updating resolv.conf");
@@ -886,18 +934,44 @@ update_dns (NMDnsManager *self,
 		nameservers[0] = g_strdup ("127.0.0.1");
 	}
 
+	content = create_resolv_conf (searches, nameservers, options);
+
 	if (update) {
 		switch (priv->rc_manager) {
 		case NM_DNS_MANAGER_RESOLV_CONF_MAN_NONE:
-			result = update_resolv_conf (searches, nameservers, options, error, TRUE);
+			result = update_resolv_conf (self, content, error, TRUE);
 			resolv_conf_updated = TRUE;
 			break;
 		case NM_DNS_MANAGER_RESOLV_CONF_MAN_RESOLVCONF:
-			result = dispatch_resolvconf (searches, nameservers, options, error);
+			/* An empty string stands for removing our information */
+			input = g_strdup ((searches || nameservers) ? content : "");
+			if (!g_strcmp0 (priv->last_dispatch, input)) {
+				priv->updates_suppressed++;
+				nm_log_dbg (LOGD_DNS, "not calling %s since nothing changed", RESOLVCONF_PATH);
+				result = SR_SUCCESS;
+				g_free (input);
+				break;
+			}
+			result = dispatch_resolvconf (*input ? input : NULL, error);
+			g_free (priv->last_dispatch);
+			priv->last_dispatch = result == SR_SUCCESS ? input : NULL;
+			if (result != SR_SUCCESS)
+				g_free (input);
 			break;
 		case NM_DNS_MANAGER_RESOLV_CONF_MAN_NETCONFIG:
-			result = dispatch_netconfig (searches, nameservers, nis_domain,
-			                             nis_servers, error);
+			input = create_netconfig_input (searches, nameservers, nis_domain, nis_servers);
+			if (!g_strcmp0 (priv->last_dispatch, input)) {
+				priv->updates_suppressed++;
+				nm_log_dbg (LOGD_DNS, "not calling %s since nothing changed", NETCONFIG_PATH);
+				result = SR_SUCCESS;
+				g_free (input);
+				break;
+			}
+			result = dispatch_netconfig (input, error);
+			g_free (priv->last_dispatch);
+			priv->last_dispatch = result == SR_SUCCESS ? input : NULL;
+			if (result != SR_SUCCESS)
+				g_free (input);
 			break;
 		default:
 			g_assert_not_reached ();
@@ -906,7 +980,7 @@ update_dns (NMDnsManager *self,
 		if (result == SR_NOTFOUND) {
 			nm_log_dbg (LOGD_DNS, "program not available, writing to resolv.conf");
 			g_clear_error (error);
-			result = update_resolv_conf (searches, nameservers, options, error, TRUE);
+			result = update_resolv_conf (self, content, error, TRUE);
 			resolv_conf_updated = TRUE;
 		}
 	}
@@ -914,7 +988,12 @@ update_dns (NMDnsManager *self,
 	/* Unless we've already done it, update private resolv.conf in NMRUNDIR
 	   ignoring any errors */
 	if (!resolv_conf_updated)
-		update_resolv_conf (searches, nameservers, options, NULL, FALSE);
+		update_resolv_conf (self, content, NULL, FALSE);
+
+	g_free (content);
+
+	nm_log_dbg (LOGD_DNS, "DNS: %" G_GUINT64_FORMAT " updates coalesced, %" G_GUINT64_FORMAT " unchanged updates suppressed so far",
+	            priv->updates_coalesced, priv->updates_suppressed);
 
 	/* signal that resolv.conf was changed */
 	if (update && result == SR_SUCCESS)
@@ -932,6 +1011,48 @@ update_dns (NMDnsManager *self,
 	return !update || result == SR_SUCCESS;
 }
 
+static gboolean
+update_dns_timeout_cb (gpointer user_data)
+{
+	NMDnsManager *self = NM_DNS_MANAGER (user_data);
+	GError *error = NULL;
+
+	NM_DNS_MANAGER_GET_PRIVATE (self)->update_id = 0;
+
+	if (!update_dns (self, FALSE, &error)) {
+		nm_log_warn (LOGD_DNS, "could not commit DNS changes: %s", error->message);
+		g_clear_error (&error);
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Apply the current configuration, either right away or, when a
+ * dns-update-delay is configured, once the delay has passed.  Any changes
+ * made in the meantime are folded into that single update.
+ */
+static void
+schedule_update_dns (NMDnsManager *self)
+{
+	NMDnsManagerPrivate *priv = NM_DNS_MANAGER_GET_PRIVATE (self);
+	GError *error = NULL;
+
+	if (priv->update_delay == 0) {
+		if (!update_dns (self, FALSE, &error)) {
+			nm_log_warn (LOGD_DNS, "could not commit DNS changes: %s", error->message);
+			g_clear_error (&error);
+		}
+		return;
+	}
+
+	if (priv->update_id) {
+		priv->updates_coalesced++;
+		return;
+	}
+
+	priv->update_id = g_timeout_add (priv->update_delay, update_dns_timeout_cb, self);
+}
+
 static void
 plugin_failed (NMDnsPlugin *plugin, gpointer user_data)
 {
@@ -972,7 +1093,6 @@ nm_dns_manager_add_ip4_config (NMDnsManager *mgr,
                                NMDnsIPConfigType cfg_type)
 {
 	NMDnsManagerPrivate *priv;
-	GError *error = NULL;
 
 	g_return_val_if_fail (mgr != NULL, FALSE);
 	g_return_val_if_fail (config != NULL, FALSE);
@@ -996,10 +1116,8 @@ nm_dns_manager_add_ip4_config (NMDnsManager *mgr,
 	if (!g_slist_find (priv->configs, config))
 		priv->configs = g_slist_append (priv->configs, g_object_ref (config));
 
-	if (!priv->updates_queue && !update_dns (mgr, FALSE, &error)) {
-		nm_log_warn (LOGD_DNS, "could not commit DNS changes: %s", error->message);
-		g_clear_error (&error);
-	}
+	if (!priv->updates_queue)
+		schedule_update_dns (mgr);
 
 	return TRUE;
 }
@@ -1008,7 +1126,6 @@ gboolean
 nm_dns_manager_remove_ip4_config (NMDnsManager *mgr, NMIP4Config *config)
 {
 	NMDnsManagerPrivate *priv;
-	GError *error = NULL;
 
 	g_return_val_if_fail (mgr != NULL, FALSE);
 	g_return_val_if_fail (config != NULL, FALSE);
@@ -1028,10 +1145,8 @@ nm_dns_manager_remove_ip4_config (NMDnsManager *mgr, NMIP4Config *config)
 
 	g_object_unref (config);
 
-	if (!priv->updates_queue && !update_dns (mgr, FALSE, &error)) {
-		nm_log_warn (LOGD_DNS, "could not commit DNS changes: %s", error->message);
-		g_clear_error (&error);
-	}
+	if (!priv->updates_queue)
+		schedule_update_dns (mgr);
 
 	g_object_set_data (G_OBJECT (config), IP_CONFIG_IFACE_TAG, NULL);
 
@@ -1045,7 +1160,6 @@ nm_dns_manager_add_ip6_config (NMDnsManager *mgr,
                                NMDnsIPConfigType cfg_type)
 {
 	NMDnsManagerPrivate *priv;
-	GError *error = NULL;
 
 	g_return_val_if_fail (mgr != NULL, FALSE);
 	g_return_val_if_fail (config != NULL, FALSE);
@@ -1069,10 +1183,8 @@ nm_dns_manager_add_ip6_config (NMDnsManager *mgr,
 	if (!g_slist_find (priv->configs, config))
 		priv->configs = g_slist_append (priv->configs, g_object_ref (config));
 
-	if (!priv->updates_queue && !update_dns (mgr, FALSE, &error)) {
-		nm_log_warn (LOGD_DNS, "could not commit DNS changes: %s", error->message);
-		g_clear_error (&error);
-	}
+	if (!priv->updates_queue)
+		schedule_update_dns (mgr);
 
 	return TRUE;
 }
@@ -1081,7 +1193,6 @@ gboolean
 nm_dns_manager_remove_ip6_config (NMDnsManager *mgr, NMIP6Config *config)
 {
 	NMDnsManagerPrivate *priv;
-	GError *error = NULL;
 
 	g_return_val_if_fail (mgr != NULL, FALSE);
 	g_return_val_if_fail (config != NULL, FALSE);
@@ -1101,10 +1212,8 @@ nm_dns_manager_remove_ip6_config (NMDnsManager *mgr, NMIP6Config *config)
 
 	g_object_unref (config);	
 
-	if (!priv->updates_queue && !update_dns (mgr, FALSE, &error)) {
-		nm_log_warn (LOGD_DNS, "could not commit DNS changes: %s", error->message);
-		g_clear_error (&error);
-	}
+	if (!priv->updates_queue)
+		schedule_update_dns (mgr);
 
 	g_object_set_data (G_OBJECT (config), IP_CONFIG_IFACE_TAG, NULL);
 
@@ -1125,7 +1234,6 @@ nm_dns_manager_set_hostname (NMDnsManager *mgr,
                              const char *hostname)
 {
 	NMDnsManagerPrivate *priv = NM_DNS_MANAGER_GET_PRIVATE (mgr);
-	GError *error = NULL;
 	const char *filtered = NULL;
 
 	/* Certain hostnames we don't want to include in resolv.conf 'searches' */
@@ -1143,10 +1251,8 @@ nm_dns_manager_set_hostname (NMDnsManager *mgr,
 	g_free (priv->hostname);
 	priv->hostname = g_strdup (filtered);
 
-	if (!priv->updates_queue && !update_dns (mgr, FALSE, &error)) {
-		nm_log_warn (LOGD_DNS, "could not commit DNS changes: %s", error->message);
-		g_clear_error (&error);
-	}
+	if (!priv->updates_queue)
+		schedule_update_dns (mgr);
 }
 
 NMDnsManagerResolvConfMode
@@ -1176,7 +1282,6 @@ void
 nm_dns_manager_end_updates (NMDnsManager *mgr, const char *func)
 {
 	NMDnsManagerPrivate *priv;
-	GError *error = NULL;
 	gboolean changed;
 	guint8 new[HASH_LEN];
 
@@ -1197,18 +1302,45 @@ nm_dns_manager_end_updates (NMDnsManager *mgr, const char *func)
 
 	/* Commit all the outstanding changes */
 	nm_log_dbg (LOGD_DNS, "(%s): committing DNS changes (%d)", func, priv->updates_queue);
-	if (!update_dns (mgr, FALSE, &error)) {
-		nm_log_warn (LOGD_DNS, "could not commit DNS changes: %s", error->message);
-		g_clear_error (&error);
-	}
+	schedule_update_dns (mgr);
 
 	memset (priv->prev_hash, 0, sizeof (priv->prev_hash));
 }
 
+void
+nm_dns_manager_get_stats (NMDnsManager *mgr,
+                          guint64 *out_coalesced,
+                          guint64 *out_suppressed)
+{
+	NMDnsManagerPrivate *priv;
+
+	g_return_if_fail (NM_IS_DNS_MANAGER (mgr));
+
+	priv = NM_DNS_MANAGER_GET_PRIVATE (mgr);
+	if (out_coalesced)
+		*out_coalesced = priv->updates_coalesced;
+	if (out_suppressed)
+		*out_suppressed = priv->updates_suppressed;
+}
+
 /******************************************************************/
 
 NM_DEFINE_SINGLETON_GETTER (NMDnsManager, nm_dns_manager_get, NM_TYPE_DNS_MANAGER);
 
+NMDnsManager *
+_nm_dns_manager_new_for_test (const char *rundir, guint update_delay)
+{
+	NMDnsManager *self;
+	NMDnsManagerPrivate *priv;
+
+	self = g_object_new (NM_TYPE_DNS_MANAGER, NULL);
+	priv = NM_DNS_MANAGER_GET_PRIVATE (self);
+	g_free (priv->my_resolv_conf);
+	priv->my_resolv_conf = g_build_filename (rundir, "resolv.conf", NULL);
+	priv->update_delay = update_delay;
+	return self;
+}
+
 static void
 init_resolv_conf_mode (NMDnsManager *self)
 {
@@ -1292,6 +1424,8 @@ init_resolv_conf_manager (NMDnsManager *self)
 	}
 
 	nm_log_info (LOGD_DNS, "DNS: using resolv.conf manager '%s'", desc);
+
+	g_clear_pointer (&priv->last_dispatch, g_free);
 }
 
 static void
@@ -1323,7 +1457,10 @@ nm_dns_manager_init (NMDnsManager *self)
 	/* Set the initial hash */
 	compute_hash (self, NM_DNS_MANAGER_GET_PRIVATE (self)->hash);
 
+	priv->my_resolv_conf = g_strdup (MY_RESOLV_CONF);
+
 	priv->config = g_object_ref (nm_config_get ());
+	priv->update_delay = nm_config_get_dns_update_delay (priv->config);
 	g_signal_connect (G_OBJECT (priv->config),
 	                  NM_CONFIG_SIGNAL_CONFIG_CHANGED,
 	                  G_CALLBACK (config_changed_cb),
@@ -1349,7 +1486,10 @@ dispose (GObject *object)
 	 * pointing to 127.0.0.1 if any plugins were active.  Thus update
 	 * DNS after disposing of all plugins.  But if we haven't done any
 	 * DNS updates yet, there's no reason to touch resolv.conf on shutdown.
+	 * An update that is still pending is flushed by this as well.
 	 */
+	if (nm_clear_g_source (&priv->update_id))
+		priv->dns_touched = TRUE;
 	if (priv->dns_touched && !update_dns (self, TRUE, &error)) {
 		nm_log_warn (LOGD_DNS, "could not commit DNS changes on shutdown: %s", error->message);
 		g_clear_error (&error);
@@ -1373,6 +1513,8 @@ finalize (GObject *object)
 	NMDnsManagerPrivate *priv = NM_DNS_MANAGER_GET_PRIVATE (object);
 
 	g_free (priv->hostname);
+	g_free (priv->last_dispatch);
+	g_free (priv->my_resolv_conf);
 
 	G_OBJECT_CLASS (nm_dns_manager_parent_class)->finalize (object);
 }
@@ -117,6 +117,14 @@ typedef enum {
 
 NMDnsManagerResolvConfMode nm_dns_manager_get_resolv_conf_mode (NMDnsManager *mgr);
 
+void nm_dns_manager_get_stats (NMDnsManager *mgr,
+                               guint64 *out_coalesced,
+                               guint64 *out_suppressed);
+
+/* For tests: keeps the private resolv.conf in @rundir and waits
+ * @update_delay ms before applying changes */
+NMDnsManager *_nm_dns_manager_new_for_test (const char *rundir, guint update_delay);
+
 G_END_DECLS
 
 #endif /* __NETWORKMANAGER_DNS_MANAGER_H__ */
@@ -183,6 +183,12 @@ nm_dns_plugin_child_spawn (NMDnsPlugin *self,
 	return priv->pid;
 }
 
+GPid
+nm_dns_plugin_child_pid (NMDnsPlugin *self)
+{
+	return NM_DNS_PLUGIN_GET_PRIVATE (self)->pid;
+}
+
 gboolean
 nm_dns_plugin_child_kill (NMDnsPlugin *self)
 {
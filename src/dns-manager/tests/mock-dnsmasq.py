@@ -0,0 +1,79 @@
+#!/usr/bin/env python
+# -*- Mode: python; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+
+# Stands in for dnsmasq in test-dns-dnsmasq.  NM_TEST_DNSMASQ_MODE picks
+# the dnsmasq build to pretend to be:
+#   dbus       - has D-Bus support and SetServersEx
+#   no-method  - gets on the bus, but lacks SetServersEx
+#   no-dbus    - built without D-Bus support
+# Each start and each SetServersEx call is appended as a line to the
+# file named by NM_TEST_DNSMASQ_LOG.
+
+from __future__ import print_function
+
+from gi.repository import GLib
+import os
+import sys
+import dbus
+import dbus.service
+import dbus.mainloop.glib
+
+IFACE_DNSMASQ = 'org.freedesktop.NetworkManager.dnsmasq'
+PATH_DNSMASQ = '/uk/org/thekelleys/dnsmasq'
+
+mode = os.environ.get('NM_TEST_DNSMASQ_MODE', 'dbus')
+
+def log(line):
+    with open(os.environ['NM_TEST_DNSMASQ_LOG'], 'a') as f:
+        f.write(line + '\n')
+
+class Dnsmasq(dbus.service.Object):
+    @dbus.service.method(dbus_interface=IFACE_DNSMASQ, in_signature='aas', out_signature='')
+    def SetServersEx(self, servers):
+        log('SetServersEx ' + ' '.join(['/'.join(s) for s in servers]))
+
+class OldDnsmasq(dbus.service.Object):
+    @dbus.service.method(dbus_interface=IFACE_DNSMASQ, in_signature='av', out_signature='')
+    def SetServers(self, servers):
+        pass
+
+def main():
+    args = sys.argv[1:]
+
+    if '--version' in args:
+        if mode == 'no-dbus':
+            print('Dnsmasq version 2.72  Compile time options: IPv6 GNU-getopt no-DBus i18n')
+        else:
+            print('Dnsmasq version 2.72  Compile time options: IPv6 GNU-getopt DBus i18n')
+        sys.exit(0)
+
+    bus_name = None
+    for arg in args:
+        if arg.startswith('--enable-dbus='):
+            bus_name = arg[len('--enable-dbus='):]
+        elif arg.startswith('--conf-file=') and arg != '--conf-file=/dev/null':
+            log('start ' + arg)
+
+    mainloop = GLib.MainLoop()
+
+    if bus_name:
+        if mode == 'no-dbus':
+            sys.exit(1)
+        log('start dbus')
+
+        dbus.mainloop.glib.DBusGMainLoop(set_as_default=True)
+        bus = dbus.SystemBus()
+        if mode == 'no-method':
+            obj = OldDnsmasq(bus, PATH_DNSMASQ)
+        else:
+            obj = Dnsmasq(bus, PATH_DNSMASQ)
+        if not bus.request_name(bus_name):
+            sys.exit(1)
+
+    # dnsmasq runs until it is killed; but don't stick around if the
+    # test crashed
+    GLib.timeout_add_seconds(20, mainloop.quit)
+    mainloop.run()
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,215 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2015 Red Hat, Inc.
+ *
+ */
+
+#include "config.h"
+
+#include <signal.h>
+#include <arpa/inet.h>
+#include <glib/gstdio.h>
+
+#include "nm-dns-dnsmasq.h"
+#include "nm-ip4-config.h"
+#include "nm-logging.h"
+
+#include "nm-test-utils.h"
+
+/* The D-Bus interaction is tested against mock-dnsmasq.py, which takes
+ * dnsmasq's place on a private bus (see Makefile.am). */
+
+typedef struct {
+	NMTstMockLog ml;
+	NMDnsPlugin *plugin;
+	gboolean failed;
+} Fixture;
+
+static void
+plugin_failed (NMDnsPlugin *plugin, gpointer user_data)
+{
+	((Fixture *) user_data)->failed = TRUE;
+}
+
+static void
+fixture_setup (Fixture *f, const char *mode)
+{
+	nmtst_mock_log_init (&f->ml, "NM_TEST_DNSMASQ_LOG");
+	g_setenv ("NM_TEST_DNSMASQ_MODE", mode, TRUE);
+
+	f->plugin = _nm_dns_dnsmasq_new_for_test (TEST_MOCK_DNSMASQ, f->ml.dir);
+	g_signal_connect (f->plugin, NM_DNS_PLUGIN_FAILED, G_CALLBACK (plugin_failed), f);
+}
+
+static void
+fixture_teardown (Fixture *f)
+{
+	char *conf;
+
+	g_object_unref (f->plugin);
+
+	conf = g_build_filename (f->ml.dir, "dnsmasq.conf", NULL);
+	g_unlink (conf);
+	g_free (conf);
+	nmtst_mock_log_clear (&f->ml);
+}
+
+static void
+update (Fixture *f, const char *nameserver)
+{
+	NMIP4Config *config;
+	GSList *configs;
+	guint32 addr;
+
+	g_assert (inet_pton (AF_INET, nameserver, &addr) == 1);
+	config = nm_ip4_config_new (1);
+	nm_ip4_config_add_nameserver (config, addr);
+	configs = g_slist_append (NULL, config);
+
+	g_assert (nm_dns_plugin_update (f->plugin, NULL, configs, NULL, NULL));
+
+	g_slist_free (configs);
+	g_object_unref (config);
+}
+
+static void
+assert_conf (Fixture *f, const char *expected)
+{
+	char *path, *contents = NULL;
+
+	path = g_build_filename (f->ml.dir, "dnsmasq.conf", NULL);
+	g_assert (g_file_get_contents (path, &contents, NULL, NULL));
+	g_assert_cmpstr (contents, ==, expected);
+	g_free (contents);
+	g_free (path);
+}
+
+/*******************************************/
+
+static void
+test_set_servers (void)
+{
+	Fixture f = { 0 };
+
+	fixture_setup (&f, "dbus");
+
+	update (&f, "1.2.3.4");
+	nmtst_mock_log_wait (&f.ml, "SetServersEx 1.2.3.4", 1);
+
+	/* New servers are passed to the running dnsmasq */
+	update (&f, "5.6.7.8");
+	nmtst_mock_log_wait (&f.ml, "SetServersEx 5.6.7.8", 1);
+
+	g_assert_cmpint (nmtst_mock_log_count (&f.ml, "start dbus"), ==, 1);
+	g_assert (!f.failed);
+
+	fixture_teardown (&f);
+}
+
+static void
+test_unknown_method (void)
+{
+	Fixture f = { 0 };
+	char *start_conf;
+
+	fixture_setup (&f, "no-method");
+	start_conf = g_strdup_printf ("start --conf-file=%s/dnsmasq.conf", f.ml.dir);
+
+	/* A dnsmasq on the bus without SetServersEx gets the servers in
+	 * the config file instead... */
+	update (&f, "1.2.3.4");
+	nmtst_mock_log_wait (&f.ml, start_conf, 1);
+	assert_conf (&f, "server=1.2.3.4\n");
+
+	/* ...and is restarted for every change from then on */
+	update (&f, "5.6.7.8");
+	nmtst_mock_log_wait (&f.ml, start_conf, 2);
+	assert_conf (&f, "server=5.6.7.8\n");
+
+	g_assert_cmpint (nmtst_mock_log_count (&f.ml, "start dbus"), ==, 1);
+
+	g_free (start_conf);
+	fixture_teardown (&f);
+}
+
+static void
+test_no_dbus (void)
+{
+	Fixture f = { 0 };
+	char *start_conf;
+
+	fixture_setup (&f, "no-dbus");
+	start_conf = g_strdup_printf ("start --conf-file=%s/dnsmasq.conf", f.ml.dir);
+
+	/* A dnsmasq built without D-Bus is never started with it */
+	update (&f, "1.2.3.4");
+	nmtst_mock_log_wait (&f.ml, start_conf, 1);
+	assert_conf (&f, "server=1.2.3.4\n");
+	g_assert_cmpint (nmtst_mock_log_count (&f.ml, "start dbus"), ==, 0);
+	g_assert (!f.failed);
+
+	g_free (start_conf);
+	fixture_teardown (&f);
+}
+
+static void
+test_respawn (void)
+{
+	Fixture f = { 0 };
+	char *start_conf;
+
+	fixture_setup (&f, "no-method");
+	start_conf = g_strdup_printf ("start --conf-file=%s/dnsmasq.conf", f.ml.dir);
+
+	update (&f, "1.2.3.4");
+	nmtst_mock_log_wait (&f.ml, start_conf, 1);
+
+	/* After dnsmasq quit, the one started next may support SetServersEx */
+	g_setenv ("NM_TEST_DNSMASQ_MODE", "dbus", TRUE);
+	g_assert (kill (nm_dns_plugin_child_pid (f.plugin), SIGTERM) == 0);
+	nmtst_main_context_wait_for_flag (&f.failed, "the plugin to fail");
+	f.failed = FALSE;
+
+	update (&f, "5.6.7.8");
+	nmtst_mock_log_wait (&f.ml, "SetServersEx 5.6.7.8", 1);
+	g_assert_cmpint (nmtst_mock_log_count (&f.ml, "start dbus"), ==, 2);
+	g_assert_cmpint (nmtst_mock_log_count (&f.ml, start_conf), ==, 1);
+
+	g_free (start_conf);
+	fixture_teardown (&f);
+}
+
+/*******************************************/
+
+NMTST_DEFINE ();
+
+int
+main (int argc, char **argv)
+{
+	nmtst_init_with_logging (&argc, &argv, "ERR", "ALL");
+
+	/* The plugin talks to dnsmasq on the system bus */
+	if (g_getenv ("DBUS_SESSION_BUS_ADDRESS"))
+		g_setenv ("DBUS_SYSTEM_BUS_ADDRESS", g_getenv ("DBUS_SESSION_BUS_ADDRESS"), TRUE);
+
+	g_test_add_func ("/dns/dnsmasq/set-servers", test_set_servers);
+	g_test_add_func ("/dns/dnsmasq/unknown-method", test_unknown_method);
+	g_test_add_func ("/dns/dnsmasq/no-dbus", test_no_dbus);
+	g_test_add_func ("/dns/dnsmasq/respawn", test_respawn);
+
+	return g_test_run ();
+}
@@ -0,0 +1,240 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2015 Red Hat, Inc.
+ *
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+#include <glib/gstdio.h>
+
+#include "nm-dns-manager.h"
+#include "nm-config.h"
+#include "nm-ip4-config.h"
+
+#include "nm-test-utils.h"
+
+/* With dns=none only the private copy of resolv.conf is maintained, which
+ * the tests redirect into a temporary directory. */
+
+#define UPDATE_DELAY_MS 100
+
+typedef struct {
+	char *rundir;
+	char *resolv_conf;
+	NMDnsManager *mgr;
+} Fixture;
+
+static void
+fixture_setup (Fixture *f, guint update_delay)
+{
+	f->rundir = g_dir_make_tmp ("test-dns-manager-XXXXXX", NULL);
+	g_assert (f->rundir);
+	f->resolv_conf = g_build_filename (f->rundir, "resolv.conf", NULL);
+	f->mgr = _nm_dns_manager_new_for_test (f->rundir, update_delay);
+}
+
+static void
+fixture_teardown (Fixture *f)
+{
+	g_clear_object (&f->mgr);
+	g_unlink (f->resolv_conf);
+	g_rmdir (f->rundir);
+	g_free (f->resolv_conf);
+	g_free (f->rundir);
+}
+
+static NMIP4Config *
+add_nameserver (Fixture *f, const char *iface, const char *nameserver)
+{
+	NMIP4Config *config;
+	guint32 addr;
+
+	config = nm_ip4_config_new (1);
+	if (nameserver) {
+		g_assert (inet_pton (AF_INET, nameserver, &addr) == 1);
+		nm_ip4_config_add_nameserver (config, addr);
+	}
+	g_assert (nm_dns_manager_add_ip4_config (f->mgr, iface, config, NM_DNS_IP_CONFIG_TYPE_DEFAULT));
+	return config;
+}
+
+/* Identifies one version of the file; a rewrite renames a new file into place */
+static ino_t
+file_ino (Fixture *f)
+{
+	struct stat st;
+
+	g_assert (stat (f->resolv_conf, &st) == 0);
+	return st.st_ino;
+}
+
+static void
+assert_nameservers (Fixture *f, const char *expected)
+{
+	char *contents = NULL;
+
+	g_assert (g_file_get_contents (f->resolv_conf, &contents, NULL, NULL));
+	g_assert_cmpstr (contents, ==, expected);
+	g_free (contents);
+}
+
+static void
+assert_stats (Fixture *f, guint64 coalesced, guint64 suppressed)
+{
+	guint64 c, s;
+
+	nm_dns_manager_get_stats (f->mgr, &c, &s);
+	g_assert_cmpint (c, ==, coalesced);
+	g_assert_cmpint (s, ==, suppressed);
+}
+
+static gboolean
+file_exists (gpointer user_data)
+{
+	return g_file_test (((Fixture *) user_data)->resolv_conf, G_FILE_TEST_EXISTS);
+}
+
+/*******************************************/
+
+static void
+test_unchanged (void)
+{
+	Fixture f = { 0 };
+	NMIP4Config *c1, *c2, *c3;
+	ino_t ino;
+
+	fixture_setup (&f, 0);
+
+	c1 = add_nameserver (&f, "eth0", "1.2.3.4");
+	assert_nameservers (&f, "# Generated by NetworkManager\n"
+	                        "nameserver 1.2.3.4\n");
+	ino = file_ino (&f);
+
+	/* A change that does not affect the contents leaves the file alone */
+	c2 = add_nameserver (&f, "eth1", NULL);
+	g_assert (file_ino (&f) == ino);
+	g_assert (nm_dns_manager_remove_ip4_config (f.mgr, c2));
+	g_assert (file_ino (&f) == ino);
+	assert_stats (&f, 0, 2);
+
+	/* ...while any other change replaces it */
+	c3 = add_nameserver (&f, "eth2", "5.6.7.8");
+	assert_nameservers (&f, "# Generated by NetworkManager\n"
+	                        "nameserver 1.2.3.4\n"
+	                        "nameserver 5.6.7.8\n");
+	g_assert (file_ino (&f) != ino);
+	assert_stats (&f, 0, 2);
+
+	g_object_unref (c1);
+	g_object_unref (c2);
+	g_object_unref (c3);
+	fixture_teardown (&f);
+}
+
+static void
+test_update_delay (void)
+{
+	Fixture f = { 0 };
+	NMIP4Config *c1, *c2, *c3;
+	ino_t ino;
+
+	fixture_setup (&f, UPDATE_DELAY_MS);
+
+	/* Changes within the delay are applied together, once */
+	c1 = add_nameserver (&f, "eth0", "1.2.3.4");
+	c2 = add_nameserver (&f, "eth1", "5.6.7.8");
+	g_assert (nm_dns_manager_remove_ip4_config (f.mgr, c1));
+	g_assert (!g_file_test (f.resolv_conf, G_FILE_TEST_EXISTS));
+
+	nmtst_main_context_wait_for (file_exists, &f, f.resolv_conf);
+	assert_nameservers (&f, "# Generated by NetworkManager\n"
+	                        "nameserver 5.6.7.8\n");
+	ino = file_ino (&f);
+
+	nmtst_main_context_run (3 * UPDATE_DELAY_MS);
+	g_assert (file_ino (&f) == ino);
+	assert_stats (&f, 2, 0);
+
+	/* An update still pending is applied when the manager goes away */
+	c3 = add_nameserver (&f, "eth2", "9.10.11.12");
+	g_assert (file_ino (&f) == ino);
+	g_clear_object (&f.mgr);
+	assert_nameservers (&f, "# Generated by NetworkManager\n"
+	                        "nameserver 5.6.7.8\n"
+	                        "nameserver 9.10.11.12\n");
+
+	g_object_unref (c1);
+	g_object_unref (c2);
+	g_object_unref (c3);
+	fixture_teardown (&f);
+}
+
+/*******************************************/
+
+static void
+setup_config (const char *dir)
+{
+	char *path;
+	char *argv[] = { "test-dns-manager", "--config", NULL, "--config-dir", "/no/such/dir", NULL };
+	char **argv_p = argv;
+	int argc = G_N_ELEMENTS (argv) - 1;
+	NMConfigCmdLineOptions *cli;
+	GOptionContext *context;
+	GError *error = NULL;
+
+	path = g_build_filename (dir, "NetworkManager.conf", NULL);
+	g_assert (g_file_set_contents (path, "[main]\ndns=none\n", -1, NULL));
+	argv[2] = path;
+
+	cli = nm_config_cmd_line_options_new ();
+	context = g_option_context_new (NULL);
+	nm_config_cmd_line_options_add_to_entries (cli, context);
+	g_assert (g_option_context_parse (context, &argc, &argv_p, NULL));
+	g_option_context_free (context);
+
+	g_assert (nm_config_setup (cli, &error));
+	g_assert_no_error (error);
+	nm_config_cmd_line_options_free (cli);
+
+	g_unlink (path);
+	g_free (path);
+}
+
+NMTST_DEFINE ();
+
+int
+main (int argc, char **argv)
+{
+	char *dir;
+
+	nmtst_init_with_logging (&argc, &argv, "ERR", "ALL");
+
+	dir = g_dir_make_tmp ("test-dns-manager-conf-XXXXXX", NULL);
+	g_assert (dir);
+	setup_config (dir);
+	g_rmdir (dir);
+	g_free (dir);
+
+	g_test_add_func ("/dns/manager/unchanged", test_unchanged);
+	g_test_add_func ("/dns/manager/update-delay", test_update_delay);
+
+	return g_test_run ();
+}
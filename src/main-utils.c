@@ -48,6 +48,13 @@ sighup_handler (gpointer user_data)
 	return G_SOURCE_CONTINUE;
 }
 
+static gboolean
+sigusr1_handler (gpointer user_data)
+{
+	nm_logging_buffer_dump ();
+	return G_SOURCE_CONTINUE;
+}
+
 static gboolean
 sigint_handler (gpointer user_data)
 {
@@ -84,6 +91,9 @@ nm_main_utils_setup_signals (GMainLoop *main_loop)
 	signal (SIGPIPE, SIG_IGN);
 
 	g_unix_signal_add (SIGHUP, sighup_handler, NULL);
+	/* GLib only supports SIGUSR1 in g_unix_signal_add() since 2.36 */
+	if (!glib_check_version (2, 36, 0))
+		g_unix_signal_add (SIGUSR1, sigusr1_handler, NULL);
 	g_unix_signal_add (SIGINT, sigint_handler, main_loop);
 	g_unix_signal_add (SIGTERM, sigterm_handler, main_loop);
 }
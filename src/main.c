@@ -54,6 +54,7 @@
 #include "nm-session-monitor.h"
 #include "nm-dispatcher.h"
 #include "nm-settings.h"
+#include "nm-settings-connection.h"
 #include "nm-auth-manager.h"
 #include "nm-core-internal.h"
 
@@ -373,6 +374,7 @@ main (int argc, char *argv[])
 			g_clear_pointer (&bad_domains, g_free);
 		}
 	}
+	nm_logging_set_buffer (nm_config_get_log_buffer (config));
 
 	if (global_opt.become_daemon && !global_opt.debug) {
 		if (daemon (0, 0) < 0) {
@@ -486,6 +488,8 @@ main (int argc, char *argv[])
 
 	nm_manager_stop (manager);
 
+	nm_settings_connection_flush_databases ();
+
 done:
 	g_clear_object (&manager);
 
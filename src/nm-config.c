@@ -70,9 +70,11 @@ typedef struct {
 	gboolean monitor_connection_files;
 	gboolean auth_polkit;
 	char *dhcp_client;
+	guint dns_update_delay;
 
 	char *log_level;
 	char *log_domains;
+	guint log_buffer;
 
 	char *debug;
 
@@ -194,6 +196,14 @@ nm_config_get_dhcp_client (NMConfig *config)
 	return NM_CONFIG_GET_PRIVATE (config)->dhcp_client;
 }
 
+guint
+nm_config_get_dns_update_delay (NMConfig *config)
+{
+	g_return_val_if_fail (config != NULL, 0);
+
+	return NM_CONFIG_GET_PRIVATE (config)->dns_update_delay;
+}
+
 const char *
 nm_config_get_log_level (NMConfig *config)
 {
@@ -210,6 +220,14 @@ nm_config_get_log_domains (NMConfig *config)
 	return NM_CONFIG_GET_PRIVATE (config)->log_domains;
 }
 
+guint
+nm_config_get_log_buffer (NMConfig *config)
+{
+	g_return_val_if_fail (config != NULL, 0);
+
+	return NM_CONFIG_GET_PRIVATE (config)->log_buffer;
+}
+
 const char *
 nm_config_get_debug (NMConfig *config)
 {
@@ -842,9 +860,11 @@ init_sync (GInitable *initable, GCancellable *cancellable, GError **error)
 	priv->auth_polkit = nm_config_keyfile_get_boolean (keyfile, "main", "auth-polkit", NM_CONFIG_DEFAULT_AUTH_POLKIT);
 
 	priv->dhcp_client = g_key_file_get_value (keyfile, "main", "dhcp", NULL);
+	priv->dns_update_delay = MAX (g_key_file_get_integer (keyfile, "main", "dns-update-delay", NULL), 0);
 
 	priv->log_level = g_key_file_get_value (keyfile, "logging", "level", NULL);
 	priv->log_domains = g_key_file_get_value (keyfile, "logging", "domains", NULL);
+	priv->log_buffer = MAX (g_key_file_get_integer (keyfile, "logging", "buffer", NULL), 0);
 
 	priv->debug = g_key_file_get_value (keyfile, "main", "debug", NULL);
 
@@ -37,6 +37,7 @@
 #include <string.h>
 #include "nm-logging.h"
 #include "NetworkManagerUtils.h"
+#include "nm-dbus-glib-types.h"
 
 #define PRIV_SOCK_PATH NMRUNDIR "/private"
 #define PRIV_SOCK_TAG  "private"
@@ -46,6 +47,8 @@ enum {
 	NAME_OWNER_CHANGED,
 	PRIVATE_CONNECTION_NEW,
 	PRIVATE_CONNECTION_DISCONNECTED,
+	INTERFACES_ADDED,
+	INTERFACES_REMOVED,
 	NUMBER_OF_SIGNALS
 };
 
@@ -63,6 +66,7 @@ typedef struct {
 	DBusConnection *connection;
 	DBusGConnection *g_connection;
 	GHashTable *exported;
+	GHashTable *exported_properties;
 	gboolean started;
 
 	GSList *private_servers;
@@ -79,6 +83,24 @@ static void nm_dbus_manager_cleanup (NMDBusManager *self, gboolean dispose);
 static void start_reconnection_timeout (NMDBusManager *self);
 static void object_destroyed (NMDBusManager *self, gpointer object);
 
+static gboolean impl_dbus_manager_get_managed_objects (NMDBusManager *self,
+                                                       GHashTable **out_objects,
+                                                       GError **error);
+
+#include "nm-object-manager-glue.h"
+
+#define DBUS_TYPE_G_MAP_OF_OBJECT_PATH_TO_MAP_OF_MAP_OF_VARIANT \
+	(dbus_g_type_get_map ("GHashTable", DBUS_TYPE_G_OBJECT_PATH, DBUS_TYPE_G_MAP_OF_MAP_OF_VARIANT))
+
+/* One exported D-Bus property, as registered through
+ * nm_dbus_manager_register_exported_type(). All strings point into
+ * the static DBusGObjectInfo. */
+typedef struct {
+	const char *interface;
+	const char *dbus_name;
+	const char *gobject_name;
+} ExportedProperty;
+
 NM_DEFINE_SINGLETON_DESTRUCTOR (NMDBusManager);
 NM_DEFINE_SINGLETON_WEAK_REF (NMDBusManager);
 
@@ -522,6 +544,7 @@ nm_dbus_manager_init (NMDBusManager *self)
 	NMDBusManagerPrivate *priv = NM_DBUS_MANAGER_GET_PRIVATE (self);
 
 	priv->exported = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+	priv->exported_properties = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) g_array_unref);
 
 #if HAVE_DBUS_GLIB_100
 	private_server_setup (self);
@@ -545,6 +568,8 @@ nm_dbus_manager_dispose (GObject *object)
 		priv->exported = NULL;
 	}
 
+	g_clear_pointer (&priv->exported_properties, g_hash_table_unref);
+
 	g_slist_free_full (priv->private_servers, private_server_free);
 	priv->private_servers = NULL;
 	priv->priv_server = NULL;
@@ -599,6 +624,24 @@ nm_dbus_manager_class_init (NMDBusManagerClass *klass)
 		              G_STRUCT_OFFSET (NMDBusManagerClass, private_connection_disconnected),
 		              NULL, NULL, NULL,
 		              G_TYPE_NONE, 1, G_TYPE_POINTER);
+
+	/* org.freedesktop.DBus.ObjectManager signals */
+	signals[INTERFACES_ADDED] =
+		g_signal_new ("interfaces-added",
+		              G_OBJECT_CLASS_TYPE (object_class),
+		              G_SIGNAL_RUN_LAST,
+		              0, NULL, NULL, NULL,
+		              G_TYPE_NONE, 2, DBUS_TYPE_G_OBJECT_PATH, DBUS_TYPE_G_MAP_OF_MAP_OF_VARIANT);
+
+	signals[INTERFACES_REMOVED] =
+		g_signal_new ("interfaces-removed",
+		              G_OBJECT_CLASS_TYPE (object_class),
+		              G_SIGNAL_RUN_LAST,
+		              0, NULL, NULL, NULL,
+		              G_TYPE_NONE, 2, DBUS_TYPE_G_OBJECT_PATH, G_TYPE_STRV);
+
+	dbus_g_object_type_install_info (G_TYPE_FROM_CLASS (klass),
+	                                 &dbus_glib_nm_object_manager_object_info);
 }
 
 
@@ -810,6 +853,9 @@ nm_dbus_manager_start_service (NMDBusManager *self)
 	if (!priv->proxy)
 		return FALSE;
 
+	if (!g_hash_table_lookup (priv->exported, self))
+		nm_dbus_manager_register_object (self, NM_DBUS_PATH_OBJECT_MANAGER, self);
+
 	if (!dbus_g_proxy_call (priv->proxy, "RequestName", &err,
 	                        G_TYPE_STRING, NM_DBUS_SERVICE,
 	                        G_TYPE_UINT, DBUS_NAME_FLAG_DO_NOT_QUEUE,
@@ -848,10 +894,139 @@ nm_dbus_manager_get_connection (NMDBusManager *self)
 	return NM_DBUS_MANAGER_GET_PRIVATE (self)->g_connection;
 }
 
+static void
+gvalue_destroy (gpointer data)
+{
+	GValue *value = data;
+
+	g_value_unset (value);
+	g_slice_free (GValue, value);
+}
+
+/* Returns the a{sa{sv}} of all interfaces and properties of @object */
+static GHashTable *
+object_get_interfaces (NMDBusManager *self, GObject *object)
+{
+	NMDBusManagerPrivate *priv = NM_DBUS_MANAGER_GET_PRIVATE (self);
+	GHashTable *interfaces, *properties;
+	GType type;
+	guint i;
+
+	interfaces = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) g_hash_table_unref);
+
+	for (type = G_OBJECT_TYPE (object); type; type = g_type_parent (type)) {
+		GArray *props = g_hash_table_lookup (priv->exported_properties, GSIZE_TO_POINTER (type));
+
+		for (i = 0; props && i < props->len; i++) {
+			ExportedProperty *prop = &g_array_index (props, ExportedProperty, i);
+			GParamSpec *pspec;
+			GValue *value;
+
+			pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (object), prop->gobject_name);
+			if (!pspec || !(pspec->flags & G_PARAM_READABLE))
+				continue;
+
+			properties = g_hash_table_lookup (interfaces, prop->interface);
+			if (!properties) {
+				properties = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, gvalue_destroy);
+				g_hash_table_insert (interfaces, (char *) prop->interface, properties);
+			}
+
+			value = g_slice_new0 (GValue);
+			g_value_init (value, G_PARAM_SPEC_VALUE_TYPE (pspec));
+			g_object_get_property (object, prop->gobject_name, value);
+			g_hash_table_insert (properties, (char *) prop->dbus_name, value);
+		}
+	}
+	return interfaces;
+}
+
+static char **
+object_get_interface_names (NMDBusManager *self, GObject *object)
+{
+	NMDBusManagerPrivate *priv = NM_DBUS_MANAGER_GET_PRIVATE (self);
+	GPtrArray *names;
+	GType type;
+	guint i, j;
+
+	names = g_ptr_array_new ();
+	for (type = G_OBJECT_TYPE (object); type; type = g_type_parent (type)) {
+		GArray *props = g_hash_table_lookup (priv->exported_properties, GSIZE_TO_POINTER (type));
+
+		for (i = 0; props && i < props->len; i++) {
+			const char *interface = g_array_index (props, ExportedProperty, i).interface;
+
+			for (j = 0; j < names->len; j++) {
+				if (!strcmp (names->pdata[j], interface))
+					break;
+			}
+			if (j == names->len)
+				g_ptr_array_add (names, g_strdup (interface));
+		}
+	}
+	g_ptr_array_add (names, NULL);
+	return (char **) g_ptr_array_free (names, FALSE);
+}
+
+static void
+emit_interfaces_added (NMDBusManager *self, const char *path, GObject *object)
+{
+	GHashTable *interfaces;
+
+	if (object == (GObject *) self)
+		return;
+
+	interfaces = object_get_interfaces (self, object);
+	g_signal_emit (self, signals[INTERFACES_ADDED], 0, path, interfaces);
+	g_hash_table_unref (interfaces);
+}
+
+static void
+emit_interfaces_removed (NMDBusManager *self, const char *path, GObject *object)
+{
+	char **names;
+
+	if (object == (GObject *) self)
+		return;
+
+	names = object_get_interface_names (self, object);
+	g_signal_emit (self, signals[INTERFACES_REMOVED], 0, path, names);
+	g_strfreev (names);
+}
+
+static gboolean
+impl_dbus_manager_get_managed_objects (NMDBusManager *self,
+                                       GHashTable **out_objects,
+                                       GError **error)
+{
+	NMDBusManagerPrivate *priv = NM_DBUS_MANAGER_GET_PRIVATE (self);
+	GHashTableIter iter;
+	GObject *object;
+	const char *path;
+
+	*out_objects = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_hash_table_unref);
+
+	g_hash_table_iter_init (&iter, priv->exported);
+	while (g_hash_table_iter_next (&iter, (gpointer) &object, (gpointer) &path)) {
+		if (object == (GObject *) self)
+			continue;
+		g_hash_table_insert (*out_objects,
+		                     g_strdup (path),
+		                     object_get_interfaces (self, object));
+	}
+	return TRUE;
+}
+
 static void
 object_destroyed (NMDBusManager *self, gpointer object)
 {
-	g_hash_table_remove (NM_DBUS_MANAGER_GET_PRIVATE (self)->exported, object);
+	NMDBusManagerPrivate *priv = NM_DBUS_MANAGER_GET_PRIVATE (self);
+	const char *path;
+
+	path = g_hash_table_lookup (priv->exported, object);
+	if (path)
+		emit_interfaces_removed (self, path, object);
+	g_hash_table_remove (priv->exported, object);
 }
 
 void
@@ -859,18 +1034,34 @@ nm_dbus_manager_register_exported_type (NMDBusManager         *self,
                                         GType                  object_type,
                                         const DBusGObjectInfo *info)
 {
+	NMDBusManagerPrivate *priv = NM_DBUS_MANAGER_GET_PRIVATE (self);
 	const char *properties_info, *dbus_name, *gobject_name, *tmp_access;
+	GArray *props;
 
 	dbus_g_object_type_install_info (object_type, info);
 	if (!info->exported_properties)
 		return;
 
+	props = g_hash_table_lookup (priv->exported_properties, GSIZE_TO_POINTER (object_type));
+	if (!props) {
+		props = g_array_new (FALSE, FALSE, sizeof (ExportedProperty));
+		g_hash_table_insert (priv->exported_properties, GSIZE_TO_POINTER (object_type), props);
+	}
+
 	properties_info = info->exported_properties;
 	while (*properties_info) {
+		ExportedProperty prop;
+
 		/* The format is: "interface\0DBusPropertyName\0gobject_property_name\0access\0" */
 		dbus_name = strchr (properties_info, '\0') + 1;
 		gobject_name = strchr (dbus_name, '\0') + 1;
 		tmp_access = strchr (gobject_name, '\0') + 1;
+
+		prop.interface = properties_info;
+		prop.dbus_name = dbus_name;
+		prop.gobject_name = gobject_name;
+		g_array_append_val (props, prop);
+
 		properties_info = strchr (tmp_access, '\0') + 1;
 
 		/* Note that nm-properties-changed-signal takes advantage of the
@@ -909,6 +1100,8 @@ nm_dbus_manager_register_object (NMDBusManager *self,
 			                                     G_OBJECT (object));
 		}
 	}
+
+	emit_interfaces_added (self, path, G_OBJECT (object));
 }
 
 void
@@ -917,12 +1110,16 @@ nm_dbus_manager_unregister_object (NMDBusManager *self, gpointer object)
 	NMDBusManagerPrivate *priv = NM_DBUS_MANAGER_GET_PRIVATE (self);
 	GHashTableIter iter;
 	DBusConnection *connection;
+	const char *path;
 
 	g_assert (G_IS_OBJECT (object));
 
-	if (!g_hash_table_lookup (priv->exported, G_OBJECT (object)))
+	path = g_hash_table_lookup (priv->exported, G_OBJECT (object));
+	if (!path)
 		g_return_if_reached ();
 
+	emit_interfaces_removed (self, path, G_OBJECT (object));
+
 	g_hash_table_remove (priv->exported, G_OBJECT (object));
 	g_object_weak_unref (G_OBJECT (object), (GWeakNotify) object_destroyed, self);
 
@@ -47,6 +47,8 @@ typedef struct {
 	guint32 gateway;
 	GArray *addresses;
 	GArray *routes;
+	GHashTable *addresses_index;  /* address::IndexEntry, built on demand */
+	GHashTable *routes_index;  /* network/plen::IndexEntry, built on demand */
 	GArray *nameservers;
 	GPtrArray *domains;
 	GPtrArray *searches;
@@ -208,6 +210,102 @@ routes_are_duplicate (const NMPlatformIP4Route *a, const NMPlatformIP4Route *b,
 	       (!consider_gateway_and_metric || (a->gateway == b->gateway && a->metric == b->metric));
 }
 
+/*******************************************************************************/
+
+/* The position of the first address or route with a given identity in
+ * the addresses/routes arrays.  Appending keeps an index up to date, any
+ * other change to an array drops its index until it is needed again. */
+typedef struct {
+	guint32 addr;
+	guint8 plen;
+	guint idx;
+} IndexEntry;
+
+static guint
+_index_entry_hash (gconstpointer key)
+{
+	const IndexEntry *entry = key;
+
+	return entry->addr ^ ((guint) entry->plen << 24);
+}
+
+static gboolean
+_index_entry_equal (gconstpointer a, gconstpointer b)
+{
+	const IndexEntry *entry_a = a;
+	const IndexEntry *entry_b = b;
+
+	return entry_a->addr == entry_b->addr && entry_a->plen == entry_b->plen;
+}
+
+static void
+_index_add (GHashTable *index, guint32 addr, guint8 plen, guint idx)
+{
+	IndexEntry needle = { addr, plen, 0 };
+	IndexEntry *entry;
+
+	if (g_hash_table_contains (index, &needle))
+		return;
+
+	entry = g_new (IndexEntry, 1);
+	*entry = needle;
+	entry->idx = idx;
+	g_hash_table_add (index, entry);
+}
+
+static int
+_index_lookup (GHashTable *index, guint32 addr, guint8 plen)
+{
+	IndexEntry needle = { addr, plen, 0 };
+	IndexEntry *entry;
+
+	entry = g_hash_table_lookup (index, &needle);
+	return entry ? (int) entry->idx : -1;
+}
+
+static GHashTable *
+_addresses_index (const NMIP4Config *self)
+{
+	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
+	guint i;
+
+	if (!priv->addresses_index) {
+		priv->addresses_index = g_hash_table_new_full (_index_entry_hash, _index_entry_equal, g_free, NULL);
+		for (i = 0; i < priv->addresses->len; i++) {
+			const NMPlatformIP4Address *a = &g_array_index (priv->addresses, NMPlatformIP4Address, i);
+
+			_index_add (priv->addresses_index, a->address, 0, i);
+		}
+	}
+	return priv->addresses_index;
+}
+
+static GHashTable *
+_routes_index (const NMIP4Config *self)
+{
+	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
+	guint i;
+
+	if (!priv->routes_index) {
+		priv->routes_index = g_hash_table_new_full (_index_entry_hash, _index_entry_equal, g_free, NULL);
+		for (i = 0; i < priv->routes->len; i++) {
+			const NMPlatformIP4Route *r = &g_array_index (priv->routes, NMPlatformIP4Route, i);
+
+			_index_add (priv->routes_index, r->network, r->plen, i);
+		}
+	}
+	return priv->routes_index;
+}
+
+static void
+_indexes_clear (NMIP4Config *self)
+{
+	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
+
+	g_clear_pointer (&priv->addresses_index, g_hash_table_destroy);
+	g_clear_pointer (&priv->routes_index, g_hash_table_destroy);
+}
+
 NMIP4Config *
 nm_ip4_config_capture (int ifindex, gboolean capture_resolv_conf)
 {
@@ -230,6 +328,7 @@ nm_ip4_config_capture (int ifindex, gboolean capture_resolv_conf)
 
 	priv->addresses = nm_platform_ip4_address_get_all (NM_PLATFORM_GET, ifindex);
 	priv->routes = nm_platform_ip4_route_get_all (NM_PLATFORM_GET, ifindex, NM_PLATFORM_GET_ROUTE_MODE_ALL);
+	_indexes_clear (config);
 
 	/* Extract gateway from default route */
 	old_gateway = priv->gateway;
@@ -621,9 +720,16 @@ static int
 _addresses_get_index (const NMIP4Config *self, const NMPlatformIP4Address *addr)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
+	int idx;
 	guint i;
 
-	for (i = 0; i < priv->addresses->len; i++) {
+	idx = _index_lookup (_addresses_index (self), addr->address, 0);
+	if (idx < 0)
+		return -1;
+
+	/* The index has the first address that matches; another one with the
+	 * same address but a different prefix length may follow. */
+	for (i = idx; i < priv->addresses->len; i++) {
 		const NMPlatformIP4Address *a = &g_array_index (priv->addresses, NMPlatformIP4Address, i);
 
 		if (addr->address == a->address &&
@@ -651,17 +757,7 @@ _nameservers_get_index (const NMIP4Config *self, guint32 ns)
 static int
 _routes_get_index (const NMIP4Config *self, const NMPlatformIP4Route *route)
 {
-	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
-	guint i;
-
-	for (i = 0; i < priv->routes->len; i++) {
-		const NMPlatformIP4Route *r = &g_array_index (priv->routes, NMPlatformIP4Route, i);
-
-		if (   route->network == r->network
-		    && route->plen == r->plen)
-			return (int) i;
-	}
-	return -1;
+	return _index_lookup (_routes_index (self), route->network, route->plen);
 }
 
 static int
@@ -1276,6 +1372,7 @@ nm_ip4_config_reset_addresses (NMIP4Config *config)
 
 	if (priv->addresses->len != 0) {
 		g_array_set_size (priv->addresses, 0);
+		g_clear_pointer (&priv->addresses_index, g_hash_table_destroy);
 		_NOTIFY (config, PROP_ADDRESS_DATA);
 		_NOTIFY (config, PROP_ADDRESSES);
 	}
@@ -1296,43 +1393,45 @@ nm_ip4_config_add_address (NMIP4Config *config, const NMPlatformIP4Address *new)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (config);
 	NMPlatformIP4Address item_old;
+	GHashTable *index;
 	int i;
 
 	g_return_if_fail (new != NULL);
 
-	for (i = 0; i < priv->addresses->len; i++ ) {
+	index = _addresses_index (config);
+	i = _index_lookup (index, new->address, 0);
+	if (i >= 0) {
 		NMPlatformIP4Address *item = &g_array_index (priv->addresses, NMPlatformIP4Address, i);
 
-		if (addresses_are_duplicate (item, new, FALSE)) {
-			if (nm_platform_ip4_address_cmp (item, new) == 0)
-				return;
-
-			/* remember the old values. */
-			item_old = *item;
-			/* Copy over old item to get new lifetime, timestamp, preferred */
-			*item = *new;
-
-			/* But restore highest priority source */
-			item->source = MAX (item_old.source, new->source);
-
-			/* for addresses that we read from the kernel, we keep the timestamps as defined
-			 * by the previous source (item_old). The reason is, that the other source configured the lifetimes
-			 * with "what should be" and the kernel values are "what turned out after configuring it".
-			 *
-			 * For other sources, the longer lifetime wins. */
-			if (   (new->source == NM_IP_CONFIG_SOURCE_KERNEL && new->source != item_old.source)
-			    || nm_platform_ip_address_cmp_expiry ((const NMPlatformIPAddress *) &item_old, (const NMPlatformIPAddress *) new) > 0) {
-				item->timestamp = item_old.timestamp;
-				item->lifetime = item_old.lifetime;
-				item->preferred = item_old.preferred;
-			}
-			if (nm_platform_ip4_address_cmp (&item_old, item) == 0)
-				return;
-			goto NOTIFY;
+		if (nm_platform_ip4_address_cmp (item, new) == 0)
+			return;
+
+		/* remember the old values. */
+		item_old = *item;
+		/* Copy over old item to get new lifetime, timestamp, preferred */
+		*item = *new;
+
+		/* But restore highest priority source */
+		item->source = MAX (item_old.source, new->source);
+
+		/* for addresses that we read from the kernel, we keep the timestamps as defined
+		 * by the previous source (item_old). The reason is, that the other source configured the lifetimes
+		 * with "what should be" and the kernel values are "what turned out after configuring it".
+		 *
+		 * For other sources, the longer lifetime wins. */
+		if (   (new->source == NM_IP_CONFIG_SOURCE_KERNEL && new->source != item_old.source)
+		    || nm_platform_ip_address_cmp_expiry ((const NMPlatformIPAddress *) &item_old, (const NMPlatformIPAddress *) new) > 0) {
+			item->timestamp = item_old.timestamp;
+			item->lifetime = item_old.lifetime;
+			item->preferred = item_old.preferred;
 		}
+		if (nm_platform_ip4_address_cmp (&item_old, item) == 0)
+			return;
+		goto NOTIFY;
 	}
 
 	g_array_append_val (priv->addresses, *new);
+	_index_add (index, new->address, 0, priv->addresses->len - 1);
 NOTIFY:
 	_NOTIFY (config, PROP_ADDRESS_DATA);
 	_NOTIFY (config, PROP_ADDRESSES);
@@ -1346,6 +1445,7 @@ nm_ip4_config_del_address (NMIP4Config *config, guint i)
 	g_return_if_fail (i < priv->addresses->len);
 
 	g_array_remove_index (priv->addresses, i);
+	g_clear_pointer (&priv->addresses_index, g_hash_table_destroy);
 	_NOTIFY (config, PROP_ADDRESS_DATA);
 	_NOTIFY (config, PROP_ADDRESSES);
 }
@@ -1370,16 +1470,7 @@ gboolean
 nm_ip4_config_address_exists (const NMIP4Config *config,
                               const NMPlatformIP4Address *needle)
 {
-	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (config);
-	guint i;
-
-	for (i = 0; i < priv->addresses->len; i++) {
-		const NMPlatformIP4Address *haystack = &g_array_index (priv->addresses, NMPlatformIP4Address, i);
-
-		if (needle->address == haystack->address && needle->plen == haystack->plen)
-			return TRUE;
-	}
-	return FALSE;
+	return _addresses_get_index (config, needle) >= 0;
 }
 
 /******************************************************************/
@@ -1391,6 +1482,7 @@ nm_ip4_config_reset_routes (NMIP4Config *config)
 
 	if (priv->routes->len != 0) {
 		g_array_set_size (priv->routes, 0);
+		g_clear_pointer (&priv->routes_index, g_hash_table_destroy);
 		_NOTIFY (config, PROP_ROUTE_DATA);
 		_NOTIFY (config, PROP_ROUTES);
 	}
@@ -1411,29 +1503,31 @@ nm_ip4_config_add_route (NMIP4Config *config, const NMPlatformIP4Route *new)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (config);
 	NMIPConfigSource old_source;
+	GHashTable *index;
 	int i;
 
 	g_return_if_fail (new != NULL);
 	g_return_if_fail (new->plen > 0);
 	g_assert (priv->ifindex);
 
-	for (i = 0; i < priv->routes->len; i++ ) {
+	index = _routes_index (config);
+	i = _index_lookup (index, new->network, new->plen);
+	if (i >= 0) {
 		NMPlatformIP4Route *item = &g_array_index (priv->routes, NMPlatformIP4Route, i);
 
-		if (routes_are_duplicate (item, new, FALSE)) {
-			if (nm_platform_ip4_route_cmp (item, new) == 0)
-				return;
-			old_source = item->source;
-			memcpy (item, new, sizeof (*item));
-			/* Restore highest priority source */
-			item->source = MAX (old_source, new->source);
-			item->ifindex = priv->ifindex;
-			goto NOTIFY;
-		}
+		if (nm_platform_ip4_route_cmp (item, new) == 0)
+			return;
+		old_source = item->source;
+		memcpy (item, new, sizeof (*item));
+		/* Restore highest priority source */
+		item->source = MAX (old_source, new->source);
+		item->ifindex = priv->ifindex;
+		goto NOTIFY;
 	}
 
 	g_array_append_val (priv->routes, *new);
 	g_array_index (priv->routes, NMPlatformIP4Route, priv->routes->len - 1).ifindex = priv->ifindex;
+	_index_add (index, new->network, new->plen, priv->routes->len - 1);
 NOTIFY:
 	_NOTIFY (config, PROP_ROUTE_DATA);
 	_NOTIFY (config, PROP_ROUTES);
@@ -1447,6 +1541,7 @@ nm_ip4_config_del_route (NMIP4Config *config, guint i)
 	g_return_if_fail (i < priv->routes->len);
 
 	g_array_remove_index (priv->routes, i);
+	g_clear_pointer (&priv->routes_index, g_hash_table_destroy);
 	_NOTIFY (config, PROP_ROUTE_DATA);
 	_NOTIFY (config, PROP_ROUTES);
 }
@@ -2000,6 +2095,13 @@ nm_ip4_config_hash (const NMIP4Config *config, GChecksum *sum, gboolean dns_only
 
 }
 
+static gboolean
+_u32v_equal (const GArray *a, const GArray *b)
+{
+	return    a->len == b->len
+	       && (!a->len || !memcmp (a->data, b->data, a->len * sizeof (guint32)));
+}
+
 /**
  * nm_ip4_config_equal:
  * @a: first config to compare
@@ -2008,7 +2110,8 @@ nm_ip4_config_hash (const NMIP4Config *config, GChecksum *sum, gboolean dns_only
  * Compares two #NMIP4Configs for basic equality.  This means that all
  * attributes must exist in the same order in both configs (addresses, routes,
  * domains, DNS servers, etc) but some attributes (address lifetimes, and address
- * and route sources) are ignored.
+ * and route sources) are ignored.  A %NULL config is only equal to %NULL,
+ * not to an empty config.
  *
  * Returns: %TRUE if the configurations are basically equal to each other,
  * %FALSE if not
@@ -2016,28 +2119,48 @@ nm_ip4_config_hash (const NMIP4Config *config, GChecksum *sum, gboolean dns_only
 gboolean
 nm_ip4_config_equal (const NMIP4Config *a, const NMIP4Config *b)
 {
-	GChecksum *a_checksum = g_checksum_new (G_CHECKSUM_SHA1);
-	GChecksum *b_checksum = g_checksum_new (G_CHECKSUM_SHA1);
-	gsize a_len = g_checksum_type_get_length (G_CHECKSUM_SHA1);
-	gsize b_len = g_checksum_type_get_length (G_CHECKSUM_SHA1);
-	guchar a_data[a_len], b_data[b_len];
-	gboolean equal;
+	NMIP4ConfigPrivate *a_priv, *b_priv;
+	guint i;
 
-	if (a)
-		nm_ip4_config_hash (a, a_checksum, FALSE);
-	if (b)
-		nm_ip4_config_hash (b, b_checksum, FALSE);
+	if (a == b)
+		return TRUE;
+	if (!a || !b)
+		return FALSE;
 
-	g_checksum_get_digest (a_checksum, a_data, &a_len);
-	g_checksum_get_digest (b_checksum, b_data, &b_len);
+	a_priv = NM_IP4_CONFIG_GET_PRIVATE (a);
+	b_priv = NM_IP4_CONFIG_GET_PRIVATE (b);
+
+	/* Compare the same attributes that nm_ip4_config_hash() covers,
+	 * cheap length checks first. */
+	if (   a_priv->gateway != b_priv->gateway
+	    || a_priv->addresses->len != b_priv->addresses->len
+	    || a_priv->routes->len != b_priv->routes->len
+	    || !_u32v_equal (a_priv->nameservers, b_priv->nameservers)
+	    || !_u32v_equal (a_priv->nis, b_priv->nis)
+	    || !_u32v_equal (a_priv->wins, b_priv->wins)
+	    || g_strcmp0 (a_priv->nis_domain, b_priv->nis_domain)
+	    || !nm_utils_strv_array_equal (a_priv->domains, b_priv->domains)
+	    || !nm_utils_strv_array_equal (a_priv->searches, b_priv->searches)
+	    || !nm_utils_strv_array_equal (a_priv->dns_options, b_priv->dns_options))
+		return FALSE;
 
-	g_assert (a_len == b_len);
-	equal = !memcmp (a_data, b_data, a_len);
+	for (i = 0; i < a_priv->addresses->len; i++) {
+		const NMPlatformIP4Address *a_addr = &g_array_index (a_priv->addresses, NMPlatformIP4Address, i);
+		const NMPlatformIP4Address *b_addr = &g_array_index (b_priv->addresses, NMPlatformIP4Address, i);
 
-	g_checksum_free (a_checksum);
-	g_checksum_free (b_checksum);
+		if (!addresses_are_duplicate (a_addr, b_addr, TRUE))
+			return FALSE;
+	}
 
-	return equal;
+	for (i = 0; i < a_priv->routes->len; i++) {
+		const NMPlatformIP4Route *a_route = &g_array_index (a_priv->routes, NMPlatformIP4Route, i);
+		const NMPlatformIP4Route *b_route = &g_array_index (b_priv->routes, NMPlatformIP4Route, i);
+
+		if (!routes_are_duplicate (a_route, b_route, TRUE))
+			return FALSE;
+	}
+
+	return TRUE;
 }
 
 /******************************************************************/
@@ -2067,6 +2190,7 @@ finalize (GObject *object)
 
 	g_array_unref (priv->addresses);
 	g_array_unref (priv->routes);
+	_indexes_clear (NM_IP4_CONFIG (object));
 	g_array_unref (priv->nameservers);
 	g_ptr_array_unref (priv->domains);
 	g_ptr_array_unref (priv->searches);
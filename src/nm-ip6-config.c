@@ -47,6 +47,8 @@ typedef struct {
 	struct in6_addr gateway;
 	GArray *addresses;
 	GArray *routes;
+	GHashTable *addresses_index;  /* address::IndexEntry, built on demand */
+	GHashTable *routes_index;  /* network/plen::IndexEntry, built on demand */
 	GArray *nameservers;
 	GPtrArray *domains;
 	GPtrArray *searches;
@@ -212,6 +214,107 @@ routes_are_duplicate (const NMPlatformIP6Route *a, const NMPlatformIP6Route *b,
 	            && nm_utils_ip6_route_metric_normalize (a->metric) == nm_utils_ip6_route_metric_normalize (b->metric)));
 }
 
+/*******************************************************************************/
+
+/* The position of the first address or route with a given identity in
+ * the addresses/routes arrays.  Appending keeps an index up to date, any
+ * other change to an array drops its index until it is needed again. */
+typedef struct {
+	struct in6_addr addr;
+	guint8 plen;
+	guint idx;
+} IndexEntry;
+
+static guint
+_index_entry_hash (gconstpointer key)
+{
+	const IndexEntry *entry = key;
+	const guint32 *words = (const guint32 *) &entry->addr;
+	guint h = entry->plen;
+	guint i;
+
+	for (i = 0; i < sizeof (entry->addr) / sizeof (guint32); i++)
+		h = (h * 33) + words[i];
+	return h;
+}
+
+static gboolean
+_index_entry_equal (gconstpointer a, gconstpointer b)
+{
+	const IndexEntry *entry_a = a;
+	const IndexEntry *entry_b = b;
+
+	return IN6_ARE_ADDR_EQUAL (&entry_a->addr, &entry_b->addr) && entry_a->plen == entry_b->plen;
+}
+
+static void
+_index_add (GHashTable *index, const struct in6_addr *addr, guint8 plen, guint idx)
+{
+	IndexEntry needle = { *addr, plen, 0 };
+	IndexEntry *entry;
+
+	if (g_hash_table_contains (index, &needle))
+		return;
+
+	entry = g_new (IndexEntry, 1);
+	*entry = needle;
+	entry->idx = idx;
+	g_hash_table_add (index, entry);
+}
+
+static int
+_index_lookup (GHashTable *index, const struct in6_addr *addr, guint8 plen)
+{
+	IndexEntry needle = { *addr, plen, 0 };
+	IndexEntry *entry;
+
+	entry = g_hash_table_lookup (index, &needle);
+	return entry ? (int) entry->idx : -1;
+}
+
+static GHashTable *
+_addresses_index (const NMIP6Config *self)
+{
+	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
+	guint i;
+
+	if (!priv->addresses_index) {
+		priv->addresses_index = g_hash_table_new_full (_index_entry_hash, _index_entry_equal, g_free, NULL);
+		for (i = 0; i < priv->addresses->len; i++) {
+			const NMPlatformIP6Address *a = &g_array_index (priv->addresses, NMPlatformIP6Address, i);
+
+			_index_add (priv->addresses_index, &a->address, 0, i);
+		}
+	}
+	return priv->addresses_index;
+}
+
+static GHashTable *
+_routes_index (const NMIP6Config *self)
+{
+	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
+	guint i;
+
+	if (!priv->routes_index) {
+		priv->routes_index = g_hash_table_new_full (_index_entry_hash, _index_entry_equal, g_free, NULL);
+		for (i = 0; i < priv->routes->len; i++) {
+			const NMPlatformIP6Route *r = &g_array_index (priv->routes, NMPlatformIP6Route, i);
+
+			_index_add (priv->routes_index, &r->network, r->plen, i);
+		}
+	}
+	return priv->routes_index;
+}
+
+static void
+_indexes_clear (NMIP6Config *self)
+{
+	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
+
+	g_clear_pointer (&priv->addresses_index, g_hash_table_destroy);
+	g_clear_pointer (&priv->routes_index, g_hash_table_destroy);
+}
+
 static gint
 _addresses_sort_cmp_get_prio (const struct in6_addr *addr)
 {
@@ -307,6 +410,7 @@ nm_ip6_config_addresses_sort (NMIP6Config *self, NMSettingIP6ConfigPrivacy use_t
 		memcpy (data_pre, priv->addresses->data, data_len);
 
 		g_array_sort_with_data (priv->addresses, _addresses_sort_cmp, GINT_TO_POINTER (use_temporary));
+		g_clear_pointer (&priv->addresses_index, g_hash_table_destroy);
 
 		changed = memcmp (data_pre, priv->addresses->data, data_len) != 0;
 		g_free (data_pre);
@@ -343,6 +447,7 @@ nm_ip6_config_capture (int ifindex, gboolean capture_resolv_conf, NMSettingIP6Co
 
 	priv->addresses = nm_platform_ip6_address_get_all (NM_PLATFORM_GET, ifindex);
 	priv->routes = nm_platform_ip6_route_get_all (NM_PLATFORM_GET, ifindex, NM_PLATFORM_GET_ROUTE_MODE_ALL);
+	_indexes_clear (config);
 
 	/* Extract gateway from default route */
 	old_gateway = priv->gateway;
@@ -390,6 +495,7 @@ nm_ip6_config_capture (int ifindex, gboolean capture_resolv_conf, NMSettingIP6Co
 		                                                        NULL);
 
 	g_array_sort_with_data (priv->addresses, _addresses_sort_cmp, GINT_TO_POINTER (use_temporary));
+	g_clear_pointer (&priv->addresses_index, g_hash_table_destroy);
 
 	/* actually, nobody should be connected to the signal, just to be sure, notify */
 	if (notify_nameservers)
@@ -736,16 +842,7 @@ nm_ip6_config_destination_is_direct (const NMIP6Config *config, const struct in6
 static int
 _addresses_get_index (const NMIP6Config *self, const NMPlatformIP6Address *addr)
 {
-	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
-	guint i;
-
-	for (i = 0; i < priv->addresses->len; i++) {
-		const NMPlatformIP6Address *a = &g_array_index (priv->addresses, NMPlatformIP6Address, i);
-
-		if (IN6_ARE_ADDR_EQUAL (&addr->address, &a->address))
-			return (int) i;
-	}
-	return -1;
+	return _index_lookup (_addresses_index (self), &addr->address, 0);
 }
 
 static int
@@ -766,16 +863,7 @@ _nameservers_get_index (const NMIP6Config *self, const struct in6_addr *ns)
 static int
 _routes_get_index (const NMIP6Config *self, const NMPlatformIP6Route *route)
 {
-	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
-	guint i;
-
-	for (i = 0; i < priv->routes->len; i++) {
-		const NMPlatformIP6Route *r = &g_array_index (priv->routes, NMPlatformIP6Route, i);
-
-		if (routes_are_duplicate (route, r, FALSE))
-			return (int) i;
-	}
-	return -1;
+	return _index_lookup (_routes_index (self), &route->network, route->plen);
 }
 
 static int
@@ -1265,6 +1353,7 @@ nm_ip6_config_reset_addresses (NMIP6Config *config)
 
 	if (priv->addresses->len != 0) {
 		g_array_set_size (priv->addresses, 0);
+		g_clear_pointer (&priv->addresses_index, g_hash_table_destroy);
 		_NOTIFY (config, PROP_ADDRESS_DATA);
 		_NOTIFY (config, PROP_ADDRESSES);
 	}
@@ -1285,43 +1374,45 @@ nm_ip6_config_add_address (NMIP6Config *config, const NMPlatformIP6Address *new)
 {
 	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (config);
 	NMPlatformIP6Address item_old;
+	GHashTable *index;
 	int i;
 
 	g_return_if_fail (new != NULL);
 
-	for (i = 0; i < priv->addresses->len; i++ ) {
+	index = _addresses_index (config);
+	i = _index_lookup (index, &new->address, 0);
+	if (i >= 0) {
 		NMPlatformIP6Address *item = &g_array_index (priv->addresses, NMPlatformIP6Address, i);
 
-		if (IN6_ARE_ADDR_EQUAL (&item->address, &new->address)) {
-			if (nm_platform_ip6_address_cmp (item, new) == 0)
-				return;
-
-			/* remember the old values. */
-			item_old = *item;
-			/* Copy over old item to get new lifetime, timestamp, preferred */
-			*item = *new;
-
-			/* But restore highest priority source */
-			item->source = MAX (item_old.source, new->source);
-
-			/* for addresses that we read from the kernel, we keep the timestamps as defined
-			 * by the previous source (item_old). The reason is, that the other source configured the lifetimes
-			 * with "what should be" and the kernel values are "what turned out after configuring it".
-			 *
-			 * For other sources, the longer lifetime wins. */
-			if (   (new->source == NM_IP_CONFIG_SOURCE_KERNEL && new->source != item_old.source)
-			    || nm_platform_ip_address_cmp_expiry ((const NMPlatformIPAddress *) &item_old, (const NMPlatformIPAddress *) new) > 0) {
-				item->timestamp = item_old.timestamp;
-				item->lifetime = item_old.lifetime;
-				item->preferred = item_old.preferred;
-			}
-			if (nm_platform_ip6_address_cmp (&item_old, item) == 0)
-				return;
-			goto NOTIFY;
+		if (nm_platform_ip6_address_cmp (item, new) == 0)
+			return;
+
+		/* remember the old values. */
+		item_old = *item;
+		/* Copy over old item to get new lifetime, timestamp, preferred */
+		*item = *new;
+
+		/* But restore highest priority source */
+		item->source = MAX (item_old.source, new->source);
+
+		/* for addresses that we read from the kernel, we keep the timestamps as defined
+		 * by the previous source (item_old). The reason is, that the other source configured the lifetimes
+		 * with "what should be" and the kernel values are "what turned out after configuring it".
+		 *
+		 * For other sources, the longer lifetime wins. */
+		if (   (new->source == NM_IP_CONFIG_SOURCE_KERNEL && new->source != item_old.source)
+		    || nm_platform_ip_address_cmp_expiry ((const NMPlatformIPAddress *) &item_old, (const NMPlatformIPAddress *) new) > 0) {
+			item->timestamp = item_old.timestamp;
+			item->lifetime = item_old.lifetime;
+			item->preferred = item_old.preferred;
 		}
+		if (nm_platform_ip6_address_cmp (&item_old, item) == 0)
+			return;
+		goto NOTIFY;
 	}
 
 	g_array_append_val (priv->addresses, *new);
+	_index_add (index, &new->address, 0, priv->addresses->len - 1);
 NOTIFY:
 	_NOTIFY (config, PROP_ADDRESS_DATA);
 	_NOTIFY (config, PROP_ADDRESSES);
@@ -1335,6 +1426,7 @@ nm_ip6_config_del_address (NMIP6Config *config, guint i)
 	g_return_if_fail (i < priv->addresses->len);
 
 	g_array_remove_index (priv->addresses, i);
+	g_clear_pointer (&priv->addresses_index, g_hash_table_destroy);
 	_NOTIFY (config, PROP_ADDRESS_DATA);
 	_NOTIFY (config, PROP_ADDRESSES);
 }
@@ -1360,9 +1452,16 @@ nm_ip6_config_address_exists (const NMIP6Config *config,
                               const NMPlatformIP6Address *needle)
 {
 	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (config);
+	int idx;
 	guint i;
 
-	for (i = 0; i < priv->addresses->len; i++) {
+	idx = _addresses_get_index (config, needle);
+	if (idx < 0)
+		return FALSE;
+
+	/* The index has the first address that matches; another one with the
+	 * same address but a different prefix length may follow. */
+	for (i = idx; i < priv->addresses->len; i++) {
 		const NMPlatformIP6Address *haystack = &g_array_index (priv->addresses, NMPlatformIP6Address, i);
 
 		if (   IN6_ARE_ADDR_EQUAL (&needle->address, &haystack->address)
@@ -1381,6 +1480,7 @@ nm_ip6_config_reset_routes (NMIP6Config *config)
 
 	if (priv->routes->len != 0) {
 		g_array_set_size (priv->routes, 0);
+		g_clear_pointer (&priv->routes_index, g_hash_table_destroy);
 		_NOTIFY (config, PROP_ROUTE_DATA);
 		_NOTIFY (config, PROP_ROUTES);
 	}
@@ -1401,29 +1501,31 @@ nm_ip6_config_add_route (NMIP6Config *config, const NMPlatformIP6Route *new)
 {
 	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (config);
 	NMIPConfigSource old_source;
+	GHashTable *index;
 	int i;
 
 	g_return_if_fail (new != NULL);
 	g_return_if_fail (new->plen > 0);
 	g_assert (priv->ifindex);
 
-	for (i = 0; i < priv->routes->len; i++ ) {
+	index = _routes_index (config);
+	i = _index_lookup (index, &new->network, new->plen);
+	if (i >= 0) {
 		NMPlatformIP6Route *item = &g_array_index (priv->routes, NMPlatformIP6Route, i);
 
-		if (routes_are_duplicate (item, new, FALSE)) {
-			if (nm_platform_ip6_route_cmp (item, new) == 0)
-				return;
-			old_source = item->source;
-			*item = *new;
-			/* Restore highest priority source */
-			item->source = MAX (old_source, new->source);
-			item->ifindex = priv->ifindex;
-			goto NOTIFY;
-		}
+		if (nm_platform_ip6_route_cmp (item, new) == 0)
+			return;
+		old_source = item->source;
+		*item = *new;
+		/* Restore highest priority source */
+		item->source = MAX (old_source, new->source);
+		item->ifindex = priv->ifindex;
+		goto NOTIFY;
 	}
 
 	g_array_append_val (priv->routes, *new);
 	g_array_index (priv->routes, NMPlatformIP6Route, priv->routes->len - 1).ifindex = priv->ifindex;
+	_index_add (index, &new->network, new->plen, priv->routes->len - 1);
 NOTIFY:
 	_NOTIFY (config, PROP_ROUTE_DATA);
 	_NOTIFY (config, PROP_ROUTES);
@@ -1437,6 +1539,7 @@ nm_ip6_config_del_route (NMIP6Config *config, guint i)
 	g_return_if_fail (i < priv->routes->len);
 
 	g_array_remove_index (priv->routes, i);
+	g_clear_pointer (&priv->routes_index, g_hash_table_destroy);
 	_NOTIFY (config, PROP_ROUTE_DATA);
 	_NOTIFY (config, PROP_ROUTES);
 }
@@ -1838,7 +1941,8 @@ nm_ip6_config_hash (const NMIP6Config *config, GChecksum *sum, gboolean dns_only
  * Compares two #NMIP6Configs for basic equality.  This means that all
  * attributes must exist in the same order in both configs (addresses, routes,
  * domains, DNS servers, etc) but some attributes (address lifetimes, and address
- * and route sources) are ignored.
+ * and route sources) are ignored.  A %NULL config is only equal to %NULL,
+ * not to an empty config.
  *
  * Returns: %TRUE if the configurations are basically equal to each other,
  * %FALSE if not
@@ -1846,28 +1950,54 @@ nm_ip6_config_hash (const NMIP6Config *config, GChecksum *sum, gboolean dns_only
 gboolean
 nm_ip6_config_equal (const NMIP6Config *a, const NMIP6Config *b)
 {
-	GChecksum *a_checksum = g_checksum_new (G_CHECKSUM_SHA1);
-	GChecksum *b_checksum = g_checksum_new (G_CHECKSUM_SHA1);
-	gsize a_len = g_checksum_type_get_length (G_CHECKSUM_SHA1);
-	gsize b_len = g_checksum_type_get_length (G_CHECKSUM_SHA1);
-	guchar a_data[a_len], b_data[b_len];
-	gboolean equal;
+	NMIP6ConfigPrivate *a_priv, *b_priv;
+	guint i;
 
-	if (a)
-		nm_ip6_config_hash (a, a_checksum, FALSE);
-	if (b)
-		nm_ip6_config_hash (b, b_checksum, FALSE);
+	if (a == b)
+		return TRUE;
+	if (!a || !b)
+		return FALSE;
+
+	a_priv = NM_IP6_CONFIG_GET_PRIVATE (a);
+	b_priv = NM_IP6_CONFIG_GET_PRIVATE (b);
+
+	/* Compare the same attributes that nm_ip6_config_hash() covers,
+	 * cheap length checks first. */
+	if (   !IN6_ARE_ADDR_EQUAL (&a_priv->gateway, &b_priv->gateway)
+	    || a_priv->addresses->len != b_priv->addresses->len
+	    || a_priv->routes->len != b_priv->routes->len
+	    || a_priv->nameservers->len != b_priv->nameservers->len
+	    || !nm_utils_strv_array_equal (a_priv->domains, b_priv->domains)
+	    || !nm_utils_strv_array_equal (a_priv->searches, b_priv->searches)
+	    || !nm_utils_strv_array_equal (a_priv->dns_options, b_priv->dns_options))
+		return FALSE;
 
-	g_checksum_get_digest (a_checksum, a_data, &a_len);
-	g_checksum_get_digest (b_checksum, b_data, &b_len);
+	for (i = 0; i < a_priv->nameservers->len; i++) {
+		if (!IN6_ARE_ADDR_EQUAL (&g_array_index (a_priv->nameservers, struct in6_addr, i),
+		                         &g_array_index (b_priv->nameservers, struct in6_addr, i)))
+			return FALSE;
+	}
+
+	for (i = 0; i < a_priv->addresses->len; i++) {
+		const NMPlatformIP6Address *a_addr = &g_array_index (a_priv->addresses, NMPlatformIP6Address, i);
+		const NMPlatformIP6Address *b_addr = &g_array_index (b_priv->addresses, NMPlatformIP6Address, i);
 
-	g_assert (a_len == b_len);
-	equal = !memcmp (a_data, b_data, a_len);
+		if (!addresses_are_duplicate (a_addr, b_addr, TRUE))
+			return FALSE;
+	}
 
-	g_checksum_free (a_checksum);
-	g_checksum_free (b_checksum);
+	for (i = 0; i < a_priv->routes->len; i++) {
+		const NMPlatformIP6Route *a_route = &g_array_index (a_priv->routes, NMPlatformIP6Route, i);
+		const NMPlatformIP6Route *b_route = &g_array_index (b_priv->routes, NMPlatformIP6Route, i);
+
+		if (   !IN6_ARE_ADDR_EQUAL (&a_route->network, &b_route->network)
+		    || a_route->plen != b_route->plen
+		    || !IN6_ARE_ADDR_EQUAL (&a_route->gateway, &b_route->gateway)
+		    || a_route->metric != b_route->metric)
+			return FALSE;
+	}
 
-	return equal;
+	return TRUE;
 }
 
 /******************************************************************/
@@ -1895,6 +2025,7 @@ finalize (GObject *object)
 
 	g_array_unref (priv->addresses);
 	g_array_unref (priv->routes);
+	_indexes_clear (NM_IP6_CONFIG (object));
 	g_array_unref (priv->nameservers);
 	g_ptr_array_unref (priv->domains);
 	g_ptr_array_unref (priv->searches);
@@ -51,6 +51,31 @@ static gboolean logging_set_up;
 static gboolean syslog_opened;
 static char *logging_domains_to_string;
 
+/* Size of the preformatted message stored with each record */
+#define LOG_BUFFER_MSG_LEN 256
+
+typedef struct {
+	gint64 timestamp;
+	const char *file;
+	const char *func;
+	guint line;
+	NMLogLevel level;
+	char msg[LOG_BUFFER_MSG_LEN];
+} LogRecord;
+
+/* When enabled, DEBUG and TRACE messages are only formatted into a fixed-size
+ * ring of records; the full line is built and written to syslog when the
+ * buffer is dumped. Messages are logged from worker threads too, so the ring
+ * is protected by a lock; logging still never allocates.
+ */
+static struct {
+	LogRecord *records;
+	guint size;
+	guint next;     /* slot the next record goes to */
+	guint count;    /* number of valid records, at most @size */
+} log_buffer;
+G_LOCK_DEFINE_STATIC (log_buffer);
+
 typedef struct {
 	NMLogDomain num;
 	const char *name;
@@ -360,79 +385,207 @@ nm_logging_enabled (NMLogLevel level, NMLogDomain domain)
 	return !!(logging[level] & domain);
 }
 
-void
-_nm_log_impl (const char *file,
-              guint line,
-              const char *func,
-              NMLogLevel level,
-              NMLogDomain domain,
-              int error,
-              const char *fmt,
-              ...)
+static void
+_log_write (NMLogLevel level,
+            const char *file,
+            guint line,
+            const char *func,
+            gint64 timestamp,
+            const char *msg)
 {
-	va_list args;
-	char *msg;
-	char *fullmsg = NULL;
-	GTimeVal tv;
-	int syslog_level = LOG_INFO;
-	int g_log_level = G_LOG_LEVEL_INFO;
-
-	g_return_if_fail (level < LOGL_MAX);
-
-	_ensure_initialized ();
-
-	if (!(logging[level] & domain))
-		return;
-
-	/* Make sure that %m maps to the specified error */
-	if (error != 0)
-		errno = error;
-
-	va_start (args, fmt);
-	msg = g_strdup_vprintf (fmt, args);
-	va_end (args);
+	const char *prefix;
+	int syslog_level;
+	int g_log_level;
 
 	switch (level) {
 	case LOGL_TRACE:
-		g_get_current_time (&tv);
+		prefix = "<trace>";
 		syslog_level = LOG_DEBUG;
 		g_log_level = G_LOG_LEVEL_DEBUG;
-		fullmsg = g_strdup_printf ("<trace> [%ld.%06ld] [%s:%u] %s(): %s", tv.tv_sec, tv.tv_usec, file, line, func, msg);
 		break;
 	case LOGL_DEBUG:
-		g_get_current_time (&tv);
+		prefix = "<debug>";
 		syslog_level = LOG_INFO;
 		g_log_level = G_LOG_LEVEL_DEBUG;
-		fullmsg = g_strdup_printf ("<debug> [%ld.%06ld] [%s:%u] %s(): %s", tv.tv_sec, tv.tv_usec, file, line, func, msg);
 		break;
 	case LOGL_INFO:
+		prefix = "<info> ";
 		syslog_level = LOG_INFO;
 		g_log_level = G_LOG_LEVEL_MESSAGE;
-		fullmsg = g_strconcat ("<info>  ", msg, NULL);
 		break;
 	case LOGL_WARN:
+		prefix = "<warn> ";
 		syslog_level = LOG_WARNING;
 		g_log_level = G_LOG_LEVEL_WARNING;
-		fullmsg = g_strconcat ("<warn>  ", msg, NULL);
 		break;
 	case LOGL_ERR:
+		prefix = "<error>";
 		syslog_level = LOG_ERR;
 		/* g_log_level is still WARNING, because ERROR is fatal */
 		g_log_level = G_LOG_LEVEL_WARNING;
-		g_get_current_time (&tv);
-		fullmsg = g_strdup_printf ("<error> [%ld.%06ld] [%s:%u] %s(): %s", tv.tv_sec, tv.tv_usec, file, line, func, msg);
 		break;
 	default:
 		g_assert_not_reached ();
 	}
 
-	if (syslog_opened)
-		syslog (syslog_level, "%s", fullmsg);
-	else
-		g_log (G_LOG_DOMAIN, g_log_level, "%s", fullmsg);
+	/* The prefix is passed as format arguments instead of being
+	 * concatenated with the message, so no intermediate string is needed. */
+	if (level == LOGL_INFO || level == LOGL_WARN) {
+		if (syslog_opened)
+			syslog (syslog_level, "%s %s", prefix, msg);
+		else
+			g_log (G_LOG_DOMAIN, g_log_level, "%s %s", prefix, msg);
+	} else {
+		long sec = timestamp / G_USEC_PER_SEC;
+		long usec = timestamp % G_USEC_PER_SEC;
+
+		if (syslog_opened) {
+			syslog (syslog_level, "%s [%ld.%06ld] [%s:%u] %s(): %s",
+			        prefix, sec, usec, file, line, func, msg);
+		} else {
+			g_log (G_LOG_DOMAIN, g_log_level, "%s [%ld.%06ld] [%s:%u] %s(): %s",
+			       prefix, sec, usec, file, line, func, msg);
+		}
+	}
+}
+
+void
+_nm_log_impl (const char *file,
+              guint line,
+              const char *func,
+              NMLogLevel level,
+              NMLogDomain domain,
+              int error,
+              const char *fmt,
+              ...)
+{
+	va_list args;
+	char buf[512];
+	char *msg = buf;
+	int len;
+	int errsv = errno;
+
+	g_return_if_fail (level < LOGL_MAX);
+
+	_ensure_initialized ();
+
+	if (!(logging[level] & domain))
+		return;
+
+	/* %m maps to the specified error, or else to errno as it was on entry.
+	 * errno is set right before each formatting, as taking the lock may
+	 * change it. */
+	if (error == 0)
+		error = errsv;
+
+	if (level <= LOGL_DEBUG && log_buffer.size) {
+		LogRecord *record;
+
+		G_LOCK (log_buffer);
+		if (G_UNLIKELY (!log_buffer.size)) {
+			/* Buffering was turned off meanwhile */
+			G_UNLOCK (log_buffer);
+			goto direct;
+		}
+
+		record = &log_buffer.records[log_buffer.next];
+		log_buffer.next = (log_buffer.next + 1) % log_buffer.size;
+		if (log_buffer.count < log_buffer.size)
+			log_buffer.count++;
+
+		record->timestamp = g_get_real_time ();
+		record->file = file;
+		record->line = line;
+		record->func = func;
+		record->level = level;
+		errno = error;
+		va_start (args, fmt);
+		g_vsnprintf (record->msg, sizeof (record->msg), fmt, args);
+		va_end (args);
+		G_UNLOCK (log_buffer);
+		return;
+	}
+
+direct:
+	/* Format into the stack buffer; only overlong messages need the heap */
+	errno = error;
+	va_start (args, fmt);
+	len = g_vsnprintf (buf, sizeof (buf), fmt, args);
+	va_end (args);
+	if (len >= (int) sizeof (buf)) {
+		errno = error;
+		va_start (args, fmt);
+		msg = g_strdup_vprintf (fmt, args);
+		va_end (args);
+	}
+
+	_log_write (level, file, line, func,
+	            level == LOGL_INFO || level == LOGL_WARN ? 0 : g_get_real_time (),
+	            msg);
+
+	if (msg != buf)
+		g_free (msg);
+}
+
+/**
+ * nm_logging_set_buffer:
+ * @n_records: number of records to keep, or 0 to disable buffering
+ *
+ * Enables the in-memory log buffer. While enabled, DEBUG and TRACE messages
+ * are kept in a ring of the last @n_records messages instead of being
+ * written out immediately; use nm_logging_buffer_dump() to write them.
+ * Messages at INFO and above are always written directly.
+ */
+void
+nm_logging_set_buffer (guint n_records)
+{
+	if (n_records == log_buffer.size)
+		return;
+
+	if (log_buffer.size)
+		nm_logging_buffer_dump ();
+
+	G_LOCK (log_buffer);
+	g_free (log_buffer.records);
+	log_buffer.records = n_records ? g_new0 (LogRecord, n_records) : NULL;
+	log_buffer.size = n_records;
+	log_buffer.next = 0;
+	log_buffer.count = 0;
+	G_UNLOCK (log_buffer);
+}
+
+/**
+ * nm_logging_buffer_dump:
+ *
+ * Writes out all messages held in the log buffer, oldest first, and
+ * empties the buffer.
+ */
+void
+nm_logging_buffer_dump (void)
+{
+	guint first, i;
+
+	G_LOCK (log_buffer);
+	if (!log_buffer.count) {
+		G_UNLOCK (log_buffer);
+		return;
+	}
+
+	/* Oldest record first; @count never exceeds @size, so no underflow */
+	first = log_buffer.next + log_buffer.size - log_buffer.count;
+
+	_log_write (LOGL_INFO, NULL, 0, NULL, 0, "--- begin of buffered debug log ---");
+	for (i = 0; i < log_buffer.count; i++) {
+		LogRecord *record = &log_buffer.records[(first + i) % log_buffer.size];
+
+		_log_write (record->level, record->file, record->line, record->func,
+		            record->timestamp, record->msg);
+	}
+	_log_write (LOGL_INFO, NULL, 0, NULL, 0, "--- end of buffered debug log ---");
 
-	g_free (msg);
-	g_free (fullmsg);
+	log_buffer.next = 0;
+	log_buffer.count = 0;
+	G_UNLOCK (log_buffer);
 }
 
 /************************************************************************/
@@ -163,6 +163,9 @@ gboolean nm_logging_setup (const char  *level,
                            const char  *domains,
                            char       **bad_domains,
                            GError     **error);
+void     nm_logging_set_buffer       (guint n_records);
+void     nm_logging_buffer_dump      (void);
+
 void     nm_logging_syslog_openlog   (gboolean debug);
 void     nm_logging_syslog_closelog  (void);
 
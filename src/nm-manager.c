@@ -1483,7 +1483,10 @@ static NMConnection *
 get_existing_connection (NMManager *manager, NMDevice *device, gboolean *out_generated)
 {
 	NMManagerPrivate *priv = NM_MANAGER_GET_PRIVATE (manager);
-	gs_free_slist GSList *connections = nm_manager_get_activatable_connections (manager);
+	gs_free_slist GSList *connections = NULL;
+	gs_free_slist GSList *candidates = NULL;
+	gs_free char *fingerprint = NULL;
+	GSList *iter;
 	NMConnection *connection = NULL, *matched;
 	NMSettingsConnection *added = NULL;
 	GError *error = NULL;
@@ -1531,7 +1534,17 @@ get_existing_connection (NMManager *manager, NMDevice *device, gboolean *out_gen
 	 *
 	 * When no configured connection matches the generated connection, we keep
 	 * the generated connection instead.
+	 *
+	 * Only connections sharing the fingerprint of the generated connection
+	 * can match at all, so NMSettings hands out just those and only the few
+	 * that are not already active get diffed.
 	 */
+	fingerprint = nm_utils_connection_get_fingerprint (connection);
+	candidates = nm_settings_get_connections_by_fingerprint (priv->settings, fingerprint);
+	for (iter = candidates; iter; iter = iter->next) {
+		if (!find_ac_for_connection (manager, iter->data))
+			connections = g_slist_prepend (connections, iter->data);
+	}
 	connections = g_slist_reverse (g_slist_sort (connections, nm_settings_sort_connections));
 	matched = nm_utils_match_connection (connections,
 	                                     connection,
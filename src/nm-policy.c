@@ -640,9 +640,7 @@ auto_activate_device (gpointer user_data)
 	NMPolicyPrivate *priv;
 	NMConnection *best_connection;
 	char *specific_object = NULL;
-	GPtrArray *connections;
-	GSList *connection_list;
-	guint i;
+	GSList *connections, *iter;
 
 	g_assert (data);
 	policy = data->policy;
@@ -657,21 +655,16 @@ auto_activate_device (gpointer user_data)
 	if (nm_device_get_act_request (data->device))
 		goto out;
 
-	connection_list = nm_manager_get_activatable_connections (priv->manager);
-	if (!connection_list)
+	/* NMSettings keeps the connections ordered by autoconnect priority and
+	 * last-connected-timestamp, and the activatable ones preserve that order. */
+	connections = nm_manager_get_activatable_connections (priv->manager);
+	if (!connections)
 		goto out;
 
-	connections = _nm_utils_copy_slist_to_array (connection_list, NULL, NULL);
-	g_slist_free (connection_list);
-
-	/* sort is stable (which is important at this point) so that connections
-	 * with same priority are still sorted by last-connected-timestamp. */
-	g_ptr_array_sort (connections, (GCompareFunc) nm_utils_cmp_connection_by_autoconnect_priority);
-
 	/* Find the first connection that should be auto-activated */
 	best_connection = NULL;
-	for (i = 0; i < connections->len; i++) {
-		NMSettingsConnection *candidate = NM_SETTINGS_CONNECTION (connections->pdata[i]);
+	for (iter = connections; iter; iter = g_slist_next (iter)) {
+		NMSettingsConnection *candidate = NM_SETTINGS_CONNECTION (iter->data);
 
 		if (!nm_settings_connection_can_autoconnect (candidate))
 			continue;
@@ -680,7 +673,7 @@ auto_activate_device (gpointer user_data)
 			break;
 		}
 	}
-	g_ptr_array_free (connections, TRUE);
+	g_slist_free (connections);
 
 	if (best_connection) {
 		GError *error = NULL;
@@ -28,18 +28,42 @@
 #include "nm-logging.h"
 #include "nm-properties-changed-signal.h"
 #include "nm-dbus-glib-types.h"
+#include "NetworkManagerUtils.h"
 
 typedef struct {
 	GHashTable *exported_props;
+	/* D-Bus property name -> minimum emission interval in ms */
+	GHashTable *min_intervals;
 	guint signal_id;
 } NMPropertiesChangedClassInfo;
 
 typedef struct {
+	guint interval;
+	gint64 last_emitted;
+} NMPropertiesChangedThrottle;
+
+typedef struct {
+	GObject *object;
 	GHashTable *hash;
+	/* D-Bus property name -> NMPropertiesChangedThrottle, for rate-limited properties */
+	GHashTable *throttle;
 	guint signal_id;
-	guint idle_id;
 } NMPropertiesChangedInfo;
 
+/* All objects with pending property changes are flushed together from a
+ * single idle (or, for rate-limited properties, timeout) source rather than
+ * each scheduling its own.
+ */
+static struct {
+	GHashTable *dirty;
+	GHashTable *flushing;
+	guint idle_id;
+	guint timeout_id;
+	gint64 timeout_at;
+	guint64 signals_sent;
+	guint64 props_coalesced;
+} dispatcher;
+
 static GQuark
 nm_properties_changed_signal_quark (void)
 {
@@ -60,15 +84,25 @@ destroy_value (gpointer data)
 	g_slice_free (GValue, val);
 }
 
+static void
+destroy_throttle (gpointer data)
+{
+	g_slice_free (NMPropertiesChangedThrottle, data);
+}
+
 static void
 properties_changed_info_destroy (gpointer data)
 {
 	NMPropertiesChangedInfo *info = data;
 
-	if (info->idle_id)
-		g_source_remove (info->idle_id);
+	if (dispatcher.dirty)
+		g_hash_table_remove (dispatcher.dirty, info->object);
+	if (dispatcher.flushing)
+		g_hash_table_remove (dispatcher.flushing, info->object);
 
 	g_hash_table_destroy (info->hash);
+	if (info->throttle)
+		g_hash_table_destroy (info->throttle);
 	g_slice_free (NMPropertiesChangedInfo, info);
 }
 
@@ -96,37 +130,144 @@ add_to_string (gpointer key, gpointer value, gpointer user_data)
 	g_value_unset (&str_val);
 }
 
+/* Emits the pending changes of @info whose minimum interval has elapsed.
+ * Returns the time at which held-back changes become due, or 0 if nothing
+ * is left pending.
+ */
+static gint64
+properties_changed (NMPropertiesChangedInfo *info, gint64 now)
+{
+	GObject *object = info->object;
+	GHashTable *emit;
+	GHashTableIter iter;
+	gpointer key, value;
+	gint64 due = 0;
+
+	if (info->throttle) {
+		emit = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, destroy_value);
+		g_hash_table_iter_init (&iter, info->hash);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			NMPropertiesChangedThrottle *throttle = g_hash_table_lookup (info->throttle, key);
+
+			if (throttle) {
+				gint64 next = throttle->last_emitted + throttle->interval;
+
+				if (throttle->last_emitted && next > now) {
+					if (!due || next < due)
+						due = next;
+					continue;
+				}
+				throttle->last_emitted = now;
+			}
+			g_hash_table_iter_steal (&iter);
+			g_hash_table_insert (emit, key, value);
+		}
+	} else {
+		emit = info->hash;
+		info->hash = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, destroy_value);
+	}
+
+	if (g_hash_table_size (emit)) {
+		if (nm_logging_enabled (LOGL_DEBUG, LOGD_DBUS_PROPS)) {
+			GString *buf = g_string_new (NULL);
+
+			g_hash_table_foreach (emit, add_to_string, buf);
+			nm_log_dbg (LOGD_DBUS_PROPS, "%s -> %s", G_OBJECT_TYPE_NAME (object), buf->str);
+			g_string_free (buf, TRUE);
+		}
+
+		dispatcher.signals_sent++;
+		g_signal_emit (object, info->signal_id, 0, emit);
+	}
+	g_hash_table_destroy (emit);
+
+	return due;
+}
+
+static void dispatcher_schedule (gint64 due);
+
 static gboolean
-properties_changed (gpointer data)
+dispatcher_flush (gpointer user_data)
 {
-	GObject *object = G_OBJECT (data);
-	NMPropertiesChangedInfo *info = g_object_get_qdata (object, nm_properties_changed_signal_quark ());
+	GHashTable *dirty;
+	GHashTableIter iter;
+	gpointer object;
+	gint64 now, due, next_due = 0;
+	guint64 signals_sent = dispatcher.signals_sent;
+	guint n_objects;
+
+	if (GPOINTER_TO_UINT (user_data))
+		dispatcher.timeout_id = 0;
+	else
+		dispatcher.idle_id = 0;
+
+	/* Emission may queue further changes (or destroy objects), so take the
+	 * current set and start a fresh one. Objects destroyed meanwhile are
+	 * dropped from the set being flushed as well.
+	 */
+	dirty = dispatcher.dirty;
+	dispatcher.dirty = g_hash_table_new (g_direct_hash, g_direct_equal);
+	dispatcher.flushing = dirty;
+	n_objects = g_hash_table_size (dirty);
+	now = nm_utils_get_monotonic_timestamp_ms ();
 
-	g_assert (info);
+	while (g_hash_table_size (dirty)) {
+		NMPropertiesChangedInfo *info;
 
-	if (nm_logging_enabled (LOGL_DEBUG, LOGD_DBUS_PROPS)) {
-		GString *buf = g_string_new (NULL);
+		g_hash_table_iter_init (&iter, dirty);
+		g_hash_table_iter_next (&iter, &object, NULL);
+		g_hash_table_iter_remove (&iter);
 
-		g_hash_table_foreach (info->hash, add_to_string, buf);
-		nm_log_dbg (LOGD_DBUS_PROPS, "%s -> %s", G_OBJECT_TYPE_NAME (object), buf->str);
-		g_string_free (buf, TRUE);
+		info = g_object_get_qdata (object, nm_properties_changed_signal_quark ());
+		if (!info)
+			continue;
+
+		g_object_ref (object);
+		due = properties_changed (info, now);
+		if (due) {
+			g_hash_table_add (dispatcher.dirty, object);
+			if (!next_due || due < next_due)
+				next_due = due;
+		}
+		g_object_unref (object);
 	}
+	dispatcher.flushing = NULL;
+	g_hash_table_destroy (dirty);
+
+	nm_log_dbg (LOGD_DBUS_PROPS, "flushed %u objects in %" G_GUINT64_FORMAT " signals "
+	            "(total %" G_GUINT64_FORMAT " signals, %" G_GUINT64_FORMAT " changes coalesced)",
+	            n_objects, dispatcher.signals_sent - signals_sent,
+	            dispatcher.signals_sent, dispatcher.props_coalesced);
 
-	g_signal_emit (object, info->signal_id, 0, info->hash);
-	g_hash_table_remove_all (info->hash);
+	if (next_due)
+		dispatcher_schedule (next_due);
 
 	return FALSE;
 }
 
 static void
-idle_id_reset (gpointer data)
+dispatcher_schedule (gint64 due)
 {
-	GObject *object = G_OBJECT (data);
-	NMPropertiesChangedInfo *info = g_object_get_qdata (object, nm_properties_changed_signal_quark ());
+	gint64 now;
 
-	/* info is unset when the object is being destroyed */
-	if (info)
-		info->idle_id = 0;
+	if (!due) {
+		if (!dispatcher.idle_id) {
+			dispatcher.idle_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE, dispatcher_flush,
+			                                      GUINT_TO_POINTER (FALSE), NULL);
+		}
+		return;
+	}
+
+	if (dispatcher.timeout_id) {
+		if (dispatcher.timeout_at <= due)
+			return;
+		g_source_remove (dispatcher.timeout_id);
+	}
+
+	now = nm_utils_get_monotonic_timestamp_ms ();
+	dispatcher.timeout_at = due;
+	dispatcher.timeout_id = g_timeout_add (due > now ? due - now : 0,
+	                                       dispatcher_flush, GUINT_TO_POINTER (TRUE));
 }
 
 static void
@@ -137,6 +278,7 @@ notify (GObject *object, GParamSpec *pspec)
 	const char *dbus_property_name = NULL;
 	GValue *value;
 	GType type;
+	guint interval;
 
 	for (type = G_OBJECT_TYPE (object); type; type = g_type_parent (type)) {
 		classinfo = g_type_get_qdata (type, nm_properties_changed_signal_quark ());
@@ -156,6 +298,7 @@ notify (GObject *object, GParamSpec *pspec)
 	info = g_object_get_qdata (object, nm_properties_changed_signal_quark ());
 	if (!info) {
 		info = g_slice_new0 (NMPropertiesChangedInfo);
+		info->object = object;
 		info->hash = g_hash_table_new_full (g_str_hash, g_str_equal,
 		                                    NULL, destroy_value);
 		info->signal_id = classinfo->signal_id;
@@ -164,13 +307,32 @@ notify (GObject *object, GParamSpec *pspec)
 		                         info, properties_changed_info_destroy);
 	}
 
+	interval = GPOINTER_TO_UINT (g_hash_table_lookup (classinfo->min_intervals, dbus_property_name));
+	if (interval) {
+		if (!info->throttle) {
+			info->throttle = g_hash_table_new_full (g_str_hash, g_str_equal,
+			                                        NULL, destroy_throttle);
+		}
+		if (!g_hash_table_contains (info->throttle, dbus_property_name)) {
+			NMPropertiesChangedThrottle *throttle = g_slice_new0 (NMPropertiesChangedThrottle);
+
+			throttle->interval = interval;
+			g_hash_table_insert (info->throttle, (char *) dbus_property_name, throttle);
+		}
+	}
+
+	if (g_hash_table_contains (info->hash, dbus_property_name))
+		dispatcher.props_coalesced++;
+
 	value = g_slice_new0 (GValue);
 	g_value_init (value, pspec->value_type);
 	g_object_get_property (object, pspec->name, value);
 	g_hash_table_insert (info->hash, (char *) dbus_property_name, value);
 
-	if (!info->idle_id)
-		info->idle_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE, properties_changed, object, idle_id_reset);
+	if (!dispatcher.dirty)
+		dispatcher.dirty = g_hash_table_new (g_direct_hash, g_direct_equal);
+	g_hash_table_add (dispatcher.dirty, object);
+	dispatcher_schedule (0);
 }
 
 static NMPropertiesChangedClassInfo *
@@ -189,6 +351,7 @@ nm_properties_changed_signal_setup_type (GType type)
 	g_type_class_unref (object_class);
 
 	classinfo->exported_props = g_hash_table_new (g_str_hash, g_str_equal);
+	classinfo->min_intervals = g_hash_table_new (g_str_hash, g_str_equal);
 
 	/* See if we've already added the signal to a parent class. (We can't just use
 	 * g_signal_lookup() here because it prints a warning if the signal doesn't exist!)
@@ -246,3 +409,53 @@ nm_properties_changed_signal_add_property (GType       type,
 	                     (char *) dbus_property_name);
 	g_free (hyphen_name);
 }
+
+/**
+ * nm_properties_changed_signal_set_min_interval:
+ * @type: the exported type
+ * @gobject_property_name: an exported property of @type
+ * @interval_ms: minimum time between two emissions of the property on the
+ *   same object, or 0 to emit every change
+ *
+ * Rate-limits a frequently changing property. Changes arriving within
+ * @interval_ms of the previous emission are held back and only the latest
+ * value is sent once the interval has passed. Other properties of the object
+ * are not delayed.
+ */
+void
+nm_properties_changed_signal_set_min_interval (GType       type,
+                                               const char *gobject_property_name,
+                                               guint       interval_ms)
+{
+	NMPropertiesChangedClassInfo *classinfo;
+	const char *dbus_property_name;
+
+	classinfo = g_type_get_qdata (type, nm_properties_changed_signal_quark ());
+	g_return_if_fail (classinfo != NULL);
+
+	dbus_property_name = g_hash_table_lookup (classinfo->exported_props, gobject_property_name);
+	g_return_if_fail (dbus_property_name != NULL);
+
+	if (interval_ms) {
+		g_hash_table_insert (classinfo->min_intervals,
+		                     (char *) dbus_property_name,
+		                     GUINT_TO_POINTER (interval_ms));
+	} else
+		g_hash_table_remove (classinfo->min_intervals, dbus_property_name);
+}
+
+/**
+ * nm_properties_changed_signal_get_stats:
+ * @out_signals_sent: (out) (allow-none): number of PropertiesChanged signals emitted
+ * @out_props_coalesced: (out) (allow-none): number of property changes that were
+ *   merged into an already pending change instead of being sent separately
+ */
+void
+nm_properties_changed_signal_get_stats (guint64 *out_signals_sent,
+                                        guint64 *out_props_coalesced)
+{
+	if (out_signals_sent)
+		*out_signals_sent = dispatcher.signals_sent;
+	if (out_props_coalesced)
+		*out_props_coalesced = dispatcher.props_coalesced;
+}
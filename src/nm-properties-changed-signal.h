@@ -28,4 +28,11 @@ void nm_properties_changed_signal_add_property (GType       type,
                                                 const char *dbus_property_name,
                                                 const char *gobject_property_name);
 
+void nm_properties_changed_signal_set_min_interval (GType       type,
+                                                    const char *gobject_property_name,
+                                                    guint       interval_ms);
+
+void nm_properties_changed_signal_get_stats (guint64 *out_signals_sent,
+                                             guint64 *out_props_coalesced);
+
 #endif /* _NM_PROPERTIES_CHANGED_SIGNAL_H_ */
@@ -342,6 +342,18 @@ _sort_indexes_cmp (guint *a, guint *b)
 
 /*********************************************************************************************/
 
+typedef struct {
+	guint op;
+	const NMPlatformIPXRoute *route;
+} BatchAdd;
+
+/* Returns %TRUE if failing to add @route does not make the sync fail. */
+static gboolean
+_route_add_failure_is_ignored (const NMPlatformIPXRoute *route)
+{
+	return route->rx.source >= NM_IP_CONFIG_SOURCE_USER;
+}
+
 static gboolean
 _vx_route_sync (const VTableIP *vtable, NMRouteManager *self, int ifindex, const GArray *known_routes)
 {
@@ -353,6 +365,8 @@ _vx_route_sync (const VTableIP *vtable, NMRouteManager *self, int ifindex, const
 	guint i, i_type;
 	GArray *to_delete_indexes = NULL, *to_restore_routes = NULL;
 	GPtrArray *to_add_routes = NULL;
+	GArray *batch_adds = NULL;
+	gboolean batch;
 	guint i_known_routes, i_plat_routes, i_ipx_routes;
 	const NMPlatformIPXRoute *cur_known_route, *cur_plat_route;
 	NMPlatformIPXRoute *cur_ipx_route;
@@ -472,6 +486,10 @@ _vx_route_sync (const VTableIP *vtable, NMRouteManager *self, int ifindex, const
 		ASSERT_route_index_valid (vtable, ipx_routes->entries, ipx_routes->index, TRUE);
 	}
 
+	/* Send all changes to platform at once and collect the results at
+	 * the end, see nm_platform_batch_begin(). */
+	batch = nm_platform_batch_begin (NM_PLATFORM_GET);
+
 	/***************************************************************************
 	 * Delete routes in platform, that no longer exist in @ipx_routes
 	 ***************************************************************************/
@@ -558,11 +576,20 @@ _vx_route_sync (const VTableIP *vtable, NMRouteManager *self, int ifindex, const
 			if (   !cur_plat_route
 			    || route_id_cmp_result != 0
 			    || !_route_equals_ignoring_ifindex (vtable, cur_plat_route, cur_ipx_route)) {
+				BatchAdd batch_add;
 				gboolean s;
 
+				batch_add.op = nm_platform_batch_get_length (NM_PLATFORM_GET);
+				batch_add.route = cur_ipx_route;
+
 				s = vtable->vt->route_add (NM_PLATFORM_GET, ifindex, cur_ipx_route, 0);
-				if (!s && cur_ipx_route->rx.source < NM_IP_CONFIG_SOURCE_USER) {
-					_LOGD (vtable->vt->addr_family, "ignore error adding IPv%c route to kernel: %s",
+				if (s && batch) {
+					/* the result is only known after committing the batch. */
+					if (!batch_adds)
+						batch_adds = g_array_new (FALSE, FALSE, sizeof (BatchAdd));
+					g_array_append_val (batch_adds, batch_add);
+				} else if (!s && !_route_add_failure_is_ignored (cur_ipx_route)) {
+					_LOGD (vtable->vt->addr_family, "failed to add IPv%c route to kernel, continue with the remaining routes: %s",
 					       vtable->vt->is_ip4 ? '4' : '6',
 					       vtable->vt->route_to_string (cur_ipx_route));
 					/* Remember that there was a failure, but for now continue trying to sync the
@@ -573,6 +600,26 @@ _vx_route_sync (const VTableIP *vtable, NMRouteManager *self, int ifindex, const
 		}
 	}
 
+	if (batch) {
+		GArray *results = NULL;
+
+		nm_platform_batch_commit (NM_PLATFORM_GET, &results);
+		for (i = 0; batch_adds && i < batch_adds->len; i++) {
+			const BatchAdd *batch_add = &g_array_index (batch_adds, BatchAdd, i);
+
+			if (   !g_array_index (results, gboolean, batch_add->op)
+			    && !_route_add_failure_is_ignored (batch_add->route)) {
+				_LOGD (vtable->vt->addr_family, "failed to add IPv%c route to kernel, continue with the remaining routes: %s",
+				       vtable->vt->is_ip4 ? '4' : '6',
+				       vtable->vt->route_to_string (batch_add->route));
+				success = FALSE;
+			}
+		}
+		g_array_unref (results);
+		if (batch_adds)
+			g_array_unref (batch_adds);
+	}
+
 	g_free (known_routes_idx);
 	g_free (plat_routes_idx);
 	g_array_unref (plat_routes);
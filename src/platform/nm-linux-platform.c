@@ -415,16 +415,85 @@ typedef enum {
 	OBJECT_TYPE_MAX = __OBJECT_TYPE_LAST - 1,
 } ObjectType;
 
+typedef enum {
+	CACHE_INDEX_LINK_IFINDEX,
+	CACHE_INDEX_LINK_NAME,
+	CACHE_INDEX_LINK_ADDRESS,
+	CACHE_INDEX_ADDRESS_IFINDEX,
+	CACHE_INDEX_ADDRESS_ID,   /* family, local address and plen */
+	CACHE_INDEX_ROUTE_IFINDEX,
+	CACHE_INDEX_ROUTE_ID,     /* family, network and plen */
+	__CACHE_INDEX_LAST,
+} CacheIndexType;
+
+typedef struct {
+	int ifindex;
+	int family;
+	int plen;
+	guint len;
+	guint8 data[NM_UTILS_HWADDR_LEN_MAX];
+} CacheIndexKey;
+
+typedef struct {
+	CacheIndexKey key;
+	GQueue objects;
+} CacheIndexBucket;
+
+typedef struct {
+	/* CacheIndexKey -> CacheIndexBucket */
+	GHashTable *buckets;
+	/* nl_object -> its GList link in the bucket */
+	GHashTable *nodes;
+} CacheIndex;
+
 /******************************************************************/
 
+/* Object classes whose caches are (re)populated independently */
+typedef enum {
+	CACHE_CLASS_LINK            = (1 << 0),
+	CACHE_CLASS_ADDRESS         = (1 << 1),
+	CACHE_CLASS_ROUTE           = (1 << 2),
+	CACHE_CLASS_ALL             = CACHE_CLASS_LINK | CACHE_CLASS_ADDRESS | CACHE_CLASS_ROUTE,
+} CacheClass;
+
+/* Events are received on several sockets, so that an overflow only costs
+ * a resync of the object classes whose events were lost. Routes are
+ * usually by far the most numerous objects and get their own socket.
+ *
+ * The kernel only keeps the order of events within one socket: a route
+ * event can be read before the RTM_NEWLINK of its interface, or after its
+ * RTM_DELLINK. Links and addresses share a socket, so their order holds;
+ * routes of a link that is not cached yet are delayed until the events
+ * pending on the other socket are read (see delay_object()). */
+typedef enum {
+	EVENT_SOCKET_LINK_ADDRESS,
+	EVENT_SOCKET_ROUTE,
+	__EVENT_SOCKET_LAST,
+} EventSocketType;
+
+typedef struct {
+	NMPlatform *platform;
+	CacheClass classes;
+	struct nl_sock *nlh;
+	GIOChannel *channel;
+	guint watch_id;
+} EventSocket;
+
 typedef struct {
 	struct nl_sock *nlh;
-	struct nl_sock *nlh_event;
+	struct nl_sock *nlh_batch;
 	struct nl_cache *link_cache;
 	struct nl_cache *address_cache;
 	struct nl_cache *route_cache;
-	GIOChannel *event_channel;
-	guint event_id;
+	EventSocket event_sockets[__EVENT_SOCKET_LAST];
+
+	GArray *batch;
+	guint batch_acked;
+
+	GPtrArray *delayed_objects;
+	guint delayed_objects_id;
+
+	CacheIndex cache_index[__CACHE_INDEX_LAST];
 
 	GUdevClient *udev_client;
 	GHashTable *udev_devices;
@@ -517,6 +586,493 @@ nm_nl_cache_search (struct nl_cache *cache, struct nl_object *needle)
 	return obj;
 }
 
+/******************************************************************
+ * Cache indexes
+ *
+ * The libnl caches only support iterating over all objects or searching
+ * for one object by its full identity. To look up the objects of one
+ * interface (or all routes to one destination) without walking the whole
+ * cache, we keep additional hash indexes next to the libnl caches. Each
+ * index maps a key to the list of cached objects that share that key, in
+ * the same order as they appear in the libnl cache.
+ *
+ * The indexes must be updated whenever an object is added to or removed
+ * from a cache; use cache_add_object() and cache_remove_object() for that.
+ ******************************************************************/
+
+G_STATIC_ASSERT (IFNAMSIZ <= NM_UTILS_HWADDR_LEN_MAX);
+
+static guint
+cache_index_key_hash (gconstpointer ptr)
+{
+	const CacheIndexKey *key = ptr;
+	guint h = 5381;
+	guint i;
+
+	h = (h * 33) + (guint) key->ifindex;
+	h = (h * 33) + (guint) key->family;
+	h = (h * 33) + (guint) key->plen;
+	for (i = 0; i < key->len; i++)
+		h = (h * 33) + key->data[i];
+	return h;
+}
+
+static gboolean
+cache_index_key_equal (gconstpointer a, gconstpointer b)
+{
+	const CacheIndexKey *key_a = a;
+	const CacheIndexKey *key_b = b;
+
+	return    key_a->ifindex == key_b->ifindex
+	       && key_a->family == key_b->family
+	       && key_a->plen == key_b->plen
+	       && key_a->len == key_b->len
+	       && memcmp (key_a->data, key_b->data, key_a->len) == 0;
+}
+
+/* Sets the network of @key from @addr with the host part cleared.
+ * @addr can be %NULL for the zero address. */
+static void
+cache_index_key_set_network (CacheIndexKey *key, int family, gconstpointer addr, int plen)
+{
+	key->family = family;
+	key->plen = plen;
+
+	if (family == AF_INET) {
+		in_addr_t network = 0;
+
+		if (addr)
+			network = nm_utils_ip4_address_clear_host_address (*((const in_addr_t *) addr), plen);
+		key->len = sizeof (network);
+		memcpy (key->data, &network, sizeof (network));
+	} else {
+		struct in6_addr network = IN6ADDR_ANY_INIT;
+
+		if (addr)
+			nm_utils_ip6_address_clear_host_address (&network, addr, plen);
+		key->len = sizeof (network);
+		memcpy (key->data, &network, sizeof (network));
+	}
+}
+
+static ObjectType
+cache_index_get_object_type (CacheIndexType idx)
+{
+	switch (idx) {
+	case CACHE_INDEX_LINK_IFINDEX:
+	case CACHE_INDEX_LINK_NAME:
+	case CACHE_INDEX_LINK_ADDRESS:
+		return OBJECT_TYPE_LINK;
+	case CACHE_INDEX_ADDRESS_IFINDEX:
+	case CACHE_INDEX_ADDRESS_ID:
+		return OBJECT_TYPE_IP4_ADDRESS;
+	case CACHE_INDEX_ROUTE_IFINDEX:
+	case CACHE_INDEX_ROUTE_ID:
+		return OBJECT_TYPE_IP4_ROUTE;
+	default:
+		g_return_val_if_reached (OBJECT_TYPE_UNKNOWN);
+	}
+}
+
+/* Fills @key for @object in the index @idx. Returns %FALSE if the
+ * object does not belong to the index (e.g. a link without address). */
+static gboolean
+cache_index_key_init (CacheIndexKey *key, CacheIndexType idx, struct nl_object *object)
+{
+	ObjectType type = _nlo_get_object_type (object);
+
+	memset (key, 0, sizeof (*key));
+
+	/* The index types are per object class, not per address family. */
+	if (type == OBJECT_TYPE_IP6_ADDRESS)
+		type = OBJECT_TYPE_IP4_ADDRESS;
+	else if (type == OBJECT_TYPE_IP6_ROUTE)
+		type = OBJECT_TYPE_IP4_ROUTE;
+	if (type != cache_index_get_object_type (idx))
+		return FALSE;
+
+	switch (idx) {
+	case CACHE_INDEX_LINK_IFINDEX:
+		key->ifindex = rtnl_link_get_ifindex ((struct rtnl_link *) object);
+		return TRUE;
+	case CACHE_INDEX_LINK_NAME:
+		{
+			const char *name = rtnl_link_get_name ((struct rtnl_link *) object);
+
+			if (!name || !*name)
+				return FALSE;
+			key->len = strnlen (name, IFNAMSIZ);
+			memcpy (key->data, name, key->len);
+			return TRUE;
+		}
+	case CACHE_INDEX_LINK_ADDRESS:
+		{
+			struct nl_addr *nladdr = rtnl_link_get_addr ((struct rtnl_link *) object);
+			guint len;
+
+			if (!nladdr)
+				return FALSE;
+			len = nl_addr_get_len (nladdr);
+			if (len == 0 || len > sizeof (key->data))
+				return FALSE;
+			key->len = len;
+			memcpy (key->data, nl_addr_get_binary_addr (nladdr), len);
+			return TRUE;
+		}
+	case CACHE_INDEX_ADDRESS_IFINDEX:
+		key->ifindex = rtnl_addr_get_ifindex ((struct rtnl_addr *) object);
+		return TRUE;
+	case CACHE_INDEX_ADDRESS_ID:
+		{
+			struct rtnl_addr *rtnladdr = (struct rtnl_addr *) object;
+			struct nl_addr *nladdr = rtnl_addr_get_local (rtnladdr);
+			int family = rtnl_addr_get_family (rtnladdr);
+			guint len;
+
+			if (!nladdr)
+				return FALSE;
+			len = nl_addr_get_len (nladdr);
+			if (len != (family == AF_INET ? sizeof (in_addr_t) : sizeof (struct in6_addr)))
+				return FALSE;
+			key->family = family;
+			key->plen = rtnl_addr_get_prefixlen (rtnladdr);
+			key->len = len;
+			memcpy (key->data, nl_addr_get_binary_addr (nladdr), len);
+			return TRUE;
+		}
+	case CACHE_INDEX_ROUTE_IFINDEX:
+		{
+			struct rtnl_route *rtnlroute = (struct rtnl_route *) object;
+
+			if (rtnl_route_get_nnexthops (rtnlroute) != 1)
+				return FALSE;
+			key->ifindex = rtnl_route_nh_get_ifindex (rtnl_route_nexthop_n (rtnlroute, 0));
+			return TRUE;
+		}
+	case CACHE_INDEX_ROUTE_ID:
+		{
+			struct rtnl_route *rtnlroute = (struct rtnl_route *) object;
+			struct nl_addr *dst = rtnl_route_get_dst (rtnlroute);
+			int family = rtnl_route_get_family (rtnlroute);
+
+			gsize addrlen = family == AF_INET ? sizeof (in_addr_t) : sizeof (struct in6_addr);
+
+			if (!dst || nl_addr_get_family (dst) != family)
+				return FALSE;
+			cache_index_key_set_network (key, family,
+			                             nl_addr_get_len (dst) == addrlen ? nl_addr_get_binary_addr (dst) : NULL,
+			                             nl_addr_get_prefixlen (dst));
+			return TRUE;
+		}
+	default:
+		g_return_val_if_reached (FALSE);
+	}
+}
+
+static void
+cache_index_bucket_free (gpointer data)
+{
+	CacheIndexBucket *bucket = data;
+
+	g_queue_foreach (&bucket->objects, (GFunc) nl_object_put, NULL);
+	g_queue_clear (&bucket->objects);
+	g_slice_free (CacheIndexBucket, bucket);
+}
+
+static void
+cache_index_init (CacheIndex *index)
+{
+	index->buckets = g_hash_table_new_full (cache_index_key_hash, cache_index_key_equal, NULL, cache_index_bucket_free);
+	index->nodes = g_hash_table_new (g_direct_hash, g_direct_equal);
+}
+
+static void
+cache_index_destroy (CacheIndex *index)
+{
+	g_hash_table_unref (index->nodes);
+	g_hash_table_unref (index->buckets);
+}
+
+static void
+cache_index_clear (CacheIndex *index)
+{
+	g_hash_table_remove_all (index->nodes);
+	g_hash_table_remove_all (index->buckets);
+}
+
+static void
+cache_index_add (NMPlatform *platform, struct nl_object *object)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	CacheIndexType idx;
+
+	for (idx = 0; idx < __CACHE_INDEX_LAST; idx++) {
+		CacheIndex *index = &priv->cache_index[idx];
+		CacheIndexBucket *bucket;
+		CacheIndexKey key;
+
+		if (!cache_index_key_init (&key, idx, object))
+			continue;
+		if (g_hash_table_contains (index->nodes, object))
+			continue;
+
+		bucket = g_hash_table_lookup (index->buckets, &key);
+		if (!bucket) {
+			bucket = g_slice_new0 (CacheIndexBucket);
+			bucket->key = key;
+			g_queue_init (&bucket->objects);
+			g_hash_table_insert (index->buckets, &bucket->key, bucket);
+		}
+		nl_object_get (object);
+		g_queue_push_tail (&bucket->objects, object);
+		g_hash_table_insert (index->nodes, object, g_queue_peek_tail_link (&bucket->objects));
+	}
+}
+
+static void
+cache_index_remove (NMPlatform *platform, struct nl_object *object)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	CacheIndexType idx;
+
+	for (idx = 0; idx < __CACHE_INDEX_LAST; idx++) {
+		CacheIndex *index = &priv->cache_index[idx];
+		CacheIndexBucket *bucket;
+		CacheIndexKey key;
+		GList *link;
+
+		link = g_hash_table_lookup (index->nodes, object);
+		if (!link)
+			continue;
+		g_hash_table_remove (index->nodes, object);
+
+		/* Cached objects are never modified in fields that are part of
+		 * an index key, so the key still leads to the right bucket. */
+		if (!cache_index_key_init (&key, idx, object))
+			g_return_if_reached ();
+		bucket = g_hash_table_lookup (index->buckets, &key);
+		g_return_if_fail (bucket);
+
+		g_queue_delete_link (&bucket->objects, link);
+		nl_object_put (object);
+		if (g_queue_is_empty (&bucket->objects))
+			g_hash_table_remove (index->buckets, &bucket->key);
+	}
+}
+
+/* Rebuilds the indexes of the object class @type from the current content
+ * of its libnl cache @cache. */
+static void
+cache_index_rebuild (NMPlatform *platform, ObjectType type, struct nl_cache *cache)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	struct nl_object *object;
+	CacheIndexType idx;
+
+	for (idx = 0; idx < __CACHE_INDEX_LAST; idx++) {
+		if (cache_index_get_object_type (idx) == type)
+			cache_index_clear (&priv->cache_index[idx]);
+	}
+
+	for (object = nl_cache_get_first (cache); object; object = nl_cache_get_next (object))
+		cache_index_add (platform, object);
+}
+
+/* Returns the cached objects matching @key in index @idx. The list is
+ * owned by the index and only valid until the next cache modification. */
+static const GList *
+cache_index_lookup (NMPlatform *platform, CacheIndexType idx, const CacheIndexKey *key)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	CacheIndexBucket *bucket;
+
+	bucket = g_hash_table_lookup (priv->cache_index[idx].buckets, key);
+	return bucket ? bucket->objects.head : NULL;
+}
+
+static const GList *
+cache_index_lookup_ifindex (NMPlatform *platform, CacheIndexType idx, int ifindex)
+{
+	CacheIndexKey key = { .ifindex = ifindex };
+
+	return cache_index_lookup (platform, idx, &key);
+}
+
+static int
+cache_add_object (NMPlatform *platform, struct nl_cache *cache, struct nl_object *object)
+{
+	int nle;
+
+	nle = nl_cache_add (cache, object);
+	if (!nle)
+		cache_index_add (platform, object);
+	return nle;
+}
+
+static void
+cache_remove_object (NMPlatform *platform, struct nl_object *object)
+{
+	cache_index_remove (platform, object);
+	nl_cache_remove (object);
+}
+
+/* Hashes an object by (a part of) its identity, as used by nl_object_identical(). */
+static guint
+cache_object_id_hash (gconstpointer ptr)
+{
+	struct nl_object *object = (struct nl_object *) ptr;
+	CacheIndexType idx;
+	CacheIndexKey key;
+
+	switch (_nlo_get_object_type (object)) {
+	case OBJECT_TYPE_LINK:
+		idx = CACHE_INDEX_LINK_IFINDEX;
+		break;
+	case OBJECT_TYPE_IP4_ADDRESS:
+	case OBJECT_TYPE_IP6_ADDRESS:
+		idx = CACHE_INDEX_ADDRESS_ID;
+		break;
+	case OBJECT_TYPE_IP4_ROUTE:
+	case OBJECT_TYPE_IP6_ROUTE:
+		idx = CACHE_INDEX_ROUTE_ID;
+		break;
+	default:
+		return 0;
+	}
+
+	if (!cache_index_key_init (&key, idx, object))
+		return 0;
+	return cache_index_key_hash (&key);
+}
+
+static gboolean
+cache_object_id_equal (gconstpointer a, gconstpointer b)
+{
+	return nl_object_identical ((struct nl_object *) a, (struct nl_object *) b);
+}
+
+/* Iterates either over all objects of @cache, or, for a positive @ifindex,
+ * only over the objects of that interface in the index @idx. */
+typedef struct {
+	gboolean indexed;
+	const GList *list;
+	struct nl_object *object;
+} CacheIter;
+
+static void
+cache_iter_init_ifindex (CacheIter *iter, NMPlatform *platform, struct nl_cache *cache, CacheIndexType idx, int ifindex)
+{
+	memset (iter, 0, sizeof (*iter));
+	if (ifindex > 0) {
+		iter->indexed = TRUE;
+		iter->list = cache_index_lookup_ifindex (platform, idx, ifindex);
+	} else
+		iter->object = nl_cache_get_first (cache);
+}
+
+static struct nl_object *
+cache_iter_next (CacheIter *iter)
+{
+	struct nl_object *object;
+
+	if (iter->indexed) {
+		if (!iter->list)
+			return NULL;
+		object = iter->list->data;
+		iter->list = iter->list->next;
+	} else {
+		object = iter->object;
+		if (object)
+			iter->object = nl_cache_get_next (object);
+	}
+	return object;
+}
+
+/* Returns a new reference to the cached link with @ifindex. */
+static struct rtnl_link *
+link_get_cached (NMPlatform *platform, int ifindex)
+{
+	const GList *list;
+
+	list = cache_index_lookup_ifindex (platform, CACHE_INDEX_LINK_IFINDEX, ifindex);
+	if (!list)
+		return NULL;
+	nl_object_get (list->data);
+	return list->data;
+}
+
+typedef struct {
+	struct nl_object *needle;
+	struct nl_object *result;
+} DumpSearchData;
+
+static void
+dump_search_parse_cb (struct nl_object *obj, void *arg)
+{
+	DumpSearchData *data = arg;
+
+	if (!data->result && nl_object_identical (obj, data->needle)) {
+		nl_object_get (obj);
+		data->result = obj;
+	}
+}
+
+static int
+dump_search_valid_cb (struct nl_msg *msg, void *arg)
+{
+	nl_msg_parse (msg, dump_search_parse_cb, arg);
+	return NL_OK;
+}
+
+/* The kernel offers no way to fetch one particular address or route, so
+ * request a dump restricted to the family of @needle and look at each
+ * object as it is received. Unlike filling a temporary nl_cache, this keeps
+ * at most one object and does not build (and tear down) a copy of the whole
+ * table for every lookup. */
+static int
+dump_search_kernel_object (struct nl_sock *sk, struct nl_object *needle, struct nl_object **out_object)
+{
+	DumpSearchData data = { .needle = needle, .result = NULL };
+	struct nl_cb *cb;
+	int msg_type, family;
+	int err;
+
+	switch (_nlo_get_object_type (needle)) {
+	case OBJECT_TYPE_IP4_ADDRESS:
+	case OBJECT_TYPE_IP6_ADDRESS:
+		msg_type = RTM_GETADDR;
+		family = rtnl_addr_get_family ((struct rtnl_addr *) needle);
+		break;
+	case OBJECT_TYPE_IP4_ROUTE:
+	case OBJECT_TYPE_IP6_ROUTE:
+		msg_type = RTM_GETROUTE;
+		family = rtnl_route_get_family ((struct rtnl_route *) needle);
+		break;
+	default:
+		g_return_val_if_reached (-NLE_INVAL);
+	}
+
+	err = nl_rtgen_request (sk, msg_type, family, NLM_F_DUMP);
+	if (err < 0)
+		return err;
+
+	cb = nl_cb_clone (nl_socket_get_cb (sk));
+	if (cb == NULL)
+		return -NLE_NOMEM;
+	nl_cb_set (cb, NL_CB_VALID, NL_CB_CUSTOM, dump_search_valid_cb, &data);
+
+	err = nl_recvmsgs (sk, cb);
+	nl_cb_put (cb);
+	if (err < 0) {
+		if (data.result)
+			nl_object_put (data.result);
+		return err;
+	}
+
+	*out_object = data.result;
+	return 0;
+}
+
 /* Ask the kernel for an object identical (as in nl_cache_identical) to the
  * needle argument. This is a kernel counterpart for nl_cache_search.
  *
@@ -563,27 +1119,16 @@ get_kernel_object (struct nl_sock *sock, struct nl_object *needle)
 	case OBJECT_TYPE_IP6_ADDRESS:
 	case OBJECT_TYPE_IP4_ROUTE:
 	case OBJECT_TYPE_IP6_ROUTE:
-		/* Fallback to a one-time cache allocation. */
 		{
-			struct nl_cache *cache;
 			int nle;
 
-			/* FIXME: every time we refresh *one* object, we request an
-			 * entire dump. E.g. check_cache_items() gets O(n2) complexitly. */
-
-			nle = nl_cache_alloc_and_fill (
-					nl_cache_ops_lookup (nl_object_get_type (needle)),
-					sock, &cache);
-			if (nle) {
+			nle = dump_search_kernel_object (sock, needle, &object);
+			if (nle < 0) {
 				error ("get_kernel_object for type %d failed: %s (%d)",
 				       type, nl_geterror (nle), nle);
 				return NULL;
 			}
 
-			object = nl_cache_search (cache, needle);
-
-			nl_cache_free (cache);
-
 			if (object && (type == OBJECT_TYPE_IP4_ADDRESS || type == OBJECT_TYPE_IP6_ADDRESS))
 				_rtnl_addr_hack_lifetimes_rel_to_abs ((struct rtnl_addr *) object);
 
@@ -1490,27 +2035,141 @@ object_has_ifindex (struct nl_object *object, int ifindex)
 	}
 }
 
+static int
+object_get_family (struct nl_object *object)
+{
+	switch (_nlo_get_object_type (object)) {
+	case OBJECT_TYPE_IP4_ADDRESS:
+	case OBJECT_TYPE_IP4_ROUTE:
+		return AF_INET;
+	case OBJECT_TYPE_IP6_ADDRESS:
+	case OBJECT_TYPE_IP6_ROUTE:
+		return AF_INET6;
+	default:
+		return AF_UNSPEC;
+	}
+}
+
 static gboolean refresh_object (NMPlatform *platform, struct nl_object *object, gboolean removed, NMPlatformReason reason);
+static void announce_object (NMPlatform *platform, const struct nl_object *object, NMPlatformSignalChangeType change_type, NMPlatformReason reason);
+
+typedef struct {
+	int ifindex;
+	GHashTable *objects;
+} DumpIfindexData;
 
 static void
-check_cache_items (NMPlatform *platform, struct nl_cache *cache, int ifindex)
+dump_ifindex_parse_cb (struct nl_object *obj, void *arg)
 {
-	auto_nl_cache struct nl_cache *cloned_cache = nl_cache_clone (cache);
-	struct nl_object *object;
-	GPtrArray *objects_to_refresh = g_ptr_array_new_with_free_func ((GDestroyNotify) nl_object_put);
+	DumpIfindexData *data = arg;
+
+	if (   _nlo_get_object_type (obj) != OBJECT_TYPE_UNKNOWN
+	    && object_has_ifindex (obj, data->ifindex)) {
+		nl_object_get (obj);
+		g_hash_table_add (data->objects, obj);
+	}
+}
+
+static int
+dump_ifindex_valid_cb (struct nl_msg *msg, void *arg)
+{
+	nl_msg_parse (msg, dump_ifindex_parse_cb, arg);
+	return NL_OK;
+}
+
+/* Dumps the objects of the class of index @idx and @family from kernel,
+ * but only keeps those of @ifindex. */
+static GHashTable *
+dump_ifindex_kernel_objects (struct nl_sock *sk, CacheIndexType idx, int family, int ifindex)
+{
+	DumpIfindexData data = { .ifindex = ifindex };
+	struct nl_cb *cb;
+	int nle;
+
+	nle = nl_rtgen_request (sk, idx == CACHE_INDEX_ROUTE_IFINDEX ? RTM_GETROUTE : RTM_GETADDR, family, NLM_F_DUMP);
+	if (nle < 0)
+		goto error;
+
+	cb = nl_cb_clone (nl_socket_get_cb (sk));
+	if (!cb) {
+		nle = -NLE_NOMEM;
+		goto error;
+	}
+
+	data.objects = g_hash_table_new_full (cache_object_id_hash, cache_object_id_equal,
+	                                      (GDestroyNotify) nl_object_put, NULL);
+	nl_cb_set (cb, NL_CB_VALID, NL_CB_CUSTOM, dump_ifindex_valid_cb, &data);
+	nle = nl_recvmsgs (sk, cb);
+	nl_cb_put (cb);
+	if (nle < 0) {
+		g_hash_table_unref (data.objects);
+		goto error;
+	}
+	return data.objects;
+
+error:
+	error ("failed to dump objects of ifindex %d: %s (%d)", ifindex, nl_geterror (nle), nle);
+	return NULL;
+}
+
+/* Drops the cached objects of @ifindex in the index @idx (addresses or routes)
+ * that the kernel deleted implicitly, e.g. when the interface went down or
+ * was removed. With @gone, the kernel is known to have deleted all of them,
+ * otherwise the objects of @ifindex are fetched in one dump from kernel. */
+static void
+check_cache_items (NMPlatform *platform, CacheIndexType idx, int family, int ifindex, gboolean gone)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	GPtrArray *objects_to_check;
+	GHashTable *kernel_objects = NULL;
+	const GList *iter;
 	guint i;
 
-	for (object = nl_cache_get_first (cloned_cache); object; object = nl_cache_get_next (object)) {
-		if (object_has_ifindex (object, ifindex)) {
-			nl_object_get (object);
-			g_ptr_array_add (objects_to_refresh, object);
+	g_return_if_fail (idx == CACHE_INDEX_ADDRESS_IFINDEX || idx == CACHE_INDEX_ROUTE_IFINDEX);
+
+	iter = cache_index_lookup_ifindex (platform, idx, ifindex);
+	if (!iter)
+		return;
+
+	/* Take a snapshot, announcing the removal might modify the cache. */
+	objects_to_check = g_ptr_array_new_with_free_func ((GDestroyNotify) nl_object_put);
+	for (; iter; iter = iter->next) {
+		struct nl_object *object = iter->data;
+
+		if (family != AF_UNSPEC && object_get_family (object) != family)
+			continue;
+		nl_object_get (object);
+		g_ptr_array_add (objects_to_check, object);
+	}
+
+	if (!gone && objects_to_check->len) {
+		kernel_objects = dump_ifindex_kernel_objects (priv->nlh, idx, family, ifindex);
+		if (!kernel_objects) {
+			/* Fall back to checking each object individually */
+			for (i = 0; i < objects_to_check->len; i++)
+				refresh_object (platform, objects_to_check->pdata[i], TRUE, NM_PLATFORM_REASON_CACHE_CHECK);
+			goto out;
 		}
 	}
 
-	for (i = 0; i < objects_to_refresh->len; i++)
-		refresh_object (platform, objects_to_refresh->pdata[i], TRUE, NM_PLATFORM_REASON_CACHE_CHECK);
+	for (i = 0; i < objects_to_check->len; i++) {
+		struct nl_object *object = objects_to_check->pdata[i];
+
+		if (kernel_objects && g_hash_table_contains (kernel_objects, object))
+			continue;
+
+		/* Only announce objects that are still in the cache. */
+		if (!g_hash_table_contains (priv->cache_index[idx].nodes, object))
+			continue;
+
+		cache_remove_object (platform, object);
+		announce_object (platform, object, NM_PLATFORM_SIGNAL_REMOVED, NM_PLATFORM_REASON_CACHE_CHECK);
+	}
 
-	g_ptr_array_free (objects_to_refresh, TRUE);
+out:
+	if (kernel_objects)
+		g_hash_table_unref (kernel_objects);
+	g_ptr_array_free (objects_to_check, TRUE);
 }
 
 static void
@@ -1538,11 +2197,11 @@ announce_object (NMPlatform *platform, const struct nl_object *object, NMPlatfor
 			switch (change_type) {
 			case NM_PLATFORM_SIGNAL_CHANGED:
 				if (!device.connected)
-					check_cache_items (platform, priv->route_cache, device.ifindex);
+					check_cache_items (platform, CACHE_INDEX_ROUTE_IFINDEX, AF_UNSPEC, device.ifindex, FALSE);
 				break;
 			case NM_PLATFORM_SIGNAL_REMOVED:
-				check_cache_items (platform, priv->address_cache, device.ifindex);
-				check_cache_items (platform, priv->route_cache, device.ifindex);
+				check_cache_items (platform, CACHE_INDEX_ADDRESS_IFINDEX, AF_UNSPEC, device.ifindex, TRUE);
+				check_cache_items (platform, CACHE_INDEX_ROUTE_IFINDEX, AF_UNSPEC, device.ifindex, TRUE);
 				g_hash_table_remove (priv->wifi_data, GINT_TO_POINTER (device.ifindex));
 				break;
 			default:
@@ -1561,9 +2220,8 @@ announce_object (NMPlatform *platform, const struct nl_object *object, NMPlatfor
 			 */
 			switch (change_type) {
 			case NM_PLATFORM_SIGNAL_REMOVED:
-				check_cache_items (platform,
-				                   priv->route_cache,
-				                   rtnl_addr_get_ifindex ((struct rtnl_addr *) object));
+				check_cache_items (platform, CACHE_INDEX_ROUTE_IFINDEX, AF_INET,
+				                   rtnl_addr_get_ifindex ((struct rtnl_addr *) object), FALSE);
 				break;
 			default:
 				break;
@@ -1628,79 +2286,385 @@ announce_object (NMPlatform *platform, const struct nl_object *object, NMPlatfor
 
 static struct nl_object * build_rtnl_link (int ifindex, const char *name, NMLinkType type);
 
+/* Updates the cache entry for @object with @kernel_object, the current
+ * state of the object in the kernel (or %NULL if the kernel doesn't have
+ * it), and announces the change. */
 static gboolean
-refresh_object (NMPlatform *platform, struct nl_object *object, gboolean removed, NMPlatformReason reason)
+refresh_object_full (NMPlatform *platform, struct nl_object *object, struct nl_object *kernel_object, gboolean removed, NMPlatformReason reason)
 {
-	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
 	auto_nl_object struct nl_object *cached_object = NULL;
-	auto_nl_object struct nl_object *kernel_object = NULL;
 	struct nl_cache *cache;
 	int nle;
 
 	cache = choose_cache (platform, object);
 	cached_object = nm_nl_cache_search (cache, object);
-	kernel_object = get_kernel_object (priv->nlh, object);
 
 	if (removed) {
 		if (kernel_object)
 			return TRUE;
 
-		/* Only announce object if it was still in the cache. */
-		if (cached_object) {
-			nl_cache_remove (cached_object);
+		/* Only announce object if it was still in the cache. */
+		if (cached_object) {
+			cache_remove_object (platform, cached_object);
+
+			announce_object (platform, cached_object, NM_PLATFORM_SIGNAL_REMOVED, reason);
+		}
+	} else {
+		ObjectType type;
+
+		if (!kernel_object)
+			return FALSE;
+
+		/* Unsupported object types should never have reached the caches */
+		type = _nlo_get_object_type (kernel_object);
+		g_assert (type != OBJECT_TYPE_UNKNOWN);
+
+		hack_empty_master_iff_lower_up (platform, kernel_object);
+
+		if (cached_object)
+			cache_remove_object (platform, cached_object);
+		nle = cache_add_object (platform, cache, kernel_object);
+		if (nle) {
+			nm_log_dbg (LOGD_PLATFORM, "refresh_object(reason %d) failed during nl_cache_add with %d", reason, nle);
+			return FALSE;
+		}
+
+		announce_object (platform, kernel_object, cached_object ? NM_PLATFORM_SIGNAL_CHANGED : NM_PLATFORM_SIGNAL_ADDED, reason);
+
+		if (type == OBJECT_TYPE_LINK) {
+			int kernel_master = rtnl_link_get_master ((struct rtnl_link *) kernel_object);
+			int cached_master = cached_object ? rtnl_link_get_master ((struct rtnl_link *) cached_object) : 0;
+			const char *orig_link_type = rtnl_link_get_type ((struct rtnl_link *) object);
+			const char *kernel_link_type = rtnl_link_get_type ((struct rtnl_link *) kernel_object);
+			struct nl_object *master_object;
+
+			/* Refresh the master device (even on enslave/release) */
+			if (kernel_master) {
+				master_object = build_rtnl_link (kernel_master, NULL, NM_LINK_TYPE_NONE);
+				refresh_object (platform, master_object, FALSE, NM_PLATFORM_REASON_INTERNAL);
+				nl_object_put (master_object);
+			}
+			if (cached_master && cached_master != kernel_master) {
+				master_object = build_rtnl_link (cached_master, NULL, NM_LINK_TYPE_NONE);
+				refresh_object (platform, master_object, FALSE, NM_PLATFORM_REASON_INTERNAL);
+				nl_object_put (master_object);
+			}
+
+			/* Ensure the existing link type matches the refreshed link type */
+			if (orig_link_type && kernel_link_type && strcmp (orig_link_type, kernel_link_type)) {
+				platform->error = NM_PLATFORM_ERROR_WRONG_TYPE;
+				return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+static gboolean
+refresh_object (NMPlatform *platform, struct nl_object *object, gboolean removed, NMPlatformReason reason)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	auto_nl_object struct nl_object *kernel_object = NULL;
+
+	kernel_object = get_kernel_object (priv->nlh, object);
+	return refresh_object_full (platform, object, kernel_object, removed, reason);
+}
+
+/******************************************************************
+ * Batched address and route changes
+ *
+ * Between batch_begin() and batch_commit(), add_object() and delete_object()
+ * only send the request for addresses and routes on a dedicated socket and
+ * return immediately. The kernel processes rtnetlink requests synchronously
+ * while they are sent, so the changes take effect right away; only reading
+ * the acknowledgements and refreshing the cache is deferred.
+ *
+ * The kernel multicasts the notification of a change before it acknowledges
+ * the request. batch_commit() therefore collects all acknowledgements in one
+ * pass and then dispatches the pending events, which carry the changed
+ * objects. Only requests whose outcome the events don't tell are refreshed
+ * one by one.
+ ******************************************************************/
+
+/* Read acknowledgements before the socket receive buffer could overflow. */
+#define BATCH_MAX_PENDING_ACKS 64
+
+typedef struct {
+	struct nl_object *object;
+	gboolean is_delete;
+	guint32 seq;
+	int nle;
+} BatchItem;
+
+static gboolean
+batch_supports_object (struct nl_object *object)
+{
+	switch (_nlo_get_object_type (object)) {
+	case OBJECT_TYPE_IP4_ADDRESS:
+	case OBJECT_TYPE_IP6_ADDRESS:
+	case OBJECT_TYPE_IP4_ROUTE:
+	case OBJECT_TYPE_IP6_ROUTE:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+static void
+batch_item_clear (gpointer data)
+{
+	BatchItem *item = data;
+
+	nl_object_put (item->object);
+}
+
+static BatchItem *
+batch_next_unacked (NMPlatform *platform)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+
+	g_return_val_if_fail (priv->batch_acked < priv->batch->len, NULL);
+
+	return &g_array_index (priv->batch, BatchItem, priv->batch_acked++);
+}
+
+static int
+batch_ack_cb (struct nl_msg *msg, void *arg)
+{
+	BatchItem *item = batch_next_unacked (arg);
+
+	if (item)
+		item->nle = 0;
+	return NL_OK;
+}
+
+static int
+batch_error_cb (struct sockaddr_nl *nla, struct nlmsgerr *nlerr, void *arg)
+{
+	BatchItem *item = batch_next_unacked (arg);
+
+	if (item) {
+		if (item->seq != nlerr->msg.nlmsg_seq)
+			warning ("batch: unexpected error for request %u, expected %u", nlerr->msg.nlmsg_seq, item->seq);
+		item->nle = -nl_syserr2nlerr (nlerr->error);
+	}
+	return NL_SKIP;
+}
+
+/* Reads acknowledgements until all sent requests are acknowledged. */
+static void
+batch_receive_acks (NMPlatform *platform)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	struct nl_cb *cb;
+	int nle = 0;
+
+	if (priv->batch_acked >= priv->batch->len)
+		return;
+
+	cb = nl_cb_clone (nl_socket_get_cb (priv->nlh_batch));
+	if (cb) {
+		nl_cb_set (cb, NL_CB_ACK, NL_CB_CUSTOM, batch_ack_cb, platform);
+		nl_cb_err (cb, NL_CB_CUSTOM, batch_error_cb, platform);
+
+		while (priv->batch_acked < priv->batch->len) {
+			nle = nl_recvmsgs (priv->nlh_batch, cb);
+			if (nle < 0)
+				break;
+		}
+		nl_cb_put (cb);
+	} else
+		nle = -NLE_NOMEM;
+
+	if (priv->batch_acked < priv->batch->len) {
+		error ("batch: failed to receive acknowledgements: %s (%d)", nl_geterror (nle), nle);
+		while (priv->batch_acked < priv->batch->len)
+			batch_next_unacked (platform)->nle = nle < 0 ? nle : -NLE_FAILURE;
+	}
+}
+
+static gboolean
+batch_begin (NMPlatform *platform)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+
+	g_return_val_if_fail (!priv->batch, FALSE);
+
+	if (!priv->nlh_batch) {
+		priv->nlh_batch = setup_socket (FALSE, platform);
+		g_return_val_if_fail (priv->nlh_batch, FALSE);
+	}
+
+	priv->batch = g_array_new (FALSE, FALSE, sizeof (BatchItem));
+	g_array_set_clear_func (priv->batch, batch_item_clear);
+	priv->batch_acked = 0;
+	return TRUE;
+}
+
+static guint
+batch_get_length (NMPlatform *platform)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+
+	return priv->batch ? priv->batch->len : 0;
+}
+
+/* Sends the request for @object without waiting for the kernel's answer. */
+static gboolean
+batch_queue (NMPlatform *platform, struct nl_object *object, gboolean is_delete)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	struct nl_msg *msg = NULL;
+	BatchItem item = { 0 };
+	int nle;
+
+	switch (_nlo_get_object_type (object)) {
+	case OBJECT_TYPE_IP4_ADDRESS:
+	case OBJECT_TYPE_IP6_ADDRESS:
+		if (is_delete)
+			nle = rtnl_addr_build_delete_request ((struct rtnl_addr *) object, 0, &msg);
+		else
+			nle = rtnl_addr_build_add_request ((struct rtnl_addr *) object, NLM_F_CREATE | NLM_F_REPLACE, &msg);
+		break;
+	case OBJECT_TYPE_IP4_ROUTE:
+	case OBJECT_TYPE_IP6_ROUTE:
+		if (is_delete)
+			nle = rtnl_route_build_del_request ((struct rtnl_route *) object, 0, &msg);
+		else
+			nle = rtnl_route_build_add_request ((struct rtnl_route *) object, NLM_F_CREATE | NLM_F_REPLACE, &msg);
+		break;
+	default:
+		g_return_val_if_reached (FALSE);
+	}
+
+	if (nle < 0) {
+		error ("batch: failed to build request for %s: %s (%d)", to_string_object (platform, object), nl_geterror (nle), nle);
+		return FALSE;
+	}
+
+	if (priv->batch->len - priv->batch_acked >= BATCH_MAX_PENDING_ACKS)
+		batch_receive_acks (platform);
+
+	nle = nl_send_auto (priv->nlh_batch, msg);
+	item.seq = nlmsg_hdr (msg)->nlmsg_seq;
+	nlmsg_free (msg);
+	if (nle < 0) {
+		error ("batch: failed to send request for %s: %s (%d)", to_string_object (platform, object), nl_geterror (nle), nle);
+		return FALSE;
+	}
+
+	nl_object_get (object);
+	item.object = object;
+	item.is_delete = is_delete;
+	item.nle = 1;
+	g_array_append_val (priv->batch, item);
+	return TRUE;
+}
+
+static gboolean
+batch_item_succeeded (NMPlatform *platform, const BatchItem *item)
+{
+	ObjectType type = _nlo_get_object_type (item->object);
+
+	/* Accept the same errors as add_object() and delete_object(). */
+	switch (item->nle) {
+	case -NLE_SUCCESS:
+		return TRUE;
+	case -NLE_EXIST:
+		if (!item->is_delete)
+			return TRUE;
+		break;
+	case -NLE_OBJ_NOTFOUND:
+		if (item->is_delete)
+			return TRUE;
+		break;
+	case -NLE_FAILURE:
+		if (item->is_delete && type == OBJECT_TYPE_IP6_ADDRESS)
+			return TRUE;
+		break;
+	case -NLE_NOADDR:
+		if (item->is_delete && (type == OBJECT_TYPE_IP4_ADDRESS || type == OBJECT_TYPE_IP6_ADDRESS))
+			return TRUE;
+		break;
+	default:
+		break;
+	}
+
+	error ("Netlink error %s %s: %s (%d)", item->is_delete ? "deleting" : "adding",
+	       to_string_object (platform, item->object), nl_geterror (item->nle), item->nle);
+	return FALSE;
+}
+
+static void event_socket_drain (EventSocket *es);
+
+static gboolean
+batch_commit (NMPlatform *platform, GArray **out_results)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	GArray *batch = priv->batch;
+	GArray *results;
+	gboolean success = TRUE;
+	guint i;
+
+	g_return_val_if_fail (batch, FALSE);
 
-			announce_object (platform, cached_object, NM_PLATFORM_SIGNAL_REMOVED, reason);
-		}
-	} else {
-		ObjectType type;
+	batch_receive_acks (platform);
 
-		if (!kernel_object)
-			return FALSE;
+	/* From now on, changes are synchronous again. The events dispatched
+	 * below announce the changes, whose handlers might modify the platform. */
+	priv->batch = NULL;
 
-		/* Unsupported object types should never have reached the caches */
-		type = _nlo_get_object_type (kernel_object);
-		g_assert (type != OBJECT_TYPE_UNKNOWN);
+	results = g_array_sized_new (FALSE, FALSE, sizeof (gboolean), batch->len);
+	for (i = 0; i < batch->len; i++) {
+		const BatchItem *item = &g_array_index (batch, BatchItem, i);
+		gboolean item_success = batch_item_succeeded (platform, item);
 
-		hack_empty_master_iff_lower_up (platform, kernel_object);
+		g_array_append_val (results, item_success);
+		success &= item_success;
+	}
 
-		if (cached_object)
-			nl_cache_remove (cached_object);
-		nle = nl_cache_add (cache, kernel_object);
-		if (nle) {
-			nm_log_dbg (LOGD_PLATFORM, "refresh_object(reason %d) failed during nl_cache_add with %d", reason, nle);
-			return FALSE;
-		}
+	debug ("batch: committed %u requests (%s)", batch->len, success ? "success" : "with failures");
 
-		announce_object (platform, kernel_object, cached_object ? NM_PLATFORM_SIGNAL_CHANGED : NM_PLATFORM_SIGNAL_ADDED, reason);
+	/* All notifications of the batch are queued by now. Besides the
+	 * requested objects, they also cover the side effects, such as prefix
+	 * routes going away with their address. */
+	for (i = 0; i < __EVENT_SOCKET_LAST; i++)
+		event_socket_drain (&priv->event_sockets[i]);
 
-		if (type == OBJECT_TYPE_LINK) {
-			int kernel_master = rtnl_link_get_master ((struct rtnl_link *) kernel_object);
-			int cached_master = cached_object ? rtnl_link_get_master ((struct rtnl_link *) cached_object) : 0;
-			const char *orig_link_type = rtnl_link_get_type ((struct rtnl_link *) object);
-			const char *kernel_link_type = rtnl_link_get_type ((struct rtnl_link *) kernel_object);
-			struct nl_object *master_object;
+	for (i = 0; i < batch->len; i++) {
+		const BatchItem *item = &g_array_index (batch, BatchItem, i);
+		auto_nl_object struct nl_object *cached_object = NULL;
 
-			/* Refresh the master device (even on enslave/release) */
-			if (kernel_master) {
-				master_object = build_rtnl_link (kernel_master, NULL, NM_LINK_TYPE_NONE);
-				refresh_object (platform, master_object, FALSE, NM_PLATFORM_REASON_INTERNAL);
-				nl_object_put (master_object);
-			}
-			if (cached_master && cached_master != kernel_master) {
-				master_object = build_rtnl_link (cached_master, NULL, NM_LINK_TYPE_NONE);
-				refresh_object (platform, master_object, FALSE, NM_PLATFORM_REASON_INTERNAL);
-				nl_object_put (master_object);
-			}
+		/* A failed request didn't change anything. */
+		if (!g_array_index (results, gboolean, i))
+			continue;
 
-			/* Ensure the existing link type matches the refreshed link type */
-			if (orig_link_type && kernel_link_type && strcmp (orig_link_type, kernel_link_type)) {
-				platform->error = NM_PLATFORM_ERROR_WRONG_TYPE;
-				return FALSE;
+		if (item->nle == 0) {
+			/* The kernel did what was asked. A deletion can be applied
+			 * without asking the kernel, in case its event was lost; an
+			 * addition needs the object as the kernel completed it. */
+			if (item->is_delete) {
+				refresh_object_full (platform, item->object, NULL, TRUE, NM_PLATFORM_REASON_INTERNAL);
+				continue;
 			}
+			cached_object = nm_nl_cache_search (choose_cache (platform, item->object), item->object);
+			if (cached_object)
+				continue;
 		}
+
+		/* The outcome is unknown, e.g. the deletion of an address that
+		 * failed in one of the accepted ways. */
+		refresh_object (platform, item->object, item->is_delete, NM_PLATFORM_REASON_INTERNAL);
 	}
 
-	return TRUE;
+	g_array_unref (batch);
+
+	if (out_results)
+		*out_results = results;
+	else
+		g_array_unref (results);
+	return success;
 }
 
 /* Decreases the reference count if @obj for convenience */
@@ -1713,6 +2677,9 @@ add_object (NMPlatform *platform, struct nl_object *obj)
 
 	g_return_val_if_fail (object, FALSE);
 
+	if (priv->batch && batch_supports_object (object))
+		return batch_queue (platform, object, FALSE);
+
 	nle = add_kernel_object (priv->nlh, object);
 
 	/* NLE_EXIST is considered equivalent to success to avoid race conditions. You
@@ -1755,6 +2722,11 @@ delete_object (NMPlatform *platform, struct nl_object *object, gboolean do_refre
 	object_type = _nlo_get_object_type (object);
 	g_return_val_if_fail (object_type != OBJECT_TYPE_UNKNOWN, FALSE);
 
+	if (priv->batch && batch_supports_object (object)) {
+		result = batch_queue (platform, object, TRUE);
+		goto out;
+	}
+
 	switch (object_type) {
 	case OBJECT_TYPE_LINK:
 		nle = rtnl_link_delete (priv->nlh, (struct rtnl_link *) object);
@@ -1898,6 +2870,154 @@ nm_nl_object_diff (ObjectType type, struct nl_object *_a, struct nl_object *_b)
  * through the cache manager. In this case, nm-linux-platform serves as the
  * cache manager instead of the one provided by libnl.
  */
+/* Returns the interface of an address or a single-nexthop route, or 0 */
+static int
+object_get_ifindex (struct nl_object *object)
+{
+	switch (_nlo_get_object_type (object)) {
+	case OBJECT_TYPE_IP4_ADDRESS:
+	case OBJECT_TYPE_IP6_ADDRESS:
+		return rtnl_addr_get_ifindex ((struct rtnl_addr *) object);
+	case OBJECT_TYPE_IP4_ROUTE:
+	case OBJECT_TYPE_IP6_ROUTE:
+		if (rtnl_route_get_nnexthops ((struct rtnl_route *) object) != 1)
+			return 0;
+		return rtnl_route_nh_get_ifindex (rtnl_route_nexthop_n ((struct rtnl_route *) object, 0));
+	default:
+		return 0;
+	}
+}
+
+static gboolean
+object_link_cached (NMPlatform *platform, struct nl_object *object)
+{
+	auto_nl_object struct rtnl_link *rtnllink = NULL;
+	int ifindex;
+
+	ifindex = object_get_ifindex (object);
+	if (ifindex <= 0)
+		return TRUE;
+
+	rtnllink = link_get_cached (platform, ifindex);
+	return !!rtnllink;
+}
+
+/* Adds or updates the cache with @kernel_object, the object of an
+ * RTM_NEW* event, and announces the change. */
+static void
+event_object_new (NMPlatform *platform, struct nl_object *kernel_object)
+{
+	ObjectType type = _nlo_get_object_type (kernel_object);
+	struct nl_cache *cache = choose_cache_by_type (platform, type);
+	auto_nl_object struct nl_object *cached_object = NULL;
+	int nle;
+
+	cached_object = nm_nl_cache_search (cache, kernel_object);
+
+	/* Handle external addition */
+	if (!cached_object) {
+		nle = cache_add_object (platform, cache, kernel_object);
+		if (nle) {
+			error ("netlink cache error: %s", nl_geterror (nle));
+			return;
+		}
+		announce_object (platform, kernel_object, NM_PLATFORM_SIGNAL_ADDED, NM_PLATFORM_REASON_EXTERNAL);
+		return;
+	}
+	/* Ignore non-change
+	 *
+	 * This also catches notifications for internal addition or change, unless
+	 * another action occured very soon after it.
+	 */
+	if (!nm_nl_object_diff (type, kernel_object, cached_object))
+		return;
+
+	/* Handle external change */
+	cache_remove_object (platform, cached_object);
+	nle = cache_add_object (platform, cache, kernel_object);
+	if (nle) {
+		error ("netlink cache error: %s", nl_geterror (nle));
+		return;
+	}
+	announce_object (platform, kernel_object, NM_PLATFORM_SIGNAL_CHANGED, NM_PLATFORM_REASON_EXTERNAL);
+}
+
+static gboolean
+delayed_objects_handle (gpointer user_data)
+{
+	NMPlatform *platform = NM_PLATFORM (user_data);
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	GPtrArray *objects;
+	guint i;
+
+	priv->delayed_objects_id = 0;
+
+	/* Handling objects emits signals, whose handlers may cause more
+	 * objects to be delayed. */
+	objects = priv->delayed_objects;
+	priv->delayed_objects = g_ptr_array_new_with_free_func ((GDestroyNotify) nl_object_put);
+
+	for (i = 0; i < objects->len; i++) {
+		struct nl_object *object = objects->pdata[i];
+
+		/* The link's events were read meanwhile. If it is still unknown,
+		 * it is gone, and the kernel deleted @object along with it
+		 * without an RTM_DELROUTE. */
+		if (object_link_cached (platform, object))
+			event_object_new (platform, object);
+		else
+			debug ("netlink: ignore event for object of removed link %d", object_get_ifindex (object));
+	}
+	g_ptr_array_unref (objects);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Keeps the object of an RTM_NEW* event whose link is not cached yet until
+ * the events already pending on all sockets are read. These include the
+ * link's RTM_NEWLINK or RTM_DELLINK, as the kernel sends them before any
+ * event of the link's routes. */
+static void
+delay_object (NMPlatform *platform, struct nl_object *object)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+
+	debug ("netlink: delay event for object of unknown link %d", object_get_ifindex (object));
+
+	nl_object_get (object);
+	g_ptr_array_add (priv->delayed_objects, object);
+	if (!priv->delayed_objects_id)
+		priv->delayed_objects_id = g_idle_add (delayed_objects_handle, platform);
+}
+
+/* Drops the delayed objects that @object, of a newer event, supersedes.
+ * With @classes, drops the delayed objects of these classes instead. */
+static void
+delayed_objects_drop (NMPlatform *platform, struct nl_object *object, CacheClass classes)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	guint i;
+
+	for (i = priv->delayed_objects->len; i > 0; i--) {
+		struct nl_object *delayed = priv->delayed_objects->pdata[i - 1];
+		CacheClass delayed_class;
+
+		switch (_nlo_get_object_type (delayed)) {
+		case OBJECT_TYPE_IP4_ADDRESS:
+		case OBJECT_TYPE_IP6_ADDRESS:
+			delayed_class = CACHE_CLASS_ADDRESS;
+			break;
+		default:
+			delayed_class = CACHE_CLASS_ROUTE;
+			break;
+		}
+
+		if (   (classes & delayed_class)
+		    || (object && nl_object_identical (object, delayed)))
+			g_ptr_array_remove_index (priv->delayed_objects, i - 1);
+	}
+}
+
 static int
 event_notification (struct nl_msg *msg, gpointer user_data)
 {
@@ -1908,7 +3028,6 @@ event_notification (struct nl_msg *msg, gpointer user_data)
 	auto_nl_object struct nl_object *cached_object = NULL;
 	auto_nl_object struct nl_object *kernel_object = NULL;
 	int event;
-	int nle;
 	ObjectType type;
 
 	event = nlmsg_hdr (msg)->nlmsg_type;
@@ -1939,10 +3058,40 @@ event_notification (struct nl_msg *msg, gpointer user_data)
 
 	cache = choose_cache_by_type (platform, type);
 	cached_object = nm_nl_cache_search (cache, object);
-	kernel_object = get_kernel_object (priv->nlh, object);
+
+	switch (type) {
+	case OBJECT_TYPE_IP4_ADDRESS:
+	case OBJECT_TYPE_IP6_ADDRESS:
+	case OBJECT_TYPE_IP4_ROUTE:
+	case OBJECT_TYPE_IP6_ROUTE:
+		/* Address and route notifications carry the complete object and
+		 * the kernel delivers them in order, so the latest event always
+		 * reflects the kernel state. Trust it instead of asking the kernel
+		 * again, which for these types costs a dump of the whole table. */
+		if (event == RTM_NEWADDR || event == RTM_NEWROUTE) {
+			if (type == OBJECT_TYPE_IP4_ROUTE || type == OBJECT_TYPE_IP6_ROUTE) {
+				/* Cloned routes are never part of a dump; ignore them. */
+				if (rtnl_route_get_flags ((struct rtnl_route *) object) & RTM_F_CLONED)
+					return NL_OK;
+			} else
+				_rtnl_addr_hack_lifetimes_rel_to_abs ((struct rtnl_addr *) object);
+			nl_object_get (object);
+			kernel_object = object;
+		}
+		break;
+	case OBJECT_TYPE_LINK:
+		kernel_object = get_kernel_object (priv->nlh, object);
+		break;
+	default:
+		break;
+	}
 
 	hack_empty_master_iff_lower_up (platform, kernel_object);
 
+	/* This event is newer than a delayed one for the same object */
+	if (priv->delayed_objects->len)
+		delayed_objects_drop (platform, object, 0);
+
 	/* Removed object */
 	switch (event) {
 	case RTM_DELLINK:
@@ -1959,7 +3108,7 @@ event_notification (struct nl_msg *msg, gpointer user_data)
 		if (!cached_object)
 			return NL_OK;
 
-		nl_cache_remove (cached_object);
+		cache_remove_object (platform, cached_object);
 		announce_object (platform, cached_object, NM_PLATFORM_SIGNAL_REMOVED, NM_PLATFORM_REASON_EXTERNAL);
 		if (event == RTM_DELLINK) {
 			int ifindex = rtnl_link_get_ifindex ((struct rtnl_link *) cached_object);
@@ -1984,33 +3133,14 @@ event_notification (struct nl_msg *msg, gpointer user_data)
 		if (type == OBJECT_TYPE_UNKNOWN)
 			return NL_OK;
 
-		/* Handle external addition */
-		if (!cached_object) {
-			nle = nl_cache_add (cache, kernel_object);
-			if (nle) {
-				error ("netlink cache error: %s", nl_geterror (nle));
-				return NL_OK;
-			}
-			announce_object (platform, kernel_object, NM_PLATFORM_SIGNAL_ADDED, NM_PLATFORM_REASON_EXTERNAL);
-			return NL_OK;
-		}
-		/* Ignore non-change
-		 *
-		 * This also catches notifications for internal addition or change, unless
-		 * another action occured very soon after it.
-		 */
-		if (!nm_nl_object_diff (type, kernel_object, cached_object))
-			return NL_OK;
-
-		/* Handle external change */
-		nl_cache_remove (cached_object);
-		nle = nl_cache_add (cache, kernel_object);
-		if (nle) {
-			error ("netlink cache error: %s", nl_geterror (nle));
+		/* Wait for the link of addresses and routes to show up */
+		if (   type != OBJECT_TYPE_LINK
+		    && !object_link_cached (platform, kernel_object)) {
+			delay_object (platform, kernel_object);
 			return NL_OK;
 		}
-		announce_object (platform, kernel_object, NM_PLATFORM_SIGNAL_CHANGED, NM_PLATFORM_REASON_EXTERNAL);
 
+		event_object_new (platform, kernel_object);
 		return NL_OK;
 	default:
 		error ("Unknown netlink event: %d", event);
@@ -2203,11 +3333,10 @@ link_get_all (NMPlatform *platform)
 static gboolean
 _nm_platform_link_get (NMPlatform *platform, int ifindex, NMPlatformLink *l)
 {
-	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
 	auto_nl_object struct rtnl_link *rtnllink = NULL;
 	NMPlatformLink tmp = { 0 };
 
-	rtnllink = rtnl_link_get (priv->link_cache, ifindex);
+	rtnllink = link_get_cached (platform, ifindex);
 	return (rtnllink && init_link (platform, l ? l : &tmp, rtnllink));
 }
 
@@ -2217,20 +3346,17 @@ _nm_platform_link_get_by_address (NMPlatform *platform,
                                   size_t length,
                                   NMPlatformLink *l)
 {
-	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
-	struct nl_object *object;
+	CacheIndexKey key = { 0 };
+	const GList *iter;
 
-	for (object = nl_cache_get_first (priv->link_cache); object; object = nl_cache_get_next (object)) {
-		struct rtnl_link *rtnl_link = (struct rtnl_link *) object;
-		struct nl_addr *nladdr;
-		gconstpointer hwaddr;
-
-		nladdr = rtnl_link_get_addr (rtnl_link);
-		if (nladdr && (nl_addr_get_len (nladdr) == length)) {
-			hwaddr = nl_addr_get_binary_addr (nladdr);
-			if (hwaddr && memcmp (hwaddr, address, length) == 0)
-				return init_link (platform, l, rtnl_link);
-		}
+	if (length == 0 || length > sizeof (key.data))
+		return FALSE;
+	key.len = length;
+	memcpy (key.data, address, length);
+
+	for (iter = cache_index_lookup (platform, CACHE_INDEX_LINK_ADDRESS, &key); iter; iter = iter->next) {
+		if (init_link (platform, l, (struct rtnl_link *) iter->data))
+			return TRUE;
 	}
 	return FALSE;
 }
@@ -2307,8 +3433,7 @@ link_add (NMPlatform *platform,
 static struct rtnl_link *
 link_get (NMPlatform *platform, int ifindex)
 {
-	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
-	struct rtnl_link *rtnllink = rtnl_link_get (priv->link_cache, ifindex);
+	struct rtnl_link *rtnllink = link_get_cached (platform, ifindex);
 
 	if (!rtnllink) {
 		platform->error = NM_PLATFORM_ERROR_NOT_FOUND;
@@ -2359,8 +3484,7 @@ link_change (NMPlatform *platform, int ifindex, struct rtnl_link *change)
 static gboolean
 link_delete (NMPlatform *platform, int ifindex)
 {
-	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
-	auto_nl_object struct rtnl_link *rtnllink = rtnl_link_get (priv->link_cache, ifindex);
+	auto_nl_object struct rtnl_link *rtnllink = link_get_cached (platform, ifindex);
 
 	if (!rtnllink) {
 		platform->error = NM_PLATFORM_ERROR_NOT_FOUND;
@@ -2373,9 +3497,16 @@ link_delete (NMPlatform *platform, int ifindex)
 static int
 link_get_ifindex (NMPlatform *platform, const char *ifname)
 {
-	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	CacheIndexKey key = { 0 };
+	const GList *list;
+
+	if (!ifname || !*ifname)
+		return 0;
+	key.len = strnlen (ifname, IFNAMSIZ);
+	memcpy (key.data, ifname, key.len);
 
-	return rtnl_link_name2i (priv->link_cache, ifname);
+	list = cache_index_lookup (platform, CACHE_INDEX_LINK_NAME, &key);
+	return list ? rtnl_link_get_ifindex (list->data) : 0;
 }
 
 static const char *
@@ -3609,10 +4740,12 @@ ip4_address_get_all (NMPlatform *platform, int ifindex)
 	GArray *addresses;
 	NMPlatformIP4Address address;
 	struct nl_object *object;
+	CacheIter iter;
 
 	addresses = g_array_new (FALSE, FALSE, sizeof (NMPlatformIP4Address));
 
-	for (object = nl_cache_get_first (priv->address_cache); object; object = nl_cache_get_next (object)) {
+	cache_iter_init_ifindex (&iter, platform, priv->address_cache, CACHE_INDEX_ADDRESS_IFINDEX, ifindex);
+	while ((object = cache_iter_next (&iter))) {
 		if (_address_match ((struct rtnl_addr *) object, AF_INET, ifindex)) {
 			if (init_ip4_address (&address, (struct rtnl_addr *) object))
 				g_array_append_val (addresses, address);
@@ -3629,10 +4762,12 @@ ip6_address_get_all (NMPlatform *platform, int ifindex)
 	GArray *addresses;
 	NMPlatformIP6Address address;
 	struct nl_object *object;
+	CacheIter iter;
 
 	addresses = g_array_new (FALSE, FALSE, sizeof (NMPlatformIP6Address));
 
-	for (object = nl_cache_get_first (priv->address_cache); object; object = nl_cache_get_next (object)) {
+	cache_iter_init_ifindex (&iter, platform, priv->address_cache, CACHE_INDEX_ADDRESS_IFINDEX, ifindex);
+	while ((object = cache_iter_next (&iter))) {
 		if (_address_match ((struct rtnl_addr *) object, AF_INET6, ifindex)) {
 			if (init_ip6_address (&address, (struct rtnl_addr *) object))
 				g_array_append_val (addresses, address);
@@ -3803,15 +4938,19 @@ ip6_address_exists (NMPlatform *platform, int ifindex, struct in6_addr addr, int
 static gboolean
 ip4_check_reinstall_device_route (NMPlatform *platform, int ifindex, const NMPlatformIP4Address *address, guint32 device_route_metric)
 {
-	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
 	NMPlatformIP4Address addr_candidate;
 	NMPlatformIP4Route route_candidate;
-	struct nl_object *object;
-	guint32 device_network;
+	CacheIndexKey key = { 0 };
+	const GList *iter;
 
-	for (object = nl_cache_get_first (priv->address_cache); object; object = nl_cache_get_next (object)) {
-		if (_address_match ((struct rtnl_addr *) object, AF_INET, 0)) {
-			if (init_ip4_address (&addr_candidate, (struct rtnl_addr *) object))
+	key.family = AF_INET;
+	key.plen = address->plen;
+	key.len = sizeof (address->address);
+	memcpy (key.data, &address->address, sizeof (address->address));
+
+	for (iter = cache_index_lookup (platform, CACHE_INDEX_ADDRESS_ID, &key); iter; iter = iter->next) {
+		if (_address_match ((struct rtnl_addr *) iter->data, AF_INET, 0)) {
+			if (init_ip4_address (&addr_candidate, (struct rtnl_addr *) iter->data))
 				if (   addr_candidate.plen == address->plen
 				    && addr_candidate.address == address->address) {
 					/* If we already have the same address installed on any interface,
@@ -3823,15 +4962,14 @@ ip4_check_reinstall_device_route (NMPlatform *platform, int ifindex, const NMPla
 		}
 	}
 
-	device_network = nm_utils_ip4_address_clear_host_address (address->address, address->plen);
+	memset (&key, 0, sizeof (key));
+	cache_index_key_set_network (&key, AF_INET, &address->address, address->plen);
 
-	for (object = nl_cache_get_first (priv->route_cache); object; object = nl_cache_get_next (object)) {
-		if (_route_match ((struct rtnl_route *) object, AF_INET, 0, TRUE)) {
-			if (init_ip4_route (&route_candidate, (struct rtnl_route *) object)) {
-				if (   route_candidate.network == device_network
-				    && route_candidate.plen == address->plen
-				    && (   route_candidate.metric == 0
-				        || route_candidate.metric == device_route_metric)) {
+	for (iter = cache_index_lookup (platform, CACHE_INDEX_ROUTE_ID, &key); iter; iter = iter->next) {
+		if (_route_match ((struct rtnl_route *) iter->data, AF_INET, 0, TRUE)) {
+			if (init_ip4_route (&route_candidate, (struct rtnl_route *) iter->data)) {
+				if (   route_candidate.metric == 0
+				    || route_candidate.metric == device_route_metric) {
 					/* There is already any route with metric 0 or the metric we want to install
 					 * for the same subnet. */
 					return FALSE;
@@ -3875,12 +5013,14 @@ ip4_route_get_all (NMPlatform *platform, int ifindex, NMPlatformGetRouteMode mod
 	GArray *routes;
 	NMPlatformIP4Route route;
 	struct nl_object *object;
+	CacheIter iter;
 
 	g_return_val_if_fail (NM_IN_SET (mode, NM_PLATFORM_GET_ROUTE_MODE_ALL, NM_PLATFORM_GET_ROUTE_MODE_NO_DEFAULT, NM_PLATFORM_GET_ROUTE_MODE_ONLY_DEFAULT), NULL);
 
 	routes = g_array_new (FALSE, FALSE, sizeof (NMPlatformIP4Route));
 
-	for (object = nl_cache_get_first (priv->route_cache); object; object = nl_cache_get_next (object)) {
+	cache_iter_init_ifindex (&iter, platform, priv->route_cache, CACHE_INDEX_ROUTE_IFINDEX, ifindex);
+	while ((object = cache_iter_next (&iter))) {
 		if (_route_match ((struct rtnl_route *) object, AF_INET, ifindex, FALSE)) {
 			if (_rtnl_route_is_default ((struct rtnl_route *) object)) {
 				if (mode == NM_PLATFORM_GET_ROUTE_MODE_NO_DEFAULT)
@@ -3904,12 +5044,14 @@ ip6_route_get_all (NMPlatform *platform, int ifindex, NMPlatformGetRouteMode mod
 	GArray *routes;
 	NMPlatformIP6Route route;
 	struct nl_object *object;
+	CacheIter iter;
 
 	g_return_val_if_fail (NM_IN_SET (mode, NM_PLATFORM_GET_ROUTE_MODE_ALL, NM_PLATFORM_GET_ROUTE_MODE_NO_DEFAULT, NM_PLATFORM_GET_ROUTE_MODE_ONLY_DEFAULT), NULL);
 
 	routes = g_array_new (FALSE, FALSE, sizeof (NMPlatformIP6Route));
 
-	for (object = nl_cache_get_first (priv->route_cache); object; object = nl_cache_get_next (object)) {
+	cache_iter_init_ifindex (&iter, platform, priv->route_cache, CACHE_INDEX_ROUTE_IFINDEX, ifindex);
+	while ((object = cache_iter_next (&iter))) {
 		if (_route_match ((struct rtnl_route *) object, AF_INET6, ifindex, FALSE)) {
 			if (_rtnl_route_is_default ((struct rtnl_route *) object)) {
 				if (mode == NM_PLATFORM_GET_ROUTE_MODE_NO_DEFAULT)
@@ -4008,16 +5150,15 @@ ip6_route_add (NMPlatform *platform, int ifindex, NMIPConfigSource source,
 }
 
 static struct rtnl_route *
-route_search_cache (struct nl_cache *cache, int family, int ifindex, const void *network, int plen, guint32 metric)
+route_search_cache (NMPlatform *platform, int family, int ifindex, const void *network, int plen, guint32 metric)
 {
-	guint32 network_clean[4], dst_clean[4];
-	struct nl_object *object;
+	CacheIndexKey key = { 0 };
+	const GList *iter;
 
-	clear_host_address (family, network, plen, network_clean);
+	cache_index_key_set_network (&key, family, network, plen);
 
-	for (object = nl_cache_get_first (cache); object; object = nl_cache_get_next (object)) {
-		struct nl_addr *dst;
-		struct rtnl_route *rtnlroute = (struct rtnl_route *) object;
+	for (iter = cache_index_lookup (platform, CACHE_INDEX_ROUTE_ID, &key); iter; iter = iter->next) {
+		struct rtnl_route *rtnlroute = iter->data;
 
 		if (!_route_match (rtnlroute, family, ifindex, FALSE))
 			continue;
@@ -4025,24 +5166,6 @@ route_search_cache (struct nl_cache *cache, int family, int ifindex, const void
 		if (metric != rtnl_route_get_priority (rtnlroute))
 			continue;
 
-		dst = rtnl_route_get_dst (rtnlroute);
-		if (   !dst
-		    || nl_addr_get_family (dst) != family
-		    || nl_addr_get_prefixlen (dst) != plen)
-			continue;
-
-		/* plen = 0 means all host bits, so all bits should be cleared.
-		 * Likewise if the binary address is not present or all zeros.
-		 */
-		if (plen == 0 || nl_addr_iszero (dst))
-			memset (dst_clean, 0, sizeof (dst_clean));
-		else
-			clear_host_address (family, nl_addr_get_binary_addr (dst), plen, dst_clean);
-
-		if (memcmp (dst_clean, network_clean,
-		            family == AF_INET ? sizeof (guint32) : sizeof (struct in6_addr)) != 0)
-			continue;
-
 		rtnl_route_get (rtnlroute);
 		return rtnlroute;
 	}
@@ -4052,11 +5175,16 @@ route_search_cache (struct nl_cache *cache, int family, int ifindex, const void
 static gboolean
 refresh_route (NMPlatform *platform, int family, int ifindex, const void *network, int plen, guint32 metric)
 {
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
 	struct nl_cache *cache;
 	auto_nl_object struct rtnl_route *cached_object = NULL;
 
+	/* A pending batch refreshes all its routes on commit. */
+	if (priv->batch)
+		return TRUE;
+
 	cache = choose_cache_by_type (platform, family == AF_INET ? OBJECT_TYPE_IP4_ROUTE : OBJECT_TYPE_IP6_ROUTE);
-	cached_object = route_search_cache (cache, family, ifindex, network, plen, metric);
+	cached_object = route_search_cache (platform, family, ifindex, network, plen, metric);
 
 	if (cached_object)
 		return refresh_object (platform, (struct nl_object *) cached_object, TRUE, NM_PLATFORM_REASON_INTERNAL);
@@ -4093,7 +5221,7 @@ ip4_route_delete (NMPlatform *platform, int ifindex, in_addr_t network, int plen
 	 * Lookup in the cache so that we hopefully get the right values. */
 	cached_object = (struct rtnl_route *) nl_cache_search (cache, route);
 	if (!cached_object)
-		cached_object = route_search_cache (cache, AF_INET, ifindex, &network, plen, metric);
+		cached_object = route_search_cache (platform, AF_INET, ifindex, &network, plen, metric);
 
 	if (!_nl_has_capability (1 /* NL_CAPABILITY_ROUTE_BUILD_MSG_SET_SCOPE */)) {
 		/* When searching for a matching IPv4 route to delete, the kernel
@@ -4157,7 +5285,7 @@ ip_route_exists (NMPlatform *platform, int family, int ifindex, gpointer network
 	auto_nl_object struct nl_object *cached_object = nl_cache_search (cache, object);
 
 	if (!cached_object)
-		cached_object = (struct nl_object *) route_search_cache (cache, family, ifindex, network, plen, metric);
+		cached_object = (struct nl_object *) route_search_cache (platform, family, ifindex, network, plen, metric);
 	return !!cached_object;
 }
 
@@ -4217,30 +5345,36 @@ init_link_cache (NMPlatform *platform)
 static void
 cache_announce_changes (NMPlatform *platform, struct nl_cache *new, struct nl_cache *old)
 {
+	GHashTable *old_objects;
 	struct nl_object *object;
 
 	if (!old)
 		return;
 
+	/* Match the objects by their identity through a hash table, so that
+	 * the diff stays linear in the size of the caches. */
+	old_objects = g_hash_table_new (cache_object_id_hash, cache_object_id_equal);
+	for (object = nl_cache_get_first (old); object; object = nl_cache_get_next (object))
+		g_hash_table_add (old_objects, object);
+
 	for (object = nl_cache_get_first (new); object; object = nl_cache_get_next (object)) {
-		struct nl_object *cached_object = nm_nl_cache_search (old, object);
+		struct nl_object *cached_object = g_hash_table_lookup (old_objects, object);
 
 		if (cached_object) {
 			ObjectType type = _nlo_get_object_type (object);
+
+			g_hash_table_remove (old_objects, cached_object);
 			if (nm_nl_object_diff (type, object, cached_object))
 				announce_object (platform, object, NM_PLATFORM_SIGNAL_CHANGED, NM_PLATFORM_REASON_EXTERNAL);
-			nl_object_put (cached_object);
 		} else
 			announce_object (platform, object, NM_PLATFORM_SIGNAL_ADDED, NM_PLATFORM_REASON_EXTERNAL);
 	}
 	for (object = nl_cache_get_first (old); object; object = nl_cache_get_next (object)) {
-		struct nl_object *cached_object = nm_nl_cache_search (new, object);
-		if (cached_object)
-			nl_object_put (cached_object);
-		else
+		if (g_hash_table_lookup (old_objects, object) == object)
 			announce_object (platform, object, NM_PLATFORM_SIGNAL_REMOVED, NM_PLATFORM_REASON_EXTERNAL);
 	}
 
+	g_hash_table_unref (old_objects);
 	nl_cache_free (old);
 }
 
@@ -4271,40 +5405,63 @@ cache_remove_unknown (struct nl_cache *cache)
 	}
 }
 
-/* Creates and populates the netlink object caches. Called upon platform init and
- * when we run out of sync (out of buffer space, netlink congestion control). In case
- * the caches already exist, it finds changed, added and removed objects, announces
- * them and destroys the old caches. */
+/* Creates and populates the netlink object caches of @classes. Called upon
+ * platform init and when we run out of sync (out of buffer space, netlink
+ * congestion control). In case the caches already exist, it finds changed,
+ * added and removed objects, announces them and destroys the old caches. */
 static void
-cache_repopulate_all (NMPlatform *platform)
+cache_repopulate (NMPlatform *platform, CacheClass classes)
 {
 	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
-	struct nl_cache *old_link_cache = priv->link_cache;
-	struct nl_cache *old_address_cache = priv->address_cache;
-	struct nl_cache *old_route_cache = priv->route_cache;
+	struct nl_cache *old_link_cache = NULL;
+	struct nl_cache *old_address_cache = NULL;
+	struct nl_cache *old_route_cache = NULL;
 	struct nl_object *object;
 
-	debug ("platform: %spopulate platform cache", old_link_cache ? "re" : "");
-
-	/* Allocate new netlink caches */
-	init_link_cache (platform);
-	rtnl_addr_alloc_cache (priv->nlh, &priv->address_cache);
-	rtnl_route_alloc_cache (priv->nlh, AF_UNSPEC, 0, &priv->route_cache);
-	g_assert (priv->link_cache && priv->address_cache && priv->route_cache);
+	debug ("platform: %spopulate platform cache:%s%s%s",
+	       priv->link_cache ? "re" : "",
+	       (classes & CACHE_CLASS_LINK) ? " links" : "",
+	       (classes & CACHE_CLASS_ADDRESS) ? " addresses" : "",
+	       (classes & CACHE_CLASS_ROUTE) ? " routes" : "");
+
+	/* Allocate new netlink caches, remove all unknown objects from them
+	 * and rebuild the indexes. */
+	if (classes & CACHE_CLASS_LINK) {
+		old_link_cache = priv->link_cache;
+		init_link_cache (platform);
+		g_assert (priv->link_cache);
+		cache_remove_unknown (priv->link_cache);
+		cache_index_rebuild (platform, OBJECT_TYPE_LINK, priv->link_cache);
+	}
 
-	/* Remove all unknown objects from the caches */
-	cache_remove_unknown (priv->link_cache);
-	cache_remove_unknown (priv->address_cache);
-	cache_remove_unknown (priv->route_cache);
+	/* The dumps supersede delayed events */
+	delayed_objects_drop (platform, NULL, classes);
+
+	if (classes & CACHE_CLASS_ADDRESS) {
+		old_address_cache = priv->address_cache;
+		rtnl_addr_alloc_cache (priv->nlh, &priv->address_cache);
+		g_assert (priv->address_cache);
+		cache_remove_unknown (priv->address_cache);
+		for (object = nl_cache_get_first (priv->address_cache); object; object = nl_cache_get_next (object))
+			_rtnl_addr_hack_lifetimes_rel_to_abs ((struct rtnl_addr *) object);
+		cache_index_rebuild (platform, OBJECT_TYPE_IP4_ADDRESS, priv->address_cache);
+	}
 
-	for (object = nl_cache_get_first (priv->address_cache); object; object = nl_cache_get_next (object)) {
-		_rtnl_addr_hack_lifetimes_rel_to_abs ((struct rtnl_addr *) object);
+	if (classes & CACHE_CLASS_ROUTE) {
+		old_route_cache = priv->route_cache;
+		rtnl_route_alloc_cache (priv->nlh, AF_UNSPEC, 0, &priv->route_cache);
+		g_assert (priv->route_cache);
+		cache_remove_unknown (priv->route_cache);
+		cache_index_rebuild (platform, OBJECT_TYPE_IP4_ROUTE, priv->route_cache);
 	}
 
 	/* Make sure all changes we've missed are announced. */
-	cache_announce_changes (platform, priv->link_cache, old_link_cache);
-	cache_announce_changes (platform, priv->address_cache, old_address_cache);
-	cache_announce_changes (platform, priv->route_cache, old_route_cache);
+	if (old_link_cache)
+		cache_announce_changes (platform, priv->link_cache, old_link_cache);
+	if (old_address_cache)
+		cache_announce_changes (platform, priv->address_cache, old_address_cache);
+	if (old_route_cache)
+		cache_announce_changes (platform, priv->route_cache, old_route_cache);
 }
 
 /******************************************************************/
@@ -4329,18 +5486,24 @@ verify_source (struct nl_msg *msg, gpointer user_data)
 	return NL_OK;
 }
 
+/* Reads and dispatches the events pending on @es. Returns %FALSE when
+ * there were none left, or they could not be read. */
 static gboolean
-event_handler (GIOChannel *channel,
-               GIOCondition io_condition,
-               gpointer user_data)
+event_socket_read (EventSocket *es)
 {
-	NMPlatform *platform = NM_PLATFORM (user_data);
-	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
 	int nle;
 
-	nle = nl_recvmsgs_default (priv->nlh_event);
+	errno = 0;
+	nle = nl_recvmsgs_default (es->nlh);
+
+	/* Work around a libnl bug fixed in 3.2.22 (375a6294) */
+	if (nle == 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		nle = -NLE_AGAIN;
+
 	if (nle < 0)
 		switch (nle) {
+		case -NLE_AGAIN:
+			break;
 		case -NLE_DUMP_INTR:
 			/* this most likely happens due to our request (RTM_GETADDR, AF_INET6, NLM_F_DUMP)
 			 * to detect support for support_kernel_extended_ifa_flags. This is not critical
@@ -4351,23 +5514,43 @@ event_handler (GIOChannel *channel,
 			warning ("Too many netlink events. Need to resynchronize platform cache");
 			/* Drain the event queue, we've lost events and are out of sync anyway and we'd
 			 * like to free up some space. We'll read in the status synchronously. */
-			nl_socket_modify_cb (priv->nlh_event, NL_CB_VALID, NL_CB_DEFAULT, NULL, NULL);
+			nl_socket_modify_cb (es->nlh, NL_CB_VALID, NL_CB_DEFAULT, NULL, NULL);
 			do {
 				errno = 0;
 
-				nle = nl_recvmsgs_default (priv->nlh_event);
+				nle = nl_recvmsgs_default (es->nlh);
 
 				/* Work around a libnl bug fixed in 3.2.22 (375a6294) */
 				if (nle == 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
 					nle = -NLE_AGAIN;
 			} while (nle != -NLE_AGAIN);
-			nl_socket_modify_cb (priv->nlh_event, NL_CB_VALID, NL_CB_CUSTOM, event_notification, user_data);
-			cache_repopulate_all (platform);
+			nl_socket_modify_cb (es->nlh, NL_CB_VALID, NL_CB_CUSTOM, event_notification, es->platform);
+
+			/* Only the object classes of this socket lost events. */
+			cache_repopulate (es->platform, es->classes);
 			break;
 		default:
 			error ("Failed to retrieve incoming events: %s (%d)", nl_geterror (nle), nle);
 			break;
 	}
+	return nle >= 0;
+}
+
+/* Dispatches the pending events of @es right away instead of waiting for
+ * the main loop. */
+static void
+event_socket_drain (EventSocket *es)
+{
+	while (event_socket_read (es))
+		;
+}
+
+static gboolean
+event_handler (GIOChannel *channel,
+               GIOCondition io_condition,
+               gpointer user_data)
+{
+	event_socket_read (user_data);
 	return TRUE;
 }
 
@@ -4404,6 +5587,65 @@ setup_socket (gboolean event, gpointer user_data)
 	return sock;
 }
 
+#define EVENT_SOCKET_RCVBUF_SIZE (8 * 1024 * 1024)
+
+static void
+event_socket_init (NMPlatform *platform, EventSocket *es, CacheClass classes)
+{
+	int size = EVENT_SOCKET_RCVBUF_SIZE;
+	int channel_flags;
+	gboolean status;
+	int nle;
+
+	es->platform = platform;
+	es->classes = classes;
+	es->nlh = setup_socket (TRUE, platform);
+	g_assert (es->nlh);
+
+	/* Bursts of events (e.g. many interfaces coming and going at once) easily
+	 * overflow the default buffer, which forces a resync of the cache.
+	 * SO_RCVBUFFORCE allows exceeding net.core.rmem_max, but requires
+	 * CAP_NET_ADMIN. */
+	if (setsockopt (nl_socket_get_fd (es->nlh), SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof (size)) < 0) {
+		nle = nl_socket_set_buffer_size (es->nlh, size, 0);
+		g_assert (!nle);
+	}
+
+	if (classes & CACHE_CLASS_LINK) {
+		nle = nl_socket_add_memberships (es->nlh, RTNLGRP_LINK, 0);
+		g_assert (!nle);
+	}
+	if (classes & CACHE_CLASS_ADDRESS) {
+		nle = nl_socket_add_memberships (es->nlh, RTNLGRP_IPV4_IFADDR, RTNLGRP_IPV6_IFADDR, 0);
+		g_assert (!nle);
+	}
+	if (classes & CACHE_CLASS_ROUTE) {
+		nle = nl_socket_add_memberships (es->nlh, RTNLGRP_IPV4_ROUTE, RTNLGRP_IPV6_ROUTE, 0);
+		g_assert (!nle);
+	}
+	debug ("Netlink socket for events established: %d", nl_socket_get_local_port (es->nlh));
+
+	es->channel = g_io_channel_unix_new (nl_socket_get_fd (es->nlh));
+	g_io_channel_set_encoding (es->channel, NULL, NULL);
+	g_io_channel_set_close_on_unref (es->channel, TRUE);
+
+	channel_flags = g_io_channel_get_flags (es->channel);
+	status = g_io_channel_set_flags (es->channel,
+		channel_flags | G_IO_FLAG_NONBLOCK, NULL);
+	g_assert (status);
+	es->watch_id = g_io_add_watch (es->channel,
+		(EVENT_CONDITIONS | ERROR_CONDITIONS | DISCONNECT_CONDITIONS),
+		event_handler, es);
+}
+
+static void
+event_socket_destroy (EventSocket *es)
+{
+	g_source_remove (es->watch_id);
+	g_io_channel_unref (es->channel);
+	nl_socket_free (es->nlh);
+}
+
 /******************************************************************/
 
 static void
@@ -4440,7 +5682,7 @@ udev_device_added (NMPlatform *platform,
 	g_hash_table_insert (priv->udev_devices, GINT_TO_POINTER (ifindex),
 	                     g_object_ref (udev_device));
 
-	rtnllink = rtnl_link_get (priv->link_cache, ifindex);
+	rtnllink = link_get_cached (platform, ifindex);
 	if (!rtnllink) {
 		debug ("(%s): udev-add: interface not known via netlink; ignoring ifindex %d...", ifname, ifindex);
 		return;
@@ -4516,6 +5758,12 @@ handle_udev_event (GUdevClient *client,
 static void
 nm_linux_platform_init (NMLinuxPlatform *platform)
 {
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	CacheIndexType idx;
+
+	for (idx = 0; idx < __CACHE_INDEX_LAST; idx++)
+		cache_index_init (&priv->cache_index[idx]);
+	priv->delayed_objects = g_ptr_array_new_with_free_func ((GDestroyNotify) nl_object_put);
 }
 
 static void
@@ -4524,8 +5772,6 @@ constructed (GObject *_object)
 	NMPlatform *platform = NM_PLATFORM (_object);
 	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
 	const char *udev_subsys[] = { "net", NULL };
-	int channel_flags;
-	gboolean status;
 	int nle;
 	GUdevEnumerator *enumerator;
 	GList *devices, *iter;
@@ -4535,36 +5781,13 @@ constructed (GObject *_object)
 	g_assert (priv->nlh);
 	debug ("Netlink socket for requests established: %d", nl_socket_get_local_port (priv->nlh));
 
-	/* Initialize netlink socket for events */
-	priv->nlh_event = setup_socket (TRUE, platform);
-	g_assert (priv->nlh_event);
-	/* The default buffer size wasn't enough for the testsuites. It might just
-	 * as well happen with NetworkManager itself. For now let's hope 128KB is
-	 * good enough.
-	 */
-	nle = nl_socket_set_buffer_size (priv->nlh_event, 131072, 0);
-	g_assert (!nle);
-	nle = nl_socket_add_memberships (priv->nlh_event,
-	                                 RTNLGRP_LINK,
-	                                 RTNLGRP_IPV4_IFADDR, RTNLGRP_IPV6_IFADDR,
-	                                 RTNLGRP_IPV4_ROUTE,  RTNLGRP_IPV6_ROUTE,
-	                                 0);
-	g_assert (!nle);
-	debug ("Netlink socket for events established: %d", nl_socket_get_local_port (priv->nlh_event));
-
-	priv->event_channel = g_io_channel_unix_new (nl_socket_get_fd (priv->nlh_event));
-	g_io_channel_set_encoding (priv->event_channel, NULL, NULL);
-	g_io_channel_set_close_on_unref (priv->event_channel, TRUE);
-
-	channel_flags = g_io_channel_get_flags (priv->event_channel);
-	status = g_io_channel_set_flags (priv->event_channel,
-		channel_flags | G_IO_FLAG_NONBLOCK, NULL);
-	g_assert (status);
-	priv->event_id = g_io_add_watch (priv->event_channel,
-		(EVENT_CONDITIONS | ERROR_CONDITIONS | DISCONNECT_CONDITIONS),
-		event_handler, platform);
+	/* Initialize netlink sockets for events */
+	event_socket_init (platform, &priv->event_sockets[EVENT_SOCKET_LINK_ADDRESS],
+	                   CACHE_CLASS_LINK | CACHE_CLASS_ADDRESS);
+	event_socket_init (platform, &priv->event_sockets[EVENT_SOCKET_ROUTE],
+	                   CACHE_CLASS_ROUTE);
 
-	cache_repopulate_all (platform);
+	cache_repopulate (platform, CACHE_CLASS_ALL);
 
 #if HAVE_LIBNL_INET6_ADDR_GEN_MODE
 	if (G_UNLIKELY (_support_user_ipv6ll == 0)) {
@@ -4587,7 +5810,7 @@ constructed (GObject *_object)
 
 	/* request all IPv6 addresses (hopeing that there is at least one), to check for
 	 * the IFA_FLAGS attribute. */
-	nle = nl_rtgen_request (priv->nlh_event, RTM_GETADDR, AF_INET6, NLM_F_DUMP);
+	nle = nl_rtgen_request (priv->event_sockets[EVENT_SOCKET_LINK_ADDRESS].nlh, RTM_GETADDR, AF_INET6, NLM_F_DUMP);
 	if (nle < 0)
 		nm_log_warn (LOGD_PLATFORM, "Netlink error: requesting RTM_GETADDR failed with %s", nl_geterror (nle));
 
@@ -4614,12 +5837,22 @@ static void
 nm_linux_platform_finalize (GObject *object)
 {
 	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (object);
+	CacheIndexType idx;
+	guint i;
 
 	/* Free netlink resources */
-	g_source_remove (priv->event_id);
-	g_io_channel_unref (priv->event_channel);
+	for (i = 0; i < __EVENT_SOCKET_LAST; i++)
+		event_socket_destroy (&priv->event_sockets[i]);
 	nl_socket_free (priv->nlh);
-	nl_socket_free (priv->nlh_event);
+	if (priv->nlh_batch)
+		nl_socket_free (priv->nlh_batch);
+	if (priv->batch)
+		g_array_unref (priv->batch);
+	if (priv->delayed_objects_id)
+		g_source_remove (priv->delayed_objects_id);
+	g_ptr_array_unref (priv->delayed_objects);
+	for (idx = 0; idx < __CACHE_INDEX_LAST; idx++)
+		cache_index_destroy (&priv->cache_index[idx]);
 	nl_cache_free (priv->link_cache);
 	nl_cache_free (priv->address_cache);
 	nl_cache_free (priv->route_cache);
@@ -4745,6 +5978,10 @@ nm_linux_platform_class_init (NMLinuxPlatformClass *klass)
 	platform_class->ip4_route_exists = ip4_route_exists;
 	platform_class->ip6_route_exists = ip6_route_exists;
 
+	platform_class->batch_begin = batch_begin;
+	platform_class->batch_get_length = batch_get_length;
+	platform_class->batch_commit = batch_commit;
+
 	platform_class->check_support_kernel_extended_ifa_flags = check_support_kernel_extended_ifa_flags;
 	platform_class->check_support_user_ipv6ll = check_support_user_ipv6ll;
 }
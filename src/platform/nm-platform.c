@@ -2102,6 +2102,93 @@ nm_platform_ip4_check_reinstall_device_route (NMPlatform *self, int ifindex, con
 	return klass->ip4_check_reinstall_device_route (self, ifindex, address, device_route_metric);
 }
 
+/**
+ * nm_platform_batch_begin:
+ * @self: platform instance
+ *
+ * Starts a batch of address and route changes. Until nm_platform_batch_commit()
+ * is called, adding and deleting addresses and routes only sends the request
+ * and returns %TRUE without waiting for the result, and the platform cache is
+ * not updated.
+ *
+ * Returns: %TRUE if a batch was started, %FALSE if the platform does not
+ *   support batching. In that case changes stay synchronous and
+ *   nm_platform_batch_commit() must not be called.
+ */
+gboolean
+nm_platform_batch_begin (NMPlatform *self)
+{
+	_CHECK_SELF (self, klass, FALSE);
+	reset_error (self);
+
+	if (!klass->batch_begin)
+		return FALSE;
+
+	return klass->batch_begin (self);
+}
+
+/**
+ * nm_platform_batch_get_length:
+ * @self: platform instance
+ *
+ * Returns: the number of operations queued in the current batch. This is
+ *   the index that the next queued operation will have in the results of
+ *   nm_platform_batch_commit().
+ */
+guint
+nm_platform_batch_get_length (NMPlatform *self)
+{
+	_CHECK_SELF (self, klass, 0);
+
+	if (!klass->batch_get_length)
+		return 0;
+
+	return klass->batch_get_length (self);
+}
+
+/**
+ * nm_platform_batch_commit:
+ * @self: platform instance
+ * @out_results: (allow-none): on return, a #GArray of #gboolean with
+ *   the result of each queued operation, in queue order
+ *
+ * Waits for the results of all operations of the current batch and
+ * updates the platform cache.
+ *
+ * Returns: %TRUE if all operations succeeded.
+ */
+gboolean
+nm_platform_batch_commit (NMPlatform *self, GArray **out_results)
+{
+	_CHECK_SELF (self, klass, FALSE);
+	reset_error (self);
+
+	g_return_val_if_fail (klass->batch_commit, FALSE);
+
+	return klass->batch_commit (self, out_results);
+}
+
+/* Commits the batch, if any, and checks the results of the operations
+ * whose indexes are in @checked_ops. Frees @checked_ops. */
+static gboolean
+_address_sync_commit (NMPlatform *self, gboolean batch, GArray *checked_ops)
+{
+	GArray *results = NULL;
+	gboolean success = TRUE;
+	guint i;
+
+	if (batch) {
+		nm_platform_batch_commit (self, &results);
+		for (i = 0; i < checked_ops->len; i++) {
+			if (!g_array_index (results, gboolean, g_array_index (checked_ops, guint, i)))
+				success = FALSE;
+		}
+		g_array_unref (results);
+	}
+	g_array_unref (checked_ops);
+	return success;
+}
+
 /**
  * nm_platform_ip4_address_sync:
  * @self: platform instance
@@ -2122,10 +2209,18 @@ nm_platform_ip4_address_sync (NMPlatform *self, int ifindex, const GArray *known
 	GArray *addresses;
 	NMPlatformIP4Address *address;
 	guint32 now = nm_utils_get_monotonic_timestamp_s ();
+	GArray *add_ops;
+	gboolean batch;
+	gboolean success = TRUE;
 	int i;
 
 	_CHECK_SELF (self, klass, FALSE);
 
+	/* Send all changes at once, see nm_platform_batch_begin(). Only the
+	 * results of adding addresses matter for our return value. */
+	batch = nm_platform_batch_begin (self);
+	add_ops = g_array_new (FALSE, FALSE, sizeof (guint));
+
 	/* Delete unknown addresses */
 	addresses = nm_platform_ip4_address_get_all (self, ifindex);
 	for (i = 0; i < addresses->len; i++) {
@@ -2136,14 +2231,21 @@ nm_platform_ip4_address_sync (NMPlatform *self, int ifindex, const GArray *known
 	}
 	g_array_free (addresses, TRUE);
 
-	if (!known_addresses)
-		return TRUE;
+	/* nm_platform_ip4_check_reinstall_device_route() looks at the cache, which
+	 * must not contain the addresses and prefix routes deleted above anymore.
+	 * Otherwise replacing an address within the same subnet would find the old
+	 * device route and keep the kernel's route with metric 0. */
+	if (batch) {
+		nm_platform_batch_commit (self, NULL);
+		batch = nm_platform_batch_begin (self);
+	}
 
 	/* Add missing addresses */
-	for (i = 0; i < known_addresses->len; i++) {
+	for (i = 0; known_addresses && i < known_addresses->len; i++) {
 		const NMPlatformIP4Address *known_address = &g_array_index (known_addresses, NMPlatformIP4Address, i);
 		guint32 lifetime, preferred;
 		guint32 network;
+		guint op;
 		gboolean reinstall_device_route = FALSE;
 
 		/* add a padding of 5 seconds to avoid potential races. */
@@ -2153,8 +2255,12 @@ nm_platform_ip4_address_sync (NMPlatform *self, int ifindex, const GArray *known
 		if (nm_platform_ip4_check_reinstall_device_route (self, ifindex, known_address, device_route_metric))
 			reinstall_device_route = TRUE;
 
-		if (!nm_platform_ip4_address_add (self, ifindex, known_address->address, known_address->peer_address, known_address->plen, lifetime, preferred, known_address->label))
-			return FALSE;
+		op = nm_platform_batch_get_length (self);
+		g_array_append_val (add_ops, op);
+		if (!nm_platform_ip4_address_add (self, ifindex, known_address->address, known_address->peer_address, known_address->plen, lifetime, preferred, known_address->label)) {
+			success = FALSE;
+			break;
+		}
 
 		if (reinstall_device_route) {
 			/* Kernel automatically adds a device route for us with metric 0. That is not what we want.
@@ -2164,6 +2270,9 @@ nm_platform_ip4_address_sync (NMPlatform *self, int ifindex, const GArray *known
 			 * this is a problem. Surprisingly, kernel is able to add two routes for the same subnet/prefix,metric
 			 * to different interfaces. We cannot. Adding one, would replace the other. This is avoided
 			 * by the above nm_platform_ip4_check_reinstall_device_route() check.
+			 *
+			 * In a batch, the kernel processes the requests in order, so the
+			 * address (and its device route) already exists at this point.
 			 */
 			network = nm_utils_ip4_address_clear_host_address (known_address->address, known_address->plen);
 			(void) nm_platform_ip4_route_add (self, ifindex, NM_IP_CONFIG_SOURCE_KERNEL, network, known_address->plen,
@@ -2173,7 +2282,7 @@ nm_platform_ip4_address_sync (NMPlatform *self, int ifindex, const GArray *known
 		}
 	}
 
-	return TRUE;
+	return _address_sync_commit (self, batch, add_ops) && success;
 }
 
 /**
@@ -2195,8 +2304,16 @@ nm_platform_ip6_address_sync (NMPlatform *self, int ifindex, const GArray *known
 	GArray *addresses;
 	NMPlatformIP6Address *address;
 	guint32 now = nm_utils_get_monotonic_timestamp_s ();
+	GArray *add_ops;
+	gboolean batch;
+	gboolean success = TRUE;
 	int i;
 
+	_CHECK_SELF (self, klass, FALSE);
+
+	batch = nm_platform_batch_begin (self);
+	add_ops = g_array_new (FALSE, FALSE, sizeof (guint));
+
 	/* Delete unknown addresses */
 	addresses = nm_platform_ip6_address_get_all (self, ifindex);
 	for (i = 0; i < addresses->len; i++) {
@@ -2211,25 +2328,27 @@ nm_platform_ip6_address_sync (NMPlatform *self, int ifindex, const GArray *known
 	}
 	g_array_free (addresses, TRUE);
 
-	if (!known_addresses)
-		return TRUE;
-
 	/* Add missing addresses */
-	for (i = 0; i < known_addresses->len; i++) {
+	for (i = 0; known_addresses && i < known_addresses->len; i++) {
 		const NMPlatformIP6Address *known_address = &g_array_index (known_addresses, NMPlatformIP6Address, i);
 		guint32 lifetime, preferred;
+		guint op;
 
 		/* add a padding of 5 seconds to avoid potential races. */
 		if (!_address_get_lifetime ((NMPlatformIPAddress *) known_address, now, 5, &lifetime, &preferred))
 			continue;
 
+		op = nm_platform_batch_get_length (self);
+		g_array_append_val (add_ops, op);
 		if (!nm_platform_ip6_address_add (self, ifindex, known_address->address,
 		                                  known_address->peer_address, known_address->plen,
-		                                  lifetime, preferred, known_address->flags))
-			return FALSE;
+		                                  lifetime, preferred, known_address->flags)) {
+			success = FALSE;
+			break;
+		}
 	}
 
-	return TRUE;
+	return _address_sync_commit (self, batch, add_ops) && success;
 }
 
 gboolean
@@ -494,6 +494,10 @@ typedef struct {
 	gboolean (*ip4_route_exists) (NMPlatform *, int ifindex, in_addr_t network, int plen, guint32 metric);
 	gboolean (*ip6_route_exists) (NMPlatform *, int ifindex, struct in6_addr network, int plen, guint32 metric);
 
+	gboolean (*batch_begin) (NMPlatform *);
+	guint (*batch_get_length) (NMPlatform *);
+	gboolean (*batch_commit) (NMPlatform *, GArray **out_results);
+
 	gboolean (*check_support_kernel_extended_ifa_flags) (NMPlatform *);
 	gboolean (*check_support_user_ipv6ll) (NMPlatform *);
 } NMPlatformClass;
@@ -661,6 +665,10 @@ gboolean nm_platform_ip6_route_delete (NMPlatform *self, int ifindex, struct in6
 gboolean nm_platform_ip4_route_exists (NMPlatform *self, int ifindex, in_addr_t network, int plen, guint32 metric);
 gboolean nm_platform_ip6_route_exists (NMPlatform *self, int ifindex, struct in6_addr network, int plen, guint32 metric);
 
+gboolean nm_platform_batch_begin (NMPlatform *self);
+guint nm_platform_batch_get_length (NMPlatform *self);
+gboolean nm_platform_batch_commit (NMPlatform *self, GArray **out_results);
+
 const char *nm_platform_link_to_string (const NMPlatformLink *link);
 const char *nm_platform_ip4_address_to_string (const NMPlatformIP4Address *address);
 const char *nm_platform_ip6_address_to_string (const NMPlatformIP6Address *address);
@@ -1,6 +1,7 @@
 #include "config.h"
 
 #include "test-common.h"
+#include "NetworkManagerUtils.h"
 
 #define DEVICE_NAME "nm-test-device"
 #define IP4_ADDRESS "192.0.2.1"
@@ -242,6 +243,46 @@ test_ip6_address_external (void)
 	free_signal (address_removed);
 }
 
+static void
+test_ip4_address_sync_same_subnet (void)
+{
+	int ifindex = nm_platform_link_get_ifindex (NM_PLATFORM_GET, DEVICE_NAME);
+	GArray *known_addresses;
+	NMPlatformIP4Address address = { 0 };
+	in_addr_t addr1, addr2, network;
+	guint32 metric = 100;
+
+	inet_pton (AF_INET, "192.0.2.2", &addr1);
+	inet_pton (AF_INET, "192.0.2.3", &addr2);
+	network = nm_utils_ip4_address_clear_host_address (addr1, IP4_PLEN);
+
+	g_assert (nm_platform_link_set_up (NM_PLATFORM_GET, ifindex));
+
+	known_addresses = g_array_new (FALSE, FALSE, sizeof (NMPlatformIP4Address));
+	address.ifindex = ifindex;
+	address.address = addr1;
+	address.plen = IP4_PLEN;
+	g_array_append_val (known_addresses, address);
+
+	g_assert (nm_platform_ip4_address_sync (NM_PLATFORM_GET, ifindex, known_addresses, metric));
+	g_assert (nm_platform_ip4_route_exists (NM_PLATFORM_GET, ifindex, network, IP4_PLEN, metric));
+	g_assert (!nm_platform_ip4_route_exists (NM_PLATFORM_GET, ifindex, network, IP4_PLEN, 0));
+
+	/* Replace the address by another one in the same subnet, like a DHCP
+	 * renewal with a new address would. The prefix route must again get
+	 * the device route metric. */
+	g_array_index (known_addresses, NMPlatformIP4Address, 0).address = addr2;
+	g_assert (nm_platform_ip4_address_sync (NM_PLATFORM_GET, ifindex, known_addresses, metric));
+	g_assert (!nm_platform_ip4_address_exists (NM_PLATFORM_GET, ifindex, addr1, IP4_PLEN));
+	g_assert (nm_platform_ip4_address_exists (NM_PLATFORM_GET, ifindex, addr2, IP4_PLEN));
+	g_assert (nm_platform_ip4_route_exists (NM_PLATFORM_GET, ifindex, network, IP4_PLEN, metric));
+	g_assert (!nm_platform_ip4_route_exists (NM_PLATFORM_GET, ifindex, network, IP4_PLEN, 0));
+
+	g_array_set_size (known_addresses, 0);
+	g_assert (nm_platform_ip4_address_sync (NM_PLATFORM_GET, ifindex, known_addresses, metric));
+	g_array_unref (known_addresses);
+}
+
 void
 init_tests (int *argc, char ***argv)
 {
@@ -265,5 +306,6 @@ setup_tests (void)
 	if (strcmp (g_type_name (G_TYPE_FROM_INSTANCE (nm_platform_get ())), "NMFakePlatform")) {
 		g_test_add_func ("/address/external/ip4", test_ip4_address_external);
 		g_test_add_func ("/address/external/ip6", test_ip6_address_external);
+		g_test_add_func ("/address/sync/ip4-same-subnet", test_ip4_address_sync_same_subnet);
 	}
 }
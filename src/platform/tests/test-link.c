@@ -15,6 +15,10 @@
 #define VLAN_ID 4077
 #define VLAN_FLAGS 0
 #define MTU 1357
+#define IP4_ADDRESS "192.0.2.1"
+#define IP4_NETWORK "198.51.100.0"
+#define IP4_PLEN 24
+#define ROUTE_METRIC 22988
 
 static void
 test_bogus(void)
@@ -401,6 +405,7 @@ test_internal (void)
 	const char mac[6] = { 0x00, 0xff, 0x11, 0xee, 0x22, 0xdd };
 	const char *address;
 	size_t addrlen;
+	NMPlatformLink plink;
 	int ifindex;
 
 	/* Check the functions for non-existent devices */
@@ -458,6 +463,8 @@ test_internal (void)
 	g_assert (!memcmp (address, mac, addrlen));
 	address = nm_platform_link_get_address (NM_PLATFORM_GET, ifindex, NULL);
 	g_assert (!memcmp (address, mac, addrlen));
+	g_assert (nm_platform_link_get_by_address (NM_PLATFORM_GET, mac, sizeof (mac), &plink));
+	g_assert_cmpint (plink.ifindex, ==, ifindex);
 	accept_signal (link_changed);
 
 	/* Set MTU */
@@ -546,6 +553,114 @@ test_external (void)
 	free_signal (link_removed);
 }
 
+/* The per-interface listings are served from the ifindex indexes, the
+ * existence checks from the address and route indexes, and the listing of
+ * all routes from the cache itself. All of them must agree. */
+static void
+assert_ip4_indexed (int ifindex, in_addr_t addr, in_addr_t network, gboolean exists)
+{
+	GArray *addresses, *routes;
+	guint i, n_found = 0, n_ifindex = 0;
+
+	addresses = nm_platform_ip4_address_get_all (NM_PLATFORM_GET, ifindex);
+	g_assert (addresses);
+	for (i = 0; i < addresses->len; i++) {
+		NMPlatformIP4Address *address = &g_array_index (addresses, NMPlatformIP4Address, i);
+
+		g_assert_cmpint (address->ifindex, ==, ifindex);
+		if (address->address == addr && address->plen == IP4_PLEN)
+			n_found++;
+	}
+	g_assert_cmpint (n_found, ==, exists ? 1 : 0);
+	g_assert (!nm_platform_ip4_address_exists (NM_PLATFORM_GET, ifindex, addr, IP4_PLEN) == !exists);
+	g_array_unref (addresses);
+
+	n_found = 0;
+	routes = nm_platform_ip4_route_get_all (NM_PLATFORM_GET, ifindex, NM_PLATFORM_GET_ROUTE_MODE_ALL);
+	g_assert (routes);
+	for (i = 0; i < routes->len; i++) {
+		NMPlatformIP4Route *route = &g_array_index (routes, NMPlatformIP4Route, i);
+
+		g_assert_cmpint (route->ifindex, ==, ifindex);
+		if (route->network == network && route->plen == IP4_PLEN && route->metric == ROUTE_METRIC)
+			n_found++;
+	}
+	g_assert_cmpint (n_found, ==, exists ? 1 : 0);
+	g_assert (!nm_platform_ip4_route_exists (NM_PLATFORM_GET, ifindex, network, IP4_PLEN, ROUTE_METRIC) == !exists);
+	n_found = routes->len;
+	g_array_unref (routes);
+
+	routes = nm_platform_ip4_route_get_all (NM_PLATFORM_GET, 0, NM_PLATFORM_GET_ROUTE_MODE_ALL);
+	g_assert (routes);
+	for (i = 0; i < routes->len; i++) {
+		if (g_array_index (routes, NMPlatformIP4Route, i).ifindex == ifindex)
+			n_ifindex++;
+	}
+	g_assert_cmpint (n_ifindex, ==, n_found);
+	g_array_unref (routes);
+}
+
+static void
+test_indexes (void)
+{
+	const char mac[6] = { 0x00, 0xff, 0x11, 0xee, 0x22, 0xdd };
+	const char mac2[6] = { 0x00, 0xff, 0x11, 0xee, 0x22, 0xde };
+	NMPlatformLink plink;
+	in_addr_t addr, network;
+	int ifindex;
+
+	inet_pton (AF_INET, IP4_ADDRESS, &addr);
+	inet_pton (AF_INET, IP4_NETWORK, &network);
+
+	/* Add */
+	g_assert (nm_platform_dummy_add (NM_PLATFORM_GET, DEVICE_NAME, NULL));
+	ifindex = nm_platform_link_get_ifindex (NM_PLATFORM_GET, DEVICE_NAME);
+	g_assert (ifindex > 0);
+	g_assert (nm_platform_link_set_address (NM_PLATFORM_GET, ifindex, mac, sizeof (mac)));
+	g_assert (nm_platform_link_set_up (NM_PLATFORM_GET, ifindex));
+	g_assert (nm_platform_link_get_by_address (NM_PLATFORM_GET, mac, sizeof (mac), &plink));
+	g_assert_cmpint (plink.ifindex, ==, ifindex);
+
+	assert_ip4_indexed (ifindex, addr, network, FALSE);
+	g_assert (nm_platform_ip4_address_add (NM_PLATFORM_GET, ifindex, addr, 0, IP4_PLEN,
+	                                       NM_PLATFORM_LIFETIME_PERMANENT, NM_PLATFORM_LIFETIME_PERMANENT, NULL));
+	g_assert (nm_platform_ip4_route_add (NM_PLATFORM_GET, ifindex, NM_IP_CONFIG_SOURCE_USER,
+	                                     network, IP4_PLEN, INADDR_ANY, 0, ROUTE_METRIC, 0));
+	assert_ip4_indexed (ifindex, addr, network, TRUE);
+
+	/* Change: the link moves to its new address, the changed address and
+	 * route replace the old ones */
+	g_assert (nm_platform_link_set_address (NM_PLATFORM_GET, ifindex, mac2, sizeof (mac2)));
+	g_assert (!nm_platform_link_get_by_address (NM_PLATFORM_GET, mac, sizeof (mac), &plink));
+	g_assert (nm_platform_link_get_by_address (NM_PLATFORM_GET, mac2, sizeof (mac2), &plink));
+	g_assert_cmpint (plink.ifindex, ==, ifindex);
+	g_assert (nm_platform_link_set_mtu (NM_PLATFORM_GET, ifindex, MTU));
+	g_assert_cmpint (nm_platform_link_get_ifindex (NM_PLATFORM_GET, DEVICE_NAME), ==, ifindex);
+
+	g_assert (nm_platform_ip4_address_add (NM_PLATFORM_GET, ifindex, addr, 0, IP4_PLEN, 2000, 1000, NULL));
+	g_assert (nm_platform_ip4_route_add (NM_PLATFORM_GET, ifindex, NM_IP_CONFIG_SOURCE_USER,
+	                                     network, IP4_PLEN, INADDR_ANY, 0, ROUTE_METRIC, 1000));
+	assert_ip4_indexed (ifindex, addr, network, TRUE);
+
+	/* Delete */
+	g_assert (nm_platform_ip4_route_delete (NM_PLATFORM_GET, ifindex, network, IP4_PLEN, ROUTE_METRIC));
+	g_assert (nm_platform_ip4_address_delete (NM_PLATFORM_GET, ifindex, addr, IP4_PLEN, 0));
+	assert_ip4_indexed (ifindex, addr, network, FALSE);
+
+	/* Remove the link while its address and route are still indexed */
+	g_assert (nm_platform_ip4_address_add (NM_PLATFORM_GET, ifindex, addr, 0, IP4_PLEN,
+	                                       NM_PLATFORM_LIFETIME_PERMANENT, NM_PLATFORM_LIFETIME_PERMANENT, NULL));
+	g_assert (nm_platform_ip4_route_add (NM_PLATFORM_GET, ifindex, NM_IP_CONFIG_SOURCE_USER,
+	                                     network, IP4_PLEN, INADDR_ANY, 0, ROUTE_METRIC, 0));
+	assert_ip4_indexed (ifindex, addr, network, TRUE);
+
+	g_assert (nm_platform_link_delete (NM_PLATFORM_GET, ifindex));
+	g_assert (!nm_platform_link_get (NM_PLATFORM_GET, ifindex, &plink));
+	g_assert (!nm_platform_link_get_ifindex (NM_PLATFORM_GET, DEVICE_NAME));
+	g_assert (!nm_platform_link_get_by_address (NM_PLATFORM_GET, mac2, sizeof (mac2), &plink));
+	assert_ip4_indexed (ifindex, addr, network, FALSE);
+}
+
 void
 init_tests (int *argc, char ***argv)
 {
@@ -565,6 +680,7 @@ setup_tests (void)
 	g_test_add_func ("/link/bogus", test_bogus);
 	g_test_add_func ("/link/loopback", test_loopback);
 	g_test_add_func ("/link/internal", test_internal);
+	g_test_add_func ("/link/indexes", test_indexes);
 	g_test_add_func ("/link/software/bridge", test_bridge);
 	g_test_add_func ("/link/software/bond", test_bond);
 	g_test_add_func ("/link/software/team", test_team);
@@ -38,6 +38,7 @@
 #include "nm-properties-changed-signal.h"
 #include "nm-core-internal.h"
 #include "nm-glib-compat.h"
+#include "nm-settings-utils.h"
 
 #define SETTINGS_TIMESTAMPS_FILE  NMSTATEDIR "/timestamps"
 #define SETTINGS_SEEN_BSSIDS_FILE NMSTATEDIR "/seen-bssids"
@@ -85,6 +86,7 @@ enum {
 	PROP_READY,
 	PROP_FLAGS,
 	PROP_FILENAME,
+	PROP_TIMESTAMP,
 };
 
 enum {
@@ -627,40 +629,49 @@ nm_settings_connection_delete (NMSettingsConnection *connection,
 	}
 }
 
-static void
-remove_entry_from_db (NMSettingsConnection *connection, const char* db_name)
-{
-	GKeyFile *key_file;
-	const char *db_file;
+/**************************************************************/
 
-	if (strcmp (db_name, "timestamps") == 0)
-		db_file = SETTINGS_TIMESTAMPS_FILE;
-	else if (strcmp (db_name, "seen-bssids") == 0)
-		db_file = SETTINGS_SEEN_BSSIDS_FILE;
-	else
-		return;
+/* The timestamps and seen-bssids databases are kept in memory and written
+ * back after a short delay, and on shutdown via
+ * nm_settings_connection_flush_databases(). */
 
-	key_file = g_key_file_new ();
-	if (g_key_file_load_from_file (key_file, db_file, G_KEY_FILE_KEEP_COMMENTS, NULL)) {
-		const char *connection_uuid;
-		char *data;
-		gsize len;
-		GError *error = NULL;
+#define STATE_DB_FLUSH_DELAY_SEC 5
 
-		connection_uuid = nm_connection_get_uuid (NM_CONNECTION (connection));
+static NMSettingsStateDB state_db_timestamps = {
+	.filename = SETTINGS_TIMESTAMPS_FILE,
+	.group = "timestamps",
+	.flush_delay = STATE_DB_FLUSH_DELAY_SEC,
+};
 
-		g_key_file_remove_key (key_file, db_name, connection_uuid, NULL);
-		data = g_key_file_to_data (key_file, &len, &error);
-		if (data) {
-			g_file_set_contents (db_file, data, len, &error);
-			g_free (data);
-		}
-		if (error) {
-			nm_log_warn (LOGD_SETTINGS, "error writing %s file '%s': %s", db_name, db_file, error->message);
-			g_error_free (error);
-		}
-	}
-	g_key_file_free (key_file);
+static NMSettingsStateDB state_db_seen_bssids = {
+	.filename = SETTINGS_SEEN_BSSIDS_FILE,
+	.group = "seen-bssids",
+	.list_separator = ',',
+	.flush_delay = STATE_DB_FLUSH_DELAY_SEC,
+};
+
+/**
+ * nm_settings_connection_flush_databases:
+ *
+ * Writes pending changes of the timestamps and seen-bssids databases
+ * to disk.
+ **/
+void
+nm_settings_connection_flush_databases (void)
+{
+	nm_settings_state_db_flush (&state_db_timestamps);
+	nm_settings_state_db_flush (&state_db_seen_bssids);
+}
+
+static void
+remove_entry_from_db (NMSettingsConnection *connection, NMSettingsStateDB *db)
+{
+	GKeyFile *key_file = nm_settings_state_db_get (db);
+	const char *connection_uuid;
+
+	connection_uuid = nm_connection_get_uuid (NM_CONNECTION (connection));
+	if (g_key_file_remove_key (key_file, db->group, connection_uuid, NULL))
+		nm_settings_state_db_changed (db);
 }
 
 static void
@@ -681,10 +692,10 @@ do_delete (NMSettingsConnection *connection,
 	g_object_unref (for_agents);
 
 	/* Remove timestamp from timestamps database file */
-	remove_entry_from_db (connection, "timestamps");
+	remove_entry_from_db (connection, &state_db_timestamps);
 
 	/* Remove connection from seen-bssids database file */
-	remove_entry_from_db (connection, "seen-bssids");
+	remove_entry_from_db (connection, &state_db_seen_bssids);
 
 	nm_settings_connection_signal_remove (connection);
 
@@ -1851,43 +1862,27 @@ nm_settings_connection_update_timestamp (NMSettingsConnection *connection,
 {
 	NMSettingsConnectionPrivate *priv = NM_SETTINGS_CONNECTION_GET_PRIVATE (connection);
 	const char *connection_uuid;
-	GKeyFile *timestamps_file;
-	char *data, *tmp;
-	gsize len;
-	GError *error = NULL;
+	char *tmp;
 
 	g_return_if_fail (NM_IS_SETTINGS_CONNECTION (connection));
 
 	/* Update timestamp in private storage */
-	priv->timestamp = timestamp;
 	priv->timestamp_set = TRUE;
+	if (priv->timestamp != timestamp) {
+		priv->timestamp = timestamp;
+		g_object_notify (G_OBJECT (connection), NM_SETTINGS_CONNECTION_TIMESTAMP);
+	}
 
 	if (flush_to_disk == FALSE)
 		return;
 
-	/* Save timestamp to timestamps database file */
-	timestamps_file = g_key_file_new ();
-	if (!g_key_file_load_from_file (timestamps_file, SETTINGS_TIMESTAMPS_FILE, G_KEY_FILE_KEEP_COMMENTS, &error)) {
-		if (!(error->domain == G_FILE_ERROR && error->code == G_FILE_ERROR_NOENT))
-			nm_log_warn (LOGD_SETTINGS, "error parsing timestamps file '%s': %s", SETTINGS_TIMESTAMPS_FILE, error->message);
-		g_clear_error (&error);
-	}
-
+	/* Save timestamp to timestamps database */
 	connection_uuid = nm_connection_get_uuid (NM_CONNECTION (connection));
 	tmp = g_strdup_printf ("%" G_GUINT64_FORMAT, timestamp);
-	g_key_file_set_value (timestamps_file, "timestamps", connection_uuid, tmp);
+	g_key_file_set_value (nm_settings_state_db_get (&state_db_timestamps), state_db_timestamps.group, connection_uuid, tmp);
 	g_free (tmp);
- 
-	data = g_key_file_to_data (timestamps_file, &len, &error);
-	if (data) {
-		g_file_set_contents (SETTINGS_TIMESTAMPS_FILE, data, len, &error);
-		g_free (data);
-	}
-	if (error) {
-		nm_log_warn (LOGD_SETTINGS, "error saving timestamp to file '%s': %s", SETTINGS_TIMESTAMPS_FILE, error->message);
-		g_error_free (error);
-	}
-	g_key_file_free (timestamps_file);
+
+	nm_settings_state_db_changed (&state_db_timestamps);
 }
 
 /**
@@ -1903,17 +1898,14 @@ nm_settings_connection_read_and_fill_timestamp (NMSettingsConnection *connection
 	NMSettingsConnectionPrivate *priv = NM_SETTINGS_CONNECTION_GET_PRIVATE (connection);
 	const char *connection_uuid;
 	guint64 timestamp = 0;
-	GKeyFile *timestamps_file;
 	GError *err = NULL;
 	char *tmp_str;
 
 	g_return_if_fail (NM_IS_SETTINGS_CONNECTION (connection));
 
-	/* Get timestamp from database file */
-	timestamps_file = g_key_file_new ();
-	g_key_file_load_from_file (timestamps_file, SETTINGS_TIMESTAMPS_FILE, G_KEY_FILE_KEEP_COMMENTS, NULL);
+	/* Get timestamp from database */
 	connection_uuid = nm_connection_get_uuid (NM_CONNECTION (connection));
-	tmp_str = g_key_file_get_value (timestamps_file, "timestamps", connection_uuid, &err);
+	tmp_str = g_key_file_get_value (nm_settings_state_db_get (&state_db_timestamps), state_db_timestamps.group, connection_uuid, &err);
 	if (tmp_str) {
 		timestamp = g_ascii_strtoull (tmp_str, NULL, 10);
 		g_free (tmp_str);
@@ -1928,7 +1920,6 @@ nm_settings_connection_read_and_fill_timestamp (NMSettingsConnection *connection
 		            connection_uuid, err->code, err->message);
 		g_clear_error (&err);
 	}
-	g_key_file_free (timestamps_file);
 }
 
 /**
@@ -1992,11 +1983,8 @@ nm_settings_connection_add_seen_bssid (NMSettingsConnection *connection,
 {
 	NMSettingsConnectionPrivate *priv = NM_SETTINGS_CONNECTION_GET_PRIVATE (connection);
 	const char *connection_uuid;
-	GKeyFile *seen_bssids_file;
-	char *data, *bssid_str;
+	char *bssid_str;
 	const char **list;
-	gsize len;
-	GError *error = NULL;
 	GHashTableIter iter;
 	guint n;
 
@@ -2016,33 +2004,12 @@ nm_settings_connection_add_seen_bssid (NMSettingsConnection *connection,
 	while (g_hash_table_iter_next (&iter, NULL, (gpointer) &bssid_str))
 		list[n++] = bssid_str;
 
-	/* Save BSSID to seen-bssids file */
-	seen_bssids_file = g_key_file_new ();
-	g_key_file_set_list_separator (seen_bssids_file, ',');
-	if (!g_key_file_load_from_file (seen_bssids_file, SETTINGS_SEEN_BSSIDS_FILE, G_KEY_FILE_KEEP_COMMENTS, &error)) {
-		if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
-			nm_log_warn (LOGD_SETTINGS, "error parsing seen-bssids file '%s': %s",
-			             SETTINGS_SEEN_BSSIDS_FILE, error->message);
-		}
-		g_clear_error (&error);
-	}
-
+	/* Save BSSID to seen-bssids database */
 	connection_uuid = nm_connection_get_uuid (NM_CONNECTION (connection));
-	g_key_file_set_string_list (seen_bssids_file, "seen-bssids", connection_uuid, list, n);
+	g_key_file_set_string_list (nm_settings_state_db_get (&state_db_seen_bssids), state_db_seen_bssids.group, connection_uuid, list, n);
 	g_free (list);
 
-	data = g_key_file_to_data (seen_bssids_file, &len, &error);
-	if (data) {
-		g_file_set_contents (SETTINGS_SEEN_BSSIDS_FILE, data, len, &error);
-		g_free (data);
-	}
-	g_key_file_free (seen_bssids_file);
-
-	if (error) {
-		nm_log_warn (LOGD_SETTINGS, "error saving seen-bssids to file '%s': %s",
-		             SETTINGS_SEEN_BSSIDS_FILE, error->message);
-		g_error_free (error);
-	}
+	nm_settings_state_db_changed (&state_db_seen_bssids);
 }
 
 /**
@@ -2057,19 +2024,14 @@ nm_settings_connection_read_and_fill_seen_bssids (NMSettingsConnection *connecti
 {
 	NMSettingsConnectionPrivate *priv = NM_SETTINGS_CONNECTION_GET_PRIVATE (connection);
 	const char *connection_uuid;
-	GKeyFile *seen_bssids_file;
 	char **tmp_strv = NULL;
 	gsize i, len = 0;
 	NMSettingWireless *s_wifi;
 
-	/* Get seen BSSIDs from database file */
-	seen_bssids_file = g_key_file_new ();
-	g_key_file_set_list_separator (seen_bssids_file, ',');
-	if (g_key_file_load_from_file (seen_bssids_file, SETTINGS_SEEN_BSSIDS_FILE, G_KEY_FILE_KEEP_COMMENTS, NULL)) {
-		connection_uuid = nm_connection_get_uuid (NM_CONNECTION (connection));
-		tmp_strv = g_key_file_get_string_list (seen_bssids_file, "seen-bssids", connection_uuid, &len, NULL);
-	}
-	g_key_file_free (seen_bssids_file);
+	/* Get seen BSSIDs from database */
+	connection_uuid = nm_connection_get_uuid (NM_CONNECTION (connection));
+	tmp_strv = g_key_file_get_string_list (nm_settings_state_db_get (&state_db_seen_bssids), state_db_seen_bssids.group,
+	                                       connection_uuid, &len, NULL);
 
 	/* Update connection's seen-bssids */
 	if (tmp_strv) {
@@ -2350,6 +2312,9 @@ get_property (GObject *object, guint prop_id,
 	case PROP_FILENAME:
 		g_value_set_string (value, nm_settings_connection_get_filename (self));
 		break;
+	case PROP_TIMESTAMP:
+		g_value_set_uint64 (value, priv->timestamp);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -2433,6 +2398,13 @@ nm_settings_connection_class_init (NMSettingsConnectionClass *class)
 		                      G_PARAM_READWRITE |
 		                      G_PARAM_STATIC_STRINGS));
 
+	g_object_class_install_property
+		(object_class, PROP_TIMESTAMP,
+		 g_param_spec_uint64 (NM_SETTINGS_CONNECTION_TIMESTAMP, "", "",
+		                      0, G_MAXUINT64, 0,
+		                      G_PARAM_READABLE |
+		                      G_PARAM_STATIC_STRINGS));
+
 	/* Signals */
 
 	/* Emitted when the connection is changed for any reason */
@@ -51,6 +51,7 @@ G_BEGIN_DECLS
 #define NM_SETTINGS_CONNECTION_READY    "ready"
 #define NM_SETTINGS_CONNECTION_FLAGS    "flags"
 #define NM_SETTINGS_CONNECTION_FILENAME "filename"
+#define NM_SETTINGS_CONNECTION_TIMESTAMP "timestamp"
 
 
 /**
@@ -188,6 +189,8 @@ void nm_settings_connection_add_seen_bssid (NMSettingsConnection *connection,
 
 void nm_settings_connection_read_and_fill_seen_bssids (NMSettingsConnection *connection);
 
+void nm_settings_connection_flush_databases (void);
+
 int nm_settings_connection_get_autoconnect_retries (NMSettingsConnection *connection);
 void nm_settings_connection_set_autoconnect_retries (NMSettingsConnection *connection,
                                                      int retries);
@@ -0,0 +1,439 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/* NetworkManager system settings service
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright 2015 Red Hat, Inc.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <nm-setting-connection.h>
+
+#include "nm-settings-utils.h"
+#include "nm-logging.h"
+
+/**
+ * nm_settings_file_stamp_get:
+ * @path: the file
+ * @stamp: (out): the stamp of @path, zeroed if it doesn't exist
+ *
+ * Returns: %TRUE if @path could be stat()ed
+ */
+gboolean
+nm_settings_file_stamp_get (const char *path, NMSettingsFileStamp *stamp)
+{
+	struct stat st;
+
+	memset (stamp, 0, sizeof (*stamp));
+	if (stat (path, &st) != 0)
+		return FALSE;
+
+	stamp->dev = st.st_dev;
+	stamp->ino = st.st_ino;
+	stamp->size = st.st_size;
+	stamp->mtime = st.st_mtim;
+	return TRUE;
+}
+
+gboolean
+nm_settings_file_stamp_equal (const NMSettingsFileStamp *a, const NMSettingsFileStamp *b)
+{
+	return    a->dev == b->dev
+	       && a->ino == b->ino
+	       && a->size == b->size
+	       && a->mtime.tv_sec == b->mtime.tv_sec
+	       && a->mtime.tv_nsec == b->mtime.tv_nsec;
+}
+
+typedef struct {
+	GHashTable *loaded_paths;
+	GHashTable *stamps;
+} SortPathsData;
+
+static int
+sort_paths (const char **f1, const char **f2, SortPathsData *data)
+{
+	const NMSettingsFileStamp *s1, *s2;
+	gboolean c1, c2;
+	gint64 m1, m2;
+
+	c1 = !!g_hash_table_contains (data->loaded_paths, *f1);
+	c2 = !!g_hash_table_contains (data->loaded_paths, *f2);
+	if (c1 != c2)
+		return c1 ? -1 : 1;
+
+	s1 = g_hash_table_lookup (data->stamps, *f1);
+	s2 = g_hash_table_lookup (data->stamps, *f2);
+	m1 = s1 ? (gint64) s1->mtime.tv_sec : G_MININT64;
+	m2 = s2 ? (gint64) s2->mtime.tv_sec : G_MININT64;
+	if (m1 != m2)
+		return m1 > m2 ? -1 : 1;
+
+	return strcmp (*f1, *f2);
+}
+
+/**
+ * nm_settings_sort_paths:
+ * @paths: the connection files found on disk
+ * @loaded_paths: the files of the connections loaded already
+ * @stamps: filename::stamp; each value starts with the
+ *   #NMSettingsFileStamp of the file itself
+ *
+ * While reloading, plugins don't replace connections that they already
+ * loaded while iterating over the files. To have sensible, reproducible
+ * behavior, this sorts the files of loaded connections first, and the
+ * others by last modification time.
+ */
+void
+nm_settings_sort_paths (GPtrArray *paths, GHashTable *loaded_paths, GHashTable *stamps)
+{
+	SortPathsData data = { loaded_paths, stamps };
+
+	g_ptr_array_sort_with_data (paths, (GCompareDataFunc) sort_paths, &data);
+}
+
+void
+nm_settings_path_index_init (NMSettingsPathIndex *path_index)
+{
+	path_index->by_path = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	path_index->by_connection = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+}
+
+void
+nm_settings_path_index_clear (NMSettingsPathIndex *path_index)
+{
+	g_clear_pointer (&path_index->by_path, g_hash_table_destroy);
+	g_clear_pointer (&path_index->by_connection, g_hash_table_destroy);
+}
+
+/**
+ * nm_settings_path_index_update:
+ * @path_index: the index
+ * @connection: a connection of the plugin
+ * @remove: whether @connection goes away
+ *
+ * Keeps @path_index in sync with the filename of @connection, or drops
+ * @connection from it if @remove is set.
+ */
+void
+nm_settings_path_index_update (NMSettingsPathIndex *path_index,
+                               NMSettingsConnection *connection,
+                               gboolean remove)
+{
+	const char *old_path, *new_path;
+
+	old_path = g_hash_table_lookup (path_index->by_connection, connection);
+	new_path = remove ? NULL : nm_settings_connection_get_filename (connection);
+	if (!g_strcmp0 (old_path, new_path))
+		return;
+
+	if (old_path) {
+		if (g_hash_table_lookup (path_index->by_path, old_path) == connection)
+			g_hash_table_remove (path_index->by_path, old_path);
+		g_hash_table_remove (path_index->by_connection, connection);
+	}
+	if (new_path) {
+		g_hash_table_insert (path_index->by_path, g_strdup (new_path), connection);
+		g_hash_table_insert (path_index->by_connection, connection, g_strdup (new_path));
+	}
+}
+
+void
+nm_settings_uuid_index_init (NMSettingsUuidIndex *uuid_index)
+{
+	uuid_index->by_uuid = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	uuid_index->by_connection = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+}
+
+void
+nm_settings_uuid_index_clear (NMSettingsUuidIndex *uuid_index)
+{
+	GHashTableIter iter;
+	gpointer list;
+
+	if (uuid_index->by_uuid) {
+		g_hash_table_iter_init (&iter, uuid_index->by_uuid);
+		while (g_hash_table_iter_next (&iter, NULL, &list))
+			g_slist_free (list);
+	}
+	g_clear_pointer (&uuid_index->by_uuid, g_hash_table_destroy);
+	g_clear_pointer (&uuid_index->by_connection, g_hash_table_destroy);
+}
+
+/**
+ * nm_settings_uuid_index_lookup:
+ * @uuid_index: the index
+ * @uuid: a connection UUID
+ *
+ * Returns: the connection that owns @uuid, or %NULL
+ */
+NMConnection *
+nm_settings_uuid_index_lookup (NMSettingsUuidIndex *uuid_index, const char *uuid)
+{
+	GSList *list;
+
+	list = g_hash_table_lookup (uuid_index->by_uuid, uuid);
+	return list ? list->data : NULL;
+}
+
+static void
+uuid_index_remove (NMSettingsUuidIndex *uuid_index, NMConnection *connection)
+{
+	const char *uuid;
+	GSList *list;
+
+	uuid = g_hash_table_lookup (uuid_index->by_connection, connection);
+	if (!uuid)
+		return;
+
+	list = g_hash_table_lookup (uuid_index->by_uuid, uuid);
+	list = g_slist_remove (list, connection);
+	if (list)
+		g_hash_table_insert (uuid_index->by_uuid, g_strdup (uuid), list);
+	else
+		g_hash_table_remove (uuid_index->by_uuid, uuid);
+
+	g_hash_table_remove (uuid_index->by_connection, connection);
+}
+
+/**
+ * nm_settings_uuid_index_update:
+ * @uuid_index: the index
+ * @connection: a connection
+ * @remove: whether @connection goes away
+ *
+ * Keeps @uuid_index in sync with the UUID of @connection, or drops
+ * @connection from it if @remove is set.
+ *
+ * Returns: if @connection just got a UUID that another connection
+ *   already owns, that connection; otherwise %NULL.  So a conflict is
+ *   reported once, not on every change of @connection.
+ */
+NMConnection *
+nm_settings_uuid_index_update (NMSettingsUuidIndex *uuid_index,
+                               NMConnection *connection,
+                               gboolean remove)
+{
+	const char *uuid;
+	GSList *list;
+
+	uuid = remove ? NULL : nm_connection_get_uuid (connection);
+	if (!g_strcmp0 (uuid, g_hash_table_lookup (uuid_index->by_connection, connection)))
+		return NULL;
+
+	uuid_index_remove (uuid_index, connection);
+	if (!uuid)
+		return NULL;
+
+	list = g_hash_table_lookup (uuid_index->by_uuid, uuid);
+	g_hash_table_insert (uuid_index->by_uuid, g_strdup (uuid), g_slist_append (list, connection));
+	g_hash_table_insert (uuid_index->by_connection, connection, g_strdup (uuid));
+
+	return list ? list->data : NULL;
+}
+
+static int
+autoconnect_list_cmp (gconstpointer pa, gconstpointer pb, gpointer user_data)
+{
+	NMSettingsAutoconnectList *list = user_data;
+	NMConnection *a = NM_CONNECTION (pa);
+	NMSettingConnection *con_a;
+	NMConnection *b = NM_CONNECTION (pb);
+	NMSettingConnection *con_b;
+	guint64 ts_a, ts_b;
+	gboolean can_ac_a, can_ac_b;
+	gint prio_a, prio_b;
+
+	con_a = nm_connection_get_setting_connection (a);
+	g_assert (con_a);
+	con_b = nm_connection_get_setting_connection (b);
+	g_assert (con_b);
+
+	can_ac_a = !!nm_setting_connection_get_autoconnect (con_a);
+	can_ac_b = !!nm_setting_connection_get_autoconnect (con_b);
+	if (can_ac_a != can_ac_b)
+		return can_ac_a ? -1 : 1;
+
+	/* Same order as nm_utils_cmp_connection_by_autoconnect_priority() */
+	if (can_ac_a) {
+		prio_a = nm_setting_connection_get_autoconnect_priority (con_a);
+		prio_b = nm_setting_connection_get_autoconnect_priority (con_b);
+		if (prio_a != prio_b)
+			return prio_a > prio_b ? -1 : 1;
+	}
+
+	ts_a = list->get_timestamp (a);
+	ts_b = list->get_timestamp (b);
+	if (ts_a > ts_b)
+		return -1;
+	else if (ts_a == ts_b)
+		return 0;
+	return 1;
+}
+
+void
+nm_settings_autoconnect_list_init (NMSettingsAutoconnectList *list,
+                                   NMSettingsTimestampFunc get_timestamp)
+{
+	list->sequence = g_sequence_new (NULL);
+	list->iters = g_hash_table_new (g_direct_hash, g_direct_equal);
+	list->get_timestamp = get_timestamp;
+}
+
+void
+nm_settings_autoconnect_list_clear (NMSettingsAutoconnectList *list)
+{
+	g_clear_pointer (&list->iters, g_hash_table_destroy);
+	g_clear_pointer (&list->sequence, g_sequence_free);
+}
+
+/**
+ * nm_settings_autoconnect_list_update:
+ * @list: the list
+ * @connection: a connection
+ * @remove: whether @connection goes away
+ *
+ * Adds @connection to @list, or moves it to its new position after a
+ * change of its autoconnect flag, priority or timestamp.  With @remove,
+ * drops it from @list instead.
+ */
+void
+nm_settings_autoconnect_list_update (NMSettingsAutoconnectList *list,
+                                     NMConnection *connection,
+                                     gboolean remove)
+{
+	GSequenceIter *iter;
+
+	iter = g_hash_table_lookup (list->iters, connection);
+	if (remove) {
+		if (iter) {
+			g_sequence_remove (iter);
+			g_hash_table_remove (list->iters, connection);
+		}
+	} else if (iter)
+		g_sequence_sort_changed (iter, autoconnect_list_cmp, list);
+	else {
+		iter = g_sequence_insert_sorted (list->sequence, connection, autoconnect_list_cmp, list);
+		g_hash_table_insert (list->iters, connection, iter);
+	}
+}
+
+/**
+ * nm_settings_autoconnect_list_get_all:
+ * @list: the list
+ *
+ * Returns: (transfer container): the connections of @list, in order.
+ *   Free with g_slist_free().
+ */
+GSList *
+nm_settings_autoconnect_list_get_all (NMSettingsAutoconnectList *list)
+{
+	GSequenceIter *iter;
+	GSList *connections = NULL;
+
+	iter = g_sequence_get_end_iter (list->sequence);
+	while (!g_sequence_iter_is_begin (iter)) {
+		iter = g_sequence_iter_prev (iter);
+		connections = g_slist_prepend (connections, g_sequence_get (iter));
+	}
+	return connections;
+}
+
+/**
+ * nm_settings_state_db_get:
+ * @db: the database
+ *
+ * Returns: (transfer none): the content of @db, loaded from disk on the
+ *   first call.  Call nm_settings_state_db_changed() after changing it.
+ */
+GKeyFile *
+nm_settings_state_db_get (NMSettingsStateDB *db)
+{
+	GError *error = NULL;
+
+	if (db->keyfile)
+		return db->keyfile;
+
+	db->keyfile = g_key_file_new ();
+	if (db->list_separator)
+		g_key_file_set_list_separator (db->keyfile, db->list_separator);
+	if (!g_key_file_load_from_file (db->keyfile, db->filename, G_KEY_FILE_KEEP_COMMENTS, &error)) {
+		if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			nm_log_warn (LOGD_SETTINGS, "error parsing %s file '%s': %s", db->group, db->filename, error->message);
+		g_clear_error (&error);
+	}
+	return db->keyfile;
+}
+
+static gboolean
+state_db_flush_cb (gpointer user_data)
+{
+	nm_settings_state_db_flush (user_data);
+	return G_SOURCE_REMOVE;
+}
+
+void
+nm_settings_state_db_changed (NMSettingsStateDB *db)
+{
+	g_return_if_fail (db->keyfile);
+
+	if (!db->flush_id)
+		db->flush_id = g_timeout_add_seconds (db->flush_delay, state_db_flush_cb, db);
+}
+
+/**
+ * nm_settings_state_db_flush:
+ * @db: the database
+ *
+ * Writes pending changes of @db to disk now.
+ */
+void
+nm_settings_state_db_flush (NMSettingsStateDB *db)
+{
+	char *data;
+	gsize len;
+	GError *error = NULL;
+
+	if (!db->flush_id)
+		return;
+	g_source_remove (db->flush_id);
+	db->flush_id = 0;
+
+	/* g_file_set_contents() replaces the file atomically */
+	data = g_key_file_to_data (db->keyfile, &len, &error);
+	if (data) {
+		g_file_set_contents (db->filename, data, len, &error);
+		g_free (data);
+	}
+	if (error) {
+		nm_log_warn (LOGD_SETTINGS, "error writing %s file '%s': %s", db->group, db->filename, error->message);
+		g_error_free (error);
+	}
+}
+
+/**
+ * nm_settings_state_db_clear:
+ * @db: the database
+ *
+ * Flushes @db and drops its content from memory.
+ */
+void
+nm_settings_state_db_clear (NMSettingsStateDB *db)
+{
+	nm_settings_state_db_flush (db);
+	g_clear_pointer (&db->keyfile, g_key_file_free);
+}
@@ -0,0 +1,110 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/* NetworkManager system settings service
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright 2015 Red Hat, Inc.
+ */
+
+#ifndef __NM_SETTINGS_UTILS_H__
+#define __NM_SETTINGS_UTILS_H__
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <glib.h>
+
+#include "nm-settings-connection.h"
+
+/* Helpers for settings plugins that load connections from files */
+
+/* Identifies a version of a file on disk */
+typedef struct {
+	dev_t dev;
+	ino_t ino;
+	off_t size;
+	struct timespec mtime;
+} NMSettingsFileStamp;
+
+gboolean nm_settings_file_stamp_get (const char *path, NMSettingsFileStamp *stamp);
+gboolean nm_settings_file_stamp_equal (const NMSettingsFileStamp *a, const NMSettingsFileStamp *b);
+
+void nm_settings_sort_paths (GPtrArray *paths, GHashTable *loaded_paths, GHashTable *stamps);
+
+/* Finds a plugin's connections by their filename */
+typedef struct {
+	GHashTable *by_path;        /* filename::connection */
+	GHashTable *by_connection;  /* connection::filename, as indexed in by_path */
+} NMSettingsPathIndex;
+
+void nm_settings_path_index_init (NMSettingsPathIndex *path_index);
+void nm_settings_path_index_clear (NMSettingsPathIndex *path_index);
+void nm_settings_path_index_update (NMSettingsPathIndex *path_index,
+                                    NMSettingsConnection *connection,
+                                    gboolean remove);
+
+/* Finds connections by their UUID.  Misconfigured plugins may provide
+ * connections with the same UUID; the one indexed first owns it, and the
+ * next one takes over once it goes away. */
+typedef struct {
+	GHashTable *by_uuid;        /* uuid::GSList of connections, the owner first */
+	GHashTable *by_connection;  /* connection::uuid, as indexed in by_uuid */
+} NMSettingsUuidIndex;
+
+void nm_settings_uuid_index_init (NMSettingsUuidIndex *uuid_index);
+void nm_settings_uuid_index_clear (NMSettingsUuidIndex *uuid_index);
+NMConnection *nm_settings_uuid_index_lookup (NMSettingsUuidIndex *uuid_index,
+                                             const char *uuid);
+NMConnection *nm_settings_uuid_index_update (NMSettingsUuidIndex *uuid_index,
+                                             NMConnection *connection,
+                                             gboolean remove);
+
+/* Keeps connections in the order suitable for auto-connecting: first
+ * those with autoconnect=yes, then higher autoconnect priority, then the
+ * most recently used. */
+typedef guint64 (*NMSettingsTimestampFunc) (NMConnection *connection);
+
+typedef struct {
+	GSequence *sequence;
+	GHashTable *iters;          /* connection::GSequenceIter */
+	NMSettingsTimestampFunc get_timestamp;
+} NMSettingsAutoconnectList;
+
+void nm_settings_autoconnect_list_init (NMSettingsAutoconnectList *list,
+                                        NMSettingsTimestampFunc get_timestamp);
+void nm_settings_autoconnect_list_clear (NMSettingsAutoconnectList *list);
+void nm_settings_autoconnect_list_update (NMSettingsAutoconnectList *list,
+                                          NMConnection *connection,
+                                          gboolean remove);
+GSList *nm_settings_autoconnect_list_get_all (NMSettingsAutoconnectList *list);
+
+/* A keyfile database, loaded once and kept in memory.  Changes are
+ * written back to disk @flush_delay seconds after the first one, so that
+ * a burst of changes results in a single write, or when flushed. */
+typedef struct {
+	const char *filename;
+	const char *group;
+	char list_separator;
+	guint flush_delay;
+
+	GKeyFile *keyfile;
+	guint flush_id;
+} NMSettingsStateDB;
+
+GKeyFile *nm_settings_state_db_get (NMSettingsStateDB *db);
+void nm_settings_state_db_changed (NMSettingsStateDB *db);
+void nm_settings_state_db_flush (NMSettingsStateDB *db);
+void nm_settings_state_db_clear (NMSettingsStateDB *db);
+
+#endif  /* __NM_SETTINGS_UTILS_H__ */
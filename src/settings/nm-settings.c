@@ -65,6 +65,7 @@
 #include "nm-dbus-glib-types.h"
 #include "nm-settings.h"
 #include "nm-settings-connection.h"
+#include "nm-settings-utils.h"
 #include "nm-system-config-interface.h"
 #include "nm-logging.h"
 #include "nm-dbus-manager.h"
@@ -169,6 +170,10 @@ typedef struct {
 	GSList *plugins;
 	gboolean connections_loaded;
 	GHashTable *connections;
+	NMSettingsUuidIndex uuid_index;
+	NMSettingsAutoconnectList connections_sorted;
+	GHashTable *connections_by_fingerprint;
+	GHashTable *connection_fingerprints;
 	GSList *unmanaged_specs;
 	GSList *unrecognized_specs;
 	GSList *get_connections_cache;
@@ -326,22 +331,25 @@ impl_settings_list_connections (NMSettings *self,
 NMSettingsConnection *
 nm_settings_get_connection_by_uuid (NMSettings *self, const char *uuid)
 {
-	NMSettingsPrivate *priv;
-	NMSettingsConnection *candidate;
-	GHashTableIter iter;
-
 	g_return_val_if_fail (NM_IS_SETTINGS (self), NULL);
 	g_return_val_if_fail (uuid != NULL, NULL);
 
-	priv = NM_SETTINGS_GET_PRIVATE (self);
+	return (NMSettingsConnection *) nm_settings_uuid_index_lookup (&NM_SETTINGS_GET_PRIVATE (self)->uuid_index, uuid);
+}
 
-	g_hash_table_iter_init (&iter, priv->connections);
-	while (g_hash_table_iter_next (&iter, NULL, (gpointer) &candidate)) {
-		if (g_strcmp0 (uuid, nm_connection_get_uuid (NM_CONNECTION (candidate))) == 0)
-			return candidate;
-	}
+/* Returns the connections whose nm_utils_connection_get_fingerprint() equals
+ * @fingerprint, i.e. the only candidates that nm_utils_match_connection()
+ * could match to a connection with that fingerprint.
+ * Caller must free the list with g_slist_free().
+ */
+GSList *
+nm_settings_get_connections_by_fingerprint (NMSettings *self, const char *fingerprint)
+{
+	g_return_val_if_fail (NM_IS_SETTINGS (self), NULL);
+	g_return_val_if_fail (fingerprint != NULL, NULL);
 
-	return NULL;
+	return g_slist_copy (g_hash_table_lookup (NM_SETTINGS_GET_PRIVATE (self)->connections_by_fingerprint,
+	                                          fingerprint));
 }
 
 static void
@@ -391,53 +399,27 @@ error:
 	g_clear_object (&subject);
 }
 
-static int
-connection_sort (gconstpointer pa, gconstpointer pb)
+static guint64
+connection_get_timestamp (NMConnection *connection)
 {
-	NMConnection *a = NM_CONNECTION (pa);
-	NMSettingConnection *con_a;
-	NMConnection *b = NM_CONNECTION (pb);
-	NMSettingConnection *con_b;
-	guint64 ts_a = 0, ts_b = 0;
-	gboolean can_ac_a, can_ac_b;
-
-	con_a = nm_connection_get_setting_connection (a);
-	g_assert (con_a);
-	con_b = nm_connection_get_setting_connection (b);
-	g_assert (con_b);
+	guint64 timestamp = 0;
 
-	can_ac_a = !!nm_setting_connection_get_autoconnect (con_a);
-	can_ac_b = !!nm_setting_connection_get_autoconnect (con_b);
-	if (can_ac_a != can_ac_b)
-		return can_ac_a ? -1 : 1;
-
-	nm_settings_connection_get_timestamp (NM_SETTINGS_CONNECTION (pa), &ts_a);
-	nm_settings_connection_get_timestamp (NM_SETTINGS_CONNECTION (pb), &ts_b);
-	if (ts_a > ts_b)
-		return -1;
-	else if (ts_a == ts_b)
-		return 0;
-	return 1;
+	nm_settings_connection_get_timestamp (NM_SETTINGS_CONNECTION (connection), &timestamp);
+	return timestamp;
 }
 
 /* Returns a list of NMSettingsConnections.
  * The list is sorted in the order suitable for auto-connecting, i.e.
- * first go connections with autoconnect=yes and most recent timestamp.
+ * first go connections with autoconnect=yes, then higher autoconnect
+ * priority and then most recent timestamp.
  * Caller must free the list with g_slist_free().
  */
 GSList *
 nm_settings_get_connections (NMSettings *self)
 {
-	GHashTableIter iter;
-	gpointer data = NULL;
-	GSList *list = NULL;
-
 	g_return_val_if_fail (NM_IS_SETTINGS (self), NULL);
 
-	g_hash_table_iter_init (&iter, NM_SETTINGS_GET_PRIVATE (self)->connections);
-	while (g_hash_table_iter_next (&iter, NULL, &data))
-		list = g_slist_insert_sorted (list, data, connection_sort);
-	return list;
+	return nm_settings_autoconnect_list_get_all (&NM_SETTINGS_GET_PRIVATE (self)->connections_sorted);
 }
 
 NMSettingsConnection *
@@ -860,6 +842,84 @@ load_plugins (NMSettings *self, const char **plugins, GError **error)
 	return success;
 }
 
+static void
+uuid_index_update (NMSettings *self, NMSettingsConnection *connection, gboolean remove)
+{
+	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
+	NMConnection *existing;
+
+	existing = nm_settings_uuid_index_update (&priv->uuid_index, NM_CONNECTION (connection), remove);
+	if (existing) {
+		/* The first connection with the UUID keeps it */
+		nm_log_warn (LOGD_SETTINGS, "connection '%s' has the same UUID %s as '%s'",
+		             nm_connection_get_id (NM_CONNECTION (connection)),
+		             nm_connection_get_uuid (NM_CONNECTION (connection)),
+		             nm_connection_get_id (existing));
+	}
+}
+
+static void
+fingerprint_index_remove (NMSettings *self, NMSettingsConnection *connection)
+{
+	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
+	const char *fingerprint;
+	GSList *list;
+
+	fingerprint = g_hash_table_lookup (priv->connection_fingerprints, connection);
+	if (!fingerprint)
+		return;
+
+	list = g_hash_table_lookup (priv->connections_by_fingerprint, fingerprint);
+	list = g_slist_remove (list, connection);
+	if (list)
+		g_hash_table_insert (priv->connections_by_fingerprint, g_strdup (fingerprint), list);
+	else
+		g_hash_table_remove (priv->connections_by_fingerprint, fingerprint);
+
+	g_hash_table_remove (priv->connection_fingerprints, connection);
+}
+
+static void
+fingerprint_index_update (NMSettings *self, NMSettingsConnection *connection)
+{
+	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
+	char *fingerprint;
+	GSList *list;
+
+	fingerprint = nm_utils_connection_get_fingerprint (NM_CONNECTION (connection));
+	if (!g_strcmp0 (fingerprint, g_hash_table_lookup (priv->connection_fingerprints, connection))) {
+		g_free (fingerprint);
+		return;
+	}
+
+	fingerprint_index_remove (self, connection);
+
+	list = g_hash_table_lookup (priv->connections_by_fingerprint, fingerprint);
+	list = g_slist_prepend (list, connection);
+	g_hash_table_insert (priv->connections_by_fingerprint, g_strdup (fingerprint), list);
+	g_hash_table_insert (priv->connection_fingerprints, connection, fingerprint);
+}
+
+static void
+connection_changed (NMSettingsConnection *connection, gpointer user_data)
+{
+	/* NMSettingsConnection::updated is emitted from an idle handler;
+	 * refresh the indexes right away so lookups never see stale data. */
+	uuid_index_update (NM_SETTINGS (user_data), connection, FALSE);
+	nm_settings_autoconnect_list_update (&NM_SETTINGS_GET_PRIVATE (user_data)->connections_sorted,
+	                                     NM_CONNECTION (connection), FALSE);
+	fingerprint_index_update (NM_SETTINGS (user_data), connection);
+}
+
+static void
+connection_timestamp_changed (NMSettingsConnection *connection,
+                              GParamSpec *pspec,
+                              gpointer user_data)
+{
+	nm_settings_autoconnect_list_update (&NM_SETTINGS_GET_PRIVATE (user_data)->connections_sorted,
+	                                     NM_CONNECTION (connection), FALSE);
+}
+
 static void
 connection_updated (NMSettingsConnection *connection, gpointer user_data)
 {
@@ -911,12 +971,17 @@ connection_removed (NMSettingsConnection *connection, gpointer user_data)
 	 */
 
 	g_signal_handlers_disconnect_by_func (connection, G_CALLBACK (connection_removed), self);
+	g_signal_handlers_disconnect_by_func (connection, G_CALLBACK (connection_changed), self);
+	g_signal_handlers_disconnect_by_func (connection, G_CALLBACK (connection_timestamp_changed), self);
 	g_signal_handlers_disconnect_by_func (connection, G_CALLBACK (connection_updated), self);
 	g_signal_handlers_disconnect_by_func (connection, G_CALLBACK (connection_updated_by_user), self);
 	g_signal_handlers_disconnect_by_func (connection, G_CALLBACK (connection_visibility_changed), self);
 	g_signal_handlers_disconnect_by_func (connection, G_CALLBACK (connection_ready_changed), self);
 
 	/* Forget about the connection internally */
+	uuid_index_update (self, connection, TRUE);
+	nm_settings_autoconnect_list_update (&priv->connections_sorted, NM_CONNECTION (connection), TRUE);
+	fingerprint_index_remove (self, connection);
 	g_hash_table_remove (priv->connections, (gpointer) cpath);
 
 	/* Notify D-Bus */
@@ -989,20 +1054,17 @@ claim_connection (NMSettings *self, NMSettingsConnection *connection)
 	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
 	static guint32 ec_counter = 0;
 	GError *error = NULL;
-	GHashTableIter iter;
-	gpointer data;
 	char *path;
 	NMSettingsConnection *existing;
+	const char *uuid;
 
 	g_return_if_fail (NM_IS_SETTINGS_CONNECTION (connection));
 	g_return_if_fail (nm_connection_get_path (NM_CONNECTION (connection)) == NULL);
 
-	g_hash_table_iter_init (&iter, priv->connections);
-	while (g_hash_table_iter_next (&iter, NULL, &data)) {
-		/* prevent duplicates */
-		if (data == connection)
-			return;
-	}
+	/* prevent duplicates */
+	uuid = nm_connection_get_uuid (NM_CONNECTION (connection));
+	if (uuid && nm_settings_get_connection_by_uuid (self, uuid) == connection)
+		return;
 
 	if (!nm_connection_normalize (NM_CONNECTION (connection), NULL, NULL, &error)) {
 		nm_log_warn (LOGD_SETTINGS, "plugin provided invalid connection: %s",
@@ -1042,6 +1104,10 @@ claim_connection (NMSettings *self, NMSettingsConnection *connection)
 
 	g_signal_connect (connection, NM_SETTINGS_CONNECTION_REMOVED,
 	                  G_CALLBACK (connection_removed), self);
+	g_signal_connect (connection, NM_CONNECTION_CHANGED,
+	                  G_CALLBACK (connection_changed), self);
+	g_signal_connect (connection, "notify::" NM_SETTINGS_CONNECTION_TIMESTAMP,
+	                  G_CALLBACK (connection_timestamp_changed), self);
 	g_signal_connect (connection, NM_SETTINGS_CONNECTION_UPDATED,
 	                  G_CALLBACK (connection_updated), self);
 	g_signal_connect (connection, NM_SETTINGS_CONNECTION_UPDATED_BY_USER,
@@ -1065,6 +1131,9 @@ claim_connection (NMSettings *self, NMSettingsConnection *connection)
 	g_hash_table_insert (priv->connections,
 	                     (gpointer) nm_connection_get_path (NM_CONNECTION (connection)),
 	                     g_object_ref (connection));
+	uuid_index_update (self, connection, FALSE);
+	nm_settings_autoconnect_list_update (&priv->connections_sorted, NM_CONNECTION (connection), FALSE);
+	fingerprint_index_update (self, connection);
 
 	nm_utils_log_connection_diff (NM_CONNECTION (connection), NULL, LOGL_DEBUG, LOGD_CORE, "new connection", "++ ");
 
@@ -1105,20 +1174,16 @@ nm_settings_add_connection (NMSettings *self,
 	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
 	GSList *iter;
 	NMSettingsConnection *added = NULL;
-	GHashTableIter citer;
-	NMConnection *candidate = NULL;
+	const char *uuid;
 
 	/* Make sure a connection with this UUID doesn't already exist */
-	g_hash_table_iter_init (&citer, priv->connections);
-	while (g_hash_table_iter_next (&citer, NULL, (gpointer *) &candidate)) {
-		if (g_strcmp0 (nm_connection_get_uuid (connection),
-		               nm_connection_get_uuid (candidate)) == 0) {
-			g_set_error_literal (error,
-			                     NM_SETTINGS_ERROR,
-			                     NM_SETTINGS_ERROR_UUID_EXISTS,
-			                     "A connection with this UUID already exists.");
-			return NULL;
-		}
+	uuid = nm_connection_get_uuid (connection);
+	if (uuid && nm_settings_get_connection_by_uuid (self, uuid)) {
+		g_set_error_literal (error,
+		                     NM_SETTINGS_ERROR,
+		                     NM_SETTINGS_ERROR_UUID_EXISTS,
+		                     "A connection with this UUID already exists.");
+		return NULL;
 	}
 
 	/* 1) plugin writes the NMConnection to disk
@@ -1954,6 +2019,13 @@ nm_settings_sort_connections (gconstpointer a, gconstpointer b)
 	return 0;
 }
 
+static gint
+best_connections_cmp (gconstpointer a, gconstpointer b)
+{
+	/* Newest first */
+	return nm_settings_sort_connections (*((gconstpointer *) b), *((gconstpointer *) a));
+}
+
 static GSList *
 get_best_connections (NMConnectionProvider *provider,
                       guint max_requested,
@@ -1964,44 +2036,34 @@ get_best_connections (NMConnectionProvider *provider,
 {
 	NMSettings *self = NM_SETTINGS (provider);
 	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
+	GPtrArray *candidates;
 	GSList *sorted = NULL;
 	GHashTableIter iter;
 	NMSettingsConnection *connection;
-	guint added = 0;
-	guint64 oldest = 0;
+	guint i;
 
+	candidates = g_ptr_array_sized_new (g_hash_table_size (priv->connections));
 	g_hash_table_iter_init (&iter, priv->connections);
 	while (g_hash_table_iter_next (&iter, NULL, (gpointer) &connection)) {
-		guint64 cur_ts = 0;
-
 		if (ctype1 && !nm_connection_is_type (NM_CONNECTION (connection), ctype1))
 			continue;
 		if (ctype2 && !nm_connection_is_type (NM_CONNECTION (connection), ctype2))
 			continue;
 		if (func && !func (provider, NM_CONNECTION (connection), func_data))
 			continue;
+		g_ptr_array_add (candidates, connection);
+	}
 
-		/* Don't bother with a connection that's older than the oldest one in the list */
-		if (max_requested && added >= max_requested) {
-		    nm_settings_connection_get_timestamp (connection, &cur_ts);
-		    if (cur_ts <= oldest)
-				continue;
-		}
-
-		/* List is sorted with oldest first */
-		sorted = g_slist_insert_sorted (sorted, connection, nm_settings_sort_connections);
-		added++;
-
-		if (max_requested && added > max_requested) {
-			/* Over the limit, remove the oldest one */
-			sorted = g_slist_delete_link (sorted, sorted);
-			added--;
-		}
+	g_ptr_array_sort (candidates, best_connections_cmp);
 
-		nm_settings_connection_get_timestamp (NM_SETTINGS_CONNECTION (sorted->data), &oldest);
-	}
+	i = candidates->len;
+	if (max_requested && max_requested < i)
+		i = max_requested;
+	while (i > 0)
+		sorted = g_slist_prepend (sorted, candidates->pdata[--i]);
 
-	return g_slist_reverse (sorted);
+	g_ptr_array_free (candidates, TRUE);
+	return sorted;
 }
 
 static const GSList *
@@ -2171,6 +2233,10 @@ nm_settings_init (NMSettings *self)
 	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
 
 	priv->connections = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_object_unref);
+	nm_settings_uuid_index_init (&priv->uuid_index);
+	nm_settings_autoconnect_list_init (&priv->connections_sorted, connection_get_timestamp);
+	priv->connections_by_fingerprint = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	priv->connection_fingerprints = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
 
 	/* Hold a reference to the agent manager so it stays alive; the only
 	 * other holders are NMSettingsConnection objects which are often
@@ -2229,7 +2295,16 @@ finalize (GObject *object)
 {
 	NMSettings *self = NM_SETTINGS (object);
 	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
-
+	GHashTableIter iter;
+	gpointer list;
+
+	g_hash_table_iter_init (&iter, priv->connections_by_fingerprint);
+	while (g_hash_table_iter_next (&iter, NULL, &list))
+		g_slist_free (list);
+	g_hash_table_destroy (priv->connections_by_fingerprint);
+	g_hash_table_destroy (priv->connection_fingerprints);
+	nm_settings_autoconnect_list_clear (&priv->connections_sorted);
+	nm_settings_uuid_index_clear (&priv->uuid_index);
 	g_hash_table_destroy (priv->connections);
 	g_slist_free (priv->get_connections_cache);
 
@@ -111,6 +111,9 @@ NMSettingsConnection *nm_settings_get_connection_by_path (NMSettings *settings,
 NMSettingsConnection *nm_settings_get_connection_by_uuid (NMSettings *settings,
                                                           const char *uuid);
 
+GSList *nm_settings_get_connections_by_fingerprint (NMSettings *settings,
+                                                    const char *fingerprint);
+
 gboolean nm_settings_has_connection (NMSettings *self, NMConnection *connection);
 
 const GSList *nm_settings_get_unmanaged_specs (NMSettings *self);
@@ -198,9 +198,57 @@ files_changed_cb (NMInotifyHelper *ih,
 	g_signal_emit (self, signals[IFCFG_CHANGED], 0);
 }
 
+/* nm_ifcfg_connection_parse:
+ * @full_path: the ifcfg file to read
+ *
+ * Reads the connection stored in @full_path without touching any daemon
+ * state, so that it can be called from a worker thread. Errors are not
+ * reported; pass %NULL as @parsed to nm_ifcfg_connection_new() to read
+ * the file again and get them.
+ *
+ * Returns: the parsed file, or %NULL on failure
+ */
+NMIfcfgConnectionParsed *
+nm_ifcfg_connection_parse (const char *full_path)
+{
+	NMIfcfgConnectionParsed *parsed;
+	NMConnection *connection;
+	char *unhandled_spec = NULL;
+
+	connection = connection_from_file (full_path, &unhandled_spec, NULL, NULL);
+	if (!connection)
+		return NULL;
+
+	parsed = g_slice_new (NMIfcfgConnectionParsed);
+	parsed->connection = connection;
+	parsed->unhandled_spec = unhandled_spec;
+	return parsed;
+}
+
+void
+nm_ifcfg_connection_parsed_free (NMIfcfgConnectionParsed *parsed)
+{
+	if (!parsed)
+		return;
+	g_object_unref (parsed->connection);
+	g_free (parsed->unhandled_spec);
+	g_slice_free (NMIfcfgConnectionParsed, parsed);
+}
+
+/* nm_ifcfg_connection_new:
+ * @source: (allow-none): a connection from memory to use instead of
+ *   reading @full_path
+ * @full_path: (allow-none): the ifcfg file of the connection
+ * @parsed: (allow-none): the result of nm_ifcfg_connection_parse() for
+ *   @full_path, if the file was already read
+ * @error: error in case of failure
+ * @out_ignore_error: (allow-none): set to %TRUE if the failure is expected
+ *   and should not be logged
+ */
 NMIfcfgConnection *
 nm_ifcfg_connection_new (NMConnection *source,
                          const char *full_path,
+                         NMIfcfgConnectionParsed *parsed,
                          GError **error,
                          gboolean *out_ignore_error)
 {
@@ -211,6 +259,7 @@ nm_ifcfg_connection_new (NMConnection *source,
 	gboolean update_unsaved = TRUE;
 
 	g_assert (source || full_path);
+	g_assert (!source || !parsed);
 
 	if (out_ignore_error)
 		*out_ignore_error = FALSE;
@@ -218,7 +267,11 @@ nm_ifcfg_connection_new (NMConnection *source,
 	/* If we're given a connection already, prefer that instead of re-reading */
 	if (source)
 		tmp = g_object_ref (source);
-	else {
+	else if (parsed) {
+		tmp = g_object_ref (parsed->connection);
+		unhandled_spec = g_strdup (parsed->unhandled_spec);
+		update_unsaved = FALSE;
+	} else {
 		tmp = connection_from_file (full_path,
 		                            &unhandled_spec,
 		                            error,
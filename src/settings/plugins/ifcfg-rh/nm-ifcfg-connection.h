@@ -46,8 +46,18 @@ typedef struct {
 
 GType nm_ifcfg_connection_get_type (void);
 
+/* The content of an ifcfg file, as read by nm_ifcfg_connection_parse() */
+typedef struct {
+	NMConnection *connection;
+	char *unhandled_spec;
+} NMIfcfgConnectionParsed;
+
+NMIfcfgConnectionParsed *nm_ifcfg_connection_parse (const char *full_path);
+void nm_ifcfg_connection_parsed_free (NMIfcfgConnectionParsed *parsed);
+
 NMIfcfgConnection *nm_ifcfg_connection_new (NMConnection *source,
                                             const char *full_path,
+                                            NMIfcfgConnectionParsed *parsed,
                                             GError **error,
                                             gboolean *out_ignore_error);
 
@@ -51,6 +51,7 @@
 #include "nm-config.h"
 #include "nm-logging.h"
 #include "NetworkManagerUtils.h"
+#include "nm-settings-utils.h"
 
 #include "nm-ifcfg-connection.h"
 #include "shvar.h"
@@ -96,6 +97,7 @@ static NMIfcfgConnection *update_connection (SCPluginIfcfg *plugin,
                                              NMIfcfgConnection *connection,
                                              gboolean protect_existing_connection,
                                              GHashTable *protected_connections,
+                                             NMIfcfgConnectionParsed *parsed,
                                              GError **error);
 
 static void system_config_interface_init (NMSystemConfigInterface *system_config_interface_class);
@@ -109,6 +111,9 @@ G_DEFINE_TYPE_EXTENDED (SCPluginIfcfg, sc_plugin_ifcfg, G_TYPE_OBJECT, 0,
 
 typedef struct {
 	GHashTable *connections;  /* uuid::connection */
+	NMSettingsPathIndex path_index;
+	GHashTable *file_stamps;  /* filename::FileStamp, for files loaded by the last read_connections() */
+	GHashTable *global_stamps;  /* filename::NMSettingsFileStamp, of the files read for all connections */
 	gboolean initialized;
 
 	GFileMonitor *ifcfg_monitor;
@@ -118,6 +123,83 @@ typedef struct {
 } SCPluginIfcfgPrivate;
 
 
+/* Identifies a version of an ifcfg file on disk, including the
+ * keys-, route- and route6- files that belong to it. */
+typedef struct {
+	NMSettingsFileStamp files[4];
+} FileStamp;
+
+static gboolean
+file_stamp_get (const char *path, FileStamp *stamp)
+{
+	char *paths[3];
+	guint i;
+
+	memset (stamp, 0, sizeof (*stamp));
+	if (!nm_settings_file_stamp_get (path, &stamp->files[0]))
+		return FALSE;
+
+	paths[0] = utils_get_keys_path (path);
+	paths[1] = utils_get_route_path (path);
+	paths[2] = utils_get_route6_path (path);
+	for (i = 0; i < G_N_ELEMENTS (paths); i++) {
+		if (paths[i])
+			nm_settings_file_stamp_get (paths[i], &stamp->files[i + 1]);
+		g_free (paths[i]);
+	}
+	return TRUE;
+}
+
+static gboolean
+file_stamp_equal (const FileStamp *a, const FileStamp *b)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (a->files); i++) {
+		if (!nm_settings_file_stamp_equal (&a->files[i], &b->files[i]))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* The reader also takes settings from the global network file and from the
+ * alias files of a connection. Rather than attributing them, any change to
+ * them makes read_connections() re-read every connection. */
+static void
+global_stamps_add (GHashTable *stamps, const char *path)
+{
+	NMSettingsFileStamp stamp;
+
+	/* A missing file has a zero stamp, so that it appearing counts as well */
+	nm_settings_file_stamp_get (path, &stamp);
+	g_hash_table_insert (stamps, g_strdup (path), g_memdup (&stamp, sizeof (stamp)));
+}
+
+static gboolean
+global_stamps_equal (GHashTable *a, GHashTable *b)
+{
+	GHashTableIter iter;
+	gpointer key, value, other;
+
+	if (g_hash_table_size (a) != g_hash_table_size (b))
+		return FALSE;
+
+	g_hash_table_iter_init (&iter, a);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		other = g_hash_table_lookup (b, key);
+		if (!other || !nm_settings_file_stamp_equal (value, other))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static void
+connection_filename_changed (NMIfcfgConnection *connection, GParamSpec *pspec, gpointer user_data)
+{
+	nm_settings_path_index_update (&SC_PLUGIN_IFCFG_GET_PRIVATE (user_data)->path_index,
+	                               NM_SETTINGS_CONNECTION (connection), FALSE);
+}
+
 static void
 connection_ifcfg_changed (NMIfcfgConnection *connection, gpointer user_data)
 {
@@ -136,12 +218,14 @@ connection_ifcfg_changed (NMIfcfgConnection *connection, gpointer user_data)
 
 	_LOGD ("connection_ifcfg_changed("NM_IFCFG_CONNECTION_LOG_FMTD"): %s", NM_IFCFG_CONNECTION_LOG_ARGD (connection), "reload");
 
-	update_connection (self, NULL, path, connection, TRUE, NULL, NULL);
+	update_connection (self, NULL, path, connection, TRUE, NULL, NULL, NULL);
 }
 
 static void
 connection_removed_cb (NMSettingsConnection *obj, gpointer user_data)
 {
+	nm_settings_path_index_update (&SC_PLUGIN_IFCFG_GET_PRIVATE (user_data)->path_index, obj, TRUE);
+	g_signal_handlers_disconnect_by_func (obj, connection_filename_changed, user_data);
 	g_hash_table_remove (SC_PLUGIN_IFCFG_GET_PRIVATE (user_data)->connections,
 	                     nm_connection_get_uuid (NM_CONNECTION (obj)));
 }
@@ -161,6 +245,8 @@ remove_connection (SCPluginIfcfg *self, NMIfcfgConnection *connection)
 	unrecognized = !!nm_ifcfg_connection_get_unrecognized_spec (connection);
 
 	g_object_ref (connection);
+	g_signal_handlers_disconnect_by_func (connection, connection_filename_changed, self);
+	nm_settings_path_index_update (&priv->path_index, NM_SETTINGS_CONNECTION (connection), TRUE);
 	g_hash_table_remove (priv->connections, nm_connection_get_uuid (NM_CONNECTION (connection)));
 	nm_settings_connection_signal_remove (NM_SETTINGS_CONNECTION (connection));
 	g_object_unref (connection);
@@ -175,18 +261,9 @@ remove_connection (SCPluginIfcfg *self, NMIfcfgConnection *connection)
 static NMIfcfgConnection *
 find_by_path (SCPluginIfcfg *self, const char *path)
 {
-	SCPluginIfcfgPrivate *priv = SC_PLUGIN_IFCFG_GET_PRIVATE (self);
-	GHashTableIter iter;
-	NMSettingsConnection *candidate = NULL;
-
 	g_return_val_if_fail (path != NULL, NULL);
 
-	g_hash_table_iter_init (&iter, priv->connections);
-	while (g_hash_table_iter_next (&iter, NULL, (gpointer) &candidate)) {
-		if (g_strcmp0 (path, nm_settings_connection_get_filename (candidate)) == 0)
-			return NM_IFCFG_CONNECTION (candidate);
-	}
-	return NULL;
+	return g_hash_table_lookup (SC_PLUGIN_IFCFG_GET_PRIVATE (self)->path_index.by_path, path);
 }
 
 static NMIfcfgConnection *
@@ -196,6 +273,7 @@ update_connection (SCPluginIfcfg *self,
                    NMIfcfgConnection *connection,
                    gboolean protect_existing_connection,
                    GHashTable *protected_connections,
+                   NMIfcfgConnectionParsed *parsed,
                    GError **error)
 {
 	SCPluginIfcfgPrivate *priv = SC_PLUGIN_IFCFG_GET_PRIVATE (self);
@@ -216,7 +294,7 @@ update_connection (SCPluginIfcfg *self,
 
 	/* Create a NMIfcfgConnection instance, either by reading from @full_path or
 	 * based on @source. */
-	connection_new = nm_ifcfg_connection_new (source, full_path, &local, &ignore_error);
+	connection_new = nm_ifcfg_connection_new (source, full_path, parsed, &local, &ignore_error);
 	if (!connection_new) {
 		/* Unexpected failure. Probably the file is invalid? */
 		if (   connection
@@ -376,6 +454,10 @@ update_connection (SCPluginIfcfg *self,
 		g_signal_connect (connection_new, NM_SETTINGS_CONNECTION_REMOVED,
 		                  G_CALLBACK (connection_removed_cb),
 		                  self);
+		g_signal_connect (connection_new, "notify::" NM_SETTINGS_CONNECTION_FILENAME,
+		                  G_CALLBACK (connection_filename_changed),
+		                  self);
+		nm_settings_path_index_update (&priv->path_index, NM_SETTINGS_CONNECTION (connection_new), FALSE);
 
 		if (nm_ifcfg_connection_get_unmanaged_spec (connection_new)) {
 			const char *spec;
@@ -435,7 +517,7 @@ ifcfg_dir_changed (GFileMonitor *monitor,
 		case G_FILE_MONITOR_EVENT_CREATED:
 		case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
 			/* Update or new */
-			update_connection (plugin, NULL, ifcfg_path, connection, TRUE, NULL, NULL);
+			update_connection (plugin, NULL, ifcfg_path, connection, TRUE, NULL, NULL, NULL);
 			break;
 		default:
 			break;
@@ -463,41 +545,10 @@ setup_ifcfg_monitoring (SCPluginIfcfg *plugin)
 	}
 }
 
-static GHashTable *
-_paths_from_connections (GHashTable *connections)
-{
-	GHashTableIter iter;
-	NMIfcfgConnection *connection;
-	GHashTable *paths = g_hash_table_new (g_str_hash, g_str_equal);
-
-	g_hash_table_iter_init (&iter, connections);
-	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &connection)) {
-		const char *path = nm_settings_connection_get_filename (NM_SETTINGS_CONNECTION (connection));
-
-		if (path)
-			g_hash_table_add (paths, (void *) path);
-	}
-	return paths;
-}
-
-static int
-_sort_paths (const char **f1, const char **f2, GHashTable *paths)
+static gpointer
+parse_connection_file (gpointer item, gpointer user_data)
 {
-	struct stat st;
-	gboolean c1, c2;
-	gint64 m1, m2;
-
-	c1 = !!g_hash_table_contains (paths, *f1);
-	c2 = !!g_hash_table_contains (paths, *f2);
-	if (c1 != c2)
-		return c1 ? -1 : 1;
-
-	m1 = stat (*f1, &st) == 0 ? (gint64) st.st_mtime : G_MININT64;
-	m2 = stat (*f2, &st) == 0 ? (gint64) st.st_mtime : G_MININT64;
-	if (m1 != m2)
-		return m1 > m2 ? -1 : 1;
-
-	return strcmp (*f1, *f2);
+	return nm_ifcfg_connection_parse (item);
 }
 
 static void
@@ -513,7 +564,9 @@ read_connections (SCPluginIfcfg *plugin)
 	GPtrArray *dead_connections = NULL;
 	guint i;
 	GPtrArray *filenames;
-	GHashTable *paths;
+	GPtrArray *parsed = NULL;
+	GHashTable *stamps, *global_stamps;
+	gboolean global_changed;
 
 	dir = g_dir_open (IFCFG_DIR, 0, &err);
 	if (!dir) {
@@ -524,34 +577,71 @@ read_connections (SCPluginIfcfg *plugin)
 
 	alive_connections = g_hash_table_new (NULL, NULL);
 
+	/* Each file is stat()ed exactly once per reload */
 	filenames = g_ptr_array_new_with_free_func (g_free);
+	stamps = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	global_stamps = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	global_stamps_add (global_stamps, SYSCONFDIR "/sysconfig/network");
 	while ((item = g_dir_read_name (dir))) {
 		char *full_path, *real_path;
+		FileStamp stamp;
 
 		full_path = g_build_filename (IFCFG_DIR, item, NULL);
 		real_path = utils_detect_ifcfg_path (full_path, TRUE);
 
-		if (real_path)
+		if (real_path) {
 			g_ptr_array_add (filenames, real_path);
+			if (file_stamp_get (real_path, &stamp))
+				g_hash_table_insert (stamps, g_strdup (real_path), g_memdup (&stamp, sizeof (stamp)));
+		} else if (utils_is_ifcfg_alias_file (item, NULL))
+			global_stamps_add (global_stamps, full_path);
 		g_free (full_path);
 	}
 	g_dir_close (dir);
 
-	/* While reloading, we don't replace connections that we already loaded while
-	 * iterating over the files.
-	 *
-	 * To have sensible, reproducible behavior, sort the paths by last modification
-	 * time prefering older files.
-	 */
-	paths = _paths_from_connections (priv->connections);
-	g_ptr_array_sort_with_data (filenames, (GCompareDataFunc) _sort_paths, paths);
-	g_hash_table_destroy (paths);
+	nm_settings_sort_paths (filenames, priv->path_index.by_path, stamps);
+
+	global_changed = !priv->global_stamps || !global_stamps_equal (global_stamps, priv->global_stamps);
+	if (priv->global_stamps)
+		g_hash_table_destroy (priv->global_stamps);
+	priv->global_stamps = global_stamps;
+
+	/* On the initial load, read the files in parallel; only turning them
+	 * into settings connections happens here, in order. */
+	if (!priv->initialized)
+		parsed = nm_utils_parallel_map (filenames, parse_connection_file, NULL);
 
 	for (i = 0; i < filenames->len; i++) {
-		connection = update_connection (plugin, NULL, filenames->pdata[i], NULL, FALSE, alive_connections, NULL);
+		const char *path = filenames->pdata[i];
+		const FileStamp *stamp, *old_stamp;
+
+		/* Skip files that did not change since the last reload */
+		stamp = g_hash_table_lookup (stamps, path);
+		old_stamp = priv->file_stamps ? g_hash_table_lookup (priv->file_stamps, path) : NULL;
+		connection = find_by_path (plugin, path);
+		if (   global_changed
+		    || !stamp || !old_stamp || !connection
+		    || !file_stamp_equal (stamp, old_stamp)
+		    || nm_settings_connection_get_unsaved (NM_SETTINGS_CONNECTION (connection))
+		    || g_hash_table_contains (alive_connections, connection)) {
+			connection = update_connection (plugin, NULL, path, NULL, FALSE, alive_connections,
+			                                parsed ? parsed->pdata[i] : NULL, NULL);
+		}
+
 		if (connection)
 			g_hash_table_add (alive_connections, connection);
+		else
+			g_hash_table_remove (stamps, path);
+		if (parsed)
+			nm_ifcfg_connection_parsed_free (parsed->pdata[i]);
 	}
+	if (parsed)
+		g_ptr_array_free (parsed, TRUE);
+
+	/* Remember the stamps of the files that are loaded now */
+	if (priv->file_stamps)
+		g_hash_table_destroy (priv->file_stamps);
+	priv->file_stamps = stamps;
 	g_ptr_array_free (filenames, TRUE);
 
 	g_hash_table_iter_init (&iter, priv->connections);
@@ -619,7 +709,7 @@ load_connection (NMSystemConfigInterface *config,
 		return FALSE;
 
 	connection = find_by_path (plugin, ifcfg_path);
-	update_connection (plugin, NULL, ifcfg_path, connection, TRUE, NULL, NULL);
+	update_connection (plugin, NULL, ifcfg_path, connection, TRUE, NULL, NULL, NULL);
 	if (!connection)
 		connection = find_by_path (plugin, ifcfg_path);
 
@@ -697,7 +787,7 @@ add_connection (NMSystemConfigInterface *config,
 		if (!writer_new_connection (connection, IFCFG_DIR, &path, error))
 			return NULL;
 	}
-	return NM_SETTINGS_CONNECTION (update_connection (self, connection, path, NULL, FALSE, NULL, error));
+	return NM_SETTINGS_CONNECTION (update_connection (self, connection, path, NULL, FALSE, NULL, NULL, error));
 }
 
 static gboolean
@@ -777,6 +867,7 @@ sc_plugin_ifcfg_init (SCPluginIfcfg *plugin)
 	gboolean success = FALSE;
 
 	priv->connections = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+	nm_settings_path_index_init (&priv->path_index);
 
 	priv->bus = dbus_g_bus_get (DBUS_BUS_SYSTEM, &error);
 	if (!priv->bus) {
@@ -832,6 +923,9 @@ dispose (GObject *object)
 		g_hash_table_destroy (priv->connections);
 		priv->connections = NULL;
 	}
+	nm_settings_path_index_clear (&priv->path_index);
+	g_clear_pointer (&priv->file_stamps, g_hash_table_destroy);
+	g_clear_pointer (&priv->global_stamps, g_hash_table_destroy);
 
 	if (priv->ifcfg_monitor) {
 		if (priv->ifcfg_monitor_id)
@@ -494,13 +494,14 @@ read_one_ip4_route (shvarFile *ifcfg,
 		goto out;
 	if (value) {
 		guint32 netmask;
+		char buf[NM_UTILS_INET_ADDRSTRLEN];
 
 		inet_pton (AF_INET, value, &netmask);
 		prefix = nm_utils_ip4_netmask_to_prefix (netmask);
 		g_free (value);
 		if (prefix == 0 || netmask != nm_utils_ip4_prefix_to_netmask (prefix)) {
 			g_set_error (error, NM_SETTINGS_ERROR, NM_SETTINGS_ERROR_INVALID_CONNECTION,
-			             "Invalid IP4 netmask '%s' \"%s\"", netmask_tag, nm_utils_inet4_ntop (netmask, NULL));
+			             "Invalid IP4 netmask '%s' \"%s\"", netmask_tag, nm_utils_inet4_ntop (netmask, buf));
 			goto out;
 		}
 	} else {
@@ -4385,19 +4386,26 @@ is_vlan_device (const char *name, shvarFile *parsed)
 	return FALSE;
 }
 
+/* Files may be parsed on worker threads, see read_connections() in plugin.c.
+ * Serialize access to the platform, which is not thread-safe. */
+G_LOCK_DEFINE_STATIC (platform);
+
 static gboolean
 is_wifi_device (const char *name, shvarFile *parsed)
 {
 	int ifindex;
+	gboolean is_wifi = FALSE;
 
 	g_return_val_if_fail (name != NULL, FALSE);
 	g_return_val_if_fail (parsed != NULL, FALSE);
 
+	G_LOCK (platform);
 	ifindex = nm_platform_link_get_ifindex (NM_PLATFORM_GET, name);
-	if (ifindex == 0)
-		return FALSE;
+	if (ifindex != 0)
+		is_wifi = nm_platform_link_get_type (NM_PLATFORM_GET, ifindex) == NM_LINK_TYPE_WIFI;
+	G_UNLOCK (platform);
 
-	return nm_platform_link_get_type (NM_PLATFORM_GET, ifindex) == NM_LINK_TYPE_WIFI;
+	return is_wifi;
 }
 
 static void
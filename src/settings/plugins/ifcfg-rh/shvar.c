@@ -42,6 +42,74 @@
 
 #define PARSE_WARNING(msg...) nm_log_warn (LOGD_SETTINGS, "    " msg)
 
+/* Lines are kept in file order in s->lineList; s->lineIndex maps each key
+ * to the index of the first line assigning it, which is the one
+ * svGetValue() reads and svSetValue() modifies.
+ */
+
+static char *
+line_get_key (const char *line)
+{
+	const char *eq = strchr (line, '=');
+
+	return eq ? g_strndup (line, eq - line) : NULL;
+}
+
+static void
+line_index_add (shvarFile *s, guint idx)
+{
+	char *key;
+
+	key = line_get_key (s->lineList->pdata[idx]);
+	if (!key)
+		return;
+
+	if (g_hash_table_contains (s->lineIndex, key))
+		g_free (key);
+	else
+		g_hash_table_insert (s->lineIndex, key, GUINT_TO_POINTER (idx));
+}
+
+static gboolean
+line_index_lookup (shvarFile *s, const char *key, guint *out_idx)
+{
+	gpointer idx;
+
+	if (!g_hash_table_lookup_extended (s->lineIndex, key, NULL, &idx))
+		return FALSE;
+	*out_idx = GPOINTER_TO_UINT (idx);
+	return TRUE;
+}
+
+static void
+line_append (shvarFile *s, char *line)
+{
+	g_ptr_array_add (s->lineList, line);
+	line_index_add (s, s->lineList->len - 1);
+}
+
+static void
+line_remove (shvarFile *s, const char *key, guint idx)
+{
+	guint len = strlen (key);
+	guint i;
+
+	g_free (s->lineList->pdata[idx]);
+	s->lineList->pdata[idx] = NULL;
+
+	/* A later duplicate assignment now becomes the effective one */
+	for (i = idx + 1; i < s->lineList->len; i++) {
+		const char *line = s->lineList->pdata[i];
+
+		if (line && !strncmp (line, key, len) && line[len] == '=') {
+			g_hash_table_insert (s->lineIndex, g_strdup (key), GUINT_TO_POINTER (i));
+			return;
+		}
+	}
+	g_hash_table_remove (s->lineIndex, key);
+}
+
+
 /* Open the file <name>, returning a shvarFile on success and NULL on failure.
  * Add a wrinkle to let the caller specify whether or not to create the file
  * (actually, return a structure anyway) if it doesn't exist.
@@ -54,6 +122,8 @@ svOpenFileInternal (const char *name, gboolean create, GError **error)
 	int errsv = 0;
 
 	s = g_slice_new0 (shvarFile);
+	s->lineList = g_ptr_array_new_with_free_func (g_free);
+	s->lineIndex = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
 	s->fd = -1;
 	if (create)
@@ -93,9 +163,8 @@ svOpenFileInternal (const char *name, gboolean create, GError **error)
 			total += nread;
 		}
 
-		/* we'd use g_strsplit() here, but we want a list, not an array */
 		for (p = arena; (q = strchr (p, '\n')) != NULL; p = q + 1)
-			s->lineList = g_list_append (s->lineList, g_strndup (p, q - p));
+			line_append (s, g_strndup (p, q - p));
 		g_free (arena);
 
 		/* closefd is set if we opened the file read-only, so go ahead and
@@ -116,6 +185,8 @@ svOpenFileInternal (const char *name, gboolean create, GError **error)
 	if (s->fd != -1)
 		close (s->fd);
 	g_free (s->fileName);
+	g_ptr_array_unref (s->lineList);
+	g_hash_table_destroy (s->lineIndex);
 	g_slice_free (shvarFile, s);
 
 	g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errsv),
@@ -250,8 +321,7 @@ svEscape (const char *s, char **to_free)
 	return new;
 }
 
-/* Get the value associated with the key, and leave the current pointer
- * pointing at the line containing the value.  The char* returned MUST
+/* Get the value associated with the key.  The char* returned MUST
  * be freed by the caller.
  */
 char *
@@ -273,28 +343,22 @@ svGetValue (shvarFile *s, const char *key, gboolean verbatim)
 char *
 svGetValueFull (shvarFile *s, const char *key, gboolean verbatim)
 {
-	char *value = NULL;
-	char *line;
-	char *keyString;
-	int len;
+	char *value;
+	const char *line;
+	guint idx;
 
 	g_return_val_if_fail (s != NULL, NULL);
 	g_return_val_if_fail (key != NULL, NULL);
 
-	keyString = g_strdup_printf ("%s=", key);
-	len = strlen (keyString);
-
-	for (s->current = s->lineList; s->current; s->current = s->current->next) {
-		line = s->current->data;
-		if (!strncmp (keyString, line, len)) {
-			/* Strip trailing spaces before unescaping to preserve spaces quoted whitespace */
-			value = g_strchomp (g_strdup (line + len));
-			if (!verbatim)
-				svUnescape (value);
-			break;
-		}
-	}
-	g_free (keyString);
+	if (!line_index_lookup (s, key, &idx))
+		return NULL;
+
+	line = s->lineList->pdata[idx];
+
+	/* Strip trailing spaces before unescaping to preserve spaces quoted whitespace */
+	value = g_strchomp (g_strdup (line + strlen (key) + 1));
+	if (!verbatim)
+		svUnescape (value);
 
 	return value;
 }
@@ -362,9 +426,8 @@ svGetValueInt64 (shvarFile *s, const char *key, guint base, gint64 min, gint64 m
 }
 
 /* Set the variable <key> equal to the value <value>.
- * If <key> does not exist, and the <current> pointer is set, append
- * the key=value pair after that line.  Otherwise, append the pair
- * to the bottom of the file.
+ * If <key> does not exist, append the key=value pair to the bottom
+ * of the file.
  */
 void
 svSetValue (shvarFile *s, const char *key, const char *value, gboolean verbatim)
@@ -381,6 +444,7 @@ svSetValueFull (shvarFile *s, const char *key, const char *value, gboolean verba
 	gs_free char *oldval = NULL;
 	const char *newval;
 	char *keyValue;
+	guint idx = 0;
 
 	g_return_if_fail (s != NULL);
 	g_return_if_fail (key != NULL);
@@ -391,14 +455,14 @@ svSetValueFull (shvarFile *s, const char *key, const char *value, gboolean verba
 	else
 		newval = svEscape (value, &newval_free);
 	oldval = svGetValueFull (s, key, FALSE);
+	if (oldval)
+		line_index_lookup (s, key, &idx);
 
 	if (!newval) {
 		/* delete value */
 		if (oldval) {
 			/* delete line */
-			s->lineList = g_list_remove_link (s->lineList, s->current);
-			g_free (s->current->data);
-			g_list_free_1 (s->current);
+			line_remove (s, key, idx);
 			s->modified = TRUE;
 		}
 		return;
@@ -407,18 +471,15 @@ svSetValueFull (shvarFile *s, const char *key, const char *value, gboolean verba
 	keyValue = g_strdup_printf ("%s=%s", key, newval);
 	if (!oldval) {
 		/* append line */
-		s->lineList = g_list_append (s->lineList, keyValue);
+		line_append (s, keyValue);
 		s->modified = TRUE;
 		return;
 	}
 
 	if (strcmp (oldval, newval) != 0) {
 		/* change line */
-		if (s->current) {
-			g_free (s->current->data);
-			s->current->data = keyValue;
-		} else
-			s->lineList = g_list_append (s->lineList, keyValue);
+		g_free (s->lineList->pdata[idx]);
+		s->lineList->pdata[idx] = keyValue;
 		s->modified = TRUE;
 	} else
 		g_free (keyValue);
@@ -435,6 +496,7 @@ svWriteFile (shvarFile *s, int mode, GError **error)
 {
 	FILE *f;
 	int tmpfd;
+	guint i;
 
 	if (s->modified) {
 		if (s->fd == -1)
@@ -467,9 +529,11 @@ svWriteFile (shvarFile *s, int mode, GError **error)
 		}
 		f = fdopen (tmpfd, "w");
 		fseek (f, 0, SEEK_SET);
-		for (s->current = s->lineList; s->current; s->current = s->current->next) {
-			char *line = s->current->data;
-			fprintf (f, "%s\n", line);
+		for (i = 0; i < s->lineList->len; i++) {
+			const char *line = s->lineList->pdata[i];
+
+			if (line)
+				fprintf (f, "%s\n", line);
 		}
 		fclose (f);
 	}
@@ -488,6 +552,7 @@ svCloseFile (shvarFile *s)
 		close (s->fd);
 
 	g_free (s->fileName);
-	g_list_free_full (s->lineList, g_free); /* implicitly frees s->current */
+	g_ptr_array_unref (s->lineList);
+	g_hash_table_destroy (s->lineIndex);
 	g_slice_free (shvarFile, s);
 }
@@ -39,8 +39,8 @@ typedef struct _shvarFile shvarFile;
 struct _shvarFile {
 	char      *fileName;    /* read-only */
 	int        fd;          /* read-only */
-	GList     *lineList;    /* read-only */
-	GList     *current;     /* set implicitly or explicitly, points to element of lineList */
+	GPtrArray *lineList;    /* read-only; removed lines are left as NULL */
+	GHashTable *lineIndex;  /* read-only; key -> index of its first line in lineList */
 	gboolean   modified;    /* ignore */
 };
 
@@ -51,8 +51,7 @@ shvarFile *svCreateFile (const char *name);
 /* Open the file <name>, return shvarFile on success, NULL on failure */
 shvarFile *svOpenFile (const char *name, GError **error);
 
-/* Get the value associated with the key, and leave the current pointer
- * pointing at the line containing the value.  The char* returned MUST
+/* Get the value associated with the key.  The char* returned MUST
  * be freed by the caller.
  */
 char *svGetValue (shvarFile *s, const char *key, gboolean verbatim);
@@ -67,9 +66,8 @@ gint svTrueValue (shvarFile *s, const char *key, gint def);
 gint64 svGetValueInt64 (shvarFile *s, const char *key, guint base, gint64 min, gint64 max, gint64 fallback);
 
 /* Set the variable <key> equal to the value <value>.
- * If <key> does not exist, and the <current> pointer is set, append
- * the key=value pair after that line.  Otherwise, prepend the pair
- * to the top of the file.
+ * If <key> does not exist, append the key=value pair to the bottom
+ * of the file.
  */
 void svSetValue (shvarFile *s, const char *key, const char *value, gboolean verbatim);
 void svSetValueFull (shvarFile *s, const char *key, const char *value, gboolean verbatim);
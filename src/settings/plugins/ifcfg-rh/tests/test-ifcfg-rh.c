@@ -12553,6 +12553,62 @@ test_svUnescape (void)
 	g_rand_free (r);
 }
 
+static void
+test_svSetValue_duplicates (void)
+{
+	const char *testfile = TEST_SCRATCH_DIR "/ifcfg-test-shvar-duplicates";
+	shvarFile *f;
+	GError *error = NULL;
+	char *contents = NULL;
+	char *value;
+	gboolean success;
+
+	success = g_file_set_contents (testfile,
+	                               "# comment\n"
+	                               "FOO=first\n"
+	                               "BAR=bar\n"
+	                               "FOO=second\n"
+	                               "not an assignment\n",
+	                               -1, &error);
+	g_assert_no_error (error);
+	g_assert (success);
+
+	f = svCreateFile (testfile);
+
+	/* the first assignment wins */
+	value = svGetValue (f, "FOO", FALSE);
+	g_assert_cmpstr (value, ==, "first");
+	g_free (value);
+
+	/* deleting it exposes the next one */
+	svSetValue (f, "FOO", NULL, FALSE);
+	value = svGetValue (f, "FOO", FALSE);
+	g_assert_cmpstr (value, ==, "second");
+	g_free (value);
+
+	svSetValue (f, "FOO", "third", FALSE);
+	svSetValue (f, "BAZ", "baz", FALSE);
+	svSetValue (f, "BAR", NULL, FALSE);
+	g_assert (svGetValue (f, "BAR", FALSE) == NULL);
+
+	success = svWriteFile (f, 0644, &error);
+	g_assert_no_error (error);
+	g_assert (success);
+	svCloseFile (f);
+
+	success = g_file_get_contents (testfile, &contents, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (success);
+	g_assert_cmpstr (contents, ==,
+	                 "# comment\n"
+	                 "FOO=third\n"
+	                 "not an assignment\n"
+	                 "BAZ=baz\n");
+	g_free (contents);
+
+	unlink (testfile);
+}
+
 static void
 test_read_vlan_trailing_spaces (void)
 {
@@ -12615,6 +12671,7 @@ int main (int argc, char **argv)
 	nmtst_init_assert_logging (&argc, &argv, "INFO", "DEFAULT");
 
 	g_test_add_func (TPATH "svUnescape", test_svUnescape);
+	g_test_add_func (TPATH "svSetValue-duplicates", test_svSetValue_duplicates);
 	g_test_add_func (TPATH "vlan-trailing-spaces", test_read_vlan_trailing_spaces);
 
 	g_test_add_func (TPATH "unmanaged", test_read_unmanaged);
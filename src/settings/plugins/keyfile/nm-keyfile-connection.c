@@ -36,32 +36,66 @@
 
 G_DEFINE_TYPE (NMKeyfileConnection, nm_keyfile_connection, NM_TYPE_SETTINGS_CONNECTION)
 
+/* nm_keyfile_connection_parse:
+ * @full_path: the keyfile to read
+ * @error: error in case of failure
+ *
+ * Reads and verifies the connection stored in @full_path. Unlike
+ * nm_keyfile_connection_new(), this does not touch any daemon state and
+ * can be called from a worker thread.
+ *
+ * Returns: the connection read from @full_path
+ */
+NMConnection *
+nm_keyfile_connection_parse (const char *full_path,
+                             GError **error)
+{
+	NMConnection *connection;
+
+	connection = nm_keyfile_plugin_connection_from_file (full_path, error);
+	if (!connection)
+		return NULL;
+
+	if (!nm_connection_get_uuid (connection)) {
+		g_set_error (error, NM_SETTINGS_ERROR, NM_SETTINGS_ERROR_INVALID_CONNECTION,
+		             "Connection in file %s had no UUID", full_path);
+		g_object_unref (connection);
+		return NULL;
+	}
+	return connection;
+}
+
+/* nm_keyfile_connection_new:
+ * @source: (allow-none): a connection from memory to use instead of
+ *   reading @full_path
+ * @full_path: (allow-none): the keyfile of the connection
+ * @parsed: (allow-none): the result of nm_keyfile_connection_parse()
+ *   for @full_path, if the file was already read
+ * @error: error in case of failure
+ */
 NMKeyfileConnection *
 nm_keyfile_connection_new (NMConnection *source,
                            const char *full_path,
+                           NMConnection *parsed,
                            GError **error)
 {
 	GObject *object;
 	NMConnection *tmp;
-	const char *uuid;
 	gboolean update_unsaved = TRUE;
 
 	g_assert (source || full_path);
+	g_assert (!source || !parsed);
 
 	/* If we're given a connection already, prefer that instead of re-reading */
 	if (source)
 		tmp = g_object_ref (source);
 	else {
-		tmp = nm_keyfile_plugin_connection_from_file (full_path, error);
-		if (!tmp)
-			return NULL;
-
-		uuid = nm_connection_get_uuid (NM_CONNECTION (tmp));
-		if (!uuid) {
-			g_set_error (error, NM_SETTINGS_ERROR, NM_SETTINGS_ERROR_INVALID_CONNECTION,
-			             "Connection in file %s had no UUID", full_path);
-			g_object_unref (tmp);
-			return NULL;
+		if (parsed)
+			tmp = g_object_ref (parsed);
+		else {
+			tmp = nm_keyfile_connection_parse (full_path, error);
+			if (!tmp)
+				return NULL;
 		}
 
 		/* If we just read the connection from disk, it's clearly not Unsaved */
@@ -43,8 +43,12 @@ typedef struct {
 
 GType nm_keyfile_connection_get_type (void);
 
+NMConnection *nm_keyfile_connection_parse (const char *filename,
+                                           GError **error);
+
 NMKeyfileConnection *nm_keyfile_connection_new (NMConnection *source,
                                                 const char *filename,
+                                                NMConnection *parsed,
                                                 GError **error);
 
 G_END_DECLS
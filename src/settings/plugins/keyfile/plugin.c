@@ -46,6 +46,8 @@
 #include "common.h"
 #include "utils.h"
 #include "gsystem-local-alloc.h"
+#include "NetworkManagerUtils.h"
+#include "nm-settings-utils.h"
 
 static void system_config_interface_init (NMSystemConfigInterface *system_config_interface_class);
 
@@ -57,6 +59,8 @@ G_DEFINE_TYPE_EXTENDED (SCPluginKeyfile, sc_plugin_keyfile, G_TYPE_OBJECT, 0,
 
 typedef struct {
 	GHashTable *connections;  /* uuid::connection */
+	NMSettingsPathIndex path_index;
+	GHashTable *file_stamps;  /* filename::NMSettingsFileStamp, for files loaded by the last read_connections() */
 
 	gboolean initialized;
 	GFileMonitor *monitor;
@@ -65,9 +69,18 @@ typedef struct {
 	NMConfig *config;
 } SCPluginKeyfilePrivate;
 
+static void
+connection_filename_changed (NMKeyfileConnection *connection, GParamSpec *pspec, gpointer user_data)
+{
+	nm_settings_path_index_update (&SC_PLUGIN_KEYFILE_GET_PRIVATE (user_data)->path_index,
+	                               NM_SETTINGS_CONNECTION (connection), FALSE);
+}
+
 static void
 connection_removed_cb (NMSettingsConnection *obj, gpointer user_data)
 {
+	nm_settings_path_index_update (&SC_PLUGIN_KEYFILE_GET_PRIVATE (user_data)->path_index, obj, TRUE);
+	g_signal_handlers_disconnect_by_func (obj, connection_filename_changed, user_data);
 	g_hash_table_remove (SC_PLUGIN_KEYFILE_GET_PRIVATE (user_data)->connections,
 	                     nm_connection_get_uuid (NM_CONNECTION (obj)));
 }
@@ -86,6 +99,9 @@ remove_connection (SCPluginKeyfile *self, NMKeyfileConnection *connection)
 	/* Removing from the hash table should drop the last reference */
 	g_object_ref (connection);
 	g_signal_handlers_disconnect_by_func (connection, connection_removed_cb, self);
+	g_signal_handlers_disconnect_by_func (connection, connection_filename_changed, self);
+	nm_settings_path_index_update (&SC_PLUGIN_KEYFILE_GET_PRIVATE (self)->path_index,
+	                               NM_SETTINGS_CONNECTION (connection), TRUE);
 	removed = g_hash_table_remove (SC_PLUGIN_KEYFILE_GET_PRIVATE (self)->connections,
 	                               nm_connection_get_uuid (NM_CONNECTION (connection)));
 	nm_settings_connection_signal_remove (NM_SETTINGS_CONNECTION (connection));
@@ -97,18 +113,9 @@ remove_connection (SCPluginKeyfile *self, NMKeyfileConnection *connection)
 static NMKeyfileConnection *
 find_by_path (SCPluginKeyfile *self, const char *path)
 {
-	SCPluginKeyfilePrivate *priv = SC_PLUGIN_KEYFILE_GET_PRIVATE (self);
-	GHashTableIter iter;
-	NMSettingsConnection *candidate = NULL;
-
 	g_return_val_if_fail (path != NULL, NULL);
 
-	g_hash_table_iter_init (&iter, priv->connections);
-	while (g_hash_table_iter_next (&iter, NULL, (gpointer) &candidate)) {
-		if (g_strcmp0 (path, nm_settings_connection_get_filename (candidate)) == 0)
-			return NM_KEYFILE_CONNECTION (candidate);
-	}
-	return NULL;
+	return g_hash_table_lookup (SC_PLUGIN_KEYFILE_GET_PRIVATE (self)->path_index.by_path, path);
 }
 
 /* update_connection:
@@ -130,6 +137,8 @@ find_by_path (SCPluginKeyfile *self, const char *path)
  *   Note, that this allows for @connection to be replaced by a new connection.
  * @protected_connections: (allow-none): if given, we only update an
  *   existing connection if it is not contained in this hash.
+ * @parsed: (allow-none): the content of @full_path if it was already
+ *   read with nm_keyfile_connection_parse(). Only valid without @source.
  * @error: error in case of failure
  *
  * Loads a connection from file @full_path. This can both be used to
@@ -149,6 +158,7 @@ update_connection (SCPluginKeyfile *self,
                    NMKeyfileConnection *connection,
                    gboolean protect_existing_connection,
                    GHashTable *protected_connections,
+                   NMConnection *parsed,
                    GError **error)
 {
 	SCPluginKeyfilePrivate *priv = SC_PLUGIN_KEYFILE_GET_PRIVATE (self);
@@ -163,7 +173,7 @@ update_connection (SCPluginKeyfile *self,
 	if (full_path)
 		nm_log_dbg (LOGD_SETTINGS, "keyfile: loading from file \"%s\"...", full_path);
 
-	connection_new = nm_keyfile_connection_new (source, full_path, &local);
+	connection_new = nm_keyfile_connection_new (source, full_path, parsed, &local);
 	if (!connection_new) {
 		/* Error; remove the connection */
 		if (source)
@@ -263,6 +273,10 @@ update_connection (SCPluginKeyfile *self,
 		g_signal_connect (connection_new, NM_SETTINGS_CONNECTION_REMOVED,
 		                  G_CALLBACK (connection_removed_cb),
 		                  self);
+		g_signal_connect (connection_new, "notify::" NM_SETTINGS_CONNECTION_FILENAME,
+		                  G_CALLBACK (connection_filename_changed),
+		                  self);
+		nm_settings_path_index_update (&priv->path_index, NM_SETTINGS_CONNECTION (connection_new), FALSE);
 
 		if (!source) {
 			/* Only raise the signal if we were called without source, i.e. if we read the connection from file.
@@ -305,7 +319,7 @@ dir_changed (GFileMonitor *monitor,
 	case G_FILE_MONITOR_EVENT_CREATED:
 	case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
 		if (exists)
-			update_connection (SC_PLUGIN_KEYFILE (config), NULL, full_path, connection, TRUE, NULL, NULL);
+			update_connection (SC_PLUGIN_KEYFILE (config), NULL, full_path, connection, TRUE, NULL, NULL, NULL);
 		break;
 	default:
 		break;
@@ -354,41 +368,11 @@ setup_monitoring (NMSystemConfigInterface *config)
 	                  config);
 }
 
-static GHashTable *
-_paths_from_connections (GHashTable *connections)
-{
-	GHashTableIter iter;
-	NMKeyfileConnection *connection;
-	GHashTable *paths = g_hash_table_new (g_str_hash, g_str_equal);
-
-	g_hash_table_iter_init (&iter, connections);
-	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &connection)) {
-		const char *path = nm_settings_connection_get_filename (NM_SETTINGS_CONNECTION (connection));
-
-		if (path)
-			g_hash_table_add (paths, (void *) path);
-	}
-	return paths;
-}
-
-static int
-_sort_paths (const char **f1, const char **f2, GHashTable *paths)
+static gpointer
+parse_connection_file (gpointer item, gpointer user_data)
 {
-	struct stat st;
-	gboolean c1, c2;
-	gint64 m1, m2;
-
-	c1 = !!g_hash_table_contains (paths, *f1);
-	c2 = !!g_hash_table_contains (paths, *f2);
-	if (c1 != c2)
-		return c1 ? -1 : 1;
-
-	m1 = stat (*f1, &st) == 0 ? (gint64) st.st_mtime : G_MININT64;
-	m2 = stat (*f2, &st) == 0 ? (gint64) st.st_mtime : G_MININT64;
-	if (m1 != m2)
-		return m1 > m2 ? -1 : 1;
-
-	return strcmp (*f1, *f2);
+	/* Errors are reported when the file is read again by update_connection() */
+	return nm_keyfile_connection_parse (item, NULL);
 }
 
 static void
@@ -405,7 +389,8 @@ read_connections (NMSystemConfigInterface *config)
 	GPtrArray *dead_connections = NULL;
 	guint i;
 	GPtrArray *filenames;
-	GHashTable *paths;
+	GPtrArray *parsed = NULL;
+	GHashTable *stamps;
 
 	dir = g_dir_open (KEYFILE_DIR, 0, &error);
 	if (!dir) {
@@ -419,29 +404,59 @@ read_connections (NMSystemConfigInterface *config)
 
 	alive_connections = g_hash_table_new (NULL, NULL);
 
+	/* Each file is stat()ed exactly once per reload */
 	filenames = g_ptr_array_new_with_free_func (g_free);
+	stamps = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 	while ((item = g_dir_read_name (dir))) {
+		NMSettingsFileStamp stamp;
+		char *path;
+
 		if (nm_keyfile_plugin_utils_should_ignore_file (item))
 			continue;
-		g_ptr_array_add (filenames, g_build_filename (KEYFILE_DIR, item, NULL));
+		path = g_build_filename (KEYFILE_DIR, item, NULL);
+		g_ptr_array_add (filenames, path);
+		if (nm_settings_file_stamp_get (path, &stamp))
+			g_hash_table_insert (stamps, g_strdup (path), g_memdup (&stamp, sizeof (stamp)));
 	}
 	g_dir_close (dir);
 
-	/* While reloading, we don't replace connections that we already loaded while
-	 * iterating over the files.
-	 *
-	 * To have sensible, reproducible behavior, sort the paths by last modification
-	 * time prefering older files.
-	 */
-	paths = _paths_from_connections (priv->connections);
-	g_ptr_array_sort_with_data (filenames, (GCompareDataFunc) _sort_paths, paths);
-	g_hash_table_destroy (paths);
+	nm_settings_sort_paths (filenames, priv->path_index.by_path, stamps);
+
+	/* On the initial load, read and verify the files in parallel; only
+	 * turning them into settings connections happens here, in order. */
+	if (!priv->initialized)
+		parsed = nm_utils_parallel_map (filenames, parse_connection_file, NULL);
 
 	for (i = 0; i < filenames->len; i++) {
-		connection = update_connection (self, NULL, filenames->pdata[i], NULL, FALSE, alive_connections, NULL);
+		const char *path = filenames->pdata[i];
+		const NMSettingsFileStamp *stamp, *old_stamp;
+
+		/* Skip files that did not change since the last reload */
+		stamp = g_hash_table_lookup (stamps, path);
+		old_stamp = priv->file_stamps ? g_hash_table_lookup (priv->file_stamps, path) : NULL;
+		connection = find_by_path (self, path);
+		if (   !stamp || !old_stamp || !connection
+		    || !nm_settings_file_stamp_equal (stamp, old_stamp)
+		    || nm_settings_connection_get_unsaved (NM_SETTINGS_CONNECTION (connection))
+		    || g_hash_table_contains (alive_connections, connection)) {
+			connection = update_connection (self, NULL, path, NULL, FALSE, alive_connections,
+			                                parsed ? parsed->pdata[i] : NULL, NULL);
+		}
+
 		if (connection)
 			g_hash_table_add (alive_connections, connection);
+		else
+			g_hash_table_remove (stamps, path);
+		if (parsed && parsed->pdata[i])
+			g_object_unref (parsed->pdata[i]);
 	}
+	if (parsed)
+		g_ptr_array_free (parsed, TRUE);
+
+	/* Remember the stamps of the files that are loaded now */
+	if (priv->file_stamps)
+		g_hash_table_destroy (priv->file_stamps);
+	priv->file_stamps = stamps;
 	g_ptr_array_free (filenames, TRUE);
 
 	g_hash_table_iter_init (&iter, priv->connections);
@@ -493,7 +508,7 @@ load_connection (NMSystemConfigInterface *config,
 	if (nm_keyfile_plugin_utils_should_ignore_file (filename + dir_len + 1))
 		return FALSE;
 
-	connection = update_connection (self, NULL, filename, find_by_path (self, filename), TRUE, NULL, NULL);
+	connection = update_connection (self, NULL, filename, find_by_path (self, filename), TRUE, NULL, NULL, NULL);
 
 	return (connection != NULL);
 }
@@ -517,7 +532,7 @@ add_connection (NMSystemConfigInterface *config,
 		if (!nm_keyfile_plugin_write_connection (connection, NULL, &path, error))
 			return NULL;
 	}
-	return NM_SETTINGS_CONNECTION (update_connection (self, connection, path, NULL, FALSE, NULL, error));
+	return NM_SETTINGS_CONNECTION (update_connection (self, connection, path, NULL, FALSE, NULL, NULL, error));
 }
 
 static GSList *
@@ -538,6 +553,7 @@ sc_plugin_keyfile_init (SCPluginKeyfile *plugin)
 	SCPluginKeyfilePrivate *priv = SC_PLUGIN_KEYFILE_GET_PRIVATE (plugin);
 
 	priv->connections = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+	nm_settings_path_index_init (&priv->path_index);
 }
 
 static void
@@ -590,6 +606,8 @@ dispose (GObject *object)
 		g_hash_table_destroy (priv->connections);
 		priv->connections = NULL;
 	}
+	nm_settings_path_index_clear (&priv->path_index);
+	g_clear_pointer (&priv->file_stamps, g_hash_table_destroy);
 
 	if (priv->config) {
 		g_signal_handlers_disconnect_by_func (priv->config, config_changed_cb, object);
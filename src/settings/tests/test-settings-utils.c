@@ -0,0 +1,305 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2015 Red Hat, Inc.
+ *
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <nm-setting-connection.h>
+#include <nm-setting-wired.h>
+
+#include "nm-settings-utils.h"
+#include "nm-logging.h"
+
+#include "nm-test-utils.h"
+
+#define UUID_A "6fa5a9c5-0e4b-4ff6-9c8d-9e6e9b1a7a01"
+#define UUID_B "0f5c1b38-2d1e-4f4c-a2f1-8c3b6e0e5d02"
+#define UUID_C "b1e4c0a2-7f3d-4a59-8e16-2c9d5f3b4e03"
+#define UUID_D "d3a7e5b1-9c2f-4b6e-a0d8-5e1f7c2b9a04"
+
+static void
+set_uuid (NMConnection *connection, const char *uuid)
+{
+	g_object_set (nm_connection_get_setting_connection (connection),
+	              NM_SETTING_CONNECTION_UUID, uuid,
+	              NULL);
+}
+
+static void
+test_uuid_index (void)
+{
+	NMSettingsUuidIndex uuid_index;
+	NMConnection *a, *b, *c;
+
+	a = nmtst_create_minimal_connection ("a", UUID_A, NM_SETTING_WIRED_SETTING_NAME, NULL);
+	b = nmtst_create_minimal_connection ("b", UUID_B, NM_SETTING_WIRED_SETTING_NAME, NULL);
+	c = nmtst_create_minimal_connection ("c", UUID_A, NM_SETTING_WIRED_SETTING_NAME, NULL);
+
+	nm_settings_uuid_index_init (&uuid_index);
+
+	/* add */
+	g_assert (!nm_settings_uuid_index_update (&uuid_index, a, FALSE));
+	g_assert (!nm_settings_uuid_index_update (&uuid_index, b, FALSE));
+	g_assert (nm_settings_uuid_index_lookup (&uuid_index, UUID_A) == a);
+	g_assert (nm_settings_uuid_index_lookup (&uuid_index, UUID_B) == b);
+
+	/* a duplicate is reported once; the first connection keeps the UUID */
+	g_assert (nm_settings_uuid_index_update (&uuid_index, c, FALSE) == a);
+	g_assert (!nm_settings_uuid_index_update (&uuid_index, c, FALSE));
+	g_assert (nm_settings_uuid_index_lookup (&uuid_index, UUID_A) == a);
+
+	/* change to a duplicate UUID and back */
+	set_uuid (b, UUID_A);
+	g_assert (nm_settings_uuid_index_update (&uuid_index, b, FALSE) == a);
+	g_assert (!nm_settings_uuid_index_lookup (&uuid_index, UUID_B));
+	set_uuid (b, UUID_B);
+	g_assert (!nm_settings_uuid_index_update (&uuid_index, b, FALSE));
+	g_assert (nm_settings_uuid_index_lookup (&uuid_index, UUID_B) == b);
+
+	/* removing the owner hands the UUID to the duplicate */
+	g_assert (!nm_settings_uuid_index_update (&uuid_index, a, TRUE));
+	g_assert (nm_settings_uuid_index_lookup (&uuid_index, UUID_A) == c);
+	g_assert (!nm_settings_uuid_index_update (&uuid_index, c, TRUE));
+	g_assert (!nm_settings_uuid_index_lookup (&uuid_index, UUID_A));
+
+	/* removing a connection that is not indexed is fine */
+	g_assert (!nm_settings_uuid_index_update (&uuid_index, c, TRUE));
+	g_assert (nm_settings_uuid_index_lookup (&uuid_index, UUID_B) == b);
+
+	nm_settings_uuid_index_clear (&uuid_index);
+
+	g_object_unref (a);
+	g_object_unref (b);
+	g_object_unref (c);
+}
+
+static guint64
+get_test_timestamp (NMConnection *connection)
+{
+	return GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (connection), "timestamp"));
+}
+
+static void
+set_test_timestamp (NMSettingsAutoconnectList *list, NMConnection *connection, guint timestamp)
+{
+	g_object_set_data (G_OBJECT (connection), "timestamp", GUINT_TO_POINTER (timestamp));
+	nm_settings_autoconnect_list_update (list, connection, FALSE);
+}
+
+static void
+set_test_autoconnect (NMSettingsAutoconnectList *list, NMConnection *connection,
+                      gboolean autoconnect, int priority)
+{
+	g_object_set (nm_connection_get_setting_connection (connection),
+	              NM_SETTING_CONNECTION_AUTOCONNECT, autoconnect,
+	              NM_SETTING_CONNECTION_AUTOCONNECT_PRIORITY, priority,
+	              NULL);
+	nm_settings_autoconnect_list_update (list, connection, FALSE);
+}
+
+static void
+assert_order (NMSettingsAutoconnectList *list, ...)
+{
+	GSList *connections, *iter;
+	NMConnection *expected;
+	va_list ap;
+
+	connections = nm_settings_autoconnect_list_get_all (list);
+	va_start (ap, list);
+	for (iter = connections; iter; iter = iter->next) {
+		expected = va_arg (ap, NMConnection *);
+		g_assert (iter->data == expected);
+	}
+	g_assert (va_arg (ap, NMConnection *) == NULL);
+	va_end (ap);
+	g_slist_free (connections);
+}
+
+static void
+test_autoconnect_list (void)
+{
+	NMSettingsAutoconnectList list;
+	NMConnection *a, *b, *c, *d;
+
+	a = nmtst_create_minimal_connection ("a", UUID_A, NM_SETTING_WIRED_SETTING_NAME, NULL);
+	b = nmtst_create_minimal_connection ("b", UUID_B, NM_SETTING_WIRED_SETTING_NAME, NULL);
+	c = nmtst_create_minimal_connection ("c", UUID_C, NM_SETTING_WIRED_SETTING_NAME, NULL);
+	d = nmtst_create_minimal_connection ("d", UUID_D, NM_SETTING_WIRED_SETTING_NAME, NULL);
+
+	nm_settings_autoconnect_list_init (&list, get_test_timestamp);
+
+	/* Most recently used first */
+	set_test_timestamp (&list, a, 100);
+	set_test_timestamp (&list, b, 300);
+	set_test_timestamp (&list, c, 200);
+	assert_order (&list, b, c, a, NULL);
+
+	/* A timestamp change moves the connection */
+	set_test_timestamp (&list, a, 400);
+	assert_order (&list, a, b, c, NULL);
+
+	/* Priority goes before the timestamp */
+	set_test_autoconnect (&list, c, TRUE, 10);
+	assert_order (&list, c, a, b, NULL);
+	set_test_timestamp (&list, b, 500);
+	assert_order (&list, c, b, a, NULL);
+
+	/* Connections that don't autoconnect go last, whatever their
+	 * priority, ordered by timestamp */
+	set_test_timestamp (&list, d, 50);
+	set_test_autoconnect (&list, d, FALSE, 20);
+	set_test_autoconnect (&list, c, FALSE, 10);
+	assert_order (&list, b, a, c, d, NULL);
+
+	/* And back */
+	set_test_autoconnect (&list, c, TRUE, 0);
+	assert_order (&list, b, a, c, d, NULL);
+	set_test_autoconnect (&list, c, TRUE, -5);
+	assert_order (&list, b, a, c, d, NULL);
+	set_test_autoconnect (&list, a, TRUE, -10);
+	assert_order (&list, b, c, a, d, NULL);
+
+	/* Removal */
+	nm_settings_autoconnect_list_update (&list, b, TRUE);
+	nm_settings_autoconnect_list_update (&list, b, TRUE);
+	assert_order (&list, c, a, d, NULL);
+
+	nm_settings_autoconnect_list_clear (&list);
+
+	g_object_unref (a);
+	g_object_unref (b);
+	g_object_unref (c);
+	g_object_unref (d);
+}
+
+/*******************************************/
+
+/* The BSSIDs of @uuid in the database file on disk, or -1 if there is
+ * no such entry */
+static int
+count_on_disk (const char *filename, const char *uuid)
+{
+	GKeyFile *keyfile;
+	char **list;
+	gsize len = 0;
+	int n = -1;
+
+	keyfile = g_key_file_new ();
+	g_key_file_set_list_separator (keyfile, ',');
+	g_assert (g_key_file_load_from_file (keyfile, filename, G_KEY_FILE_NONE, NULL));
+	list = g_key_file_get_string_list (keyfile, "seen-bssids", uuid, &len, NULL);
+	if (list)
+		n = len;
+	g_strfreev (list);
+	g_key_file_free (keyfile);
+	return n;
+}
+
+static gboolean
+timeout_cb (gpointer user_data)
+{
+	*((gboolean *) user_data) = TRUE;
+	return G_SOURCE_REMOVE;
+}
+
+static void
+test_state_db (void)
+{
+	char *dir, *filename;
+	NMSettingsStateDB db = {
+		.group = "seen-bssids",
+		.list_separator = ',',
+		.flush_delay = 1,
+	};
+	const char *bssids[] = { "00:11:22:33:44:55", "66:77:88:99:AA:BB" };
+	gboolean timed_out = FALSE;
+	char **list;
+	gsize len;
+	guint id;
+
+	dir = g_dir_make_tmp ("test-settings-utils-XXXXXX", NULL);
+	g_assert (dir);
+	filename = g_build_filename (dir, "seen-bssids", NULL);
+	db.filename = filename;
+
+	/* A missing file is an empty database */
+	g_assert (!g_key_file_has_group (nm_settings_state_db_get (&db), db.group));
+
+	/* Changes stay in memory until flushed, as on shutdown */
+	g_key_file_set_string_list (nm_settings_state_db_get (&db), db.group, UUID_A, bssids, 2);
+	nm_settings_state_db_changed (&db);
+	g_assert (!g_file_test (filename, G_FILE_TEST_EXISTS));
+
+	nm_settings_state_db_flush (&db);
+	g_assert (!db.flush_id);
+	g_assert_cmpint (count_on_disk (filename, UUID_A), ==, 2);
+
+	/* Nothing to write without changes */
+	g_unlink (filename);
+	nm_settings_state_db_flush (&db);
+	g_assert (!g_file_test (filename, G_FILE_TEST_EXISTS));
+
+	/* Changes are written back by themselves after the delay */
+	g_key_file_set_string_list (nm_settings_state_db_get (&db), db.group, UUID_B, bssids, 1);
+	nm_settings_state_db_changed (&db);
+	g_key_file_remove_key (nm_settings_state_db_get (&db), db.group, UUID_A, NULL);
+	nm_settings_state_db_changed (&db);
+
+	id = g_timeout_add_seconds (5, timeout_cb, &timed_out);
+	while (!g_file_test (filename, G_FILE_TEST_EXISTS)) {
+		g_assert (!timed_out);
+		g_main_context_iteration (NULL, TRUE);
+	}
+	g_source_remove (id);
+	g_assert (!db.flush_id);
+	g_assert_cmpint (count_on_disk (filename, UUID_A), ==, -1);
+	g_assert_cmpint (count_on_disk (filename, UUID_B), ==, 1);
+
+	/* What was written is read back */
+	nm_settings_state_db_clear (&db);
+	g_assert (!db.keyfile);
+	list = g_key_file_get_string_list (nm_settings_state_db_get (&db), db.group, UUID_B, &len, NULL);
+	g_assert_cmpint (len, ==, 1);
+	g_assert_cmpstr (list[0], ==, bssids[0]);
+	g_strfreev (list);
+	nm_settings_state_db_clear (&db);
+
+	g_unlink (filename);
+	g_rmdir (dir);
+	g_free (filename);
+	g_free (dir);
+}
+
+/*******************************************/
+
+NMTST_DEFINE ();
+
+int
+main (int argc, char **argv)
+{
+	nmtst_init_assert_logging (&argc, &argv, "INFO", "DEFAULT");
+
+	g_test_add_func ("/settings/uuid-index", test_uuid_index);
+	g_test_add_func ("/settings/autoconnect-list", test_autoconnect_list);
+	g_test_add_func ("/settings/state-db", test_state_db);
+
+	return g_test_run ();
+}
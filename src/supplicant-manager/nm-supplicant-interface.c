@@ -39,6 +39,8 @@
 #define WPAS_ERROR_INVALID_IFACE    WPAS_DBUS_INTERFACE ".InvalidInterface"
 #define WPAS_ERROR_EXISTS_ERROR     WPAS_DBUS_INTERFACE ".InterfaceExists"
 
+#define DBUS_INTERFACE_PROPERTIES   "org.freedesktop.DBus.Properties"
+
 G_DEFINE_TYPE (NMSupplicantInterface, nm_supplicant_interface, G_TYPE_OBJECT)
 
 #define NM_SUPPLICANT_INTERFACE_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), \
@@ -91,7 +93,9 @@ typedef struct {
 	GCancellable * assoc_cancellable;
 	char *         net_path;
 	guint32        blobs_left;
-	GHashTable *   bss_proxies;
+	GHashTable *   bss_known;    /* BSS path -> BssState */
+	GDBusConnection *bss_connection;
+	guint          bss_props_changed_id;
 	char *         current_bss;
 
 	gint32         last_scan; /* timestamp as returned by nm_utils_get_monotonic_timestamp_s() */
@@ -113,89 +117,144 @@ emit_error_helper (NMSupplicantInterface *self, GError *error)
 	g_free (name);
 }
 
+/* BSSes are tracked without a GDBusProxy each.  Their properties come with
+ * the BSSAdded signal (or from a single GetAll call for BSSes that are only
+ * known from the BSSs property), and changes are received through a single
+ * PropertiesChanged subscription per interface instead of a match rule per
+ * BSS.
+ */
+typedef enum {
+	BSS_STATE_FETCHING = 1,  /* waiting for the GetAll reply */
+	BSS_STATE_KNOWN,         /* reported via NEW_BSS */
+} BssState;
+
+typedef struct {
+	NMSupplicantInterface *self;
+	char *path;
+} BssFetchData;
+
 static void
-bss_props_changed_cb (GDBusProxy *proxy,
-                      GVariant *changed_properties,
-                      char **invalidated_properties,
+bss_emit_new (NMSupplicantInterface *self, const char *object_path, GVariant *props)
+{
+	NMSupplicantInterfacePrivate *priv = NM_SUPPLICANT_INTERFACE_GET_PRIVATE (self);
+
+	g_hash_table_insert (priv->bss_known, g_strdup (object_path), GUINT_TO_POINTER (BSS_STATE_KNOWN));
+	g_signal_emit (self, signals[NEW_BSS], 0, object_path, props);
+}
+
+static void
+bss_props_changed_cb (GDBusConnection *connection,
+                      const char *sender_name,
+                      const char *object_path,
+                      const char *interface_name,
+                      const char *signal_name,
+                      GVariant *parameters,
                       gpointer user_data)
 {
 	NMSupplicantInterface *self = NM_SUPPLICANT_INTERFACE (user_data);
 	NMSupplicantInterfacePrivate *priv = NM_SUPPLICANT_INTERFACE_GET_PRIVATE (self);
+	gs_unref_variant GVariant *changed_properties = NULL;
+
+	/* The subscription matches the BSSes of all interfaces; changes to a
+	 * BSS that is still being fetched are part of the GetAll reply.
+	 */
+	if (GPOINTER_TO_UINT (g_hash_table_lookup (priv->bss_known, object_path)) != BSS_STATE_KNOWN)
+		return;
+
+	if (!g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(sa{sv}as)")))
+		return;
 
 	if (priv->scanning)
 		priv->last_scan = nm_utils_get_monotonic_timestamp_s ();
 
-	g_signal_emit (self, signals[BSS_UPDATED], 0,
-	               g_dbus_proxy_get_object_path (proxy),
-	               changed_properties);
+	g_variant_get (parameters, "(&s@a{sv}as)", NULL, &changed_properties, NULL);
+	g_signal_emit (self, signals[BSS_UPDATED], 0, object_path, changed_properties);
 }
 
 static void
-on_bss_proxy_acquired (GDBusProxy *proxy, GAsyncResult *result, gpointer user_data)
+bss_get_all_cb (GDBusConnection *connection, GAsyncResult *result, gpointer user_data)
 {
-	NMSupplicantInterface *self;
+	BssFetchData *data = user_data;
 	NMSupplicantInterfacePrivate *priv;
 	gs_free_error GError *error = NULL;
-	gs_strfreev char **properties = NULL;
+	gs_unref_variant GVariant *reply = NULL;
 	gs_unref_variant GVariant *props = NULL;
-	GVariantBuilder builder;
-	char **iter;
-
-	if (!g_async_initable_init_finish (G_ASYNC_INITABLE (proxy), result, &error)) {
-		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
-			nm_log_dbg (LOGD_SUPPLICANT, "Failed to acquire BSS proxy: (%s)", error->message);
-			g_hash_table_remove (NM_SUPPLICANT_INTERFACE_GET_PRIVATE (user_data)->bss_proxies,
-			                     g_dbus_proxy_get_object_path (proxy));
-		}
-		return;
-	}
 
-	self = NM_SUPPLICANT_INTERFACE (user_data);
-	priv = NM_SUPPLICANT_INTERFACE_GET_PRIVATE (self);
+	reply = g_dbus_connection_call_finish (connection, result, &error);
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		goto out;
 
-	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+	priv = NM_SUPPLICANT_INTERFACE_GET_PRIVATE (data->self);
 
-	iter = properties = g_dbus_proxy_get_cached_property_names (proxy);
-	while (iter && *iter) {
-		GVariant *copy = g_dbus_proxy_get_cached_property (proxy, *iter);
+	/* Skip BSSes that were removed or announced by BSSAdded meanwhile */
+	if (GPOINTER_TO_UINT (g_hash_table_lookup (priv->bss_known, data->path)) != BSS_STATE_FETCHING)
+		goto out;
 
-		g_variant_builder_add (&builder, "{sv}", *iter++, copy);
-		g_variant_unref (copy);
+	if (!reply) {
+		nm_log_dbg (LOGD_SUPPLICANT, "Failed to get BSS properties: (%s)", error->message);
+		g_hash_table_remove (priv->bss_known, data->path);
+		goto out;
 	}
 
-	props = g_variant_builder_end (&builder);
-	g_signal_emit (self, signals[NEW_BSS], 0,
-	               g_dbus_proxy_get_object_path (proxy),
-	               g_variant_ref_sink (props));
+	g_variant_get (reply, "(@a{sv})", &props);
+	bss_emit_new (data->self, data->path, props);
+
+out:
+	g_free (data->path);
+	g_slice_free (BssFetchData, data);
 }
 
 static void
-handle_new_bss (NMSupplicantInterface *self, const char *object_path)
+handle_new_bss (NMSupplicantInterface *self, const char *object_path, GVariant *props)
 {
 	NMSupplicantInterfacePrivate *priv = NM_SUPPLICANT_INTERFACE_GET_PRIVATE (self);
-	GDBusProxy *bss_proxy;
+	BssState state;
+	BssFetchData *data;
 
 	g_return_if_fail (object_path != NULL);
 
-	if (g_hash_table_lookup (priv->bss_proxies, object_path))
+	state = GPOINTER_TO_UINT (g_hash_table_lookup (priv->bss_known, object_path));
+	if (state == BSS_STATE_KNOWN)
 		return;
 
-	bss_proxy = g_object_new (G_TYPE_DBUS_PROXY,
-	                          "g-bus-type", G_BUS_TYPE_SYSTEM,
-	                          "g-flags", G_DBUS_PROXY_FLAGS_NONE,
-	                          "g-name", WPAS_DBUS_SERVICE,
-	                          "g-object-path", object_path,
-	                          "g-interface-name", WPAS_DBUS_IFACE_BSS,
-	                          NULL);
-	g_hash_table_insert (priv->bss_proxies,
-	                     (char *) g_dbus_proxy_get_object_path (bss_proxy),
-	                     bss_proxy);
-	g_signal_connect (bss_proxy, "g-properties-changed", G_CALLBACK (bss_props_changed_cb), self);
-	g_async_initable_init_async (G_ASYNC_INITABLE (bss_proxy),
-	                             G_PRIORITY_DEFAULT,
-	                             priv->other_cancellable,
-	                             (GAsyncReadyCallback) on_bss_proxy_acquired,
-	                             self);
+	/* BSSAdded carries all properties of the BSS */
+	if (props && g_variant_n_children (props)) {
+		bss_emit_new (self, object_path, props);
+		return;
+	}
+
+	if (state == BSS_STATE_FETCHING || !priv->bss_connection)
+		return;
+
+	g_hash_table_insert (priv->bss_known, g_strdup (object_path), GUINT_TO_POINTER (BSS_STATE_FETCHING));
+
+	data = g_slice_new (BssFetchData);
+	data->self = self;
+	data->path = g_strdup (object_path);
+	g_dbus_connection_call (priv->bss_connection,
+	                        WPAS_DBUS_SERVICE,
+	                        object_path,
+	                        DBUS_INTERFACE_PROPERTIES,
+	                        "GetAll",
+	                        g_variant_new ("(s)", WPAS_DBUS_IFACE_BSS),
+	                        G_VARIANT_TYPE ("(a{sv})"),
+	                        G_DBUS_CALL_FLAGS_NONE,
+	                        -1,
+	                        priv->other_cancellable,
+	                        (GAsyncReadyCallback) bss_get_all_cb,
+	                        data);
+}
+
+static void
+bss_tracking_stop (NMSupplicantInterface *self)
+{
+	NMSupplicantInterfacePrivate *priv = NM_SUPPLICANT_INTERFACE_GET_PRIVATE (self);
+
+	if (priv->bss_props_changed_id) {
+		g_dbus_connection_signal_unsubscribe (priv->bss_connection, priv->bss_props_changed_id);
+		priv->bss_props_changed_id = 0;
+	}
+	g_clear_object (&priv->bss_connection);
 }
 
 static void
@@ -234,6 +293,7 @@ set_state (NMSupplicantInterface *self, guint32 new_state)
 
 		if (priv->iface_proxy)
 			g_signal_handlers_disconnect_by_data (priv->iface_proxy, self);
+		bss_tracking_stop (self);
 	}
 
 	priv->state = new_state;
@@ -521,7 +581,7 @@ wpas_iface_bss_added (GDBusProxy *proxy,
 	if (priv->scanning)
 		priv->last_scan = nm_utils_get_monotonic_timestamp_s ();
 
-	handle_new_bss (self, path);
+	handle_new_bss (self, path, props);
 }
 
 static void
@@ -533,7 +593,7 @@ wpas_iface_bss_removed (GDBusProxy *proxy,
 	NMSupplicantInterfacePrivate *priv = NM_SUPPLICANT_INTERFACE_GET_PRIVATE (self);
 
 	g_signal_emit (self, signals[BSS_REMOVED], 0, path);
-	g_hash_table_remove (priv->bss_proxies, path);
+	g_hash_table_remove (priv->bss_known, path);
 }
 
 static void
@@ -581,7 +641,7 @@ props_changed_cb (GDBusProxy *proxy,
 	if (g_variant_lookup (changed_properties, "BSSs", "^a&s", &array)) {
 		iter = array;
 		while (*iter)
-			handle_new_bss (self, *iter++);
+			handle_new_bss (self, *iter++, NULL);
 		g_free (array);
 	}
 
@@ -645,6 +705,20 @@ on_iface_proxy_acquired (GDBusProxy *proxy, GAsyncResult *result, gpointer user_
 	_nm_dbus_signal_connect (priv->iface_proxy, "NetworkRequest", G_VARIANT_TYPE ("(oss)"),
 	                         G_CALLBACK (wpas_iface_network_request), self);
 
+	/* One match rule for the property changes of all BSSes */
+	priv->bss_connection = g_object_ref (g_dbus_proxy_get_connection (priv->iface_proxy));
+	priv->bss_props_changed_id =
+		g_dbus_connection_signal_subscribe (priv->bss_connection,
+		                                    WPAS_DBUS_SERVICE,
+		                                    DBUS_INTERFACE_PROPERTIES,
+		                                    "PropertiesChanged",
+		                                    NULL,
+		                                    WPAS_DBUS_IFACE_BSS,
+		                                    G_DBUS_SIGNAL_FLAGS_NONE,
+		                                    bss_props_changed_cb,
+		                                    self,
+		                                    NULL);
+
 	/* Scan result aging parameters */
 	g_dbus_proxy_call (priv->iface_proxy,
 	                   "org.freedesktop.DBus.Properties.Set",
@@ -1162,8 +1236,20 @@ scan_request_cb (GDBusProxy *proxy, GAsyncResult *result, gpointer user_data)
 	g_signal_emit (NM_SUPPLICANT_INTERFACE (user_data), signals[SCAN_DONE], 0, error ? FALSE : TRUE);
 }
 
+/**
+ * nm_supplicant_interface_request_scan:
+ * @self: the supplicant interface
+ * @ssids: (allow-none): SSIDs to probe for, ignored for passive scans
+ * @passive: whether to only listen for beacons instead of sending probes
+ * @freqs: (allow-none): frequencies in MHz to limit the scan to
+ *
+ * Returns: %TRUE if the scan request was sent
+ */
 gboolean
-nm_supplicant_interface_request_scan (NMSupplicantInterface *self, const GPtrArray *ssids)
+nm_supplicant_interface_request_scan (NMSupplicantInterface *self,
+                                      const GPtrArray *ssids,
+                                      gboolean passive,
+                                      const GArray *freqs)
 {
 	NMSupplicantInterfacePrivate *priv;
 	GVariantBuilder builder;
@@ -1175,8 +1261,8 @@ nm_supplicant_interface_request_scan (NMSupplicantInterface *self, const GPtrArr
 
 	/* Scan parameters */
 	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
-	g_variant_builder_add (&builder, "{sv}", "Type", g_variant_new_string ("active"));
-	if (ssids) {
+	g_variant_builder_add (&builder, "{sv}", "Type", g_variant_new_string (passive ? "passive" : "active"));
+	if (ssids && !passive) {
 		GVariantBuilder ssids_builder;
 
 		g_variant_builder_init (&ssids_builder, G_VARIANT_TYPE_BYTESTRING_ARRAY);
@@ -1188,6 +1274,15 @@ nm_supplicant_interface_request_scan (NMSupplicantInterface *self, const GPtrArr
 		}
 		g_variant_builder_add (&builder, "{sv}", "SSIDs", g_variant_builder_end (&ssids_builder));
 	}
+	if (freqs && freqs->len) {
+		GVariantBuilder freqs_builder;
+
+		/* (center frequency, width) pairs */
+		g_variant_builder_init (&freqs_builder, G_VARIANT_TYPE ("a(uu)"));
+		for (i = 0; i < freqs->len; i++)
+			g_variant_builder_add (&freqs_builder, "(uu)", g_array_index (freqs, guint32, i), 20);
+		g_variant_builder_add (&builder, "{sv}", "Channels", g_variant_builder_end (&freqs_builder));
+	}
 
 	g_dbus_proxy_call (priv->iface_proxy,
 	                   "Scan",
@@ -1312,7 +1407,7 @@ nm_supplicant_interface_init (NMSupplicantInterface * self)
 	NMSupplicantInterfacePrivate *priv = NM_SUPPLICANT_INTERFACE_GET_PRIVATE (self);
 
 	priv->state = NM_SUPPLICANT_INTERFACE_STATE_INIT;
-	priv->bss_proxies = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_object_unref);
+	priv->bss_known = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 }
 
 static void
@@ -1362,8 +1457,10 @@ dispose (GObject *object)
 		g_cancellable_cancel (priv->other_cancellable);
 	g_clear_object (&priv->other_cancellable);
 
+	bss_tracking_stop (NM_SUPPLICANT_INTERFACE (object));
+
 	g_clear_object (&priv->wpas_proxy);
-	g_clear_pointer (&priv->bss_proxies, (GDestroyNotify) g_hash_table_destroy);
+	g_clear_pointer (&priv->bss_known, (GDestroyNotify) g_hash_table_destroy);
 
 	g_clear_pointer (&priv->net_path, g_free);
 	g_clear_pointer (&priv->dev, g_free);
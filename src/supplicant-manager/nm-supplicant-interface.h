@@ -141,7 +141,10 @@ const char * nm_supplicant_interface_get_device (NMSupplicantInterface * iface);
 
 const char *nm_supplicant_interface_get_object_path (NMSupplicantInterface * iface);
 
-gboolean nm_supplicant_interface_request_scan (NMSupplicantInterface * self, const GPtrArray *ssids);
+gboolean nm_supplicant_interface_request_scan (NMSupplicantInterface * self,
+                                               const GPtrArray *ssids,
+                                               gboolean passive,
+                                               const GArray *freqs);
 
 guint32 nm_supplicant_interface_get_state (NMSupplicantInterface * self);
 
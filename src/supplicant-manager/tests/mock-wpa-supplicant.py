@@ -0,0 +1,143 @@
+#!/usr/bin/env python
+# -*- Mode: python; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+
+# Stands in for wpa_supplicant in test-supplicant-interface.  It has a
+# single interface.  A Scan() call reports two BSSes.  BSS 0 is announced
+# by BSSAdded with all of its properties.  BSS 1 only shows up in the BSSs
+# property of the interface, and that change is sent twice.  Each
+# Properties.GetAll call on a BSS is appended as a line to the file named by
+# NM_TEST_SUPPLICANT_LOG.
+
+from gi.repository import GLib
+import os
+import dbus
+import dbus.service
+import dbus.mainloop.glib
+
+WPAS_SERVICE = 'fi.w1.wpa_supplicant1'
+WPAS_PATH = '/fi/w1/wpa_supplicant1'
+IFACE_INTERFACE = WPAS_SERVICE + '.Interface'
+IFACE_BSS = WPAS_SERVICE + '.BSS'
+IFACE_PROPS = 'org.freedesktop.DBus.Properties'
+
+INTERFACE_PATH = WPAS_PATH + '/Interfaces/0'
+
+def log(line):
+    with open(os.environ['NM_TEST_SUPPLICANT_LOG'], 'a') as f:
+        f.write(line + '\n')
+
+def bss_path(n):
+    return dbus.ObjectPath(INTERFACE_PATH + '/BSSs/%d' % n)
+
+def bss_props(n):
+    return dbus.Dictionary({
+        'BSSID': dbus.ByteArray(b'\x00\x11\x22\x33\x44' + bytes(bytearray([n]))),
+        'SSID': dbus.ByteArray(('test-%d' % n).encode('ascii')),
+        'Frequency': dbus.UInt16(2412 + 5 * n),
+        'Signal': dbus.Int16(-40 - n),
+        'Mode': dbus.String('infrastructure'),
+    }, signature='sv')
+
+class Bss(dbus.service.Object):
+    def __init__(self, bus, n):
+        self.n = n
+        self.path = bss_path(n)
+        dbus.service.Object.__init__(self, bus, self.path)
+
+    @dbus.service.method(dbus_interface=IFACE_PROPS, in_signature='s', out_signature='a{sv}')
+    def GetAll(self, iface):
+        log('GetAll ' + self.path)
+        return bss_props(self.n)
+
+    @dbus.service.signal(dbus_interface=IFACE_PROPS, signature='sa{sv}as')
+    def PropertiesChanged(self, iface, changed, invalidated):
+        pass
+
+class Interface(dbus.service.Object):
+    def __init__(self, bus):
+        self.bus = bus
+        self.bsses = []
+        self.props = {
+            'State': dbus.String('inactive'),
+            'Scanning': dbus.Boolean(False),
+            'BSSs': dbus.Array([], signature='o'),
+        }
+        dbus.service.Object.__init__(self, bus, INTERFACE_PATH)
+
+    @dbus.service.method(dbus_interface=IFACE_PROPS, in_signature='s', out_signature='a{sv}')
+    def GetAll(self, iface):
+        return dbus.Dictionary(self.props, signature='sv')
+
+    @dbus.service.method(dbus_interface=IFACE_PROPS, in_signature='ss', out_signature='v')
+    def Get(self, iface, name):
+        return self.props[name]
+
+    @dbus.service.method(dbus_interface=IFACE_PROPS, in_signature='ssv', out_signature='')
+    def Set(self, iface, name, value):
+        pass
+
+    @dbus.service.signal(dbus_interface=IFACE_PROPS, signature='sa{sv}as')
+    def PropertiesChanged(self, iface, changed, invalidated):
+        pass
+
+    @dbus.service.method(dbus_interface=IFACE_INTERFACE, in_signature='oss', out_signature='')
+    def NetworkReply(self, path, field, value):
+        pass
+
+    @dbus.service.method(dbus_interface=IFACE_INTERFACE, in_signature='a{sv}', out_signature='')
+    def Scan(self, args):
+        GLib.idle_add(self.report_bsses)
+
+    @dbus.service.signal(dbus_interface=IFACE_INTERFACE, signature='oa{sv}')
+    def BSSAdded(self, path, props):
+        pass
+
+    @dbus.service.signal(dbus_interface=IFACE_INTERFACE, signature='b')
+    def ScanDone(self, success):
+        pass
+
+    def report_bsses(self):
+        if not self.bsses:
+            self.bsses = [Bss(self.bus, 0), Bss(self.bus, 1)]
+
+        self.BSSAdded(bss_path(0), bss_props(0))
+
+        self.props['BSSs'] = dbus.Array([bss_path(0), bss_path(1)], signature='o')
+        changed = dbus.Dictionary({'BSSs': self.props['BSSs']}, signature='sv')
+        self.PropertiesChanged(IFACE_INTERFACE, changed, dbus.Array([], signature='s'))
+        self.PropertiesChanged(IFACE_INTERFACE, changed, dbus.Array([], signature='s'))
+
+        self.ScanDone(True)
+
+        self.bsses[0].PropertiesChanged(IFACE_BSS,
+                                        dbus.Dictionary({'Signal': dbus.Int16(-50)}, signature='sv'),
+                                        dbus.Array([], signature='s'))
+        return False
+
+class Supplicant(dbus.service.Object):
+    def __init__(self, bus):
+        self.interface = Interface(bus)
+        dbus.service.Object.__init__(self, bus, WPAS_PATH)
+
+    @dbus.service.method(dbus_interface=WPAS_SERVICE, in_signature='a{sv}', out_signature='o')
+    def CreateInterface(self, args):
+        return dbus.ObjectPath(INTERFACE_PATH)
+
+    @dbus.service.method(dbus_interface=WPAS_SERVICE, in_signature='s', out_signature='o')
+    def GetInterface(self, ifname):
+        return dbus.ObjectPath(INTERFACE_PATH)
+
+def main():
+    dbus.mainloop.glib.DBusGMainLoop(set_as_default=True)
+    bus = dbus.SystemBus()
+    obj = Supplicant(bus)
+    if not bus.request_name(WPAS_SERVICE):
+        raise SystemExit(1)
+
+    # Runs until it is killed; but don't stick around if the test crashed
+    mainloop = GLib.MainLoop()
+    GLib.timeout_add_seconds(20, mainloop.quit)
+    mainloop.run()
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,188 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2015 Red Hat, Inc.
+ *
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <signal.h>
+
+#include "nm-supplicant-interface.h"
+#include "nm-supplicant-types.h"
+
+#include "nm-test-utils.h"
+
+/* The D-Bus interaction is tested against mock-wpa-supplicant.py, which
+ * takes wpa_supplicant's place on a private bus (see Makefile.am). */
+
+#define BSS0_PATH "/fi/w1/wpa_supplicant1/Interfaces/0/BSSs/0"
+#define BSS1_PATH "/fi/w1/wpa_supplicant1/Interfaces/0/BSSs/1"
+
+typedef struct {
+	NMTstMockLog ml;
+	GPid pid;
+	NMSupplicantInterface *iface;
+	gboolean ready;
+
+	guint new_bss[2];
+	guint bss_updated[2];
+	guint16 frequency[2];
+	guint scan_done;
+} Fixture;
+
+static int
+bss_index (const char *object_path)
+{
+	if (!strcmp (object_path, BSS0_PATH))
+		return 0;
+	if (!strcmp (object_path, BSS1_PATH))
+		return 1;
+	g_assert_not_reached ();
+	return -1;
+}
+
+static void
+state_cb (NMSupplicantInterface *iface, guint32 new_state, guint32 old_state, int disconnect_reason, gpointer user_data)
+{
+	if (new_state >= NM_SUPPLICANT_INTERFACE_STATE_READY)
+		((Fixture *) user_data)->ready = TRUE;
+}
+
+static void
+new_bss_cb (NMSupplicantInterface *iface, const char *object_path, GVariant *props, gpointer user_data)
+{
+	Fixture *f = user_data;
+	int i = bss_index (object_path);
+
+	f->new_bss[i]++;
+	g_assert (g_variant_lookup (props, "Frequency", "q", &f->frequency[i]));
+}
+
+static void
+bss_updated_cb (NMSupplicantInterface *iface, const char *object_path, GVariant *props, gpointer user_data)
+{
+	Fixture *f = user_data;
+
+	f->bss_updated[bss_index (object_path)]++;
+}
+
+static void
+scan_done_cb (NMSupplicantInterface *iface, gboolean success, gpointer user_data)
+{
+	((Fixture *) user_data)->scan_done++;
+}
+
+static void
+name_appeared_cb (GDBusConnection *connection, const char *name, const char *name_owner, gpointer user_data)
+{
+	*((gboolean *) user_data) = TRUE;
+}
+
+static void
+fixture_setup (Fixture *f)
+{
+	char *argv[] = { TEST_MOCK_SUPPLICANT, NULL };
+	gboolean appeared = FALSE;
+	GError *error = NULL;
+	guint watch_id;
+
+	nmtst_mock_log_init (&f->ml, "NM_TEST_SUPPLICANT_LOG");
+
+	watch_id = g_bus_watch_name (G_BUS_TYPE_SYSTEM, WPAS_DBUS_SERVICE, G_BUS_NAME_WATCHER_FLAGS_NONE,
+	                             name_appeared_cb, NULL, &appeared, NULL);
+	g_assert (g_spawn_async (NULL, argv, NULL, G_SPAWN_DO_NOT_REAP_CHILD, NULL, NULL, &f->pid, &error));
+	g_assert_no_error (error);
+	nmtst_main_context_wait_for_flag (&appeared, "the mock supplicant");
+	g_bus_unwatch_name (watch_id);
+
+	f->iface = nm_supplicant_interface_new ("wlan0", TRUE, FALSE, AP_SUPPORT_YES, TRUE);
+	g_signal_connect (f->iface, NM_SUPPLICANT_INTERFACE_STATE, G_CALLBACK (state_cb), f);
+	g_signal_connect (f->iface, NM_SUPPLICANT_INTERFACE_NEW_BSS, G_CALLBACK (new_bss_cb), f);
+	g_signal_connect (f->iface, NM_SUPPLICANT_INTERFACE_BSS_UPDATED, G_CALLBACK (bss_updated_cb), f);
+	g_signal_connect (f->iface, NM_SUPPLICANT_INTERFACE_SCAN_DONE, G_CALLBACK (scan_done_cb), f);
+
+	nmtst_main_context_wait_for_flag (&f->ready, "the interface to become ready");
+}
+
+static void
+fixture_teardown (Fixture *f)
+{
+	g_object_unref (f->iface);
+
+	kill (f->pid, SIGTERM);
+	g_spawn_close_pid (f->pid);
+
+	nmtst_mock_log_clear (&f->ml);
+}
+
+static gboolean
+scan_results_received (gpointer user_data)
+{
+	Fixture *f = user_data;
+
+	return f->new_bss[0] && f->new_bss[1] && f->bss_updated[0] && f->scan_done;
+}
+
+/*******************************************/
+
+static void
+test_bss_properties (void)
+{
+	Fixture f = { 0 };
+
+	fixture_setup (&f);
+
+	g_assert (nm_supplicant_interface_request_scan (f.iface, NULL, FALSE, NULL));
+
+	nmtst_main_context_wait_for (scan_results_received, &f, "the scan results");
+
+	/* BSS 0 came with its properties in BSSAdded and is never fetched */
+	g_assert_cmpint (f.new_bss[0], ==, 1);
+	g_assert_cmpint (f.frequency[0], ==, 2412);
+	g_assert_cmpint (nmtst_mock_log_count (&f.ml, "GetAll " BSS0_PATH), ==, 0);
+
+	/* BSS 1 was listed twice in the BSSs property but fetched only once */
+	g_assert_cmpint (f.new_bss[1], ==, 1);
+	g_assert_cmpint (f.frequency[1], ==, 2417);
+	g_assert_cmpint (nmtst_mock_log_count (&f.ml, "GetAll " BSS1_PATH), ==, 1);
+
+	/* Changes of a known BSS are passed on */
+	g_assert_cmpint (f.bss_updated[0], ==, 1);
+	g_assert_cmpint (f.bss_updated[1], ==, 0);
+
+	fixture_teardown (&f);
+}
+
+/*******************************************/
+
+NMTST_DEFINE ();
+
+int
+main (int argc, char **argv)
+{
+	nmtst_init_with_logging (&argc, &argv, "ERR", "ALL");
+
+	/* The interface talks to wpa_supplicant on the system bus */
+	if (g_getenv ("DBUS_SESSION_BUS_ADDRESS"))
+		g_setenv ("DBUS_SYSTEM_BUS_ADDRESS", g_getenv ("DBUS_SESSION_BUS_ADDRESS"), TRUE);
+
+	g_test_add_func ("/supplicant/interface/bss-properties", test_bss_properties);
+
+	return g_test_run ();
+}
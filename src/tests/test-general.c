@@ -483,6 +483,51 @@ test_connection_match_cloned_mac (void)
 	g_object_unref (exact);
 }
 
+static void
+test_connection_match_fingerprint (void)
+{
+	NMConnection *orig, *fuzzy, *slave;
+	NMSettingConnection *s_con;
+	NMSettingWired *s_wired;
+	char *fp_orig, *fp_fuzzy, *fp_slave;
+
+	orig = _match_connection_new ();
+
+	/* Properties that check_possible_match() tolerates must not change
+	 * the fingerprint... */
+	fuzzy = nm_simple_connection_new_clone (orig);
+	s_wired = nm_connection_get_setting_wired (fuzzy);
+	g_assert (s_wired);
+	g_object_set (G_OBJECT (s_wired),
+	              NM_SETTING_WIRED_MAC_ADDRESS, "52:54:00:ab:db:23",
+	              NULL);
+	s_con = nm_connection_get_setting_connection (fuzzy);
+	g_object_set (G_OBJECT (s_con),
+	              NM_SETTING_CONNECTION_INTERFACE_NAME, "eth0",
+	              NULL);
+
+	/* ...while the others must. */
+	slave = nm_simple_connection_new_clone (orig);
+	s_con = nm_connection_get_setting_connection (slave);
+	g_object_set (G_OBJECT (s_con),
+	              NM_SETTING_CONNECTION_MASTER, "bond0",
+	              NM_SETTING_CONNECTION_SLAVE_TYPE, NM_SETTING_BOND_SETTING_NAME,
+	              NULL);
+
+	fp_orig = nm_utils_connection_get_fingerprint (orig);
+	fp_fuzzy = nm_utils_connection_get_fingerprint (fuzzy);
+	fp_slave = nm_utils_connection_get_fingerprint (slave);
+	g_assert_cmpstr (fp_orig, ==, fp_fuzzy);
+	g_assert_cmpstr (fp_orig, !=, fp_slave);
+
+	g_free (fp_orig);
+	g_free (fp_fuzzy);
+	g_free (fp_slave);
+	g_object_unref (orig);
+	g_object_unref (fuzzy);
+	g_object_unref (slave);
+}
+
 static void
 test_connection_no_match_ip4_addr (void)
 {
@@ -642,6 +687,228 @@ test_connection_sort_autoconnect_priority (void)
 
 /*******************************************/
 
+#define SET_NUM_CONNECTIONS 20
+
+typedef struct {
+	gboolean carrier;
+	/* like a device below DISCONNECTED, which is unavailable without carrier */
+	gboolean device_needs_carrier;
+} SetTestData;
+
+static gboolean
+_set_test_requires_carrier (NMConnection *connection, gpointer user_data)
+{
+	return !!g_object_get_data (G_OBJECT (connection), "requires-carrier");
+}
+
+static gboolean
+_set_test_available (NMConnection *connection, gpointer user_data)
+{
+	SetTestData *data = user_data;
+
+	if (!g_object_get_data (G_OBJECT (connection), "compatible"))
+		return FALSE;
+	if (data->carrier)
+		return TRUE;
+	return !data->device_needs_carrier && !_set_test_requires_carrier (connection, NULL);
+}
+
+static GHashTable *
+_set_test_new (void)
+{
+	return g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, NULL);
+}
+
+/* The expected set, filtered from @connections without the code under test */
+static GHashTable *
+_set_test_expected (const GSList *connections, SetTestData *data)
+{
+	GHashTable *expected = _set_test_new ();
+	const GSList *iter;
+
+	for (iter = connections; iter; iter = iter->next) {
+		if (_set_test_available (iter->data, data))
+			g_hash_table_add (expected, g_object_ref (iter->data));
+	}
+	return expected;
+}
+
+static gboolean
+_set_test_equal (GHashTable *a, GHashTable *b)
+{
+	GHashTableIter iter;
+	gpointer connection;
+
+	if (g_hash_table_size (a) != g_hash_table_size (b))
+		return FALSE;
+	g_hash_table_iter_init (&iter, a);
+	while (g_hash_table_iter_next (&iter, &connection, NULL)) {
+		if (!g_hash_table_contains (b, connection))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static void
+test_connection_set_update (void)
+{
+	NMConnection *all[SET_NUM_CONNECTIONS];
+	GSList *provided = NULL;
+	GHashTable *set, *before, *expected;
+	SetTestData data = { .carrier = TRUE };
+	GRand *r = nmtst_get_rand ();
+	GHashTableIter iter;
+	gpointer connection;
+	gboolean changed;
+	int i, j;
+
+	for (i = 0; i < SET_NUM_CONNECTIONS; i++) {
+		char *id = g_strdup_printf ("set-%d", i);
+
+		all[i] = nmtst_create_minimal_connection (id, NULL, NM_SETTING_WIRED_SETTING_NAME, NULL);
+		g_object_set_data (G_OBJECT (all[i]), "requires-carrier", GINT_TO_POINTER (g_rand_boolean (r)));
+		g_object_set_data (G_OBJECT (all[i]), "compatible", GINT_TO_POINTER (g_rand_int_range (r, 0, 4) != 0));
+		provided = g_slist_prepend (provided, all[i]);
+		g_free (id);
+	}
+
+	set = _set_test_new ();
+	g_assert (nm_utils_connection_set_update (set, provided, TRUE, NULL, _set_test_available, &data));
+	expected = _set_test_expected (provided, &data);
+	g_assert (_set_test_equal (set, expected));
+	g_hash_table_unref (expected);
+
+	/* Rechecking without any change does not change anything */
+	g_assert (!nm_utils_connection_set_update (set, provided, TRUE, NULL, _set_test_available, &data));
+
+	for (i = 0; i < 500; i++) {
+		NMConnection *c = all[g_rand_int_range (r, 0, SET_NUM_CONNECTIONS)];
+
+		before = _set_test_new ();
+		g_hash_table_iter_init (&iter, set);
+		while (g_hash_table_iter_next (&iter, &connection, NULL))
+			g_hash_table_add (before, g_object_ref (connection));
+
+		/* Apply one change the way NMDevice does incrementally */
+		switch (g_rand_int_range (r, 0, 4)) {
+		case 0:
+			/* carrier changed */
+			data.carrier = !data.carrier;
+			changed = nm_utils_connection_set_carrier_changed (set, provided,
+			                                                   data.device_needs_carrier,
+			                                                   _set_test_requires_carrier,
+			                                                   _set_test_available, &data);
+			break;
+		case 1:
+			/* device state changed: full recheck */
+			data.device_needs_carrier = !data.device_needs_carrier;
+			changed = nm_utils_connection_set_update (set, provided, TRUE, NULL,
+			                                          _set_test_available, &data);
+			break;
+		case 2:
+			/* connection updated */
+			g_object_set_data (G_OBJECT (c), "compatible",
+			                   GINT_TO_POINTER (!g_object_get_data (G_OBJECT (c), "compatible")));
+			changed = nm_utils_connection_set_recheck (set, c, _set_test_available, &data);
+			break;
+		default:
+			if (g_slist_find (provided, c)) {
+				/* connection removed */
+				provided = g_slist_remove (provided, c);
+				changed = g_hash_table_remove (set, c);
+			} else {
+				/* connection added */
+				provided = g_slist_prepend (provided, c);
+				changed = nm_utils_connection_set_recheck (set, c, _set_test_available, &data);
+			}
+			break;
+		}
+
+		/* ...and compare with the expected set */
+		expected = _set_test_expected (provided, &data);
+		g_assert (_set_test_equal (set, expected));
+		g_assert_cmpint (changed, ==, !_set_test_equal (set, before));
+
+		/* A full recheck of an up-to-date set finds nothing to do */
+		g_assert (!nm_utils_connection_set_update (set, provided, TRUE, NULL, _set_test_available, &data));
+
+		g_hash_table_unref (expected);
+		g_hash_table_unref (before);
+	}
+
+	/* A full recheck drops connections that are gone */
+	for (j = 0; j < SET_NUM_CONNECTIONS; j++) {
+		if (!g_slist_find (provided, all[j]))
+			g_hash_table_add (set, g_object_ref (all[j]));
+	}
+	nm_utils_connection_set_update (set, provided, TRUE, NULL, _set_test_available, &data);
+	expected = _set_test_expected (provided, &data);
+	g_assert (_set_test_equal (set, expected));
+	g_hash_table_unref (expected);
+
+	g_hash_table_unref (set);
+	g_slist_free (provided);
+	for (i = 0; i < SET_NUM_CONNECTIONS; i++)
+		g_object_unref (all[i]);
+}
+
+static void
+test_connection_set_carrier_changed (void)
+{
+	NMConnection *wired, *other;
+	GSList *provided = NULL;
+	GHashTable *set;
+	SetTestData data = { .carrier = TRUE };
+
+	wired = nmtst_create_minimal_connection ("wired", NULL, NM_SETTING_WIRED_SETTING_NAME, NULL);
+	g_object_set_data (G_OBJECT (wired), "requires-carrier", GINT_TO_POINTER (TRUE));
+	g_object_set_data (G_OBJECT (wired), "compatible", GINT_TO_POINTER (TRUE));
+	other = nmtst_create_minimal_connection ("other", NULL, NM_SETTING_WIRED_SETTING_NAME, NULL);
+	g_object_set_data (G_OBJECT (other), "compatible", GINT_TO_POINTER (TRUE));
+	provided = g_slist_prepend (provided, wired);
+	provided = g_slist_prepend (provided, other);
+
+	set = _set_test_new ();
+	g_assert (nm_utils_connection_set_update (set, provided, TRUE, NULL, _set_test_available, &data));
+	g_assert_cmpint (g_hash_table_size (set), ==, 2);
+
+	/* An activated device: only connections requiring a carrier are affected */
+	data.carrier = FALSE;
+	g_assert (nm_utils_connection_set_carrier_changed (set, provided, FALSE, _set_test_requires_carrier,
+	                                                   _set_test_available, &data));
+	g_assert_cmpint (g_hash_table_size (set), ==, 1);
+	g_assert (g_hash_table_contains (set, other));
+
+	data.carrier = TRUE;
+	g_assert (nm_utils_connection_set_carrier_changed (set, provided, FALSE, _set_test_requires_carrier,
+	                                                   _set_test_available, &data));
+	g_assert_cmpint (g_hash_table_size (set), ==, 2);
+
+	/* Below DISCONNECTED the device needs the carrier, and every connection
+	 * is re-evaluated, also those not requiring a carrier themselves */
+	data.device_needs_carrier = TRUE;
+	data.carrier = FALSE;
+	g_assert (nm_utils_connection_set_carrier_changed (set, provided, TRUE, _set_test_requires_carrier,
+	                                                   _set_test_available, &data));
+	g_assert_cmpint (g_hash_table_size (set), ==, 0);
+
+	data.carrier = TRUE;
+	g_assert (nm_utils_connection_set_carrier_changed (set, provided, TRUE, _set_test_requires_carrier,
+	                                                   _set_test_available, &data));
+	g_assert_cmpint (g_hash_table_size (set), ==, 2);
+
+	/* Nothing changed */
+	g_assert (!nm_utils_connection_set_carrier_changed (set, provided, TRUE, _set_test_requires_carrier,
+	                                                    _set_test_available, &data));
+
+	g_hash_table_unref (set);
+	g_slist_free (provided);
+	g_object_unref (wired);
+	g_object_unref (other);
+}
+
+/*******************************************/
+
 static const char *_test_match_spec_all[] = {
 	"e",
 	"em",
@@ -773,9 +1040,13 @@ main (int argc, char **argv)
 	g_test_add_func ("/general/connection-match/wired", test_connection_match_wired);
 	g_test_add_func ("/general/connection-match/cloned_mac", test_connection_match_cloned_mac);
 	g_test_add_func ("/general/connection-match/no-match-ip4-addr", test_connection_no_match_ip4_addr);
+	g_test_add_func ("/general/connection-match/fingerprint", test_connection_match_fingerprint);
 
 	g_test_add_func ("/general/connection-sort/autoconnect-priority", test_connection_sort_autoconnect_priority);
 
+	g_test_add_func ("/general/connection-set/update", test_connection_set_update);
+	g_test_add_func ("/general/connection-set/carrier-changed", test_connection_set_carrier_changed);
+
 	g_test_add_func ("/general/nm_match_spec_interface_name", test_nm_match_spec_interface_name);
 
 	return g_test_run ();
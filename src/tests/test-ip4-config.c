@@ -339,6 +339,76 @@ test_merge_subtract_mss_mtu (void)
 	g_object_unref (cfg3);
 }
 
+static void
+test_add_many_routes (void)
+{
+	NMIP4Config *a, *b;
+	NMPlatformIP4Route route;
+	guint32 network;
+	guint i;
+
+	a = nm_ip4_config_new (1);
+	b = nm_ip4_config_new (1);
+
+	for (i = 0; i < 1000; i++) {
+		memset (&route, 0, sizeof (route));
+		network = htonl (0x0a000000 + (i << 8));
+		route.network = network;
+		route.plen = 24;
+		nm_ip4_config_add_route (a, &route);
+		nm_ip4_config_add_route (b, &route);
+	}
+	g_assert_cmpuint (nm_ip4_config_get_num_routes (a), ==, 1000);
+	g_assert (nm_ip4_config_equal (a, b));
+
+	/* Adding the same routes again only updates them */
+	for (i = 0; i < 1000; i++) {
+		route = *nm_ip4_config_get_route (a, i);
+		route.metric = 10;
+		nm_ip4_config_add_route (a, &route);
+	}
+	g_assert_cmpuint (nm_ip4_config_get_num_routes (a), ==, 1000);
+	g_assert_cmpuint (nm_ip4_config_get_route (a, 999)->metric, ==, 10);
+	g_assert (!nm_ip4_config_equal (a, b));
+
+	/* Deleting shifts the remaining routes; they must still be found */
+	nm_ip4_config_del_route (a, 0);
+	route = *nm_ip4_config_get_route (a, 998);
+	route.metric = 20;
+	nm_ip4_config_add_route (a, &route);
+	g_assert_cmpuint (nm_ip4_config_get_num_routes (a), ==, 999);
+	g_assert_cmpuint (nm_ip4_config_get_route (a, 998)->metric, ==, 20);
+
+	g_object_unref (a);
+	g_object_unref (b);
+}
+
+static void
+test_equal_domains (void)
+{
+	NMIP4Config *a, *b;
+
+	a = nm_ip4_config_new (1);
+	b = nm_ip4_config_new (1);
+
+	/* Attributes are compared item by item, not as one byte stream */
+	nm_ip4_config_add_domain (a, "ab");
+	nm_ip4_config_add_domain (a, "c");
+	nm_ip4_config_add_domain (b, "a");
+	nm_ip4_config_add_domain (b, "bc");
+	g_assert (!nm_ip4_config_equal (a, b));
+	g_assert (!nm_ip4_config_equal (a, NULL));
+	g_assert (nm_ip4_config_equal (NULL, NULL));
+	g_object_unref (a);
+	g_object_unref (b);
+
+	/* Even an empty config differs from no config at all */
+	a = nm_ip4_config_new (1);
+	g_assert (!nm_ip4_config_equal (a, NULL));
+	g_assert (!nm_ip4_config_equal (NULL, a));
+	g_object_unref (a);
+}
+
 /*******************************************/
 
 NMTST_DEFINE ();
@@ -353,6 +423,8 @@ main (int argc, char **argv)
 	g_test_add_func ("/ip4-config/add-address-with-source", test_add_address_with_source);
 	g_test_add_func ("/ip4-config/add-route-with-source", test_add_route_with_source);
 	g_test_add_func ("/ip4-config/merge-subtract-mss-mtu", test_merge_subtract_mss_mtu);
+	g_test_add_func ("/ip4-config/add-many-routes", test_add_many_routes);
+	g_test_add_func ("/ip4-config/equal-domains", test_equal_domains);
 
 	return g_test_run ();
 }
@@ -321,6 +321,77 @@ test_nm_ip6_config_addresses_sort (void)
 	g_object_unref (config);
 }
 
+static void
+test_add_many_routes (void)
+{
+	NMIP6Config *a, *b;
+	NMPlatformIP6Route route;
+	guint i;
+
+	a = nm_ip6_config_new (1);
+	b = nm_ip6_config_new (1);
+
+	for (i = 0; i < 1000; i++) {
+		memset (&route, 0, sizeof (route));
+		route.network.s6_addr[0] = 0x20;
+		route.network.s6_addr[1] = 0x01;
+		route.network.s6_addr[6] = i >> 8;
+		route.network.s6_addr[7] = i & 0xff;
+		route.plen = 64;
+		nm_ip6_config_add_route (a, &route);
+		nm_ip6_config_add_route (b, &route);
+	}
+	g_assert_cmpuint (nm_ip6_config_get_num_routes (a), ==, 1000);
+	g_assert (nm_ip6_config_equal (a, b));
+
+	/* Adding the same routes again only updates them */
+	for (i = 0; i < 1000; i++) {
+		route = *nm_ip6_config_get_route (a, i);
+		route.metric = 10;
+		nm_ip6_config_add_route (a, &route);
+	}
+	g_assert_cmpuint (nm_ip6_config_get_num_routes (a), ==, 1000);
+	g_assert_cmpuint (nm_ip6_config_get_route (a, 999)->metric, ==, 10);
+	g_assert (!nm_ip6_config_equal (a, b));
+
+	/* Deleting shifts the remaining routes; they must still be found */
+	nm_ip6_config_del_route (a, 0);
+	route = *nm_ip6_config_get_route (a, 998);
+	route.metric = 20;
+	nm_ip6_config_add_route (a, &route);
+	g_assert_cmpuint (nm_ip6_config_get_num_routes (a), ==, 999);
+	g_assert_cmpuint (nm_ip6_config_get_route (a, 998)->metric, ==, 20);
+
+	g_object_unref (a);
+	g_object_unref (b);
+}
+
+static void
+test_equal_domains (void)
+{
+	NMIP6Config *a, *b;
+
+	a = nm_ip6_config_new (1);
+	b = nm_ip6_config_new (1);
+
+	/* Attributes are compared item by item, not as one byte stream */
+	nm_ip6_config_add_domain (a, "ab");
+	nm_ip6_config_add_domain (a, "c");
+	nm_ip6_config_add_domain (b, "a");
+	nm_ip6_config_add_domain (b, "bc");
+	g_assert (!nm_ip6_config_equal (a, b));
+	g_assert (!nm_ip6_config_equal (a, NULL));
+	g_assert (nm_ip6_config_equal (NULL, NULL));
+	g_object_unref (a);
+	g_object_unref (b);
+
+	/* Even an empty config differs from no config at all */
+	a = nm_ip6_config_new (1);
+	g_assert (!nm_ip6_config_equal (a, NULL));
+	g_assert (!nm_ip6_config_equal (NULL, a));
+	g_object_unref (a);
+}
+
 /*******************************************/
 
 NMTST_DEFINE();
@@ -335,6 +406,8 @@ main (int argc, char **argv)
 	g_test_add_func ("/ip6-config/add-address-with-source", test_add_address_with_source);
 	g_test_add_func ("/ip6-config/add-route-with-source", test_add_route_with_source);
 	g_test_add_func ("/ip6-config/test_nm_ip6_config_addresses_sort", test_nm_ip6_config_addresses_sort);
+	g_test_add_func ("/ip6-config/add-many-routes", test_add_many_routes);
+	g_test_add_func ("/ip6-config/equal-domains", test_equal_domains);
 
 	return g_test_run ();
 }
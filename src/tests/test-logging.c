@@ -0,0 +1,150 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2015 Red Hat, Inc.
+ *
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <errno.h>
+
+#include "nm-logging.h"
+
+#include "nm-test-utils.h"
+
+#define BEGIN_DUMP "--- begin of buffered debug log ---"
+#define END_DUMP   "--- end of buffered debug log ---"
+
+/* Everything written with g_log(), which the logging code uses as long as
+ * syslog is not opened. */
+static GPtrArray *written;
+
+static void
+log_handler (const char *log_domain, GLogLevelFlags level, const char *message, gpointer user_data)
+{
+	g_ptr_array_add (written, g_strdup (message));
+}
+
+#define S(...) ((const char *[]) { __VA_ARGS__, NULL } )
+
+/* Checks that exactly the messages in @expected (NULL-terminated) were
+ * written since the last call, in this order. */
+static void
+assert_written (const char *const *expected)
+{
+	guint i;
+
+	for (i = 0; expected[i]; i++) {
+		g_assert_cmpint (i, <, written->len);
+		if (!g_str_has_suffix (written->pdata[i], expected[i]))
+			g_error ("message %u is \"%s\", expected it to end in \"%s\"",
+			         i, (char *) written->pdata[i], expected[i]);
+	}
+	g_assert_cmpint (i, ==, written->len);
+
+	g_ptr_array_set_size (written, 0);
+}
+
+static void
+log_numbered (guint from, guint to)
+{
+	guint i;
+
+	for (i = from; i < to; i++)
+		nm_log_dbg (LOGD_CORE, "message %u", i);
+}
+
+/*******************************************/
+
+static void
+test_buffer_order (void)
+{
+	nm_logging_set_buffer (3);
+
+	/* Debug messages are held back, others are written right away */
+	log_numbered (0, 2);
+	nm_log_info (LOGD_CORE, "info");
+	assert_written (S ("info"));
+
+	/* A buffer that is not full yet */
+	nm_logging_buffer_dump ();
+	assert_written (S (BEGIN_DUMP, ": message 0", ": message 1", END_DUMP));
+
+	/* The dump empties it */
+	nm_logging_buffer_dump ();
+	g_assert_cmpint (written->len, ==, 0);
+
+	/* Exactly full */
+	log_numbered (2, 5);
+	nm_logging_buffer_dump ();
+	assert_written (S (BEGIN_DUMP, ": message 2", ": message 3", ": message 4", END_DUMP));
+
+	/* Wrapped around, only the newest ones are kept */
+	log_numbered (5, 13);
+	nm_logging_buffer_dump ();
+	assert_written (S (BEGIN_DUMP, ": message 10", ": message 11", ": message 12", END_DUMP));
+
+	/* Pending messages are written when buffering is turned off */
+	log_numbered (13, 15);
+	nm_logging_set_buffer (0);
+	assert_written (S (BEGIN_DUMP, ": message 13", ": message 14", END_DUMP));
+
+	log_numbered (15, 16);
+	assert_written (S (": message 15"));
+}
+
+static void
+test_buffer_errno (void)
+{
+	char *expected_enoent, *expected_eexist;
+
+	nm_logging_set_buffer (2);
+
+	/* %m is formatted when the message is buffered, not when it is dumped */
+	_nm_log (LOGL_DEBUG, LOGD_CORE, ENOENT, "error: %m");
+	errno = EEXIST;
+	nm_log_dbg (LOGD_CORE, "errno: %m");
+	errno = 0;
+	nm_logging_buffer_dump ();
+
+	expected_enoent = g_strdup_printf (": error: %s", g_strerror (ENOENT));
+	expected_eexist = g_strdup_printf (": errno: %s", g_strerror (EEXIST));
+	assert_written (S (BEGIN_DUMP, expected_enoent, expected_eexist, END_DUMP));
+	g_free (expected_enoent);
+	g_free (expected_eexist);
+
+	nm_logging_set_buffer (0);
+}
+
+/*******************************************/
+
+NMTST_DEFINE ();
+
+int
+main (int argc, char **argv)
+{
+	nmtst_init_with_logging (&argc, &argv, "DEBUG", "ALL");
+
+	written = g_ptr_array_new_with_free_func (g_free);
+	g_log_set_handler (G_LOG_DOMAIN, G_LOG_LEVEL_MASK, log_handler, NULL);
+
+	g_test_add_func ("/logging/buffer/order", test_buffer_order);
+	g_test_add_func ("/logging/buffer/errno", test_buffer_errno);
+
+	return g_test_run ();
+}
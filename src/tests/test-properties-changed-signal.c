@@ -0,0 +1,307 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2015 Red Hat, Inc.
+ *
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <string.h>
+
+#include "nm-properties-changed-signal.h"
+
+#include "nm-test-utils.h"
+
+#define STRENGTH_INTERVAL_MS 200
+
+/*******************************************/
+
+#define TEST_TYPE_OBJECT (test_object_get_type ())
+
+typedef struct {
+	GObject parent;
+	int foo;
+	int bar;
+	int strength;
+} TestObject;
+
+typedef struct {
+	GObjectClass parent;
+} TestObjectClass;
+
+enum {
+	PROP_0,
+	PROP_FOO,
+	PROP_BAR,
+	PROP_STRENGTH,
+};
+
+GType test_object_get_type (void);
+
+G_DEFINE_TYPE (TestObject, test_object, G_TYPE_OBJECT)
+
+static void
+test_object_init (TestObject *self)
+{
+}
+
+static void
+set_property (GObject *object, guint prop_id,
+              const GValue *value, GParamSpec *pspec)
+{
+	TestObject *self = (TestObject *) object;
+
+	switch (prop_id) {
+	case PROP_FOO:
+		self->foo = g_value_get_int (value);
+		break;
+	case PROP_BAR:
+		self->bar = g_value_get_int (value);
+		break;
+	case PROP_STRENGTH:
+		self->strength = g_value_get_int (value);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+get_property (GObject *object, guint prop_id,
+              GValue *value, GParamSpec *pspec)
+{
+	TestObject *self = (TestObject *) object;
+
+	switch (prop_id) {
+	case PROP_FOO:
+		g_value_set_int (value, self->foo);
+		break;
+	case PROP_BAR:
+		g_value_set_int (value, self->bar);
+		break;
+	case PROP_STRENGTH:
+		g_value_set_int (value, self->strength);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+test_object_class_init (TestObjectClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->set_property = set_property;
+	object_class->get_property = get_property;
+
+	g_object_class_install_property
+		(object_class, PROP_FOO,
+		 g_param_spec_int ("foo", "", "", 0, G_MAXINT, 0, G_PARAM_READWRITE));
+	g_object_class_install_property
+		(object_class, PROP_BAR,
+		 g_param_spec_int ("bar", "", "", 0, G_MAXINT, 0, G_PARAM_READWRITE));
+	g_object_class_install_property
+		(object_class, PROP_STRENGTH,
+		 g_param_spec_int ("strength", "", "", 0, G_MAXINT, 0, G_PARAM_READWRITE));
+
+	nm_properties_changed_signal_add_property (TEST_TYPE_OBJECT, "Foo", "foo");
+	nm_properties_changed_signal_add_property (TEST_TYPE_OBJECT, "Bar", "bar");
+	nm_properties_changed_signal_add_property (TEST_TYPE_OBJECT, "Strength", "strength");
+	nm_properties_changed_signal_set_min_interval (TEST_TYPE_OBJECT, "strength", STRENGTH_INTERVAL_MS);
+}
+
+/*******************************************/
+
+/* What the last PropertiesChanged signal of an object carried; -1 for
+ * properties that were not part of it. */
+typedef struct {
+	guint n_signals;
+	guint n_props;
+	int foo;
+	int bar;
+	int strength;
+} Emission;
+
+static int
+emitted_int (GHashTable *props, const char *name)
+{
+	GValue *value = g_hash_table_lookup (props, name);
+
+	return value ? g_value_get_int (value) : -1;
+}
+
+static void
+properties_changed_cb (GObject *object, GHashTable *props, gpointer user_data)
+{
+	Emission *e = user_data;
+
+	e->n_signals++;
+	e->n_props = g_hash_table_size (props);
+	e->foo = emitted_int (props, "Foo");
+	e->bar = emitted_int (props, "Bar");
+	e->strength = emitted_int (props, "Strength");
+}
+
+static GObject *
+new_object (Emission *e)
+{
+	GObject *object = g_object_new (TEST_TYPE_OBJECT, NULL);
+
+	memset (e, 0, sizeof (*e));
+	g_signal_connect (object, "properties-changed", G_CALLBACK (properties_changed_cb), e);
+	return object;
+}
+
+static void
+drain (void)
+{
+	while (g_main_context_iteration (NULL, FALSE))
+		;
+}
+
+static gboolean
+timeout_cb (gpointer user_data)
+{
+	*((gboolean *) user_data) = TRUE;
+	return G_SOURCE_REMOVE;
+}
+
+static void
+wait_for_signals (Emission *e, guint n_signals)
+{
+	gboolean timed_out = FALSE;
+	guint id;
+
+	id = g_timeout_add_seconds (5, timeout_cb, &timed_out);
+	while (e->n_signals < n_signals) {
+		if (timed_out)
+			g_error ("timed out waiting for PropertiesChanged");
+		g_main_context_iteration (NULL, TRUE);
+	}
+	g_source_remove (id);
+}
+
+/*******************************************/
+
+static void
+test_coalesce (void)
+{
+	Emission e1, e2;
+	GObject *o1 = new_object (&e1);
+	GObject *o2 = new_object (&e2);
+	guint64 sent0, coalesced0, sent, coalesced;
+
+	nm_properties_changed_signal_get_stats (&sent0, &coalesced0);
+
+	g_object_set (o1, "foo", 1, NULL);
+	g_object_set (o1, "foo", 2, NULL);
+	g_object_set (o1, "bar", 3, NULL);
+	g_object_set (o2, "foo", 4, NULL);
+	g_object_set (o1, "bar", 5, NULL);
+
+	/* Nothing is sent before returning to the main loop... */
+	g_assert_cmpint (e1.n_signals, ==, 0);
+	g_assert_cmpint (e2.n_signals, ==, 0);
+
+	/* ...then each object sends one signal with the latest values */
+	drain ();
+	g_assert_cmpint (e1.n_signals, ==, 1);
+	g_assert_cmpint (e1.n_props, ==, 2);
+	g_assert_cmpint (e1.foo, ==, 2);
+	g_assert_cmpint (e1.bar, ==, 5);
+	g_assert_cmpint (e2.n_signals, ==, 1);
+	g_assert_cmpint (e2.n_props, ==, 1);
+	g_assert_cmpint (e2.foo, ==, 4);
+
+	/* Both repeated changes of o1 were merged into the pending ones */
+	nm_properties_changed_signal_get_stats (&sent, &coalesced);
+	g_assert_cmpint (sent - sent0, ==, 2);
+	g_assert_cmpint (coalesced - coalesced0, ==, 2);
+
+	/* Later changes make a new signal with only what changed since */
+	g_object_set (o2, "bar", 6, NULL);
+	drain ();
+	g_assert_cmpint (e1.n_signals, ==, 1);
+	g_assert_cmpint (e2.n_signals, ==, 2);
+	g_assert_cmpint (e2.n_props, ==, 1);
+	g_assert_cmpint (e2.foo, ==, -1);
+	g_assert_cmpint (e2.bar, ==, 6);
+
+	nm_properties_changed_signal_get_stats (&sent, &coalesced);
+	g_assert_cmpint (sent - sent0, ==, 3);
+	g_assert_cmpint (coalesced - coalesced0, ==, 2);
+
+	/* Pending changes of a destroyed object are dropped */
+	g_object_set (o1, "foo", 7, NULL);
+	g_object_unref (o1);
+	drain ();
+	g_assert_cmpint (e1.n_signals, ==, 1);
+
+	g_object_unref (o2);
+}
+
+static void
+test_min_interval (void)
+{
+	Emission e;
+	GObject *o = new_object (&e);
+
+	/* The first change of a rate-limited property is not delayed */
+	g_object_set (o, "strength", 1, NULL);
+	drain ();
+	g_assert_cmpint (e.n_signals, ==, 1);
+	g_assert_cmpint (e.strength, ==, 1);
+
+	/* Within the interval it is held back, other properties are not */
+	g_object_set (o, "strength", 2, NULL);
+	g_object_set (o, "foo", 3, NULL);
+	g_object_set (o, "strength", 4, NULL);
+	drain ();
+	g_assert_cmpint (e.n_signals, ==, 2);
+	g_assert_cmpint (e.n_props, ==, 1);
+	g_assert_cmpint (e.foo, ==, 3);
+	g_assert_cmpint (e.strength, ==, -1);
+
+	/* Once the interval passed, only the latest value is sent */
+	wait_for_signals (&e, 3);
+	g_assert_cmpint (e.n_props, ==, 1);
+	g_assert_cmpint (e.strength, ==, 4);
+
+	drain ();
+	g_assert_cmpint (e.n_signals, ==, 3);
+
+	g_object_unref (o);
+}
+
+/*******************************************/
+
+NMTST_DEFINE ();
+
+int
+main (int argc, char **argv)
+{
+	nmtst_init_with_logging (&argc, &argv, NULL, "ALL");
+
+	g_test_add_func ("/properties-changed/coalesce", test_coalesce);
+	g_test_add_func ("/properties-changed/min-interval", test_min_interval);
+
+	return g_test_run ();
+}
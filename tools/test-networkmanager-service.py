@@ -82,12 +82,24 @@ def to_path(src):
         return dbus.ObjectPath(src.path)
     return dbus.ObjectPath("/")
 
+# Number of calls per method, so that tests can check which calls libnm makes
+call_counts = { 'GetManagedObjects': 0, 'GetAll': 0 }
+
+# All objects that GetManagedObjects reports
+exported_objs = []
+
 class ExportedObj(dbus.service.Object):
     def __init__(self, bus, object_path):
         dbus.service.Object.__init__(self, bus, object_path)
         self._bus = bus
         self.path = object_path
         self.__dbus_ifaces = {}
+        exported_objs.append(self)
+
+    def remove_from_connection(self, *args, **kwargs):
+        if self in exported_objs:
+            exported_objs.remove(self)
+        dbus.service.Object.remove_from_connection(self, *args, **kwargs)
 
     def add_dbus_interface(self, dbus_iface, get_props_func):
         self.__dbus_ifaces[dbus_iface] = get_props_func
@@ -95,8 +107,15 @@ class ExportedObj(dbus.service.Object):
     def _get_dbus_properties(self, iface):
         return self.__dbus_ifaces[iface]()
 
+    def get_managed_ifaces(self):
+        ifaces = {}
+        for iface in self.__dbus_ifaces:
+            ifaces[iface] = self.__dbus_ifaces[iface]()
+        return ifaces
+
     @dbus.service.method(dbus_interface=dbus.PROPERTIES_IFACE, in_signature='s', out_signature='a{sv}')
     def GetAll(self, iface):
+        call_counts['GetAll'] += 1
         if iface not in self.__dbus_ifaces.keys():
             raise UnknownInterfaceException()
         return self._get_dbus_properties(iface)
@@ -907,6 +926,17 @@ class NetworkManager(ExportedObj):
     def AutoRemoveNextConnection(self):
         settings.auto_remove_next_connection()
 
+    @dbus.service.method(IFACE_TEST, in_signature='b', out_signature='')
+    def SetObjectManagerDenied(self, denied):
+        object_manager.denied = denied
+
+    @dbus.service.method(IFACE_TEST, in_signature='', out_signature='a{su}')
+    def GetCallCounts(self):
+        counts = dbus.Dictionary({}, signature='su')
+        for method in call_counts:
+            counts[method] = dbus.UInt32(call_counts[method])
+        return counts
+
 ###################################################################
 IFACE_CONNECTION = 'org.freedesktop.NetworkManager.Settings.Connection'
 
@@ -945,6 +975,7 @@ class Connection(dbus.service.Object):
     # Properties interface
     @dbus.service.method(dbus_interface=dbus.PROPERTIES_IFACE, in_signature='s', out_signature='a{sv}')
     def GetAll(self, iface):
+        call_counts['GetAll'] += 1
         if iface != IFACE_CONNECTION:
             raise UnknownInterfaceException()
         return self.props
@@ -992,6 +1023,7 @@ class InvalidHostnameException(dbus.DBusException):
 class Settings(dbus.service.Object):
     def __init__(self, bus, object_path):
         dbus.service.Object.__init__(self, bus, object_path)
+        self.path = object_path
         self.connections = {}
         self.bus = bus
         self.counter = 1
@@ -1041,6 +1073,7 @@ class Settings(dbus.service.Object):
 
     @dbus.service.method(dbus_interface=dbus.PROPERTIES_IFACE, in_signature='s', out_signature='a{sv}')
     def GetAll(self, iface):
+        call_counts['GetAll'] += 1
         if iface != IFACE_SETTINGS:
             raise UnknownInterfaceException()
         return self.props
@@ -1124,6 +1157,32 @@ class AgentManager(dbus.service.Object):
                 continue
         return secrets
 
+###################################################################
+IFACE_OBJECT_MANAGER = 'org.freedesktop.DBus.ObjectManager'
+
+class AccessDeniedException(dbus.DBusException):
+    _dbus_error_name = IFACE_DBUS + '.Error.AccessDenied'
+
+class ObjectManager(dbus.service.Object):
+    def __init__(self, bus, object_path):
+        dbus.service.Object.__init__(self, bus, object_path)
+        # Mimics a bus policy that does not allow the call
+        self.denied = False
+
+    @dbus.service.method(dbus_interface=IFACE_OBJECT_MANAGER, in_signature='', out_signature='a{oa{sa{sv}}}')
+    def GetManagedObjects(self):
+        call_counts['GetManagedObjects'] += 1
+        if self.denied:
+            raise AccessDeniedException("Rejected send message")
+
+        objects = {}
+        for obj in exported_objs:
+            objects[dbus.ObjectPath(obj.path)] = obj.get_managed_ifaces()
+        objects[dbus.ObjectPath(settings.path)] = { IFACE_SETTINGS: settings.props }
+        for path in settings.connections:
+            objects[dbus.ObjectPath(path)] = { IFACE_CONNECTION: settings.connections[path].props }
+        return objects
+
 ###################################################################
 
 def stdin_cb(io, condition):
@@ -1139,7 +1198,8 @@ def main():
 
     bus = dbus.SessionBus()
 
-    global manager, settings, agent_manager
+    global manager, settings, agent_manager, object_manager
+    object_manager = ObjectManager(bus, "/org/freedesktop")
     manager = NetworkManager(bus, "/org/freedesktop/NetworkManager")
     settings = Settings(bus, "/org/freedesktop/NetworkManager/Settings")
     agent_manager = AgentManager(bus, "/org/freedesktop/NetworkManager/AgentManager")